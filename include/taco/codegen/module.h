@@ -9,20 +9,32 @@
 
 #include "taco/target.h"
 #include "taco/ir/ir.h"
+#include "taco/util/uncopyable.h"
+
+struct taco_runtime_t;
 
 namespace taco {
+class ExecutionContext;
+
 namespace ir {
 
-class Module {
+/// Modules unload their library when destroyed, so they can't be copied.
+class Module : private util::Uncopyable {
 public:
   /// Create a module for some target
   Module(Target target=getTargetFromEnvironment())
-    : lib_handle(nullptr), moduleFromUserSource(false), target(target) {
+    : lib_handle(nullptr), jit_handle(nullptr), moduleFromUserSource(false),
+      target(target) {
     setJITLibname();
     setJITTmpdir();
   }
 
-  /// Compile the source into a library, returning its full path
+  /// Unload the module's library, if it has been compiled or loaded
+  ~Module();
+
+  /// Compile the source into a library, returning its full path.  If the
+  /// target compiles in-process, no library file is written and an empty
+  /// path is returned.
   std::string compile();
   
   /// Compile the module into a source file located at the specified location
@@ -45,33 +57,85 @@ public:
   /// returned.
   void* getFuncPtr(std::string name);
 
-  /// Call a raw function in this module and return the result
-  int callFuncPackedRaw(std::string name, void** args);
+  /// Call a raw function in this module and return the result.  The
+  /// function runs with the threads and schedule of the context, or with the
+  /// ones set through taco if the context is null.
+  int callFuncPackedRaw(std::string name, void** args,
+                        const ExecutionContext* context=nullptr);
   
   /// Call a raw function in this module and return the result
-  int callFuncPackedRaw(std::string name, std::vector<void*> args) {
-    return callFuncPackedRaw(name, args.data());
+  int callFuncPackedRaw(std::string name, std::vector<void*> args,
+                        const ExecutionContext* context=nullptr) {
+    return callFuncPackedRaw(name, args.data(), context);
   }
   
-  /// Call a function using the taco_tensor_t interface and return the result
-  int callFuncPacked(std::string name, void** args) {
-    return callFuncPackedRaw("_shim_"+name, args);
+  /// Call a function using the taco_tensor_t interface and return the result.
+  /// If the module runs parallel loops on the task runtime, the last argument
+  /// must be the runtime returned by getRuntime for the context.
+  int callFuncPacked(std::string name, void** args,
+                     const ExecutionContext* context=nullptr) {
+    return callFuncPackedRaw("_shim_"+name, args, context);
   }
   
-  /// Call a function using the taco_tensor_t interface and return the result
-  int callFuncPacked(std::string name, std::vector<void*> args) {
-    return callFuncPacked(name, args.data());
+  /// Call a function using the taco_tensor_t interface and return the result.
+  /// The task runtime is passed to the function if the module uses it.
+  int callFuncPacked(std::string name, std::vector<void*> args,
+                     const ExecutionContext* context=nullptr) {
+    if (getRuntime(context) != nullptr) {
+      args.push_back(getRuntime(context));
+    }
+    return callFuncPacked(name, args.data(), context);
   }
   
+  /// A function using the taco_tensor_t interface
+  typedef int (*PackedFunc)(void**);
+
+  /// Get a function using the taco_tensor_t interface, to call it repeatedly
+  /// without looking it up by name.  Returns nullptr if there's no function of
+  /// this name.  The function is valid while the module is.
+  PackedFunc getPackedFunc(std::string name);
+
+  /// Call a function returned by getPackedFunc.  Like callFuncPacked, the
+  /// OpenMP schedule and number of threads set through taco, or of the
+  /// context, are applied for the call, but only the ones that differ from
+  /// the calling thread's are set and restored.
+  static int callPackedFunc(PackedFunc func, void** args,
+                            const ExecutionContext* context=nullptr);
+
+  /// Returns the task runtime that the functions of this module run their
+  /// parallel loops on, or nullptr if the module's target runs them with
+  /// OpenMP.  This is the runtime of the context, or a runtime with as many
+  /// workers as the number of threads set through taco if it is null.
+  taco_runtime_t* getRuntime(const ExecutionContext* context=nullptr) const;
+
+  /// Returns the target of the module.
+  const Target& getTarget() const {
+    return target;
+  }
+
   /// Set the source of the module
   void setSource(std::string source);
+
+  /// Set the key that identifies this module in the on-disk kernel cache. The
+  /// key must capture everything the generated code depends on (e.g. a
+  /// canonical form of the lowered statements); the target, compiler and
+  /// compiler flags are added to it by the module.  Modules with a key are
+  /// published to the cache when compiled.
+  void setCacheKey(std::string key);
+
+  /// Load the library for this module's cache key from the on-disk kernel
+  /// cache, which skips code generation and compilation altogether.  Returns
+  /// true on a cache hit.
+  bool loadFromCache();
   
 private:
   std::stringstream source;
   std::stringstream header;
   std::string libname;
   std::string tmpdir;
+  std::string cacheKey;
   void* lib_handle;
+  void* jit_handle;
   std::vector<Stmt> funcs;
   
   // true iff the module was created from user-provided source
@@ -81,6 +145,10 @@ private:
   
   void setJITLibname();
   void setJITTmpdir();
+  std::string getFullCacheKey();
+  void generateSource();
+  bool compileInProcess();
+  void installResultAllocator();
 
   static std::string chars;
   static std::default_random_engine gen;
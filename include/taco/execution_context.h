@@ -0,0 +1,84 @@
+#ifndef TACO_EXECUTION_CONTEXT_H
+#define TACO_EXECUTION_CONTEXT_H
+
+#include <memory>
+#include <vector>
+
+struct taco_runtime_t;
+
+namespace taco {
+class ResultAllocator;
+
+enum class ParallelSchedule {
+  Static, Dynamic
+};
+
+/// The resources that calls of compiled kernels run with: the number of
+/// threads, the parallel schedule, the cpus the threads are bound to and the
+/// allocator of workspaces.  Kernels called with a context don't read or
+/// change the process-wide settings (taco_set_num_threads and
+/// taco_set_parallel_schedule), so calls with different contexts can run
+/// concurrently without interfering, e.g. to give the requests of a server
+/// different shares of the machine.
+///
+/// Copies of a context refer to the same context.  Kernels compiled for the
+/// task runtime (see Target::TaskRuntime) run on a runtime that is owned by
+/// the context, whose threads are bound to the cpus and which passes the
+/// scratch allocator and chunk size to the kernels.  With OpenMP, the number
+/// of threads and the schedule are set on the calling thread for the call,
+/// which OpenMP keeps per thread, and the threads of parallel regions are
+/// bound to the cpus once and stay bound across calls (see setAffinity);
+/// workspaces are allocated with malloc.
+class ExecutionContext {
+public:
+  /// Create a context with taco's current number of threads and parallel
+  /// schedule, that doesn't bind threads to cpus and allocates workspaces
+  /// with malloc.
+  ExecutionContext();
+
+  /// Set the number of threads that kernels run parallel loops with.
+  void setNumThreads(int numThreads);
+
+  /// Returns the number of threads that kernels run parallel loops with.
+  int getNumThreads() const;
+
+  /// Set the schedule of parallel loops.  On the task runtime, the chunk size
+  /// is the grain of loops split by the runtime, and the kind of schedule is
+  /// ignored since workers steal chunks as they run out of work.
+  void setParallelSchedule(ParallelSchedule schedule, int chunkSize = 0);
+
+  /// Get the schedule of parallel loops.
+  void getParallelSchedule(ParallelSchedule* schedule, int* chunkSize) const;
+
+  /// Bind the threads that run kernels to the given cpus, or to no cpus in
+  /// particular if the list is empty.  Thread t of the parallel regions of
+  /// OpenMP kernels is bound to the t-th cpu, which matches the threads that
+  /// first touch arrays of a Placement with the same cpus.  These threads are
+  /// bound once and stay bound until a call with other cpus, so calls don't
+  /// pay for binding them.
+  void setAffinity(const std::vector<int>& cpus);
+
+  /// Returns the cpus that the threads that run kernels are bound to.
+  const std::vector<int>& getAffinity() const;
+
+  /// Set the allocator of the workspaces of kernels, or nullptr to allocate
+  /// them with malloc.  Any result allocator can be used, e.g. a ResultArena
+  /// to recycle the workspaces of earlier calls.
+  void setScratchAllocator(std::shared_ptr<ResultAllocator> allocator);
+
+  /// Returns the allocator of the workspaces of kernels.
+  std::shared_ptr<ResultAllocator> getScratchAllocator() const;
+
+  /// Returns the runtime struct that kernels compiled for the task runtime are
+  /// called with.  The runtime is started the first time it is requested and
+  /// restarted when the number of threads or the cpus change, which must not
+  /// happen while kernels run with the context.
+  taco_runtime_t* getRuntime() const;
+
+private:
+  struct Content;
+  std::shared_ptr<Content> content;
+};
+
+}
+#endif
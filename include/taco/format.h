@@ -67,6 +67,16 @@ public:
   /// Sets the types of the coordinate arrays for each level
   void setLevelArrayTypes(std::vector<std::vector<Datatype>> levelArrayTypes);
 
+  /// Gets the type of positions into the index arrays and values of tensors
+  /// with the format, which is Int64 if any index array has 64-bit entries
+  /// and Int32 otherwise.
+  Datatype getIndexType() const;
+
+  /// Sets the types of the index arrays of every level to Int32 or Int64.
+  /// Tensors with more than 2^31-1 stored components need Int64 indices,
+  /// while Int32 indices take half the memory and bandwidth.
+  void setIndexType(Datatype indexType);
+
 private:
   std::vector<ModeFormatPack> modeFormatPacks;
   std::vector<int> modeOrdering;
@@ -94,6 +104,12 @@ public:
   static ModeFormat Sparse;      /// alias for compressed
   static ModeFormat Singleton;   /// alias for singleton
 
+  /// Compressed mode whose coordinates are narrow offsets from block bases
+  static ModeFormat NarrowCompressed;
+
+  /// Hashed mode with 1024 buckets per segment
+  static ModeFormat Hashed;
+
   /// Properties of a mode format
   enum Property {
     FULL, NOT_FULL, ORDERED, NOT_ORDERED, UNIQUE, NOT_UNIQUE, BRANCHLESS,
@@ -151,6 +167,10 @@ public:
   /// type can be used to indicate a mode whose format is not (yet) known.
   bool defined() const;
 
+  /// Returns the implementation of the mode format, for reading the
+  /// parameters of mode formats that have them.
+  std::shared_ptr<const ModeFormatImpl> getImpl() const;
+
   friend bool operator==(const ModeFormat&, const ModeFormat&);
   friend bool operator!=(const ModeFormat&, const ModeFormat&);
   friend std::ostream& operator<<(std::ostream&, const ModeFormat&);
@@ -188,6 +208,8 @@ extern const ModeFormat Dense;
 extern const ModeFormat Compressed;
 extern const ModeFormat Sparse;
 extern const ModeFormat Singleton;
+extern const ModeFormat NarrowCompressed;
+extern const ModeFormat Hashed;
 
 extern const ModeFormat dense;
 extern const ModeFormat compressed;
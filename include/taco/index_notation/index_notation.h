@@ -640,7 +640,20 @@ public:
   /// assume that no data races will occur. For all other strategies other than Atomics,
   /// there is the precondition
   /// that the racing reduction must be over the index variable being parallelized.
-  IndexStmt parallelize(IndexVar i, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy) const;
+  ///
+  /// The load balance chooses how CPU threads share the loop.
+  /// LoadBalance::MergePath is for a loop over the rows of a dense level
+  /// with a compressed level directly below it, such as the rows of a CSR
+  /// matrix.  It partitions the rows together with their nonzeros into
+  /// equal shares of rows plus nonzeros, found by a merge-path search of
+  /// the compressed level's position array, so that a few long rows no
+  /// longer leave most threads idle.  A row split between threads is
+  /// accumulated into a per-thread carry that is added to the result after
+  /// the loop.  Loops that don't have this form, or whose results are not
+  /// dense vectors over the rows or dense tensors over the rows and
+  /// nonzeros, are partitioned by their iterations.
+  IndexStmt parallelize(IndexVar i, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy,
+                        LoadBalance load_balance = LoadBalance::Iterations) const;
 
   /// pos and coord create
   /// new index variables in their respective iteration spaces.
@@ -706,6 +719,16 @@ public:
   /// Preconditions: unrollFactor is a positive nonzero integer
   IndexStmt unroll(IndexVar i, size_t unrollFactor) const;
 
+  /// The mergeby primitive specifies how the loop over i coiterates the
+  /// tensors that it intersects.  MergeStrategy::Gallop skips ahead in each
+  /// iterator to the largest coordinate of the others with an exponential
+  /// search followed by a binary search, which is much faster than advancing
+  /// one coordinate at a time when one operand is far sparser than another.
+  /// Preconditions: the iterators that are intersected are ordered and
+  /// unique compressed levels.  Loops that don't intersect such iterators
+  /// keep the two-finger merge.
+  IndexStmt mergeby(IndexVar i, MergeStrategy strategy) const;
+
   /// The assemble primitive specifies whether a result tensor should be 
   /// assembled by appending or inserting nonzeros into the result tensor.
   /// In the latter case, the transformation inserts additional loops to 
@@ -727,6 +750,11 @@ bool isomorphic(IndexStmt, IndexStmt);
 /// Compare two index statments by value.
 bool equals(IndexStmt, IndexStmt);
 
+/// Returns a canonical textual form of an index statement, in which tensor and
+/// index variables are numbered in order of first occurrence.  Isomorphic
+/// statements have the same canonical form.
+std::string canonicalize(IndexStmt);
+
 /// Print the index statement.
 std::ostream& operator<<(std::ostream&, const IndexStmt&);
 
@@ -792,7 +820,7 @@ public:
   Forall() = default;
   Forall(const ForallNode*);
   Forall(IndexVar indexVar, IndexStmt stmt);
-  Forall(IndexVar indexVar, IndexStmt stmt, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy, size_t unrollFactor = 0);
+  Forall(IndexVar indexVar, IndexStmt stmt, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy, size_t unrollFactor = 0, MergeStrategy merge_strategy = MergeStrategy::TwoFinger, LoadBalance load_balance = LoadBalance::Iterations);
 
   IndexVar getIndexVar() const;
   IndexStmt getStmt() const;
@@ -802,12 +830,16 @@ public:
 
   size_t getUnrollFactor() const;
 
+  MergeStrategy getMergeStrategy() const;
+
+  LoadBalance getLoadBalance() const;
+
   typedef ForallNode Node;
 };
 
 /// Create a forall index statement.
 Forall forall(IndexVar i, IndexStmt stmt);
-Forall forall(IndexVar i, IndexStmt stmt, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy, size_t unrollFactor = 0);
+Forall forall(IndexVar i, IndexStmt stmt, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy, size_t unrollFactor = 0, MergeStrategy merge_strategy = MergeStrategy::TwoFinger, LoadBalance load_balance = LoadBalance::Iterations);
 
 
 /// A where statment has a producer statement that binds a tensor variable in
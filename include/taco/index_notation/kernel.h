@@ -9,6 +9,7 @@ namespace taco {
 class Function;
 class IndexStmt;
 class TensorStorage;
+class ExecutionContext;
 namespace ir {
 class Module;
 }
@@ -37,12 +38,25 @@ public:
   }
   /// @}
 
+  /// Evaluate the kernel with the threads, schedule and allocators of an
+  /// execution context.
+  /// @{
+  bool operator()(const ExecutionContext& context,
+                  const std::vector<TensorStorage>& args) const;
+  template <typename... Args>
+  bool operator()(const ExecutionContext& context, const Args&... args) const {
+    return operator()(context, {args...});
+  }
+  /// @}
+
   /// Execute the kernel to assemble the indices of the results.
   /// @{
   bool assemble(const std::vector<TensorStorage>& args) const;
   template <typename... Args> bool assemble(const Args&... args) const {
     return assemble({args...});
   }
+  bool assemble(const ExecutionContext& context,
+                const std::vector<TensorStorage>& args) const;
   /// @}
 
   /// Execute the kernel to compute the component values of the results, but
@@ -52,6 +66,8 @@ public:
   template <typename... Args> bool compute(const Args&... args) const {
     return compute({args...});
   }
+  bool compute(const ExecutionContext& context,
+               const std::vector<TensorStorage>& args) const;
   /// @}
 
   /// Check whether the kernel is defined.
@@ -165,11 +165,13 @@ class Parallelize : public TransformationInterface {
 public:
   Parallelize();
   Parallelize(IndexVar i);
-  Parallelize(IndexVar i, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy);
+  Parallelize(IndexVar i, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy,
+              LoadBalance load_balance = LoadBalance::Iterations);
 
   IndexVar geti() const;
   ParallelUnit getParallelUnit() const;
   OutputRaceStrategy getOutputRaceStrategy() const;
+  LoadBalance getLoadBalance() const;
 
   /// Apply the parallelize optimization to a concrete index statement.
   IndexStmt apply(IndexStmt stmt, std::string* reason=nullptr) const;
@@ -214,6 +216,10 @@ std::ostream &operator<<(std::ostream &, const SetAssembleStrategy&);
  * 1. The loop iterates over only one data structure,
  * 2. Every result iterator has the insert capability, and
  * 3. No cross-thread reductions.
+ * Loops over the rows of a dense level with a compressed level below it are
+ * partitioned by merge path, so that threads get equal shares of rows plus
+ * nonzeros, if kernels run on more than one thread with OpenMP or the task
+ * runtime.
  */
 IndexStmt parallelizeOuterLoop(IndexStmt stmt);
 
@@ -237,5 +243,41 @@ IndexStmt scalarPromote(IndexStmt stmt);
  */
 IndexStmt insertTemporaries(IndexStmt stmt);
 
+/**
+ * Fuse a sequence of assignments, where later assignments may read the
+ * tensors assigned by earlier ones, into one concrete index notation
+ * statement that computes the results.  Tensors assigned in the sequence that
+ * are not results are intermediates, which are only materialized by 4:
+ * 1. An intermediate that is read once is substituted into its reader.
+ * 2. Other intermediates, results that later assignments read and reductions
+ *    are computed into scalar workspaces by where statements, inside the
+ *    loops of the reader that bind their index variables.  Reads of the same
+ *    element of a tensor in one loop nest share a workspace.
+ * 3. Results that later assignments read are assigned from their workspace,
+ *    with a multi statement, in the innermost loop of a reader whose loops
+ *    iterate over the components of the result, which must be dense, and
+ *    only access dense modes with them.
+ * 4. Reads are only substituted, or computed into workspaces, where every
+ *    loop that encloses them iterates over one of their index variables,
+ *    since other loops would compute them again.  Otherwise, as when the
+ *    reader reduces over the components that it reads, the tensor is
+ *    computed into a dense temporary by a loop nest of its own, in a where
+ *    statement around the reader's loop nest, and dense results are assigned
+ *    from the temporary.
+ * For example, t(i) = A(i,j)*x(j); y(i) = t(i) + b(i); z(i) = y(i)*y(i) with
+ * result z is fused into
+ *   forall(i, where(where(z(i) = y_w*y_w, y_w = tj + b(i)),
+ *                   forall(j, tj += A(i,j)*x(j))))
+ * while t(i) = A(i,j)*x(j); z(k) = B(k,i)*t(i) with result z is fused into
+ *   where(forall(k, where(z(k) = ti, forall(i, ti += B(k,i)*t_t(i)))),
+ *         forall(i, where(t_t(i) = tj, forall(j, tj += A(i,j)*x(j)))))
+ * Loops follow the order of the index variables of the results.  Results
+ * that no later assignment reads are computed by separate loop nests of the
+ * statement, and results that don't read other assignments are concretized
+ * as usual.
+ */
+IndexStmt fuse(const std::vector<Assignment>& assignments,
+               const std::vector<TensorVar>& results);
+
 }
 #endif
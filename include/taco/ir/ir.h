@@ -1,6 +1,7 @@
 #ifndef TACO_IR_H
 #define TACO_IR_H
 
+#include <atomic>
 #include <vector>
 #include <typeinfo>
 #include <utility>
@@ -33,6 +34,7 @@ enum class IRNodeType {
   Max,
   BitAnd,
   BitOr,
+  Shr,
   Not,
   Eq,
   Neq,
@@ -92,7 +94,8 @@ struct IRNode : private util::Uncopyable {
    */
   virtual IRNodeType type_info() const = 0;
 
-  mutable long ref = 0;
+  // Atomic, so that IR can be shared by threads that compile concurrently
+  mutable std::atomic<long> ref{0};
   friend void acquire(const IRNode* node) {
     ++(node->ref);
   }
@@ -382,6 +385,16 @@ struct BitOr : public ExprNode<BitOr> {
   static const IRNodeType _type_info = IRNodeType::BitOr;
 };
 
+/** Shift right: a >> b */
+struct Shr : public ExprNode<Shr> {
+  Expr a;
+  Expr b;
+
+  static Expr make(Expr a, Expr b);
+
+  static const IRNodeType _type_info = IRNodeType::Shr;
+};
+
 /** Equality: a==b. */
 struct Eq : public ExprNode<Eq> {
   Expr a;
@@ -767,7 +780,7 @@ struct GetProperty : public ExprNode<GetProperty> {
 
   static Expr make(Expr tensor, TensorProperty property, int mode=0);
   static Expr make(Expr tensor, TensorProperty property, int mode,
-                   int index, std::string name);
+                   int index, std::string name, Datatype type=Int());
   
   static const IRNodeType _type_info = IRNodeType::GetProperty;
 };
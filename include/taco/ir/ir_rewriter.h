@@ -36,6 +36,7 @@ protected:
   virtual void visit(const Max* op);
   virtual void visit(const BitAnd* op);
   virtual void visit(const BitOr* op);
+  virtual void visit(const Shr* op);
   virtual void visit(const Eq* op);
   virtual void visit(const Neq* op);
   virtual void visit(const Gt* op);
@@ -16,6 +16,7 @@ struct Min;
 struct Max;
 struct BitAnd;
 struct BitOr;
+struct Shr;
 struct Eq;
 struct Neq;
 struct Gt;
@@ -68,6 +69,7 @@ public:
   virtual void visit(const Max*) = 0;
   virtual void visit(const BitAnd*) = 0;
   virtual void visit(const BitOr*) = 0;
+  virtual void visit(const Shr*) = 0;
   virtual void visit(const Eq*) = 0;
   virtual void visit(const Neq*) = 0;
   virtual void visit(const Gt*) = 0;
@@ -123,6 +125,7 @@ public:
   virtual void visit(const Max* op);
   virtual void visit(const BitAnd* op);
   virtual void visit(const BitOr* op);
+  virtual void visit(const Shr* op);
   virtual void visit(const Eq* op);
   virtual void visit(const Neq* op);
   virtual void visit(const Gt* op);
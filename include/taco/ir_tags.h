@@ -33,6 +33,20 @@ enum class AssembleStrategy {
 };
 extern const char *AssembleStrategy_NAMES[];
 
+/// MergeStrategy::TwoFinger advances intersected iterators one coordinate at a time
+/// MergeStrategy::Gallop skips intersected iterators ahead with exponential and binary searches
+enum class MergeStrategy {
+  TwoFinger, Gallop
+};
+extern const char *MergeStrategy_NAMES[];
+
+/// LoadBalance::Iterations partitions a parallel loop by its iterations
+/// LoadBalance::MergePath partitions a parallel loop over rows together with the nonzeros of the compressed level below it
+enum class LoadBalance {
+  Iterations, MergePath
+};
+extern const char *LoadBalance_NAMES[];
+
 }
 
 #endif //TACO_IR_TAGS_H
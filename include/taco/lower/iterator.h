@@ -149,6 +149,7 @@ public:
   ir::Stmt getInsertCoord(const ir::Expr& p,
                           const std::vector<ir::Expr>& i) const;
   ir::Expr getWidth() const;
+  ir::Expr getInsertGuard(const ir::Expr& p) const;
   ir::Stmt getInsertInitCoords(const ir::Expr& pBegin, 
                                const ir::Expr& pEnd) const;
   ir::Stmt getInsertInitLevel(const ir::Expr& szPrev, const ir::Expr& sz) const;
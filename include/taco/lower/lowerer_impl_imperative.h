@@ -123,6 +123,29 @@ protected:
   /// search for the start of the iteration of the loop (a separate kernel on GPUs)
   virtual ir::Stmt searchForFusedPositionStart(Forall forall, Iterator posIterator);
 
+  /// Returns whether a loop over rows can be partitioned by merge path, which
+  /// requires its body to be a loop over a compressed level directly below
+  /// the rows, and its results to be dense vectors over the rows or dense
+  /// tensors over the rows and the compressed level.  Sets the compressed
+  /// level's iterator and, for a vector over the rows, the result whose split
+  /// rows must be carried between threads.
+  bool canPartitionByMergePath(Forall forall, Iterator* nonzeros,
+                               TensorVar* carried);
+
+  /// Lower a loop over rows that is parallelized over CPU threads to a loop
+  /// over the threads, each of which computes an equal share of the rows and
+  /// the nonzeros of the compressed level below them.  A thread's share is
+  /// found by a merge-path search of the position array; the part of a row
+  /// that it computes before the next thread's share begins is accumulated
+  /// into a carry that is added to the carried result after the loop.
+  virtual ir::Stmt lowerForallMergePath(Forall forall, Iterator nonzeros,
+                                        TensorVar carried,
+                                        std::vector<Iterator> locaters,
+                                        std::vector<Iterator> inserters,
+                                        std::vector<Iterator> appenders,
+                                        std::set<Access> reducedAccesses,
+                                        ir::Stmt recoveryStmt);
+
     /**
      * Lower the merge lattice to code that iterates over the sparse iteration
      * space of coordinates and computes the concrete index notation statement.
@@ -141,13 +164,16 @@ protected:
      * \param statement
      *      A concrete index notation statement to compute at the points in the
      *      sparse iteration space described by the merge lattice.
+     * \param mergeStrategy
+     *      How the loops coiterate the iterators that they intersect.
      *
      * \return
      *       IR code to compute the forall loop.
      */
   virtual ir::Stmt lowerMergeLattice(MergeLattice lattice, IndexVar coordinateVar,
                                      IndexStmt statement, 
-                                     const std::set<Access>& reducedAccesses);
+                                     const std::set<Access>& reducedAccesses,
+                                     MergeStrategy mergeStrategy);
 
   virtual ir::Stmt resolveCoordinate(std::vector<Iterator> mergers, ir::Expr coordinate, bool emitVarDecl);
 
@@ -167,7 +193,20 @@ protected:
      */
   virtual ir::Stmt lowerMergePoint(MergeLattice pointLattice,
                                    ir::Expr coordinate, IndexVar coordinateVar, IndexStmt statement,
-                                   const std::set<Access>& reducedAccesses, bool resolvedCoordDeclared);
+                                   const std::set<Access>& reducedAccesses, bool resolvedCoordDeclared,
+                                   MergeStrategy mergeStrategy);
+
+  /// Returns whether a merge point can be lowered to a galloping loop, which
+  /// requires it to intersect ordered and unique compressed levels.
+  bool canGallop(MergeLattice pointLattice, bool resolvedCoordDeclared) const;
+
+  /// Lower a merge point that intersects compressed levels to a loop that,
+  /// whenever the iterators disagree, skips each iterator ahead to the
+  /// largest of their coordinates with a galloping search.
+  virtual ir::Stmt lowerGallopingMergePoint(MergeLattice pointLattice,
+                                            ir::Expr coordinate, IndexVar coordinateVar,
+                                            IndexStmt statement,
+                                            const std::set<Access>& reducedAccesses);
 
   /// Lower a merge lattice to cases.
   virtual ir::Stmt lowerMergeCases(ir::Expr coordinate, IndexVar coordinateVar, IndexStmt stmt,
@@ -323,8 +362,10 @@ protected:
    */
   ir::Stmt zeroInitValues(ir::Expr tensor, ir::Expr begin, ir::Expr size);
 
-  /// Declare position variables and initialize them with a locate.
-  ir::Stmt declLocatePosVars(std::vector<Iterator> iterators);
+  /// Declare position variables and initialize them with a locate, and insert
+  /// the coordinates at the located positions if insert is true.
+  ir::Stmt declLocatePosVars(std::vector<Iterator> iterators,
+                             bool insert=false);
 
   /// Emit loops to reduce duplicate coordinates.
   ir::Stmt reduceDuplicateCoordinates(ir::Expr coordinate, 
@@ -510,6 +551,10 @@ private:
   std::map<ParallelUnit, ir::Expr> parallelUnitSizes;
   std::map<ParallelUnit, IndexVar> parallelUnitIndexVars;
 
+  /// Map from compressed iterators to the positions that the current thread
+  /// of a merge-path partitioned loop iterates over
+  std::map<Iterator, std::pair<ir::Expr, ir::Expr>> mergePathPositionBounds;
+
   /// Keep track of what IndexVars have already been defined
   std::set<IndexVar> definedIndexVars;
   std::vector<IndexVar> definedIndexVarsOrdered;
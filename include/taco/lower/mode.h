@@ -22,7 +22,8 @@ public:
 
   /// Construct a tensor mode.
   Mode(ir::Expr tensor, Dimension size, int mode, ModeFormat modeFormat,
-       ModePack modePack, size_t packLoc, ModeFormat parentModeFormat);
+       ModePack modePack, size_t packLoc, ModeFormat parentModeFormat,
+       Datatype positionType=Int());
 
   /// Retrieve the name of the tensor mode.
   std::string getName() const;
@@ -49,6 +50,10 @@ public:
   /// Retrieve the mode type of the parent mode in the mode hierarchy.
   ModeFormat getParentModeType() const;
 
+  /// Retrieve the type of positions in the mode, which is the index type of
+  /// the tensor's format.
+  Datatype getPositionType() const;
+
   /// Store temporary variables that may be needed to access or modify a mode
   /// @{
   ir::Expr getVar(std::string varName) const;
@@ -74,7 +79,7 @@ class ModePack {
 public:
   ModePack();
   ModePack(size_t numModes, ModeFormat modeType, ir::Expr tensor, int mode, 
-           int level);
+           int level, const std::vector<Datatype>& arrayTypes={Int(), Int()});
 
   /// Returns number of tensor modes belonging to mode pack.
   size_t getNumModes() const;
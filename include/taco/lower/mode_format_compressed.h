@@ -58,8 +58,9 @@ public:
                           Mode mode) const override;
   ir::Stmt getFinalizeYieldPos(ir::Expr prevSize, Mode mode) const override;
 
-  std::vector<ir::Expr> getArrays(ir::Expr tensor, int mode, 
-                                  int level) const override;
+  std::vector<ir::Expr> getArrays(ir::Expr tensor, int mode, int level,
+                                  const std::vector<Datatype>& arrayTypes)
+                                  const override;
 
 protected:
   ir::Expr getPosArray(ModePack pack) const;
@@ -33,8 +33,9 @@ public:
   ModeFunction getYieldPos(ir::Expr parentPos, std::vector<ir::Expr> coords, 
                            Mode mode) const override;
 
-  std::vector<ir::Expr> getArrays(ir::Expr tensor, int mode, 
-                                  int level) const override;
+  std::vector<ir::Expr> getArrays(ir::Expr tensor, int mode, int level,
+                                  const std::vector<Datatype>& arrayTypes)
+                                  const override;
 
 protected:
   ir::Expr getSizeArray(ModePack pack) const;
@@ -0,0 +1,67 @@
+#ifndef TACO_MODE_FORMAT_HASHED_H
+#define TACO_MODE_FORMAT_HASHED_H
+
+#include "taco/lower/mode_format_impl.h"
+
+namespace taco {
+
+/// A hashed mode, whose segments (e.g., the rows of a matrix) are open
+/// addressing hash tables of width buckets with linear probing.  The mode has
+/// one array, crd, which stores the coordinate in each bucket or -1 if the
+/// bucket is empty, and the positions of segment s are the buckets
+/// [s*width, (s+1)*width).  Coordinates can be located and inserted in any
+/// order, so hashed modes can hold results that are scattered into, such as
+/// the rows of a sparse matrix product, without a dense workspace.  The width
+/// must be a power of two and larger than the number of coordinates in any
+/// segment, and computing a tensor with a full segment is an error.  Hashed
+/// modes are unordered; see TensorBase::compressHashedLevels to convert them
+/// to ordered compressed modes.
+class HashedModeFormat : public ModeFormatImpl {
+public:
+  using ModeFormatImpl::getInsertCoord;
+
+  HashedModeFormat();
+  HashedModeFormat(int width);
+
+  ~HashedModeFormat() override {}
+
+  ModeFormat copy(std::vector<ModeFormat::Property> properties) const override;
+
+  ModeFunction posIterBounds(ir::Expr parentPos, Mode mode) const override;
+  ModeFunction posIterAccess(ir::Expr pos, std::vector<ir::Expr> coords,
+                             Mode mode) const override;
+
+  ModeFunction locate(ir::Expr parentPos, std::vector<ir::Expr> coords,
+                      Mode mode) const override;
+
+  ir::Stmt getInsertCoord(ir::Expr p, const std::vector<ir::Expr>& i,
+                          Mode mode) const override;
+  ir::Expr getWidth(Mode mode) const override;
+  ir::Expr getInsertGuard(ir::Expr p, Mode mode) const override;
+  ir::Stmt getInsertInitCoords(ir::Expr pBegin, ir::Expr pEnd,
+                               Mode mode) const override;
+  ir::Stmt getInsertInitLevel(ir::Expr szPrev, ir::Expr sz,
+                              Mode mode) const override;
+  ir::Stmt getInsertFinalizeLevel(ir::Expr szPrev, ir::Expr sz,
+                                  Mode mode) const override;
+
+  std::vector<ir::Expr> getArrays(ir::Expr tensor, int mode, int level,
+                                  const std::vector<Datatype>& arrayTypes)
+                                  const override;
+
+  /// Returns the bucket that probing for a coordinate starts at, which the
+  /// generated taco_hashLocate function computes the same way.
+  static int64_t getHome(int64_t coordinate, int width);
+
+  /// The number of buckets of each segment.
+  const int width;
+
+protected:
+  ir::Expr getCoordArray(ModePack pack) const;
+
+  bool equals(const ModeFormatImpl& other) const override;
+};
+
+}
+
+#endif
@@ -168,6 +168,10 @@ public:
 
   virtual ir::Expr getWidth(Mode mode) const;
 
+  /// Returns whether a position that was located for insertion can be stored
+  /// to, or an undefined expression if it always can.
+  virtual ir::Expr getInsertGuard(ir::Expr p, Mode mode) const;
+
   virtual ir::Stmt
   getInsertInitCoords(ir::Expr pBegin, ir::Expr pEnd, Mode mode) const;
 
@@ -231,9 +235,11 @@ public:
   getFinalizeYieldPos(ir::Expr prevSize, Mode mode) const;
   /// @}
 
-  /// Returns arrays associated with a tensor mode
+  /// Returns arrays associated with a tensor mode, whose element types are
+  /// given by arrayTypes (see Format::getLevelArrayTypes)
   virtual std::vector<ir::Expr>
-  getArrays(ir::Expr tensor, int mode, int level) const = 0;
+  getArrays(ir::Expr tensor, int mode, int level,
+            const std::vector<Datatype>& arrayTypes) const = 0;
 
   friend bool operator==(const ModeFormatImpl&, const ModeFormatImpl&);
   friend bool operator!=(const ModeFormatImpl&, const ModeFormatImpl&);
@@ -0,0 +1,50 @@
+#ifndef TACO_MODE_FORMAT_NARROW_COMPRESSED_H
+#define TACO_MODE_FORMAT_NARROW_COMPRESSED_H
+
+#include "taco/lower/mode_format_impl.h"
+
+namespace taco {
+
+/// A compressed mode whose coordinates are stored as narrow (by default
+/// 16-bit) offsets from the smallest coordinate of each block of positions,
+/// which roughly halves the coordinate bytes that kernels stream.  The mode
+/// has three arrays: pos, as in a compressed mode, crd, the offsets, and base,
+/// whose first element is the base-2 logarithm of the number of positions in
+/// a block and whose element b+1 is the base of block b.  The coordinate at
+/// position p is therefore base[(p >> base[0]) + 1] + crd[p].  Packing picks
+/// the largest blocks whose coordinates fit in the offsets, so any tensor can
+/// be stored.  Narrow compressed modes can be iterated over but not assembled,
+/// so they can hold operands but not results.
+class NarrowCompressedModeFormat : public ModeFormatImpl {
+public:
+  NarrowCompressedModeFormat();
+  NarrowCompressedModeFormat(bool isFull, bool isOrdered, bool isUnique,
+                             bool isZeroless);
+
+  ~NarrowCompressedModeFormat() override {}
+
+  ModeFormat copy(std::vector<ModeFormat::Property> properties) const override;
+
+  ModeFunction posIterBounds(ir::Expr parentPos, Mode mode) const override;
+  ModeFunction posIterAccess(ir::Expr pos, std::vector<ir::Expr> coords,
+                             Mode mode) const override;
+
+  ModeFunction coordBounds(ir::Expr parentPos, Mode mode) const override;
+
+  std::vector<ir::Expr> getArrays(ir::Expr tensor, int mode, int level,
+                                  const std::vector<Datatype>& arrayTypes)
+                                  const override;
+
+protected:
+  ir::Expr getPosArray(ModePack pack) const;
+  ir::Expr getCoordArray(ModePack pack) const;
+  ir::Expr getBaseArray(ModePack pack) const;
+
+  /// Returns the coordinate at a position, decoded from its offset and the
+  /// base of its block.
+  ir::Expr getCoord(ir::Expr pos, Mode mode) const;
+};
+
+}
+
+#endif
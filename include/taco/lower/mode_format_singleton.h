@@ -39,8 +39,9 @@ public:
                           std::vector<ir::Expr> coords, 
                           Mode mode) const override;
 
-  std::vector<ir::Expr> getArrays(ir::Expr tensor, int mode, 
-                                  int level) const override;
+  std::vector<ir::Expr> getArrays(ir::Expr tensor, int mode, int level,
+                                  const std::vector<Datatype>& arrayTypes)
+                                  const override;
 
 protected:
   ir::Expr getCoordArray(ModePack pack) const;
@@ -5,6 +5,7 @@
 #include <ostream>
 #include <taco/type.h>
 #include <taco/storage/typed_value.h>
+#include "taco/storage/placement.h"
 #include "taco/util/collections.h"
 
 namespace taco {
@@ -24,6 +25,11 @@ public:
   /// Construct an array of elements of the given type.
   Array(Datatype type, void* data, size_t size, Policy policy=Free);
 
+  /// Construct an array of elements of the given type, whose data belongs to
+  /// owner (e.g. a memory mapped file).  The array does not free the data, but
+  /// keeps the owner alive for as long as the array (or a copy) exists.
+  Array(Datatype type, void* data, size_t size, std::shared_ptr<void> owner);
+
   /// Returns the type of the array elements
   const Datatype& getType() const;
 
@@ -41,12 +47,18 @@ public:
   /// Gets the value at a given index
   TypedComponentRef operator[] (const int index) const;
 
+  /// Returns the placement the array data was allocated with (see makeArray).
+  const Placement& getPlacement() const;
+
   /// Zero the array content
   void zero();
 
 private:
   struct Content;
   std::shared_ptr<Content> content;
+
+  friend Array makeArray(Datatype type, size_t size,
+                         const Placement& placement);
 };
 
 /// Print the array.
@@ -66,6 +78,11 @@ Array makeArray(T* data, size_t size, Array::Policy policy=Array::UserOwns) {
 /// Construct an array of elements of the given type.
 Array makeArray(Datatype type, size_t size);
 
+/// Construct an array of elements of the given type, whose pages are placed
+/// on NUMA nodes with the placement.  Arrays of placements other than the
+/// default are zeroed.
+Array makeArray(Datatype type, size_t size, const Placement& placement);
+
 /// Construct an Array from the values.
 template <typename T>
 Array makeArray(const std::vector<T>& values) {
@@ -0,0 +1,41 @@
+#ifndef TACO_FILE_IO_TBIN_H
+#define TACO_FILE_IO_TBIN_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include "taco/format.h"
+
+namespace taco {
+class TensorBase;
+class Format;
+
+/// Read a tbin tensor from a file.  The file is memory mapped and the arrays
+/// of the tensor point into the mapping, so reading takes constant time.  The
+/// tensor must be read with the format it was written with.
+TensorBase readTBIN(std::string filename, const ModeFormat& modetype,
+                    bool pack=true);
+
+/// Read a tbin tensor from a file.
+TensorBase readTBIN(std::string filename, const Format& format,
+                    bool pack=true);
+
+/// Read a tbin tensor from a stream.
+TensorBase readTBIN(std::istream& stream, const ModeFormat& modetype,
+                    bool pack=true);
+
+/// Read a tbin tensor from a stream.
+TensorBase readTBIN(std::istream& stream, const Format& format,
+                    bool pack=true);
+
+/// Write a tbin tensor to a file.
+void writeTBIN(std::string filename, const TensorBase& tensor);
+
+/// Write a tbin tensor to a stream.  The arrays of the tensor are written
+/// directly from its storage.
+void writeTBIN(std::ostream& stream, const TensorBase& tensor);
+
+}
+
+#endif
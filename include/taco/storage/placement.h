@@ -0,0 +1,97 @@
+#ifndef TACO_STORAGE_PLACEMENT_H
+#define TACO_STORAGE_PLACEMENT_H
+
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "taco/storage/result_allocator.h"
+
+namespace taco {
+
+/// The placement of the pages of arrays on the memory of the NUMA nodes of a
+/// machine.  Pages are placed on the node of the thread that first touches
+/// them, so arrays that are filled by one thread end up on one node and
+/// parallel kernels that read them afterwards pull remote memory.
+///
+/// - Default leaves the placement to the thread that fills the array.
+/// - FirstTouch zeroes new arrays in parallel, splitting them into one
+///   contiguous part per thread like a static schedule splits the iterations
+///   of a parallel loop, so that the threads of a loop over the array with a
+///   static schedule find their part on their own node.
+/// - Interleaved spreads the pages of new arrays round robin over all nodes,
+///   which balances the bandwidth of arrays that are not read by loops
+///   with a static schedule (Linux only, elsewhere it is Default).
+///
+/// The threads of first touch are bound to the cpus of the placement, if it
+/// has any, so that the thread of each part runs on the cpu that the thread
+/// of the same part of a parallel loop is bound to (see
+/// ExecutionContext::setAffinity).
+class Placement {
+public:
+  enum Kind {Default, FirstTouch, Interleaved};
+
+  /// The default placement.
+  Placement();
+
+  /// A placement of the given kind whose arrays are first touched by
+  /// numThreads threads, or taco's number of threads if numThreads is 0, or
+  /// one thread per cpu if there are cpus.
+  Placement(Kind kind, int numThreads=0, const std::vector<int>& cpus={});
+
+  /// Returns the kind of placement.
+  Kind getKind() const;
+
+  /// Returns the number of threads that first touch arrays.
+  int getNumThreads() const;
+
+  /// Returns the cpus that the threads that first touch arrays are bound to.
+  const std::vector<int>& getCpus() const;
+
+  /// Allocate size bytes with the placement, zeroed if clear is true.  The
+  /// memory is freed with free.  Arrays of the default placement are only
+  /// zeroed if clear is true, but other arrays are always touched.
+  void* allocate(size_t size, bool clear) const;
+
+  /// Copy size bytes from source to destination, with the threads that first
+  /// touch arrays copying their part of them.
+  void copy(void* destination, const void* source, size_t size) const;
+
+private:
+  Kind kind;
+  int numThreads;
+  std::vector<int> cpus;
+};
+
+bool operator==(const Placement&, const Placement&);
+bool operator!=(const Placement&, const Placement&);
+
+/// Print the placement.
+std::ostream& operator<<(std::ostream&, const Placement&);
+
+/// A result allocator that places the arrays of results (see
+/// TensorBase::setPlacement), or the workspaces of kernels run on the task
+/// runtime (see ExecutionContext::setScratchAllocator).  Grown arrays are
+/// moved to new placed arrays.
+class PlacedAllocator : public ResultAllocator {
+public:
+  explicit PlacedAllocator(const Placement& placement);
+
+  void* allocate(void* data, size_t size, bool clear);
+  void deallocate(void* data);
+
+  /// Returns the placement of allocations.
+  const Placement& getPlacement() const;
+
+private:
+  Placement placement;
+
+  /// The sizes of live allocations, which are copied when they grow
+  std::mutex mutex;
+  std::unordered_map<void*, size_t> sizes;
+};
+
+}
+#endif
@@ -0,0 +1,73 @@
+#ifndef TACO_STORAGE_RESULT_ALLOCATOR_H
+#define TACO_STORAGE_RESULT_ALLOCATOR_H
+
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "taco/util/uncopyable.h"
+
+namespace taco {
+
+/// Allocates the index and value arrays of the results of generated kernels.
+/// Generated code calls allocate to allocate and grow result arrays, and the
+/// arrays are passed to deallocate when the tensor storage that holds them is
+/// destroyed.  Allocators must be thread-safe.
+class ResultAllocator : private util::Uncopyable {
+public:
+  virtual ~ResultAllocator() = default;
+
+  /// Called before a kernel that allocates results with the allocator runs.
+  virtual void begin() {}
+
+  /// Allocate size bytes, zeroed if clear is true.  If data is not null, it
+  /// is an earlier allocation to grow to size bytes, keeping its contents.
+  virtual void* allocate(void* data, size_t size, bool clear) = 0;
+
+  /// Free an allocation.
+  virtual void deallocate(void* data) = 0;
+};
+
+/// A result allocator that recycles the arrays of earlier results.  The n-th
+/// allocation of a kernel run reuses the n-th allocation of the previous run,
+/// if it has been freed, and keeps its capacity.  Evaluating an expression
+/// repeatedly with results of similar size therefore neither grows result
+/// arrays with realloc copies nor faults in new pages.  The arena holds on to
+/// the memory of freed results until it is destroyed.
+class ResultArena : public ResultAllocator {
+public:
+  ResultArena();
+  ~ResultArena();
+
+  void begin();
+  void* allocate(void* data, size_t size, bool clear);
+  void deallocate(void* data);
+
+private:
+  struct Slot {
+    void* data;
+    size_t capacity;
+    bool free;
+  };
+
+  std::mutex mutex;
+  std::vector<Slot> slots;
+  std::unordered_map<void*, size_t> slotIndices;
+  size_t nextSlot;
+};
+
+/// Returns the result allocator of kernels called on the calling thread, or
+/// nullptr if results are allocated with malloc.
+ResultAllocator* getThreadResultAllocator();
+
+/// Set the result allocator of kernels called on the calling thread, or
+/// nullptr to allocate results with malloc.
+void setThreadResultAllocator(ResultAllocator* allocator);
+
+/// Allocate a result array with the calling thread's result allocator.
+/// Modules point generated code at this function when they load it.
+void* allocateResult(void* data, size_t size, int clear);
+
+}
+#endif
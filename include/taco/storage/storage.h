@@ -1,6 +1,7 @@
 #ifndef TACO_STORAGE_STORAGE_H
 #define TACO_STORAGE_STORAGE_H
 
+#include <cstdint>
 #include <vector>
 #include <memory>
 
@@ -60,12 +61,31 @@ public:
   /// Convert to a taco_tensor_t, whose lifetime is the same as the storage.
   operator struct taco_tensor_t*() const;
 
+  /// Returns a version number that changes whenever the index or values of
+  /// the storage are replaced.  Version numbers are unique across storages,
+  /// so a taco_tensor_t converted from storage with the same version is
+  /// still valid.
+  uint64_t getVersion() const;
+
   /// Set the tensor index, which describes the non-zero values.
   void setIndex(const Index& index);
 
   /// Set the tensor component value array.
   void setValues(const Array& values);
 
+  /// Set the placement of the arrays that taco allocates for the storage on
+  /// NUMA nodes (see Placement).  Arrays already in the storage keep their
+  /// placement until they are moved with place.
+  void setPlacement(const Placement& placement);
+
+  /// Returns the placement of the arrays of the storage.
+  const Placement& getPlacement() const;
+
+  /// Move the index and value arrays of the storage that don't have its
+  /// placement to new arrays that do, e.g. after the storage has been filled
+  /// by one thread.
+  void place();
+
 private:
   struct Content;
   std::shared_ptr<Content> content;
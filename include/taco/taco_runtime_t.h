@@ -0,0 +1,39 @@
+/// This file defines the runtime struct through which generated code runs
+/// parallel loops on taco's task runtime.  Note: this file must be valid C99,
+/// not C++.
+/// This *must* be kept in sync with the version used in codegen_c.cpp
+
+#ifndef TACO_RUNTIME_T_DEFINED
+#define TACO_RUNTIME_T_DEFINED
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct taco_runtime_t;
+
+/// The body of a parallel loop, which runs the iterations [begin, end) on
+/// the given worker.  Worker ids are less than the runtime's num_workers and
+/// no two workers run iterations of the same loop with the same id at once.
+typedef void (*taco_loop_body_t)(struct taco_runtime_t* runtime,
+                                 void* closure, int64_t begin, int64_t end,
+                                 int32_t worker);
+
+typedef struct taco_runtime_t {
+  void*   impl;                   // runtime implementation
+  int32_t num_workers;            // number of workers (bound on worker ids)
+  int64_t grain;                  // grain of loops that pass a grain of 0
+                                  // (0 if chosen by the runtime)
+  // run body over the iterations [begin, end) in chunks of at least grain
+  // iterations (or runtime->grain if grain is 0) and return when all of them
+  // have run
+  void  (*parallel_for)(struct taco_runtime_t* runtime, int64_t begin,
+                        int64_t end, int64_t grain, taco_loop_body_t body,
+                        void* closure);
+  void*   allocator;              // allocator of workspaces
+  // allocate, grow (if data is not NULL) or free (if size is 0) a workspace
+  // of size bytes, zeroed if clear is nonzero
+  void* (*allocate)(struct taco_runtime_t* runtime, void* data, size_t size,
+                    int clear);
+} taco_runtime_t;
+
+#endif
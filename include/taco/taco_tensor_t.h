@@ -18,7 +18,7 @@ typedef struct taco_tensor_t {
   taco_mode_t* mode_types;    // mode storage types
   uint8_t***   indices;       // tensor index data (per mode)
   uint8_t*     vals;          // tensor values
-  int32_t      vals_size;     // values array size
+  int64_t      vals_size;     // values array size
 } taco_tensor_t;
 
 taco_tensor_t *init_taco_tensor_t(int32_t order, int32_t csize,
@@ -18,10 +18,35 @@ struct Target {
   std::string compiler_env = "TACO_CC";
 
   std::string compiler = "cc";
+
+  /// How JIT-compiled C code is turned into executable code.  SystemCompiler
+  /// writes the code to a temporary file, runs the compiler above on it and
+  /// loads the resulting shared library.  InProcess compiles the code in
+  /// memory with libtcc (loaded at runtime), which avoids temporary files and
+  /// forking a compiler, and falls back to SystemCompiler if libtcc is not
+  /// available or cannot compile the code.
+  enum JIT {SystemCompiler=0, InProcess} jit = SystemCompiler;
+
+  /// The SIMD instruction set that loops parallelized over CPU vector lanes
+  /// are generated for.  With NoSIMD they are emitted as scalar loops with
+  /// vectorization pragmas, and otherwise with explicit vectors of the
+  /// instruction set's register width (see getVectorBytes), using GCC/Clang
+  /// vector extensions, and the C compiler is told to target the
+  /// instruction set.
+  enum SIMD {NoSIMD=0, SSE4, AVX2, AVX512, NEON} simd = NoSIMD;
+
+  /// How loops parallelized over CPU threads run.  With OpenMP they are
+  /// emitted as OpenMP parallel loops, which run on OpenMP's threads with the
+  /// schedule and number of threads that taco sets before each call.  With
+  /// TaskRuntime their bodies are emitted as functions that generated code
+  /// passes to taco's work-stealing runtime (see util::TaskRuntime), which
+  /// functions take as an explicit argument, so kernels don't depend on
+  /// process-wide state and can be called concurrently and from within other
+  /// parallel loops.
+  enum Parallelism {OpenMP=0, TaskRuntime} parallelism = OpenMP;
   
   // As we support them, we'll stick in optional features into the target as
-  // well, including things like parallelism model (e.g. openmp, cilk) for
-  // C code generation, and hardware features (e.g. AVX) for LLVM code gen.
+  // well, including hardware features (e.g. AVX) for LLVM code gen.
   
   /// Given a string of the form arch-os-features, construct the corresponding
   /// Target object.
@@ -34,11 +59,21 @@ struct Target {
   
   /// Validate a target string
   static bool validateTargetString(const std::string &s);
-  
+
+  /// Returns the width in bytes of the vector registers of a SIMD
+  /// instruction set, or 0 for NoSIMD.
+  static int getVectorBytes(SIMD simd);
+
+  /// Returns the C compiler flags that enable a SIMD instruction set.
+  static std::string getSIMDFlags(SIMD simd);
 };
 
   /// Gets the target from the environment.  If this is not set in the
-  /// environment, it uses the default C99 backend with the current OS
+  /// environment, it uses the default C99 backend with the current OS.  The
+  /// JIT backend is selected by setting TACO_JIT to "system" or "inprocess",
+  /// and the SIMD instruction set by setting TACO_SIMD to "none", "sse4",
+  /// "avx2", "avx512" or "neon", and the parallelism model by setting
+  /// TACO_PARALLELISM to "openmp" or "runtime".
   Target getTargetFromEnvironment();
 
 } // namespace taco
@@ -2,15 +2,18 @@
 #define TACO_TENSOR_H
 
 #include <memory>
+#include <functional>
 #include <string>
 #include <vector>
 #include <cassert>
 #include <utility>
 #include <array>
 #include <mutex>
+#include <future>
 
 #include "taco/type.h"
 #include "taco/format.h"
+#include "taco/execution_context.h"
 
 #include "taco/codegen/module.h"
 
@@ -30,6 +33,10 @@
 
 namespace taco {
 
+class ResultAllocator;
+class BoundKernel;
+class ComponentLocator;
+
 /// Inherits Access and adds a TensorBase object. Allows for tensor retreival
 /// for assignment setting and argument packing.
 struct AccessTensorNode;
@@ -147,11 +154,49 @@ public:
   template <typename InputIterators>
   void setFromComponents(const InputIterators& begin, const InputIterators& end);
 
+  /// Insert many components at once, given as one Int32 array of coordinates
+  /// per mode and an array of values of the tensor's component type.  Unlike
+  /// insert, the components are not copied into an insertion buffer, but are
+  /// read from the arrays when the tensor is packed.  Arrays the user owns
+  /// (Array::UserOwns) must therefore stay alive until then, while arrays
+  /// with the Free or Delete policy pass their ownership to the tensor.
+  ///
+  /// If sorted is true the coordinates must be in lexicographic order, with
+  /// modes compared in the order they are stored in (the format's mode
+  /// ordering), and they are then packed without being sorted or copied.
+  /// Duplicate coordinates are summed up.
+  void insertCOO(const std::vector<Array>& coordinates, Array values,
+                 bool sorted=false);
+
+  /// Insert the components of a matrix given in compressed sparse row form,
+  /// where the columns and values of row i are at [pos[i], pos[i+1]) in crd
+  /// and values.  The positions are Int32 or Int64, the crd and values arrays
+  /// are used as by insertCOO, and sorted means the columns of each row are
+  /// sorted.
+  void insertCSR(Array pos, Array crd, Array values, bool sorted=false);
+
   /* --- Read Methods        --- */
 
+  /// Returns the component at the coordinate, or zero if it is not stored.
+  /// The component is found by walking down the levels of the packed tensor,
+  /// which takes constant time per dense level and a binary search per
+  /// compressed level.
   template <typename CType>  
   CType at(const std::vector<int>& coordinate);
 
+  /// Returns the components at many coordinates, given as one Int32 array of
+  /// coordinates per mode, in an array of the tensor's component type.  Missing
+  /// components are zero.  The lookups are made in lexicographic order of the
+  /// coordinates, so that lookups of nearby components share their searches,
+  /// and are split between threads.
+  Array gather(const std::vector<Array>& coordinates);
+
+  /// Returns a copy of the tensor whose hashed levels, which are unordered and
+  /// store empty buckets, are converted to ordered compressed levels, e.g.,
+  /// after the tensor was computed by scattering into hashed levels.  Hashed
+  /// levels must be the last level of the format.
+  TensorBase compressHashedLevels();
+
   template<typename T, typename CType>
   class const_iterator {
   public:
@@ -294,7 +339,9 @@ public:
         valBuffer(ctx ? ctx->valBuffer : nullptr),
         curVal(Coordinates(tensorOrder), (CType)0) {
       if (!isEnd) {
-        const auto helperFuncs = tensor->getHelperFunctions(tensor->getFormat(), 
+        // Holding on to the helper functions keeps them from being evicted
+        // from the cache (and unloaded) while the iterator is alive.
+        helperFuncs = tensor->getHelperFunctions(tensor->getFormat(), 
             tensor->getComponentType(), tensor->getDimensions());
         *reinterpret_cast<void**>(&iterFunc) = 
             helperFuncs->getFuncPtr("_shim_iterate");
@@ -328,6 +375,7 @@ public:
     int                            bufferPos;
     int64_t                        chunksIterated;
     fnptr_t                        iterFunc;
+    std::shared_ptr<ir::Module>    helperFuncs;
     const std::shared_ptr<Context> ctx;
     const CType*                   valBuffer;
     value_type                     curVal;
@@ -416,15 +464,52 @@ public:
 
   void compile(IndexStmt stmt, bool assembleWhileCompute=false);
 
+  /// Start compiling the tensor expression on a background compile thread and
+  /// return a handle that becomes ready when compilation finishes.  Other
+  /// compiler methods (assemble, compute, evaluate) wait on the handle, so
+  /// independent expressions compile in parallel with each other and with
+  /// whatever the caller does until it needs the results.  The number of
+  /// compile threads is given by the TACO_COMPILE_THREADS environment
+  /// variable and defaults to the number of hardware threads.
+  std::shared_future<void> compileAsync();
+
   /// Assemble the tensor storage, including index and value arrays.
   void assemble();
 
+  /// Assemble the tensor storage with the threads, schedule and allocators of
+  /// an execution context.
+  void assemble(const ExecutionContext& context);
+
   /// Compute the given expression and put the values in the tensor storage.
   void compute();
 
+  /// Compute the given expression with the threads, schedule and allocators
+  /// of an execution context.
+  void compute(const ExecutionContext& context);
+
+  /// Compute the given expression out of core, for operands that are larger
+  /// than memory, such as tensors memory mapped from tbin files.  The
+  /// outermost loop is split into blocks of rows, such that the parts of the
+  /// operands that each block accesses fit in memoryBudget bytes, and the
+  /// compute kernel runs on one block at a time.  Operands are streamed
+  /// through memory a block at a time: the next block is read ahead while the
+  /// current one is computed, and finished blocks are released.  Operands
+  /// iterated by the outermost loop must be indexed by it in their outermost
+  /// stored mode, which must be dense or compressed, and the result must be
+  /// dense.
+  void computeOutOfCore(size_t memoryBudget);
+
   /// Compile, assemble and compute as needed.
   void evaluate();
 
+  /// Compile, and assemble and compute with an execution context, as needed.
+  void evaluate(const ExecutionContext& context);
+
+  /// Compile the tensor expression if needed, and bind its kernels to the
+  /// tensor and its operands, to evaluate the expression many times with low
+  /// overhead.
+  BoundKernel bind();
+
   /// True if the Tensor needs to be packed.
   bool needsPack();
 
@@ -462,6 +547,29 @@ public:
   /// Get the size of the initial index allocations.
   size_t getAllocSize() const;
 
+  /// Set the allocator of the index and value arrays that assemble and
+  /// compute allocate for the tensor.  By default they are allocated with
+  /// malloc.  A ResultArena reuses the memory of the tensor's earlier results,
+  /// so that evaluating an expression repeatedly neither grows result arrays
+  /// nor faults in new pages.
+  void setResultAllocator(std::shared_ptr<ResultAllocator> allocator);
+
+  /// Get the allocator of the tensor's result arrays, or nullptr if they are
+  /// allocated with malloc.
+  std::shared_ptr<ResultAllocator> getResultAllocator() const;
+
+  /// Set the placement of the tensor's index and value arrays on the memory
+  /// of NUMA nodes (see Placement).  The arrays the tensor already has are
+  /// moved to placed arrays, packing places the packed arrays and results
+  /// are allocated with a PlacedAllocator, which replaces the tensor's result
+  /// allocator.  To let the threads of parallel kernels read their part of
+  /// first touched arrays from their own node, bind them to the cpus of the
+  /// placement in the same order (see ExecutionContext::setAffinity).
+  void setPlacement(const Placement& placement);
+
+  /// Returns the placement of the tensor's index and value arrays.
+  const Placement& getPlacement() const;
+
   /// Get the taco_tensor_t representation of this tensor.
   taco_tensor_t* getTacoTensorT();
 
@@ -488,12 +596,18 @@ public:
   friend std::ostream& operator<<(std::ostream&, TensorBase&);
 
   friend struct AccessTensorNode;
+  friend class BoundKernel;
+  friend void evaluateFused(const std::vector<TensorBase>& results);
   std::vector<TensorBase> getDependentTensors();
 private:
   static std::shared_ptr<ir::Module> getHelperFunctions(
       const Format& format, Datatype ctype, const std::vector<int>& dimensions);
-  static std::shared_ptr<ir::Module> getComputeKernel(const IndexStmt stmt);
-  static void cacheComputeKernel(const IndexStmt stmt, 
+  static void cacheHelperFunctions(const Format& format, Datatype ctype,
+                                   const std::vector<int>& dimensions,
+                                   const std::shared_ptr<ir::Module> helpers);
+  static std::shared_ptr<ir::Module> getComputeKernel(const IndexStmt stmt,
+                                                      size_t hash);
+  static void cacheComputeKernel(const IndexStmt stmt, size_t hash,
                                  const std::shared_ptr<ir::Module> kernel);
 
   /* --- Compiler Methods --- */
@@ -511,6 +625,24 @@ private:
 
   void syncValues();
 
+  /// Compute the tensor, and the other uncomputed tensors that it is
+  /// connected to, with their common subexpressions computed once (see
+  /// taco_set_lazy_dag).
+  void evaluateDag();
+
+  /// Returns the position of the component at the coordinate in the values
+  /// array of the packed tensor, or -1 if the component is not stored.
+  ptrdiff_t locate(const std::vector<int>& coordinate);
+
+  void flushBulkComponents();
+
+  IndexStmt makeCompileStmt();
+  void compileStmt(IndexStmt stmt, bool assembleWhileCompute);
+  void waitForCompile() const;
+  void callKernel(const std::function<int()>& kernel, bool allocatesResults);
+  void assemble(const ExecutionContext* context);
+  void compute(const ExecutionContext* context);
+
   template<typename CType>
   iterator_wrapper<int,CType> iteratorPacked();
   
@@ -529,18 +661,44 @@ private:
 
   struct Content;
   std::shared_ptr<Content> content;
+};
+
+/// The compiled kernels of a tensor's expression bound to the tensor and its
+/// operands, which evaluate the expression with little more overhead than the
+/// kernels themselves.  The kernels are looked up and the order of their
+/// arguments is worked out once, when binding, and each call only refreshes
+/// the arguments whose storage has been replaced since the last call (e.g.
+/// by packing), so values changed in place are picked up for free.  Unlike
+/// the tensor's own compute methods, bound kernels keep evaluating the
+/// expression they were bound to if the tensor is assigned a new one, and
+/// don't compute the tensor before its operands are changed.
+class BoundKernel {
+public:
+  BoundKernel();
+
+  /// Assemble the result's index and allocate its values.
+  void assemble();
+
+  /// Compute the result's values.
+  void compute();
+
+  /// Assemble and compute as needed.
+  void evaluate();
 
-  typedef std::vector<std::tuple<Format,
-                                 Datatype,
-                                 std::vector<int>,
-                                 std::shared_ptr<ir::Module>>> HelperFuncsCache;
-  static HelperFuncsCache helperFunctions;
-  static std::mutex helperFunctionsMutex;
-
-  typedef std::vector<std::pair<IndexStmt, 
-                                std::shared_ptr<ir::Module>>> KernelsCache;
-  static KernelsCache computeKernels;
-  static std::mutex computeKernelsMutex;
+  /// Assemble, compute or evaluate with an execution context.
+  /// @{
+  void assemble(const ExecutionContext& context);
+  void compute(const ExecutionContext& context);
+  void evaluate(const ExecutionContext& context);
+  /// @}
+
+private:
+  void assemble(const ExecutionContext* context);
+  void compute(const ExecutionContext* context);
+
+  friend class TensorBase;
+  struct Content;
+  std::shared_ptr<Content> content;
 };
 
 /// A reference to a tensor. Tensor object copies copies the reference, and
@@ -705,7 +863,13 @@ enum class FileType {
   ttx,
 
   /// .rb  - The rutherford-boeing sparse matrix format.
-  rb
+  rb,
+
+  /// .tbin - The taco binary tensor format.  It stores the packed index and
+  ///         value arrays of a tensor, 64-byte aligned, so that a tensor can
+  ///         be memory mapped without copying.  It must be read with the
+  ///         format it was written with.
+  tbin
 };
 
 /// Read a tensor from a file. The file format is inferred from the filename
@@ -849,6 +1013,17 @@ void getCSCArrays(const TensorBase& tensor,
 /// Pack the operands in the given expression.
 void packOperands(const TensorBase& tensor);
 
+/// Evaluate the expressions of the results with one kernel that fuses them
+/// with the expressions of the operands that have not been computed yet, and
+/// with theirs, transitively (see fuse).  For example, after
+/// t(i) = A(i,j)*x(j), y(i) = t(i) + b(i) and z(i) = y(i)*y(i), evaluating z
+/// computes t and y in registers in the loop over the rows of A.  Operands
+/// that are not results are left uncomputed, and are computed when they are
+/// read.  Results that are read by other results must be dense and be read
+/// in loops over dense modes, and the results must share their result
+/// allocator.
+void evaluateFused(const std::vector<TensorBase>& results);
+
 /// Iterate over the typed values of a TensorBase.
 template <typename CType>
 Tensor<CType> iterate(const TensorBase& tensor) {
@@ -877,16 +1052,27 @@ struct TensorBase::Content {
 
   size_t             allocSize;
   size_t             valuesSize;
+  std::shared_ptr<ResultAllocator> resultAllocator;
+
+  std::shared_ptr<ComponentLocator> locator;
+  uint64_t           locatorVersion;
 
   ir::Stmt           assembleFunc;
   ir::Stmt           computeFunc;
+  IndexStmt          computeStmt;
   bool               assembleWhileCompute;
   std::shared_ptr<ir::Module> module;
+  std::shared_future<void>    pendingCompile;
 
   size_t             coordinateBufferUsed;
   size_t             coordinateSize;
   std::shared_ptr<std::vector<char>> coordinateBuffer;
 
+  bool               hasBulkComponents;
+  bool               bulkComponentsSorted;
+  std::vector<Array> bulkCoordinates;
+  Array              bulkValues;
+
   bool               neverPacked;
   bool               needsPack;
   bool               needsCompile;
@@ -1016,12 +1202,11 @@ CType TensorBase::at(const std::vector<int>& coordinate) {
     "from a tensor with component type " << getComponentType();
   syncValues();
 
-  for (auto& value : iterate<CType>(*this)) {
-    if (value.first.toVector() == coordinate) {
-      return value.second;
-    }
+  ptrdiff_t position = locate(coordinate);
+  if (position < 0) {
+    return 0;
   }
-  return 0;
+  return ((const CType*)getStorage().getValues().getData())[position];
 }
 
 template<typename CType>
@@ -1280,12 +1465,9 @@ TensorBase::const_iterator<T,CType> Tensor<CType>::endTyped() {
 template <typename CType>
 void Tensor<CType>::operator=(const IndexExpr& expr) {TensorBase::operator=(expr);}
 
-enum class ParallelSchedule {
-  Static, Dynamic
-};
-
 /// Set schedule to use for parallel execution of tensor computations.  This 
-/// will be replaced by a scheduling language in the future.
+/// will be replaced by a scheduling language in the future.  Computations
+/// with an ExecutionContext use the context's schedule instead.
 void taco_set_parallel_schedule(ParallelSchedule sched, int chunk_size = 0);
 
 /// Get schedule to use for parallel execution of tensor computations.  This 
@@ -1294,11 +1476,37 @@ void taco_get_parallel_schedule(ParallelSchedule *sched, int *chunk_size);
 
 /// Set maximum number of threads to use for parallel execution of tensor
 /// computations. This will be replaced by a scheduling language in the future.
+/// Computations with an ExecutionContext use the context's threads instead.
 void taco_set_num_threads(int num_threads);
 
 /// Get maximum number of threads to use for parallel execution of tensor 
 /// computations. This will be replaced by a scheduling language in the future.
 int taco_get_num_threads();
 
+/// Set the number of compiled kernels to keep in the in-memory kernel cache.
+/// Beyond this, least recently used kernels that no tensor refers to are
+/// evicted and unloaded.
+void taco_set_kernel_cache_capacity(size_t capacity);
+
+/// Get the number of compiled kernels to keep in the in-memory kernel cache.
+size_t taco_get_kernel_cache_capacity();
+
+/// Set whether tensors are evaluated as a DAG of expressions.  Assigned
+/// expressions are always left uncomputed until a tensor is read, and then
+/// computed one at a time.  In DAG mode, the first read of a tensor instead
+/// computes every uncomputed expression that is connected to it through the
+/// tensors they read.  Subexpressions that occur more than once in them, up
+/// to the names of index variables, are computed once: into a tensor whose
+/// whole expression they are, or else into a new temporary.  The temporary
+/// has the format of a tensor that reads the subexpression and is assigned
+/// over its free variables, and is dense otherwise; subexpressions that are
+/// only read by sparse tensors aren't shared.  Only subexpressions that don't
+/// depend on the variables of enclosing reductions are shared, e.g. the
+/// product B(i,j)*C(j,k) summed over j.
+void taco_set_lazy_dag(bool lazyDag);
+
+/// Get whether tensors are evaluated as a DAG of expressions.
+bool taco_get_lazy_dag();
+
 }
 #endif
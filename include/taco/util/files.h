@@ -4,6 +4,8 @@
 #include <string>
 #include <fstream>
 
+#include "taco/util/uncopyable.h"
+
 namespace taco {
 namespace util {
 
@@ -11,5 +13,33 @@ std::string sanitizePath(std::string path);
 
 void openStream(std::fstream& stream, std::string path, std::fstream::openmode mode);
 
+/// A memory mapping of a whole file.
+class MappedFile : private Uncopyable {
+public:
+  /// Map the file at the given path.  The mapping is read-only, unless
+  /// copyOnWrite is set, in which case it may be written and the writes go to
+  /// private copies of the pages instead of the file.
+  explicit MappedFile(std::string path, bool copyOnWrite=false);
+  ~MappedFile();
+
+  /// Returns the mapped file contents.
+  const char* getData() const;
+
+  /// Returns the size of the file in bytes.
+  size_t getSize() const;
+
+private:
+  const char* data;
+  size_t size;
+};
+
+/// Advise that the memory in [data, data + size) will be accessed soon, so
+/// that the pages of a memory mapped file are read ahead.
+void adviseWillNeed(const void* data, size_t size);
+
+/// Advise that the memory in [data, data + size) will not be accessed again
+/// soon, so that its pages are reclaimed first.  The contents are kept.
+void adviseWontNeed(const void* data, size_t size);
+
 }}
 #endif
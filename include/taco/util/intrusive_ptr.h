@@ -1,6 +1,7 @@
 #ifndef TACO_UTIL_INTRUSIVE_PTR_H
 #define TACO_UTIL_INTRUSIVE_PTR_H
 
+#include <atomic>
 #include <iostream>
 
 namespace taco {
@@ -130,12 +131,21 @@ public:
   }
 };
 
+/// Base class that provides an atomic reference count, so that objects can be
+/// shared by threads (e.g. index notation compiled concurrently).  Copies of an
+/// object start out unreferenced.
 template <class Data>
 class Manageable {
+public:
+  Manageable() {}
+  Manageable(const Manageable&) {}
+  Manageable& operator=(const Manageable&) { return *this; }
+
+private:
   friend void acquire(const Data *data) { ++data->ref; }
   friend void release(const Data *data) { if (--data->ref == 0) delete data; }
 
-  mutable long ref = 0;
+  mutable std::atomic<long> ref{0};
 };
 
 }} // namespace simit::util
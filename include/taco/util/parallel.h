@@ -0,0 +1,53 @@
+#ifndef TACO_UTIL_PARALLEL_H
+#define TACO_UTIL_PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace taco {
+// Declared in taco/tensor.h
+int taco_get_num_threads();
+
+namespace util {
+
+/// Returns the number of blocks to split size work items into, such that
+/// there is at most one block per thread allowed by taco_set_num_threads (and
+/// per hardware thread) and every block has at least minBlockSize items.
+inline int getNumBlocks(size_t size, size_t minBlockSize) {
+  size_t maxBlocks = std::max(std::min(std::thread::hardware_concurrency(),
+                                       (unsigned)taco_get_num_threads()), 1u);
+  size_t numBlocks = std::max(size / std::max(minBlockSize, (size_t)1),
+                              (size_t)1);
+  return (int)std::min(numBlocks, maxBlocks);
+}
+
+/// Returns the first item of a block, when size items are split into
+/// numBlocks contiguous blocks of (nearly) equal size.
+inline size_t getBlockBegin(size_t size, int numBlocks, int block) {
+  return size / numBlocks * block + size % numBlocks * block / numBlocks;
+}
+
+/// Split size items into numBlocks contiguous blocks and call
+/// f(block, begin, end) for each block in parallel.  The calling thread
+/// processes the first block.
+template <typename F>
+void parallelFor(size_t size, int numBlocks, F f) {
+  if (numBlocks <= 1) {
+    f(0, (size_t)0, size);
+    return;
+  }
+  std::vector<std::thread> threads;
+  for (int block = 1; block < numBlocks; block++) {
+    threads.emplace_back(f, block, getBlockBegin(size, numBlocks, block),
+                         getBlockBegin(size, numBlocks, block+1));
+  }
+  f(0, (size_t)0, getBlockBegin(size, numBlocks, 1));
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+}}
+#endif
@@ -0,0 +1,96 @@
+#ifndef TACO_UTIL_TASK_RUNTIME_H
+#define TACO_UTIL_TASK_RUNTIME_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "taco/taco_runtime_t.h"
+#include "taco/util/uncopyable.h"
+
+namespace taco {
+namespace util {
+
+/// A work-stealing runtime that runs the parallel loops of generated code
+/// (see Target::TaskRuntime).  Loops are split in halves until the halves
+/// have at most a grain of iterations; a worker runs one half and queues the
+/// other, and idle workers steal the oldest queued halves of other workers.
+///
+/// The thread that starts a loop takes part in running it, so loops may be
+/// started from any thread, including from the body of another loop of the
+/// same runtime (nested parallelism), without oversubscribing the machine.
+/// Threads that are not workers of the runtime run loops as its last worker.
+class TaskRuntime : private Uncopyable {
+public:
+  /// Start a runtime with the given number of workers (at least one), which
+  /// starts one thread less, since calling threads are the last worker.  If
+  /// cpus is not empty, the threads are bound to the cpus round robin.
+  explicit TaskRuntime(int numWorkers, const std::vector<int>& cpus = {});
+
+  /// Join the threads.  No loops may be running.
+  ~TaskRuntime();
+
+  /// Returns the number of workers, which bounds the worker ids.
+  int getNumWorkers() const;
+
+  /// Run body over the iterations [begin, end) in chunks of at least grain
+  /// iterations, or of a size chosen by the runtime if grain is 0, and return
+  /// when all of them have run.
+  void parallelFor(int64_t begin, int64_t end, int64_t grain,
+                   taco_loop_body_t body, void* closure);
+
+  /// Returns the runtime struct that is passed to generated code, which lets
+  /// the runtime choose grains and allocates workspaces with malloc.  Copies
+  /// of it that set other grains and allocators may be passed too.
+  taco_runtime_t* getRuntime();
+
+  /// Returns a runtime with the given number of workers that is shared by
+  /// the process.  It is started the first time it is requested.
+  static TaskRuntime* getShared(int numWorkers);
+
+private:
+  struct Loop;
+
+  static void runParallelFor(taco_runtime_t* runtime, int64_t begin,
+                             int64_t end, int64_t grain,
+                             taco_loop_body_t body, void* closure);
+  void parallelFor(taco_runtime_t* runtime, int64_t begin, int64_t end,
+                   int64_t grain, taco_loop_body_t body, void* closure);
+
+  struct Task {
+    Loop* loop;
+    int64_t begin;
+    int64_t end;
+  };
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  taco_runtime_t runtime;
+  std::vector<std::thread> threads;
+
+  /// One queue per worker.  Threads that are not workers share the last.
+  std::vector<std::unique_ptr<Queue>> queues;
+
+  std::mutex sleepMutex;
+  std::condition_variable available;
+  std::atomic<int64_t> numQueued;
+  bool stopping;
+
+  int getWorker();
+  void push(int worker, Task task);
+  bool pop(int worker, Loop* loop, Task* task);
+  bool steal(int worker, Loop* loop, Task* task);
+  void run(int worker, Task task);
+  void work(int worker);
+};
+
+}}
+#endif
@@ -0,0 +1,53 @@
+#ifndef TACO_UTIL_THREAD_POOL_H
+#define TACO_UTIL_THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "taco/util/uncopyable.h"
+
+namespace taco {
+namespace util {
+
+/// A fixed-size pool of threads that run submitted tasks in FIFO order.
+class ThreadPool : private Uncopyable {
+public:
+  /// Start a pool with the given number of threads (at least one).
+  explicit ThreadPool(int numThreads);
+
+  /// Finish the queued tasks and join the threads.
+  ~ThreadPool();
+
+  /// Queue a task, returning a future for its result.  Exceptions thrown by
+  /// the task are rethrown by the future.
+  template <typename F>
+  std::future<typename std::result_of<F()>::type> submit(F task) {
+    typedef typename std::result_of<F()>::type R;
+    auto packaged = std::make_shared<std::packaged_task<R()>>(task);
+    std::future<R> result = packaged->get_future();
+    enqueue([packaged]() { (*packaged)(); });
+    return result;
+  }
+
+  /// Returns the number of threads in the pool.
+  int getNumThreads() const;
+
+private:
+  std::vector<std::thread> threads;
+  std::queue<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable available;
+  bool stopping;
+
+  void enqueue(std::function<void()> task);
+  void run();
+};
+
+}}
+#endif
@@ -22,12 +22,15 @@ const std::string bufCapacityCopyName = "__bufcapcopy__";
 const std::string labelPrefix = "resume_";
 
 
-shared_ptr<CodeGen> CodeGen::init_default(std::ostream &dest, OutputKind outputKind) {
+shared_ptr<CodeGen> CodeGen::init_default(std::ostream &dest,
+                                          OutputKind outputKind,
+                                          Target::SIMD simd,
+                                          Target::Parallelism parallelism) {
   if (should_use_CUDA_codegen()) {
     return make_shared<CodeGen_CUDA>(dest, outputKind);
   }
   else {
-    return make_shared<CodeGen_C>(dest, outputKind);
+    return make_shared<CodeGen_C>(dest, outputKind, true, simd, parallelism);
   }
 }
 
@@ -113,6 +116,11 @@ string CodeGen::printType(Datatype type, bool is_ptr) {
   return "";
 }
 
+string CodeGen::printIndexType(Datatype type) {
+  // 32-bit index arrays keep their historical int type in generated code
+  return (type == Int32) ? "int" : printType(type, false);
+}
+
 string CodeGen::printCAlloc(string pointer, string size) {
   return pointer + " = malloc(" + size + ");";
 }
@@ -208,7 +216,7 @@ string CodeGen::printTensorProperty(string varname, const GetProperty* op, bool
     ret << " " << varname;
     return ret.str();
   } else if (op->property == TensorProperty::ValuesSize) {
-    ret << "int" << star << " " << varname;
+    ret << "int64_t" << star << " " << varname;
     return ret.str();
   }
 
@@ -222,7 +230,7 @@ string CodeGen::printTensorProperty(string varname, const GetProperty* op, bool
     ret << tp << " " << varname;
   } else {
     taco_iassert(op->property == TensorProperty::Indices);
-    tp = "int*" + star;
+    tp = printIndexType(op->type) + "*" + star;
     ret << tp << " " << varname;
   }
 
@@ -242,7 +250,7 @@ string CodeGen::unpackTensorProperty(string varname, const GetProperty* op,
     ret << tensor->name << "->vals);\n";
     return ret.str();
   } else if (op->property == TensorProperty::ValuesSize) {
-    ret << "int " << varname << " = " << tensor->name << "->vals_size;\n";
+    ret << "int64_t " << varname << " = " << tensor->name << "->vals_size;\n";
     return ret.str();
   }
 
@@ -257,10 +265,10 @@ string CodeGen::unpackTensorProperty(string varname, const GetProperty* op,
         << "->dimensions[" << op->mode << "]);\n";
   } else {
     taco_iassert(op->property == TensorProperty::Indices);
-    tp = "int*";
+    tp = printIndexType(op->type) + "*";
     auto nm = op->index;
     ret << tp << " " << restrictKeyword() << " " << varname << " = ";
-    ret << "(int*)(" << tensor->name << "->indices[" << op->mode;
+    ret << "(" << tp << ")(" << tensor->name << "->indices[" << op->mode;
     ret << "][" << nm << "]);\n";
   }
 
@@ -292,7 +300,6 @@ string CodeGen::packTensorProperty(string varname, Expr tnsr,
     return "";
   } else {
     taco_iassert(property == TensorProperty::Indices);
-    tp = "int*";
     auto nm = index;
     ret << tensor->name << "->indices" <<
         "[" << mode << "][" << nm << "] = (uint8_t*)(" << varname
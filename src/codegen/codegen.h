@@ -4,6 +4,7 @@
 #include <memory>
 #include "taco/ir/ir.h"
 #include "taco/ir/ir_printer.h"
+#include "taco/target.h"
 
 namespace taco {
 namespace ir {
@@ -17,8 +18,12 @@ public:
 
   CodeGen(std::ostream& stream, CodeGenType type) : IRPrinter(stream), codeGenType(type) {};
   CodeGen(std::ostream& stream, bool color, bool simplify, CodeGenType type) : IRPrinter(stream, color, simplify), codeGenType(type) {};
-  /// Initialize the default code generator
-  static std::shared_ptr<CodeGen> init_default(std::ostream &dest, OutputKind outputKind);
+  /// Initialize the default code generator, which emits loops parallelized
+  /// over CPU vector lanes for the given SIMD instruction set and loops
+  /// parallelized over CPU threads for the given parallelism model.
+  static std::shared_ptr<CodeGen> init_default(std::ostream &dest,
+      OutputKind outputKind, Target::SIMD simd=Target::NoSIMD,
+      Target::Parallelism parallelism=Target::OpenMP);
 
   /// Compile a lowered function
   virtual void compile(Stmt stmt, bool isFirst=false) =0;
@@ -39,6 +44,8 @@ protected:
   std::string printFree(std::string pointer);
 
   std::string printType(Datatype type, bool is_ptr);
+  /// Print the element type of an index array of the given type.
+  std::string printIndexType(Datatype type);
   std::string printContextDeclAndInit(std::map<Expr, std::string, ExprCompare> varMap,
                                           std::vector<Expr> localVars, int labels,
                                           std::string funcName);
@@ -53,6 +60,8 @@ protected:
           std::map<Expr, std::string, ExprCompare> inputMap={}, 
           std::map<Expr, std::string, ExprCompare> outputMap={});
 
+  std::string printTensorProperty(std::string varname, const GetProperty* op, bool is_ptr);
+
   void resetUniqueNameCounters();
   std::string genUniqueName(std::string name);
   void doIndentStream(std::stringstream &stream);
@@ -61,7 +70,6 @@ protected:
 private:
   virtual std::string restrictKeyword() const { return ""; }
 
-  std::string printTensorProperty(std::string varname, const GetProperty* op, bool is_ptr);
   std::string unpackTensorProperty(std::string varname, const GetProperty* op,
                               bool is_output_prop);
   std::string packTensorProperty(std::string varname, Expr tnsr, TensorProperty property,
@@ -6,6 +6,8 @@
 #include <taco.h>
 
 #include "taco/ir/ir_visitor.h"
+#include "taco/ir/ir_rewriter.h"
+#include "taco/ir/simplify.h"
 #include "codegen_c.h"
 #include "taco/error.h"
 #include "taco/util/strings.h"
@@ -21,9 +23,13 @@ namespace {
 
 // Include stdio.h for printf
 // stdlib.h for malloc/realloc
+// Result arrays are allocated through taco_allocateResult, which modules
+// point at the host's result allocator when they load
+// Parallel loops and workspaces of code generated for the task runtime go
+// through the taco_runtime_t that is passed to the generated functions
 // math.h for sqrt
 // MIN preprocessor macro
-// This *must* be kept in sync with taco_tensor_t.h
+// This *must* be kept in sync with taco_tensor_t.h and taco_runtime_t.h
 const string cHeaders =
   "#ifndef TACO_C_HEADERS\n"
   "#define TACO_C_HEADERS\n"
@@ -51,9 +57,24 @@ const string cHeaders =
   "  taco_mode_t* mode_types;    // mode storage types\n"
   "  uint8_t***   indices;       // tensor index data (per mode)\n"
   "  uint8_t*     vals;          // tensor values\n"
-  "  int32_t      vals_size;     // values array size\n"
+  "  int64_t      vals_size;     // values array size\n"
   "} taco_tensor_t;\n"
   "#endif\n"
+  "#ifndef TACO_RUNTIME_T_DEFINED\n"
+  "#define TACO_RUNTIME_T_DEFINED\n"
+  "struct taco_runtime_t;\n"
+  "typedef void (*taco_loop_body_t)(struct taco_runtime_t*, void*, int64_t,\n"
+  "                                 int64_t, int32_t);\n"
+  "typedef struct taco_runtime_t {\n"
+  "  void*   impl;                   // runtime implementation\n"
+  "  int32_t num_workers;            // number of workers (bound on worker ids)\n"
+  "  int64_t grain;                  // grain of loops that pass a grain of 0\n"
+  "  void  (*parallel_for)(struct taco_runtime_t*, int64_t, int64_t, int64_t,\n"
+  "                        taco_loop_body_t, void*);\n"
+  "  void*   allocator;              // allocator of workspaces\n"
+  "  void* (*allocate)(struct taco_runtime_t*, void*, size_t, int);\n"
+  "} taco_runtime_t;\n"
+  "#endif\n"
   "#if !_OPENMP\n"
   "int omp_get_thread_num() { return 0; }\n"
   "int omp_get_max_threads() { return 1; }\n"
@@ -103,6 +124,131 @@ const string cHeaders =
   "  }\n"
   "  return lowerBound;\n"
   "}\n"
+  "int64_t taco_binarySearchAfter64(int64_t *array, int64_t arrayStart, int64_t arrayEnd, int64_t target) {\n"
+  "  if (array[arrayStart] >= target) {\n"
+  "    return arrayStart;\n"
+  "  }\n"
+  "  int64_t lowerBound = arrayStart; // always < target\n"
+  "  int64_t upperBound = arrayEnd; // always >= target\n"
+  "  while (upperBound - lowerBound > 1) {\n"
+  "    int64_t mid = (upperBound + lowerBound) / 2;\n"
+  "    int64_t midValue = array[mid];\n"
+  "    if (midValue < target) {\n"
+  "      lowerBound = mid;\n"
+  "    }\n"
+  "    else if (midValue > target) {\n"
+  "      upperBound = mid;\n"
+  "    }\n"
+  "    else {\n"
+  "      return mid;\n"
+  "    }\n"
+  "  }\n"
+  "  return upperBound;\n"
+  "}\n"
+  "int64_t taco_binarySearchBefore64(int64_t *array, int64_t arrayStart, int64_t arrayEnd, int64_t target) {\n"
+  "  if (array[arrayEnd] <= target) {\n"
+  "    return arrayEnd;\n"
+  "  }\n"
+  "  int64_t lowerBound = arrayStart; // always <= target\n"
+  "  int64_t upperBound = arrayEnd; // always > target\n"
+  "  while (upperBound - lowerBound > 1) {\n"
+  "    int64_t mid = (upperBound + lowerBound) / 2;\n"
+  "    int64_t midValue = array[mid];\n"
+  "    if (midValue < target) {\n"
+  "      lowerBound = mid;\n"
+  "    }\n"
+  "    else if (midValue > target) {\n"
+  "      upperBound = mid;\n"
+  "    }\n"
+  "    else {\n"
+  "      return mid;\n"
+  "    }\n"
+  "  }\n"
+  "  return lowerBound;\n"
+  "}\n"
+  "int taco_gallop(int *array, int arrayStart, int arrayEnd, int target) {\n"
+  "  if (arrayStart >= arrayEnd || array[arrayStart] >= target) {\n"
+  "    return arrayStart;\n"
+  "  }\n"
+  "  int lowerBound = arrayStart; // always < target\n"
+  "  int step = 1;\n"
+  "  while (lowerBound + step < arrayEnd && array[lowerBound + step] < target) {\n"
+  "    lowerBound += step;\n"
+  "    step *= 2;\n"
+  "  }\n"
+  "  return taco_binarySearchAfter(array, lowerBound, TACO_MIN(lowerBound + step, arrayEnd), target);\n"
+  "}\n"
+  "int64_t taco_gallop64(int64_t *array, int64_t arrayStart, int64_t arrayEnd, int64_t target) {\n"
+  "  if (arrayStart >= arrayEnd || array[arrayStart] >= target) {\n"
+  "    return arrayStart;\n"
+  "  }\n"
+  "  int64_t lowerBound = arrayStart; // always < target\n"
+  "  int64_t step = 1;\n"
+  "  while (lowerBound + step < arrayEnd && array[lowerBound + step] < target) {\n"
+  "    lowerBound += step;\n"
+  "    step *= 2;\n"
+  "  }\n"
+  "  return taco_binarySearchAfter64(array, lowerBound, TACO_MIN(lowerBound + step, arrayEnd), target);\n"
+  "}\n"
+  "int taco_mergePathSearch(int *pos, int64_t rows, int64_t nnz, int64_t diagonal) {\n"
+  "  // Find the row at which the diagonal crosses the path that merges the\n"
+  "  // ends of the rows with the positions of their nonzeros.  The path is\n"
+  "  // longer than an int, even if the rows and nonzeros aren't.\n"
+  "  int64_t lowerBound = TACO_MAX(diagonal - nnz, 0);\n"
+  "  int64_t upperBound = TACO_MIN(diagonal, rows);\n"
+  "  while (lowerBound < upperBound) {\n"
+  "    int64_t mid = lowerBound + (upperBound - lowerBound) / 2;\n"
+  "    if (pos[mid + 1] <= diagonal - mid - 1) {\n"
+  "      lowerBound = mid + 1;\n"
+  "    }\n"
+  "    else {\n"
+  "      upperBound = mid;\n"
+  "    }\n"
+  "  }\n"
+  "  return (int)lowerBound;\n"
+  "}\n"
+  "int64_t taco_mergePathSearch64(int64_t *pos, int64_t rows, int64_t nnz, int64_t diagonal) {\n"
+  "  int64_t lowerBound = TACO_MAX(diagonal - nnz, 0);\n"
+  "  int64_t upperBound = TACO_MIN(diagonal, rows);\n"
+  "  while (lowerBound < upperBound) {\n"
+  "    int64_t mid = lowerBound + (upperBound - lowerBound) / 2;\n"
+  "    if (pos[mid + 1] <= diagonal - mid - 1) {\n"
+  "      lowerBound = mid + 1;\n"
+  "    }\n"
+  "    else {\n"
+  "      upperBound = mid;\n"
+  "    }\n"
+  "  }\n"
+  "  return lowerBound;\n"
+  "}\n"
+  "int taco_hashLocate(int *crd, int begin, int width, int coordinate) {\n"
+  "  int bucket = (int)((uint32_t)coordinate * 2654435761u & (uint32_t)(width - 1));\n"
+  "  for (int probes = 0; probes < width; probes++) {\n"
+  "    int stored = crd[begin + bucket];\n"
+  "    if (stored == coordinate || stored < 0) {\n"
+  "      return begin + bucket;\n"
+  "    }\n"
+  "    bucket = (bucket + 1) & (width - 1);\n"
+  "  }\n"
+  "  // The segment is full, which the host reports once the kernel returns\n"
+  "  return -1;\n"
+  "}\n"
+  "int64_t taco_hashLocate64(int64_t *crd, int64_t begin, int64_t width, int64_t coordinate) {\n"
+  "  int64_t bucket = (int64_t)((uint32_t)coordinate * 2654435761u & (uint32_t)(width - 1));\n"
+  "  for (int64_t probes = 0; probes < width; probes++) {\n"
+  "    int64_t stored = crd[begin + bucket];\n"
+  "    if (stored == coordinate || stored < 0) {\n"
+  "      return begin + bucket;\n"
+  "    }\n"
+  "    bucket = (bucket + 1) & (width - 1);\n"
+  "  }\n"
+  "  // The segment is full, which the host reports once the kernel returns\n"
+  "  return -1;\n"
+  "}\n"
+  "void* taco_defaultAllocateResult(void* data, size_t size, int clear) {\n"
+  "  return clear ? calloc(1, size) : realloc(data, size);\n"
+  "}\n"
+  "void* (*taco_allocateResult)(void*, size_t, int) = taco_defaultAllocateResult;\n"
   "taco_tensor_t* init_taco_tensor_t(int32_t order, int32_t csize,\n"
   "                                  int32_t* dimensions, int32_t* mode_ordering,\n"
   "                                  taco_mode_t* mode_types) {\n"
@@ -239,8 +385,731 @@ protected:
   }
 };
 
-CodeGen_C::CodeGen_C(std::ostream &dest, OutputKind outputKind, bool simplify)
-    : CodeGen(dest, false, simplify, C), out(dest), outputKind(outputKind) {}
+namespace {
+
+/// Replaces variables of an expression with other expressions.
+struct ReplaceVars : public IRRewriter {
+  const map<Expr, Expr, ExprCompare>& replacements;
+
+  ReplaceVars(const map<Expr, Expr, ExprCompare>& replacements)
+      : replacements(replacements) {}
+
+  using IRRewriter::visit;
+
+  void visit(const Var* op) {
+    auto replacement = replacements.find(op);
+    expr = (replacement != replacements.end()) ? replacement->second : op;
+  }
+};
+
+/// Collects the names of the variables and tensor properties that an IR node
+/// refers to.
+struct CollectNames : public IRVisitor {
+  set<string> names;
+  set<const Var*> vars;
+
+  using IRVisitor::visit;
+
+  void visit(const Var* op) {
+    names.insert(op->name);
+    vars.insert(op);
+  }
+
+  void visit(const GetProperty* op) {
+    names.insert(op->name);
+  }
+};
+
+CollectNames collectNames(const IRNode* node) {
+  CollectNames collector;
+  node->accept(&collector);
+  return collector;
+}
+
+CollectNames collectNames(Expr expr) {
+  return collectNames(expr.ptr);
+}
+
+/// Returns the names that an IR node refers to.
+set<string> getNames(const IRNode* node) {
+  return collectNames(node).names;
+}
+
+set<string> getNames(Expr expr) {
+  return getNames(expr.ptr);
+}
+
+set<string> getNames(Stmt stmt) {
+  return getNames(stmt.ptr);
+}
+
+/// Returns whether two expressions print the same, and hence compute the
+/// same value in the same iteration.
+bool isSame(Expr a, Expr b) {
+  return util::toString(a) == util::toString(b);
+}
+
+}
+
+/// Emits a loop that is parallelized over CPU vector lanes with explicit
+/// vectors (GCC/Clang vector extensions).  Blocks of as many iterations as a
+/// vector has lanes run together: integer computations, such as positions
+/// and coordinates, are replicated once per lane, floating-point computations
+/// operate on vectors, loads of contiguous positions are vector loads and
+/// other loads are gathers, and reductions accumulate into vectors that are
+/// summed after the loop.  The iterations that don't fill a vector run in a
+/// scalar loop after the vector loop.
+class CodeGen_C::VectorLoop {
+public:
+  VectorLoop(CodeGen_C* codegen, const For* loop)
+      : codegen(codegen), loop(loop), lanes(0) {}
+
+  /// Returns whether the loop can be vectorized, which requires its body to
+  /// be a sequence of declarations, assignments and stores that compute
+  /// values of a single floating-point type.
+  bool analyze() {
+    auto increment = loop->increment.as<Literal>();
+    if (increment == nullptr || !increment->type.isInt() ||
+        !increment->equalsScalar(1) || !flatten(loop->contents)) {
+      return false;
+    }
+    for (auto& stmt : body) {
+      if (!analyze(stmt)) {
+        return false;
+      }
+    }
+    if (!type.isFloat()) {
+      return false;
+    }
+    lanes = Target::getVectorBytes(codegen->simd) / type.getNumBytes();
+
+    // Values that are accumulated or stored across lanes must not be read
+    // or written by other statements, whose order relative to the other
+    // lanes changes.
+    for (auto& statement : statements) {
+      if (statement.target.empty()) {
+        continue;
+      }
+      for (auto& other : statements) {
+        if (&other != &statement &&
+            getNames(other.stmt).count(statement.target) > 0) {
+          return false;
+        }
+      }
+    }
+    return lanes > 1;
+  }
+
+  /// Emits the vector loop followed by the scalar loop.
+  void emit() {
+    string elementType = codegen->printCType(type, false);
+    vectorType = "taco_" + elementType + "x" + to_string(lanes);
+    string unalignedType = vectorType + "_u";
+    Expr var = loop->var;
+
+    codegen->doIndent();
+    codegen->stream << "{\n";
+    codegen->indent++;
+    codegen->doIndent();
+    codegen->stream << "typedef " << elementType << " " << vectorType
+                    << " __attribute__((vector_size("
+                    << lanes * type.getNumBytes() << ")));\n";
+    codegen->doIndent();
+    codegen->stream << "typedef " << elementType << " " << unalignedType
+                    << " __attribute__((vector_size("
+                    << lanes * type.getNumBytes() << "), aligned("
+                    << type.getNumBytes() << ")));\n";
+    unaligned = unalignedType;
+    for (auto& statement : statements) {
+      if (statement.kind == Statement::Reduction) {
+        statement.accumulator =
+            codegen->genUniqueName(statement.target + "_vec");
+        codegen->doIndent();
+        codegen->stream << vectorType << " " << statement.accumulator
+                        << " = {0};\n";
+      }
+    }
+    codegen->doIndent();
+    codegen->stream << codegen->keywordString(util::toString(var.type()))
+                    << " ";
+    var.accept(codegen);
+    codegen->stream << " = ";
+    codegen->parentPrecedence = Precedence::TOP;
+    loop->start.accept(codegen);
+    codegen->stream << ";\n";
+
+    codegen->doIndent();
+    codegen->stream << codegen->keywordString("for") << " (; ";
+    var.accept(codegen);
+    codegen->stream << " + " << lanes << " <= ";
+    codegen->parentPrecedence = Precedence::BOTTOM;
+    loop->end.accept(codegen);
+    codegen->stream << "; ";
+    var.accept(codegen);
+    codegen->stream << " += " << lanes << ") {\n";
+    codegen->indent++;
+    for (auto& statement : statements) {
+      emit(statement);
+    }
+    codegen->indent--;
+    codegen->doIndent();
+    codegen->stream << "}\n";
+
+    // Sum the lanes of the accumulators
+    for (auto& statement : statements) {
+      if (statement.kind == Statement::Reduction) {
+        codegen->doIndent();
+        codegen->parentPrecedence = Precedence::TOP;
+        statement.destination.accept(codegen);
+        codegen->stream << " += ";
+        for (int lane = 0; lane < lanes; lane++) {
+          codegen->stream << (lane > 0 ? " + " : "")
+                          << statement.accumulator << "[" << lane << "]";
+        }
+        codegen->stream << ";\n";
+      }
+    }
+
+    codegen->doIndent();
+    codegen->stream << codegen->keywordString("for") << " (; ";
+    var.accept(codegen);
+    codegen->stream << " < ";
+    codegen->parentPrecedence = Precedence::BOTTOM;
+    loop->end.accept(codegen);
+    codegen->stream << "; ";
+    var.accept(codegen);
+    codegen->stream << "++) {\n";
+    loop->contents.accept(codegen);
+    codegen->doIndent();
+    codegen->stream << "}\n";
+    codegen->indent--;
+    codegen->doIndent();
+    codegen->stream << "}\n";
+  }
+
+private:
+  typedef IRPrinter::Precedence Precedence;
+
+  /// How the positions of a load or store change from lane to lane
+  enum Stride {Invariant, Unit, Irregular};
+
+  /// A statement of the loop body and how it is vectorized
+  struct Statement {
+    enum Kind {
+      LaneDecl,      // an integer declared in each lane
+      VectorDecl,    // a floating-point vector declaration
+      VectorAssign,  // an assignment to a vector
+      Reduction,     // a sum into a variable or location outside the loop
+      VectorStore,   // a store to contiguous locations
+      Scatter,       // stores to the locations of each lane
+      ScatterAdd     // sums into the locations of each lane, in lane order
+    } kind;
+    Stmt stmt;
+
+    /// The value that is declared, assigned, stored or summed
+    Expr value;
+
+    /// The variable, or location of the array, that a reduction sums into
+    Expr destination;
+
+    /// The name of the variable or array that is summed into or stored to
+    string target;
+    string accumulator;
+  };
+
+  CodeGen_C* codegen;
+  const For* loop;
+  Datatype type;
+  int lanes;
+  string vectorType;
+  string unaligned;
+
+  vector<Stmt> body;
+  vector<Statement> statements;
+
+  /// The variables of each lane of integers declared in the loop, and the
+  /// values they are declared as
+  map<Expr, vector<Expr>, ExprCompare> laneVars;
+  map<Expr, Expr, ExprCompare> definitions;
+
+  /// The names of the vectors of floating-point variables declared in the
+  /// loop
+  map<Expr, string, ExprCompare> vectorVars;
+
+  bool flatten(Stmt stmt) {
+    if (isa<Block>(stmt)) {
+      for (auto& child : to<Block>(stmt)->contents) {
+        if (!flatten(child)) {
+          return false;
+        }
+      }
+      return true;
+    } else if (isa<Scope>(stmt)) {
+      return flatten(to<Scope>(stmt)->scopedStmt);
+    } else if (isa<Comment>(stmt) || isa<BlankLine>(stmt)) {
+      return true;
+    } else if (isa<VarDecl>(stmt) || isa<Assign>(stmt) || isa<Store>(stmt)) {
+      body.push_back(stmt);
+      return true;
+    }
+    return false;
+  }
+
+  bool setType(Datatype valueType) {
+    if (!valueType.isFloat() || (type.isFloat() && type != valueType)) {
+      return false;
+    }
+    type = valueType;
+    return true;
+  }
+
+  bool isLaneVar(const Var* var) const {
+    return var == loop->var.as<Var>() || laneVars.count(var) > 0;
+  }
+
+  bool isVarying(Expr expr) const {
+    for (auto var : collectNames(expr).vars) {
+      if (isLaneVar(var) || vectorVars.count(var) > 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// Returns whether an integer expression can be computed in each lane.
+  bool hasLanes(Expr expr) const {
+    for (auto var : collectNames(expr).vars) {
+      if (vectorVars.count(var) > 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  Stride getStride(Expr expr) const {
+    if (!isVarying(expr)) {
+      return Invariant;
+    } else if (expr == loop->var) {
+      return Unit;
+    } else if (isa<Var>(expr) && definitions.count(expr) > 0) {
+      return getStride(definitions.at(expr));
+    } else if (isa<ir::Add>(expr)) {
+      Stride a = getStride(to<ir::Add>(expr)->a);
+      Stride b = getStride(to<ir::Add>(expr)->b);
+      return ((a == Unit && b == Invariant) || (a == Invariant && b == Unit))
+             ? Unit : Irregular;
+    } else if (isa<ir::Sub>(expr)) {
+      Stride a = getStride(to<ir::Sub>(expr)->a);
+      Stride b = getStride(to<ir::Sub>(expr)->b);
+      return (a == Unit && b == Invariant) ? Unit : Irregular;
+    }
+    return Irregular;
+  }
+
+  /// Returns whether a floating-point expression can be computed as a vector.
+  bool isVectorizable(Expr expr) {
+    if (!isVarying(expr)) {
+      return !expr.type().isComplex();
+    } else if (isa<Var>(expr)) {
+      return vectorVars.count(expr) > 0;
+    } else if (isa<Load>(expr)) {
+      return setType(expr.type()) && hasLanes(to<Load>(expr)->loc);
+    } else if (isa<Neg>(expr)) {
+      return setType(expr.type()) && isVectorizable(to<Neg>(expr)->a);
+    }
+    Expr a, b;
+    if (isa<ir::Add>(expr)) {
+      a = to<ir::Add>(expr)->a;
+      b = to<ir::Add>(expr)->b;
+    } else if (isa<ir::Sub>(expr)) {
+      a = to<ir::Sub>(expr)->a;
+      b = to<ir::Sub>(expr)->b;
+    } else if (isa<ir::Mul>(expr)) {
+      a = to<ir::Mul>(expr)->a;
+      b = to<ir::Mul>(expr)->b;
+    } else if (isa<ir::Div>(expr)) {
+      a = to<ir::Div>(expr)->a;
+      b = to<ir::Div>(expr)->b;
+    } else {
+      return false;
+    }
+    return setType(expr.type()) && isVectorizable(a) && isVectorizable(b);
+  }
+
+  /// Returns the value that is added to a location or variable if a value
+  /// has the form target + value, and an undefined expression otherwise.
+  static Expr getAddend(Expr value, Expr target) {
+    auto add = value.as<ir::Add>();
+    if (add == nullptr || !isSame(add->a, target)) {
+      return Expr();
+    }
+    return add->b;
+  }
+
+  bool analyze(Stmt stmt) {
+    Statement statement;
+    statement.stmt = stmt;
+    if (isa<VarDecl>(stmt)) {
+      auto decl = to<VarDecl>(stmt);
+      auto var = decl->var.as<Var>();
+      if (var->is_ptr || decl->var.type().isComplex()) {
+        return false;
+      }
+      if (decl->var.type().isFloat()) {
+        if (!setType(decl->var.type()) || !isVectorizable(decl->rhs)) {
+          return false;
+        }
+        statement.kind = Statement::VectorDecl;
+        vectorVars[decl->var] = "";
+      } else {
+        if (!hasLanes(decl->rhs)) {
+          return false;
+        }
+        statement.kind = Statement::LaneDecl;
+        laneVars[decl->var] = {};
+        definitions[decl->var] = decl->rhs;
+      }
+      statement.value = decl->rhs;
+    } else if (isa<Assign>(stmt)) {
+      auto assign = to<Assign>(stmt);
+      if (assign->use_atomics || !isa<Var>(assign->lhs)) {
+        return false;
+      }
+      if (vectorVars.count(assign->lhs) > 0) {
+        if (!isVectorizable(assign->rhs)) {
+          return false;
+        }
+        statement.kind = Statement::VectorAssign;
+        statement.value = assign->rhs;
+      } else {
+        Expr addend = getAddend(assign->rhs, assign->lhs);
+        if (isVarying(assign->lhs) || !setType(assign->lhs.type()) ||
+            !addend.defined() || !isVectorizable(addend)) {
+          return false;
+        }
+        statement.kind = Statement::Reduction;
+        statement.value = addend;
+        statement.destination = assign->lhs;
+        statement.target = to<Var>(assign->lhs)->name;
+        if (getNames(addend).count(statement.target) > 0) {
+          return false;
+        }
+      }
+    } else {
+      auto store = to<Store>(stmt);
+      if (store->use_atomics || !setType(store->data.type()) ||
+          !hasLanes(store->loc)) {
+        return false;
+      }
+      statement.target = util::toString(store->arr);
+      Expr location = Load::make(store->arr, store->loc);
+      Expr addend = getAddend(store->data, location);
+      Expr value = addend.defined() ? addend : store->data;
+      if (getNames(value).count(statement.target) > 0 ||
+          !isVectorizable(value)) {
+        return false;
+      }
+      switch (getStride(store->loc)) {
+        case Invariant:
+          if (!addend.defined()) {
+            return false;
+          }
+          statement.kind = Statement::Reduction;
+          statement.value = addend;
+          statement.destination = location;
+          break;
+        case Unit:
+          statement.kind = Statement::VectorStore;
+          statement.value = store->data;
+          break;
+        case Irregular:
+          statement.kind = addend.defined() ? Statement::ScatterAdd
+                                            : Statement::Scatter;
+          statement.value = value;
+          break;
+      }
+    }
+    statements.push_back(statement);
+    return true;
+  }
+
+  /// Returns an integer expression of the loop body as computed in a lane.
+  Expr getLane(Expr expr, int lane) const {
+    map<Expr, Expr, ExprCompare> replacements;
+    replacements[loop->var] = (lane == 0) ? loop->var
+                                          : ir::Add::make(loop->var, lane);
+    for (auto& laneVar : laneVars) {
+      if (!laneVar.second.empty()) {
+        replacements[laneVar.first] = laneVar.second[lane];
+      }
+    }
+    ReplaceVars replaceVars(replacements);
+    return replaceVars.rewrite(expr);
+  }
+
+  void printLane(Expr expr, int lane) {
+    codegen->parentPrecedence = Precedence::TOP;
+    getLane(expr, lane).accept(codegen);
+  }
+
+  void printVector(Expr expr) {
+    auto& stream = codegen->stream;
+    if (!isVarying(expr)) {
+      stream << "((" << vectorType << "){";
+      for (int lane = 0; lane < lanes; lane++) {
+        stream << (lane > 0 ? ", " : "");
+        codegen->parentPrecedence = Precedence::TOP;
+        expr.accept(codegen);
+      }
+      stream << "})";
+    } else if (isa<Var>(expr)) {
+      stream << vectorVars.at(expr);
+    } else if (isa<Load>(expr)) {
+      auto load = to<Load>(expr);
+      if (getStride(load->loc) == Unit) {
+        stream << "(*(" << unaligned << "*)&";
+        printLane(expr, 0);
+        stream << ")";
+      } else {
+        stream << "((" << vectorType << "){";
+        for (int lane = 0; lane < lanes; lane++) {
+          stream << (lane > 0 ? ", " : "");
+          printLane(expr, lane);
+        }
+        stream << "})";
+      }
+    } else if (isa<Neg>(expr)) {
+      stream << "(-";
+      printVector(to<Neg>(expr)->a);
+      stream << ")";
+    } else {
+      Expr a, b;
+      string op;
+      if (isa<ir::Add>(expr)) {
+        a = to<ir::Add>(expr)->a;
+        b = to<ir::Add>(expr)->b;
+        op = " + ";
+      } else if (isa<ir::Sub>(expr)) {
+        a = to<ir::Sub>(expr)->a;
+        b = to<ir::Sub>(expr)->b;
+        op = " - ";
+      } else if (isa<ir::Mul>(expr)) {
+        a = to<ir::Mul>(expr)->a;
+        b = to<ir::Mul>(expr)->b;
+        op = " * ";
+      } else {
+        taco_iassert(isa<ir::Div>(expr));
+        a = to<ir::Div>(expr)->a;
+        b = to<ir::Div>(expr)->b;
+        op = " / ";
+      }
+      stream << "(";
+      printVector(a);
+      stream << op;
+      printVector(b);
+      stream << ")";
+    }
+  }
+
+  void emit(Statement& statement) {
+    auto& stream = codegen->stream;
+    switch (statement.kind) {
+      case Statement::LaneDecl: {
+        auto decl = to<VarDecl>(statement.stmt);
+        auto& vars = laneVars.at(decl->var);
+        vector<Expr> declared;
+        for (int lane = 0; lane < lanes; lane++) {
+          Expr laneVar = Var::make(to<Var>(decl->var)->name,
+                                   decl->var.type());
+          codegen->varMap[laneVar] = codegen->genUniqueName(
+              codegen->varMap[decl->var] + "_" + to_string(lane));
+          codegen->doIndent();
+          stream << codegen->keywordString(util::toString(decl->var.type()))
+                 << " ";
+          laneVar.accept(codegen);
+          stream << " = ";
+          printLane(decl->rhs, lane);
+          stream << ";\n";
+          declared.push_back(laneVar);
+        }
+        vars = declared;
+        break;
+      }
+      case Statement::VectorDecl: {
+        auto decl = to<VarDecl>(statement.stmt);
+        string name = codegen->genUniqueName(codegen->varMap[decl->var] +
+                                             "_vec");
+        codegen->doIndent();
+        stream << vectorType << " " << name << " = ";
+        printVector(statement.value);
+        stream << ";\n";
+        vectorVars[decl->var] = name;
+        break;
+      }
+      case Statement::VectorAssign:
+        codegen->doIndent();
+        stream << vectorVars.at(to<Assign>(statement.stmt)->lhs) << " = ";
+        printVector(statement.value);
+        stream << ";\n";
+        break;
+      case Statement::Reduction:
+        codegen->doIndent();
+        stream << statement.accumulator << " += ";
+        printVector(statement.value);
+        stream << ";\n";
+        break;
+      case Statement::VectorStore: {
+        auto store = to<Store>(statement.stmt);
+        codegen->doIndent();
+        stream << "*(" << unaligned << "*)&";
+        printLane(Load::make(store->arr, store->loc), 0);
+        stream << " = ";
+        printVector(statement.value);
+        stream << ";\n";
+        break;
+      }
+      case Statement::Scatter:
+      case Statement::ScatterAdd: {
+        // Lanes that store to the same location do so in lane order
+        auto store = to<Store>(statement.stmt);
+        string name = codegen->genUniqueName("scattered");
+        codegen->doIndent();
+        stream << vectorType << " " << name << " = ";
+        printVector(statement.value);
+        stream << ";\n";
+        for (int lane = 0; lane < lanes; lane++) {
+          codegen->doIndent();
+          printLane(Load::make(store->arr, store->loc), lane);
+          stream << (statement.kind == Statement::ScatterAdd ? " += " : " = ")
+                 << name << "[" << lane << "];\n";
+        }
+        break;
+      }
+    }
+  }
+};
+
+namespace {
+
+bool isParallelLoop(const For* op) {
+  switch (op->kind) {
+    case LoopKind::Static:
+    case LoopKind::Dynamic:
+    case LoopKind::Runtime:
+    case LoopKind::Static_Chunked:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/// Replaces the loads of a location with another expression.
+struct ReplaceLoads : public IRRewriter {
+  Expr location;
+  Expr replacement;
+
+  ReplaceLoads(Expr location, Expr replacement)
+      : location(location), replacement(replacement) {}
+
+  using IRRewriter::visit;
+
+  void visit(const Load* op) {
+    expr = isSame(op, location) ? replacement : op;
+  }
+};
+
+}
+
+/// Finds the variables and tensor properties that the body of a parallel loop
+/// uses but doesn't declare, which the function that the loop is outlined to
+/// captures from the enclosing function.  Captured variables that the body
+/// assigns are captured by reference and the others by value.
+class CodeGen_C::LoopCaptures : public IRVisitor {
+public:
+  /// The captures, in order of first use, and the names of those assigned
+  vector<Expr> captures;
+  set<string> assigned;
+
+  /// False if the loop can't be outlined, because the body reallocates or
+  /// reassigns tensor properties or yields.
+  bool canOutline;
+
+  LoopCaptures(const For* loop, const map<Expr, string, ExprCompare>& varMap)
+      : canOutline(true), varMap(varMap) {
+    declare(loop->var);
+    loop->contents.accept(this);
+  }
+
+private:
+  const map<Expr, string, ExprCompare>& varMap;
+
+  /// The names of the variables the body declares and of the captures, since
+  /// distinct variables may be emitted as the same variable
+  set<string> declared;
+  set<string> names;
+
+  using IRVisitor::visit;
+
+  void declare(Expr var) {
+    declared.insert(varMap.at(var));
+  }
+
+  void capture(Expr expr) {
+    const string& name = varMap.at(expr);
+    if (!declared.count(name) && names.insert(name).second) {
+      captures.push_back(expr);
+    }
+  }
+
+  void write(Expr expr) {
+    if (isa<Var>(expr)) {
+      const string& name = varMap.at(expr);
+      if (!declared.count(name)) {
+        assigned.insert(name);
+      }
+    }
+    else {
+      canOutline = false;
+    }
+  }
+
+  void visit(const Var* op) {
+    capture(op);
+  }
+
+  void visit(const GetProperty* op) {
+    capture(op);
+  }
+
+  void visit(const VarDecl* op) {
+    declare(op->var);
+    op->rhs.accept(this);
+  }
+
+  void visit(const For* op) {
+    declare(op->var);
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Assign* op) {
+    write(op->lhs);
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Allocate* op) {
+    write(op->var);
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Yield* op) {
+    canOutline = false;
+  }
+};
+
+CodeGen_C::CodeGen_C(std::ostream &dest, OutputKind outputKind, bool simplify,
+                     Target::SIMD simd, Target::Parallelism parallelism)
+    : CodeGen(dest, false, simplify, C), out(dest), outputKind(outputKind),
+      simd(simd), parallelism(parallelism), emittingOutlinedLoop(false) {}
 
 CodeGen_C::~CodeGen_C() {}
 
@@ -275,9 +1144,37 @@ void CodeGen_C::visit(const Function* func) {
   FindVars outputVarFinder({}, func->outputs, this);
   func->body.accept(&outputVarFinder);
 
+  // find all the vars that are not inputs or outputs and declare them
+  resetUniqueNameCounters();
+  FindVars varFinder(func->inputs, func->outputs, this);
+  func->body.accept(&varFinder);
+  varMap = varFinder.varMap;
+  localVars = varFinder.localVars;
+
+  // the parallel loops' functions are emitted ahead of the function, from
+  // the body as it is printed
+  Stmt body = func->body;
+  outlinedLoops.clear();
+  if (outputKind == ImplementationGen && parallelism == Target::TaskRuntime &&
+      !emittingCoroutine) {
+    Stmt oldBody;
+    while (simplify && body != oldBody) {
+      oldBody = body;
+      body = ir::simplify(body);
+    }
+    printOutlinedLoops(body);
+  }
+
   // output function declaration
   doIndent();
-  out << printFuncName(func, inputVarFinder.varDecls, outputVarFinder.varDecls);
+  string funcDecl = printFuncName(func, inputVarFinder.varDecls,
+                                  outputVarFinder.varDecls);
+  if (parallelism == Target::TaskRuntime) {
+    funcDecl.pop_back();
+    funcDecl += string(funcDecl.back() == '(' ? "" : ", ") +
+                "taco_runtime_t* taco_runtime)";
+  }
+  out << funcDecl;
 
   // if we're just generating a header, this is all we need to do
   if (outputKind == HeaderGen) {
@@ -290,13 +1187,6 @@ void CodeGen_C::visit(const Function* func) {
 
   indent++;
 
-  // find all the vars that are not inputs or outputs and declare them
-  resetUniqueNameCounters();
-  FindVars varFinder(func->inputs, func->outputs, this);
-  func->body.accept(&varFinder);
-  varMap = varFinder.varMap;
-  localVars = varFinder.localVars;
-
   // Print variable declarations
   out << printDecls(varFinder.varDecls, func->inputs, func->outputs) << endl;
 
@@ -306,7 +1196,7 @@ void CodeGen_C::visit(const Function* func) {
   }
 
   // output body
-  print(func->body);
+  print(body);
 
   // output repack only if we allocated memory
   if (checkForAlloc(func))
@@ -403,6 +1293,20 @@ static string getAtomicPragma() {
 // Docs for vectorization pragmas:
 // http://clang.llvm.org/docs/LanguageExtensions.html#extensions-for-loop-hint-optimizations
 void CodeGen_C::visit(const For* op) {
+  if (op->kind == LoopKind::Vectorized && simd != Target::NoSIMD &&
+      !emittingCoroutine) {
+    VectorLoop vectorLoop(this, op);
+    if (vectorLoop.analyze()) {
+      vectorLoop.emit();
+      return;
+    }
+  }
+
+  if (outlinedLoops.count(op)) {
+    printOutlinedLoopCall(op);
+    return;
+  }
+
   switch (op->kind) {
     case LoopKind::Vectorized:
       doIndent();
@@ -413,9 +1317,12 @@ void CodeGen_C::visit(const For* op) {
     case LoopKind::Dynamic:
     case LoopKind::Runtime:
     case LoopKind::Static_Chunked:
-      doIndent();
-      out << getParallelizePragma(op->kind);
-      out << "\n";
+      // Loops that can't be outlined run serially on the task runtime
+      if (parallelism == Target::OpenMP) {
+        doIndent();
+        out << getParallelizePragma(op->kind);
+        out << "\n";
+      }
       break;
     default:
       if (op->unrollFactor > 0) {
@@ -509,6 +1416,35 @@ void CodeGen_C::visit(const Max* op) {
   }
 }
 
+void CodeGen_C::visit(const Call* op) {
+  // On the task runtime, threads are the runtime's workers
+  if (parallelism == Target::TaskRuntime) {
+    if (op->func == "omp_get_thread_num") {
+      stream << (emittingOutlinedLoop ? "taco_worker" : "0");
+      return;
+    }
+    if (op->func == "omp_get_max_threads") {
+      stream << "taco_runtime->num_workers";
+      return;
+    }
+  }
+  // Searches and hash lookups of 64-bit index arrays call their 64-bit variants
+  if ((op->func.compare(0, 17, "taco_binarySearch") == 0 ||
+       op->func == "taco_gallop" || op->func == "taco_mergePathSearch" ||
+       op->func == "taco_hashLocate") &&
+      !op->args.empty() && op->args[0].type() == Int64) {
+    stream << op->func << "64(";
+    for (size_t i = 0; i < op->args.size(); i++) {
+      stream << (i > 0 ? ", " : "");
+      parentPrecedence = Precedence::CALL;
+      op->args[i].accept(this);
+    }
+    stream << ")";
+    return;
+  }
+  IRPrinter::visit(op);
+}
+
 void CodeGen_C::visit(const Allocate* op) {
   string elementType = printCType(op->var.type(), false);
 
@@ -517,7 +1453,29 @@ void CodeGen_C::visit(const Allocate* op) {
   stream << " = (";
   stream << elementType << "*";
   stream << ")";
-  if (op->is_realloc) {
+  bool runtimeAllocate = false;
+  if (isa<GetProperty>(op->var)) {
+    // Arrays of result tensors go through the result allocator
+    stream << "taco_allocateResult(";
+    if (op->is_realloc) {
+      op->var.accept(this);
+    } else {
+      stream << "NULL";
+    }
+    stream << ", ";
+  }
+  else if (parallelism == Target::TaskRuntime) {
+    // Workspaces go through the allocator of the runtime's caller
+    runtimeAllocate = true;
+    stream << "taco_runtime->allocate(taco_runtime, ";
+    if (op->is_realloc) {
+      op->var.accept(this);
+    } else {
+      stream << "NULL";
+    }
+    stream << ", ";
+  }
+  else if (op->is_realloc) {
     stream << "realloc(";
     op->var.accept(this);
     stream << ", ";
@@ -536,10 +1494,26 @@ void CodeGen_C::visit(const Allocate* op) {
   parentPrecedence = MUL;
   op->num_elements.accept(this);
   parentPrecedence = TOP;
+  if (isa<GetProperty>(op->var) || runtimeAllocate) {
+    stream << ", " << (op->clear && !op->is_realloc ? 1 : 0);
+  }
   stream << ");";
     stream << endl;
 }
 
+void CodeGen_C::visit(const Free* op) {
+  if (parallelism == Target::TaskRuntime && !isa<GetProperty>(op->var)) {
+    doIndent();
+    stream << "taco_runtime->allocate(taco_runtime, ";
+    parentPrecedence = Precedence::TOP;
+    op->var.accept(this);
+    stream << ", 0, 0);";
+    stream << endl;
+    return;
+  }
+  IRPrinter::visit(op);
+}
+
 void CodeGen_C::visit(const Sqrt* op) {
   taco_tassert(op->type.isFloat() && op->type.getNumBits() == 64) <<
       "Codegen doesn't currently support non-double sqrt";
@@ -549,6 +1523,10 @@ void CodeGen_C::visit(const Sqrt* op) {
 }
 
 void CodeGen_C::visit(const Assign* op) {
+  if (op->use_atomics && parallelism == Target::TaskRuntime) {
+    printAtomicUpdate(op->lhs, op->lhs, op->rhs);
+    return;
+  }
   if (op->use_atomics) {
     doIndent();
     stream << getAtomicPragma() << endl;
@@ -557,6 +1535,11 @@ void CodeGen_C::visit(const Assign* op) {
 }
 
 void CodeGen_C::visit(const Store* op) {
+  if (op->use_atomics && parallelism == Target::TaskRuntime) {
+    Expr location = Load::make(op->arr, op->loc);
+    printAtomicUpdate(location, location, op->data);
+    return;
+  }
   if (op->use_atomics) {
     doIndent();
     stream << getAtomicPragma() << endl;
@@ -564,7 +1547,166 @@ void CodeGen_C::visit(const Store* op) {
   IRPrinter::visit(op);
 }
 
-void CodeGen_C::generateShim(const Stmt& func, stringstream &ret) {
+void CodeGen_C::printAtomicUpdate(Expr location, Expr current, Expr value) {
+  Expr old = Var::make("taco_old", location.type());
+  Expr updated = Var::make("taco_new", location.type());
+  varMap[old] = "taco_old";
+  varMap[updated] = "taco_new";
+  if (isa<Var>(current)) {
+    map<Expr, Expr, ExprCompare> replacements = {{current, old}};
+    value = ReplaceVars(replacements).rewrite(value);
+  }
+  else {
+    value = ReplaceLoads(current, old).rewrite(value);
+  }
+
+  doIndent();
+  stream << "{\n";
+  indent++;
+  doIndent();
+  stream << printCType(location.type(), false) << " taco_old, taco_new;\n";
+  doIndent();
+  stream << "__atomic_load(&";
+  location.accept(this);
+  stream << ", &taco_old, __ATOMIC_RELAXED);\n";
+  doIndent();
+  stream << "do {\n";
+  indent++;
+  Assign::make(updated, value).accept(this);
+  indent--;
+  doIndent();
+  stream << "} while (!__atomic_compare_exchange(&";
+  location.accept(this);
+  stream << ", &taco_old, &taco_new, 0, __ATOMIC_RELAXED, "
+         << "__ATOMIC_RELAXED));\n";
+  indent--;
+  doIndent();
+  stream << "}\n";
+
+  varMap.erase(old);
+  varMap.erase(updated);
+}
+
+void CodeGen_C::printOutlinedLoops(Stmt stmt) {
+  struct ParallelLoops : public IRVisitor {
+    vector<const For*> loops;
+
+    using IRVisitor::visit;
+
+    void visit(const For* op) {
+      IRVisitor::visit(op);
+      if (isParallelLoop(op)) {
+        loops.push_back(op);
+      }
+    }
+  };
+  ParallelLoops parallelLoops;
+  stmt.accept(&parallelLoops);
+
+  for (const For* op : parallelLoops.loops) {
+    LoopCaptures loopCaptures(op, varMap);
+    if (!loopCaptures.canOutline || !isValue(op->increment, 1)) {
+      continue;
+    }
+    string name = funcName + "_loop" + to_string(outlinedLoops.size());
+
+    // The captures are passed as an array of pointers to them
+    out << "static void " << name << "(taco_runtime_t* taco_runtime, "
+        << "void* taco_closure, int64_t taco_begin, int64_t taco_end, "
+        << "int32_t taco_worker) {\n";
+    indent++;
+    map<Expr, string, ExprCompare> capturedVarMap = varMap;
+    for (size_t i = 0; i < loopCaptures.captures.size(); i++) {
+      Expr capture = loopCaptures.captures[i];
+      const string& captureName = varMap.at(capture);
+      string type;
+      if (isa<GetProperty>(capture)) {
+        type = printTensorProperty("", to<GetProperty>(capture), false);
+        type.pop_back();
+      }
+      else {
+        const Var* var = to<Var>(capture);
+        type = var->is_tensor ? "taco_tensor_t*"
+                              : printCType(var->type, var->is_ptr);
+      }
+      doIndent();
+      if (loopCaptures.assigned.count(captureName)) {
+        out << type << "* " << captureName << " = (" << type
+            << "*)((void**)taco_closure)[" << i << "];\n";
+        for (auto& var : capturedVarMap) {
+          if (var.second == captureName) {
+            var.second = "(*" + captureName + ")";
+          }
+        }
+      }
+      else {
+        out << type << " " << captureName << " = *(" << type
+            << "*)((void**)taco_closure)[" << i << "];\n";
+      }
+    }
+
+    map<Expr, string, ExprCompare> enclosingVarMap = varMap;
+    varMap = capturedVarMap;
+    emittingOutlinedLoop = true;
+    doIndent();
+    stream << keywordString("for") << " ("
+           << keywordString(util::toString(op->var.type())) << " ";
+    op->var.accept(this);
+    stream << " = taco_begin; ";
+    op->var.accept(this);
+    stream << " < taco_end; ";
+    op->var.accept(this);
+    stream << "++) {\n";
+    op->contents.accept(this);
+    doIndent();
+    stream << "}\n";
+    emittingOutlinedLoop = false;
+    varMap = enclosingVarMap;
+    indent--;
+    out << "}\n\n";
+
+    outlinedLoops[op] = name;
+  }
+}
+
+void CodeGen_C::printOutlinedLoopCall(const For* op) {
+  const string& name = outlinedLoops.at(op);
+  LoopCaptures loopCaptures(op, varMap);
+
+  doIndent();
+  stream << "{\n";
+  indent++;
+  string closure = "NULL";
+  if (!loopCaptures.captures.empty()) {
+    closure = name + "_captures";
+    doIndent();
+    stream << "void* " << closure << "[] = {";
+    for (size_t i = 0; i < loopCaptures.captures.size(); i++) {
+      stream << (i > 0 ? ", " : "") << "(void*)&";
+      loopCaptures.captures[i].accept(this);
+    }
+    stream << "};\n";
+  }
+
+  // Thread loops (with a static schedule of one iteration) run an iteration
+  // per task, and the runtime chooses how to split other loops
+  int grain = (op->kind == LoopKind::Static ||
+               op->kind == LoopKind::Dynamic) ? 1 : 0;
+  doIndent();
+  stream << "taco_runtime->parallel_for(taco_runtime, ";
+  parentPrecedence = Precedence::CALL;
+  op->start.accept(this);
+  stream << ", ";
+  parentPrecedence = Precedence::CALL;
+  op->end.accept(this);
+  stream << ", " << grain << ", " << name << ", " << closure << ");\n";
+  indent--;
+  doIndent();
+  stream << "}\n";
+}
+
+void CodeGen_C::generateShim(const Stmt& func, stringstream &ret,
+                             Target::Parallelism parallelism) {
   const Function *funcPtr = func.as<Function>();
 
   ret << "int _shim_" << funcPtr->name << "(void** parameterPack) {\n";
@@ -599,6 +1741,9 @@ void CodeGen_C::generateShim(const Stmt& func, stringstream &ret) {
     ret << delimiter << "(" << cast_type << ")(parameterPack[" << i++ << "])";
     delimiter = ", ";
   }
+  if (parallelism == Target::TaskRuntime) {
+    ret << delimiter << "(taco_runtime_t*)(parameterPack[" << i++ << "])";
+  }
   ret << ");\n";
   ret << "}\n";
 }
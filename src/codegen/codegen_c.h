@@ -14,16 +14,23 @@ namespace ir {
 class CodeGen_C : public CodeGen {
 public:
   /// Initialize a code generator that generates code to an
-  /// output stream.
-  CodeGen_C(std::ostream &dest, OutputKind outputKind, bool simplify=true);
+  /// output stream.  Vectorized loops are emitted with explicit vectors of
+  /// the given SIMD instruction set, and parallel loops for the given
+  /// parallelism model.
+  CodeGen_C(std::ostream &dest, OutputKind outputKind, bool simplify=true,
+            Target::SIMD simd=Target::NoSIMD,
+            Target::Parallelism parallelism=Target::OpenMP);
   ~CodeGen_C();
 
   /// Compile a lowered function
   void compile(Stmt stmt, bool isFirst=false);
 
   /// Generate shims that unpack an array of pointers representing
-  /// a mix of taco_tensor_t* and scalars into a function call
-  static void generateShim(const Stmt& func, std::stringstream &stream);
+  /// a mix of taco_tensor_t* and scalars into a function call.  Functions
+  /// generated for the task runtime take the taco_runtime_t* that follows the
+  /// arguments.
+  static void generateShim(const Stmt& func, std::stringstream &stream,
+                           Target::Parallelism parallelism=Target::OpenMP);
 
 protected:
   using IRPrinter::visit;
@@ -37,7 +44,9 @@ protected:
   void visit(const GetProperty*);
   void visit(const Min*);
   void visit(const Max*);
+  void visit(const Call*);
   void visit(const Allocate*);
+  void visit(const Free*);
   void visit(const Sqrt*);
   void visit(const Store*);
   void visit(const Assign*);
@@ -51,8 +60,29 @@ protected:
   std::string funcName;
   int labelCount;
   bool emittingCoroutine;
+  Target::SIMD simd;
+  Target::Parallelism parallelism;
+
+  /// The functions that the parallel loops of the current function are
+  /// outlined to for the task runtime, and whether the body of one of them is
+  /// being emitted.
+  std::map<const For*, std::string> outlinedLoops;
+  bool emittingOutlinedLoop;
 
   class FindVars;
+  class VectorLoop;
+  class LoopCaptures;
+
+  /// Emit a function for each parallel loop of a statement that can run on
+  /// the task runtime, innermost loops first.
+  void printOutlinedLoops(Stmt stmt);
+
+  /// Emit the call that runs an outlined loop on the task runtime.
+  void printOutlinedLoopCall(const For* op);
+
+  /// Emit a compare-and-swap loop that atomically stores value to location,
+  /// in which value reads the location's current value through current.
+  void printAtomicUpdate(Expr location, Expr current, Expr value);
 
 private:
   virtual std::string restrictKeyword() const { return "restrict"; }
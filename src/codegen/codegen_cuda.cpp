@@ -49,7 +49,7 @@ const string cHeaders =
   "  taco_mode_t* mode_types;    // mode storage types\n"
   "  uint8_t***   indices;       // tensor index data (per mode)\n"
   "  uint8_t*     vals;          // tensor values\n"
-  "  int32_t      vals_size;     // values array size\n"
+  "  int64_t      vals_size;     // values array size\n"
   "} taco_tensor_t;\n"
   "#endif\n"
   "#endif\n\n"; // // https://stackoverflow.com/questions/14038589/what-is-the-canonical-way-to-check-for-errors-using-the-cuda-runtime-api
@@ -0,0 +1,208 @@
+#include "codegen/kernel_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include "taco/error.h"
+#include "taco/util/env.h"
+
+using namespace std;
+
+namespace taco {
+namespace ir {
+
+namespace {
+
+string getKernelCacheDir() {
+  string dir = util::getFromEnv("TACO_KERNEL_CACHE_DIR", "");
+  if (dir.empty()) {
+    return dir;
+  }
+  if (dir.back() != '/') {
+    dir += '/';
+  }
+  return dir;
+}
+
+size_t getKernelCacheSize() {
+  string size = util::getFromEnv("TACO_KERNEL_CACHE_SIZE", "1024");
+  return (size_t)strtoull(size.c_str(), nullptr, 10) << 20;
+}
+
+/// 64-bit FNV-1a hash, which (unlike std::hash) is stable across processes,
+/// platforms and standard library implementations.
+string hashKey(const string& key) {
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : key) {
+    hash ^= (uint8_t)c;
+    hash *= 1099511628211ull;
+  }
+  const char* hexDigits = "0123456789abcdef";
+  string hex(16, '0');
+  for (int i = 15; i >= 0; --i) {
+    hex[i] = hexDigits[hash & 0xf];
+    hash >>= 4;
+  }
+  return hex;
+}
+
+bool makeDirectories(const string& dir) {
+  for (size_t pos = dir.find('/', 1); pos != string::npos;
+       pos = dir.find('/', pos + 1)) {
+    string prefix = dir.substr(0, pos);
+    if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+      return false;
+    }
+  }
+  return access(dir.c_str(), W_OK) == 0;
+}
+
+bool readFile(const string& path, string* contents) {
+  ifstream file(path, ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  stringstream buffer;
+  buffer << file.rdbuf();
+  *contents = buffer.str();
+  return true;
+}
+
+/// Write contents to a temporary file in dir and rename it to path, so that
+/// concurrent readers observe either the old file or the complete new one.
+bool publishFile(const string& dir, const string& path, const string& contents) {
+  string tmpl = dir + ".tmp_XXXXXX";
+  vector<char> tmpname(tmpl.begin(), tmpl.end());
+  tmpname.push_back('\0');
+  int fd = mkstemp(tmpname.data());
+  if (fd < 0) {
+    return false;
+  }
+  size_t written = 0;
+  while (written < contents.size()) {
+    ssize_t n = write(fd, contents.data() + written, contents.size() - written);
+    if (n <= 0) {
+      break;
+    }
+    written += n;
+  }
+  fchmod(fd, 0644);
+  close(fd);
+  if (written != contents.size() || rename(tmpname.data(), path.c_str()) != 0) {
+    unlink(tmpname.data());
+    return false;
+  }
+  return true;
+}
+
+/// Remove least recently used entries until the cache fits in maxSize bytes.
+/// Entries are ordered by the modification time of their library, which
+/// lookups refresh.
+void evictKernels(const string& dir, size_t maxSize) {
+  DIR* d = opendir(dir.c_str());
+  if (!d) {
+    return;
+  }
+  struct Entry {
+    time_t lastUsed = 0;
+    size_t size = 0;
+  };
+  map<string,Entry> entries;
+  size_t totalSize = 0;
+  while (struct dirent* ent = readdir(d)) {
+    string name = ent->d_name;
+    auto dot = name.rfind('.');
+    if (name[0] == '.' || dot == string::npos) {
+      continue;
+    }
+    struct stat st;
+    if (stat((dir + name).c_str(), &st) != 0) {
+      continue;
+    }
+    Entry& entry = entries[name.substr(0, dot)];
+    entry.size += st.st_size;
+    if (name.substr(dot) == ".so") {
+      entry.lastUsed = st.st_mtime;
+    }
+    totalSize += st.st_size;
+  }
+  closedir(d);
+
+  vector<pair<time_t,string>> lru;
+  for (auto& entry : entries) {
+    lru.push_back({entry.second.lastUsed, entry.first});
+  }
+  sort(lru.begin(), lru.end());
+  for (auto& entry : lru) {
+    if (totalSize <= maxSize) {
+      break;
+    }
+    for (string suffix : {".key", ".so", ".c"}) {
+      unlink((dir + entry.second + suffix).c_str());
+    }
+    totalSize -= entries[entry.second].size;
+  }
+}
+
+} // anonymous namespace
+
+bool kernelCacheEnabled() {
+  return !getKernelCacheDir().empty();
+}
+
+bool lookupCachedKernel(const string& key, string* libraryPath,
+                        string* source) {
+  string dir = getKernelCacheDir();
+  if (dir.empty()) {
+    return false;
+  }
+  string prefix = dir + hashKey(key);
+
+  string cachedKey;
+  if (!readFile(prefix + ".key", &cachedKey) || cachedKey != key ||
+      access((prefix + ".so").c_str(), R_OK) != 0) {
+    return false;
+  }
+  readFile(prefix + ".c", source);
+
+  // Mark the entry as recently used
+  utime((prefix + ".so").c_str(), nullptr);
+
+  *libraryPath = prefix + ".so";
+  return true;
+}
+
+void publishCachedKernel(const string& key, const string& libraryPath,
+                         const string& source) {
+  string dir = getKernelCacheDir();
+  if (dir.empty() || !makeDirectories(dir)) {
+    return;
+  }
+  string prefix = dir + hashKey(key);
+
+  // The key is published last, since lookups treat it as the marker of a
+  // complete entry.  Failures are not errors; the kernel is just not cached.
+  string library;
+  if (!readFile(libraryPath, &library) ||
+      !publishFile(dir, prefix + ".so", library) ||
+      !publishFile(dir, prefix + ".c", source) ||
+      !publishFile(dir, prefix + ".key", key)) {
+    return;
+  }
+
+  evictKernels(dir, getKernelCacheSize());
+}
+
+}}
@@ -0,0 +1,34 @@
+#ifndef TACO_KERNEL_CACHE_H
+#define TACO_KERNEL_CACHE_H
+
+#include <string>
+
+namespace taco {
+namespace ir {
+
+/// The on-disk kernel cache is a content-addressed directory of compiled
+/// kernel libraries that can be shared by concurrent processes.  It is enabled
+/// by pointing the TACO_KERNEL_CACHE_DIR environment variable at a writable
+/// directory, and its size is capped at TACO_KERNEL_CACHE_SIZE megabytes
+/// (default 1024) by evicting the least recently used entries.
+///
+/// Each entry is named by a hash of its key and consists of the library
+/// (<hash>.so), its source (<hash>.c) and the key itself (<hash>.key), which is
+/// compared on lookup to guard against hash collisions.  Files are written to
+/// temporaries and renamed into place, so readers never see partial entries.
+
+/// Returns true iff the on-disk kernel cache is enabled.
+bool kernelCacheEnabled();
+
+/// Look up the library cached under key.  On a hit, returns true and sets
+/// libraryPath to the cached library and source to its source code.
+bool lookupCachedKernel(const std::string& key, std::string* libraryPath,
+                        std::string* source);
+
+/// Publish the library at libraryPath, compiled from source, under key and
+/// evict least recently used entries until the cache fits its size cap.
+void publishCachedKernel(const std::string& key, const std::string& libraryPath,
+                         const std::string& source);
+
+}}
+#endif
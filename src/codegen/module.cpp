@@ -2,18 +2,30 @@
 
 #include <iostream>
 #include <fstream>
+#include <mutex>
 #include <dlfcn.h>
 #include <unistd.h>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 #if USE_OPENMP
 #include <omp.h>
 #endif
 
 #include "taco/tensor.h"
 #include "taco/error.h"
+#include "taco/execution_context.h"
+#include "taco/storage/result_allocator.h"
 #include "taco/util/strings.h"
 #include "taco/util/env.h"
+#include "taco/util/task_runtime.h"
+#include "taco/util/uncopyable.h"
+#include "taco/version.h"
 #include "codegen/codegen_c.h"
 #include "codegen/codegen_cuda.h"
+#include "codegen/kernel_cache.h"
+#include "codegen/module_tcc.h"
 #include "taco/cuda.h"
 
 using namespace std;
@@ -26,11 +38,26 @@ std::default_random_engine Module::gen = std::default_random_engine();
 std::uniform_int_distribution<int> Module::randint =
     std::uniform_int_distribution<int>(0, chars.length() - 1);
 
+Module::~Module() {
+  if (lib_handle) {
+    dlclose(lib_handle);
+  }
+  if (jit_handle) {
+    TCCCompiler::release(jit_handle);
+  }
+}
+
+// Guards the shared temporary directory and name generator, since modules may
+// be compiled concurrently (see TensorBase::compileAsync).
+static std::mutex jitNamesMutex;
+
 void Module::setJITTmpdir() {
+  std::lock_guard<std::mutex> lock(jitNamesMutex);
   tmpdir = util::getTmpdir();
 }
 
 void Module::setJITLibname() {
+  std::lock_guard<std::mutex> lock(jitNamesMutex);
   libname.resize(12);
   for (int i=0; i<12; i++)
     libname[i] = chars[randint(gen)];
@@ -40,7 +67,7 @@ void Module::addFunction(Stmt func) {
   funcs.push_back(func);
 }
 
-void Module::compileToSource(string path, string prefix) {
+void Module::generateSource() {
   if (!moduleFromUserSource) {
   
     // create a codegen instance and add all the funcs
@@ -54,9 +81,11 @@ void Module::compileToSource(string path, string prefix) {
     taco_tassert(target.arch == Target::C99) <<
         "Only C99 codegen supported currently";
     std::shared_ptr<CodeGen> sourcegen =
-        CodeGen::init_default(source, CodeGen::ImplementationGen);
+        CodeGen::init_default(source, CodeGen::ImplementationGen, target.simd,
+                              target.parallelism);
     std::shared_ptr<CodeGen> headergen =
-            CodeGen::init_default(header, CodeGen::HeaderGen);
+            CodeGen::init_default(header, CodeGen::HeaderGen, target.simd,
+                                  target.parallelism);
 
     for (auto func: funcs) {
       sourcegen->compile(func, !didGenRuntime);
@@ -64,6 +93,10 @@ void Module::compileToSource(string path, string prefix) {
       didGenRuntime = true;
     }
   }
+}
+
+void Module::compileToSource(string path, string prefix) {
+  generateSource();
 
   ofstream source_file;
   string file_ending = should_use_CUDA_codegen() ? ".cu" : ".c";
@@ -83,14 +116,15 @@ void Module::compileToStaticLibrary(string path, string prefix) {
   
 namespace {
 
-void writeShims(vector<Stmt> funcs, string path, string prefix) {
+void writeShims(vector<Stmt> funcs, string path, string prefix,
+                Target::Parallelism parallelism) {
   stringstream shims;
   for (auto func: funcs) {
     if (should_use_CUDA_codegen()) {
       CodeGen_CUDA::generateShim(func, shims);
     }
     else {
-      CodeGen_C::generateShim(func, shims);
+      CodeGen_C::generateShim(func, shims, parallelism);
     }
   }
   
@@ -106,9 +140,74 @@ void writeShims(vector<Stmt> funcs, string path, string prefix) {
   shims_file.close();
 }
 
+void getCompilerAndFlags(const Target& target, string* cc, string* cflags) {
+  if (should_use_CUDA_codegen()) {
+    *cc = util::getFromEnv("TACO_NVCC", "nvcc");
+    *cflags = util::getFromEnv("TACO_NVCCFLAGS",
+    get_default_CUDA_compiler_flags());
+  }
+  else {
+    *cc = util::getFromEnv(target.compiler_env, target.compiler);
+    *cflags = util::getFromEnv("TACO_CFLAGS",
+    "-O3 -ffast-math -std=c99") + " -shared -fPIC";
+    if (target.simd != Target::NoSIMD) {
+      *cflags += " " + Target::getSIMDFlags(target.simd);
+    }
+#if USE_OPENMP
+    if (target.parallelism == Target::OpenMP) {
+      *cflags += " -fopenmp";
+    }
+#endif
+  }
+}
+
 } // anonymous namespace
 
+bool Module::compileInProcess() {
+  if (target.jit != Target::InProcess || should_use_CUDA_codegen() ||
+      !TCCCompiler::available()) {
+    return false;
+  }
+
+  // The shims are compiled together with the functions they wrap, so the
+  // module's header is not needed.
+  generateSource();
+  stringstream shims;
+  for (auto func : funcs) {
+    CodeGen_C::generateShim(func, shims, target.parallelism);
+  }
+
+  string error;
+  void* handle = TCCCompiler::compile(source.str() + shims.str(), &error);
+  if (!handle) {
+    // Not every construct the C code generator emits (e.g. complex types) is
+    // supported by libtcc, so fall back to the system compiler.
+    return false;
+  }
+  if (jit_handle) {
+    TCCCompiler::release(jit_handle);
+  }
+  jit_handle = handle;
+  installResultAllocator();
+  return true;
+}
+
+void Module::installResultAllocator() {
+  // Generated code allocates result arrays through a function pointer, which
+  // is pointed at the host so that tensors can choose how results are
+  // allocated.  Code that doesn't declare it (e.g. CUDA) uses malloc.
+  typedef void* (*allocate_t)(void*, size_t, int);
+  void* allocator = getFuncPtr("taco_allocateResult");
+  if (allocator) {
+    *(allocate_t*)allocator = allocateResult;
+  }
+}
+
 string Module::compile() {
+  if (!moduleFromUserSource && compileInProcess()) {
+    return "";
+  }
+
   string prefix = tmpdir+libname;
   string fullpath = prefix + ".so";
   
@@ -116,20 +215,12 @@ string Module::compile() {
   string cflags;
   string file_ending;
   string shims_file;
+  getCompilerAndFlags(target, &cc, &cflags);
   if (should_use_CUDA_codegen()) {
-    cc = util::getFromEnv("TACO_NVCC", "nvcc");
-    cflags = util::getFromEnv("TACO_NVCCFLAGS",
-    get_default_CUDA_compiler_flags());
     file_ending = ".cu";
     shims_file = prefix + "_shims.cpp";
   }
   else {
-    cc = util::getFromEnv(target.compiler_env, target.compiler);
-    cflags = util::getFromEnv("TACO_CFLAGS",
-    "-O3 -ffast-math -std=c99") + " -shared -fPIC";
-#if USE_OPENMP
-    cflags += " -fopenmp";
-#endif
     file_ending = ".c";
     shims_file = "";
   }
@@ -142,7 +233,7 @@ string Module::compile() {
   compileToSource(tmpdir, libname);
   
   // write out the shims
-  writeShims(funcs, tmpdir, libname);
+  writeShims(funcs, tmpdir, libname, target.parallelism);
   
   // now compile it
   int err = system(cmd.data());
@@ -153,8 +244,17 @@ string Module::compile() {
   if (lib_handle) {
     dlclose(lib_handle);
   }
+  if (jit_handle) {
+    TCCCompiler::release(jit_handle);
+    jit_handle = nullptr;
+  }
   lib_handle = dlopen(fullpath.data(), RTLD_NOW | RTLD_LOCAL);
   taco_uassert(lib_handle) << "Failed to load generated code, error is: " << dlerror();
+  installResultAllocator();
+
+  if (!cacheKey.empty() && !moduleFromUserSource && kernelCacheEnabled()) {
+    publishCachedKernel(getFullCacheKey(), fullpath, source.str());
+  }
 
   return fullpath;
 }
@@ -164,15 +264,214 @@ void Module::setSource(string source) {
   moduleFromUserSource = true;
 }
 
+void Module::setCacheKey(string key) {
+  cacheKey = key;
+}
+
+string Module::getFullCacheKey() {
+  string cc;
+  string cflags;
+  getCompilerAndFlags(target, &cc, &cflags);
+  stringstream key;
+  key << "taco " << TACO_VERSION_MAJOR << "." << TACO_VERSION_MINOR << " "
+      << TACO_VERSION_GIT_SHORTHASH << "\n"
+      << "target " << target.arch << "-" << target.os
+      << (should_use_CUDA_codegen() ? " cuda" : "") << "\n"
+      << "simd " << target.simd << "\n"
+      << "parallelism " << target.parallelism << "\n"
+      << "cc " << cc << "\n"
+      << "cflags " << cflags << "\n"
+      << cacheKey;
+  return key.str();
+}
+
+bool Module::loadFromCache() {
+  if (cacheKey.empty() || !kernelCacheEnabled()) {
+    return false;
+  }
+  string fullpath;
+  string cachedSource;
+  if (!lookupCachedKernel(getFullCacheKey(), &fullpath, &cachedSource)) {
+    return false;
+  }
+  void* handle = dlopen(fullpath.data(), RTLD_NOW | RTLD_LOCAL);
+  if (!handle) {
+    // The entry may have been evicted since the lookup, so fall back to
+    // compiling the module.
+    return false;
+  }
+  if (lib_handle) {
+    dlclose(lib_handle);
+  }
+  if (jit_handle) {
+    TCCCompiler::release(jit_handle);
+    jit_handle = nullptr;
+  }
+  lib_handle = handle;
+  source.str(cachedSource);
+  installResultAllocator();
+  return true;
+}
+
 string Module::getSource() {
   return source.str();
 }
 
 void* Module::getFuncPtr(std::string name) {
+  if (jit_handle) {
+    return TCCCompiler::getSymbol(jit_handle, name);
+  }
   return dlsym(lib_handle, name.data());
 }
 
-int Module::callFuncPackedRaw(std::string name, void** args) {
+namespace {
+
+#if USE_OPENMP
+/// Returns the number of threads and the schedule that functions are called
+/// with, which are the context's or the ones set through taco.
+void getParallelSettings(const ExecutionContext* context, int* numThreads,
+                         ParallelSchedule* schedule, int* chunkSize) {
+  if (context != nullptr) {
+    *numThreads = context->getNumThreads();
+    context->getParallelSchedule(schedule, chunkSize);
+  }
+  else {
+    *numThreads = taco_get_num_threads();
+    taco_get_parallel_schedule(schedule, chunkSize);
+  }
+}
+
+void setOpenMPSchedule(ParallelSchedule schedule, int chunkSize) {
+  switch (schedule) {
+    case ParallelSchedule::Static:
+      omp_set_schedule(omp_sched_static, chunkSize);
+      break;
+    case ParallelSchedule::Dynamic:
+      omp_set_schedule(omp_sched_dynamic, chunkSize);
+      break;
+    default:
+      break;
+  }
+}
+
+/// Returns true if the OpenMP schedule is the one that setOpenMPSchedule sets
+/// for the schedule.
+bool isOpenMPSchedule(ParallelSchedule schedule, int chunkSize,
+                      omp_sched_t openMPSchedule, int openMPChunkSize) {
+  switch (schedule) {
+    case ParallelSchedule::Static:
+      return openMPSchedule == omp_sched_static && chunkSize == openMPChunkSize;
+    case ParallelSchedule::Dynamic:
+      return openMPSchedule == omp_sched_dynamic &&
+             chunkSize == openMPChunkSize;
+    default:
+      return true;
+  }
+}
+#endif
+
+#if USE_OPENMP && defined(__linux__)
+/// The cpus that the threads of the parallel regions of a thread are bound
+/// to, and the affinity they had before.
+struct TeamBinding {
+  vector<int> cpus;
+  int numThreads = 0;
+  vector<cpu_set_t> existing;
+};
+
+/// Binds thread t of the parallel regions of the calling thread to the t-th
+/// of the cpus, or restores the affinity of the threads if cpus is empty.
+/// Like the OpenMP settings, the binding is kept between calls, so that only
+/// calls that change it start parallel regions to bind the threads.
+void bindOpenMPTeam(const vector<int>& cpus, int numThreads) {
+  static thread_local TeamBinding binding;
+  if (cpus == binding.cpus &&
+      (cpus.empty() || numThreads == binding.numThreads)) {
+    return;
+  }
+  if (!binding.cpus.empty()) {
+    #pragma omp parallel num_threads(binding.numThreads)
+    {
+      pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t),
+                             &binding.existing[omp_get_thread_num()]);
+    }
+    binding.cpus.clear();
+    binding.existing.clear();
+  }
+  if (cpus.empty()) {
+    return;
+  }
+  binding.existing.resize(numThreads);
+  #pragma omp parallel num_threads(numThreads)
+  {
+    const int thread = omp_get_thread_num();
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[thread % cpus.size()], &set);
+    pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t),
+                           &binding.existing[thread]);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+  binding.cpus = cpus;
+  binding.numThreads = numThreads;
+}
+#endif
+
+/// Binds the calling thread to the cpus of a context, if it has any, while
+/// it is in scope.  For OpenMP kernels, thread t of parallel regions is bound
+/// to the t-th cpu instead, like OMP_PROC_BIND=close with one place per cpu,
+/// so that a static schedule gives each thread the part of arrays first
+/// touched from its cpu (see Placement).  These threads stay bound after the
+/// call, until a call with other cpus or without any rebinds them.
+class AffinityScope : private util::Uncopyable {
+public:
+  AffinityScope(const ExecutionContext* context, bool bindTeam)
+      : bound(false) {
+#if defined(__linux__)
+    const bool hasAffinity = context != nullptr &&
+                             !context->getAffinity().empty();
+#if USE_OPENMP
+    if (bindTeam || !hasAffinity) {
+      bindOpenMPTeam(hasAffinity ? context->getAffinity() : vector<int>(),
+                     hasAffinity ? context->getNumThreads() : 0);
+    }
+    if (bindTeam) {
+      return;
+    }
+#endif
+    if (!hasAffinity) {
+      return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : context->getAffinity()) {
+      CPU_SET(cpu, &set);
+    }
+    bound = pthread_getaffinity_np(pthread_self(), sizeof(existing),
+                                   &existing) == 0 &&
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+  }
+
+  ~AffinityScope() {
+#if defined(__linux__)
+    if (bound) {
+      pthread_setaffinity_np(pthread_self(), sizeof(existing), &existing);
+    }
+#endif
+  }
+
+private:
+  bool bound;
+#if defined(__linux__)
+  cpu_set_t existing;
+#endif
+};
+
+}
+
+int Module::callFuncPackedRaw(std::string name, void** args,
+                              const ExecutionContext* context) {
   typedef int (*fnptr_t)(void**);
   static_assert(sizeof(void*) == sizeof(fnptr_t),
     "Unable to cast dlsym() returned void pointer to function pointer");
@@ -180,24 +479,25 @@ int Module::callFuncPackedRaw(std::string name, void** args) {
   fnptr_t func_ptr;
   *reinterpret_cast<void**>(&func_ptr) = v_func_ptr;
 
+  AffinityScope affinity(context, target.parallelism == Target::OpenMP);
+  if (context != nullptr && context->getScratchAllocator()) {
+    context->getScratchAllocator()->begin();
+  }
+  if (target.parallelism == Target::TaskRuntime) {
+    return func_ptr(args);
+  }
+
 #if USE_OPENMP
+  // OpenMP keeps the schedule and number of threads per thread, so setting
+  // them doesn't affect calls on other threads
   omp_sched_t existingSched;
   ParallelSchedule tacoSched;
-  int existingChunkSize, tacoChunkSize;
+  int existingChunkSize, tacoChunkSize, tacoNumThreads;
   int existingNumThreads = omp_get_max_threads();
   omp_get_schedule(&existingSched, &existingChunkSize);
-  taco_get_parallel_schedule(&tacoSched, &tacoChunkSize);
-  switch (tacoSched) {
-    case ParallelSchedule::Static:
-      omp_set_schedule(omp_sched_static, tacoChunkSize);
-      break;
-    case ParallelSchedule::Dynamic:
-      omp_set_schedule(omp_sched_dynamic, tacoChunkSize);
-      break;
-    default:
-      break;
-  }
-  omp_set_num_threads(taco_get_num_threads());
+  getParallelSettings(context, &tacoNumThreads, &tacoSched, &tacoChunkSize);
+  setOpenMPSchedule(tacoSched, tacoChunkSize);
+  omp_set_num_threads(tacoNumThreads);
 #endif
 
   int ret = func_ptr(args);
@@ -210,5 +510,67 @@ int Module::callFuncPackedRaw(std::string name, void** args) {
   return ret;
 }
 
+Module::PackedFunc Module::getPackedFunc(std::string name) {
+  static_assert(sizeof(void*) == sizeof(PackedFunc),
+    "Unable to cast dlsym() returned void pointer to function pointer");
+  void* v_func_ptr = getFuncPtr("_shim_" + name);
+  PackedFunc func_ptr;
+  *reinterpret_cast<void**>(&func_ptr) = v_func_ptr;
+  return func_ptr;
+}
+
+int Module::callPackedFunc(PackedFunc func, void** args,
+                           const ExecutionContext* context) {
+  // Like the OpenMP settings below, the threads of parallel regions are bound
+  // whatever the target of the function, which packed functions don't know
+  AffinityScope affinity(context, true);
+  if (context != nullptr && context->getScratchAllocator()) {
+    context->getScratchAllocator()->begin();
+  }
+#if USE_OPENMP
+  // Only the settings that differ from the calling thread's are set, and
+  // restored after the call
+  omp_sched_t existingSched;
+  ParallelSchedule tacoSched;
+  int existingChunkSize, tacoChunkSize, tacoNumThreads;
+  const int existingNumThreads = omp_get_max_threads();
+  omp_get_schedule(&existingSched, &existingChunkSize);
+  getParallelSettings(context, &tacoNumThreads, &tacoSched, &tacoChunkSize);
+  const bool setsSchedule = !isOpenMPSchedule(tacoSched, tacoChunkSize,
+                                              existingSched,
+                                              existingChunkSize);
+  const bool setsNumThreads = tacoNumThreads != existingNumThreads;
+  if (setsSchedule) {
+    setOpenMPSchedule(tacoSched, tacoChunkSize);
+  }
+  if (setsNumThreads) {
+    omp_set_num_threads(tacoNumThreads);
+  }
+#endif
+
+  int ret = func(args);
+
+#if USE_OPENMP
+  if (setsSchedule) {
+    omp_set_schedule(existingSched, existingChunkSize);
+  }
+  if (setsNumThreads) {
+    omp_set_num_threads(existingNumThreads);
+  }
+#endif
+
+  return ret;
+}
+
+taco_runtime_t* Module::getRuntime(const ExecutionContext* context) const {
+  if (target.parallelism != Target::TaskRuntime) {
+    return nullptr;
+  }
+  if (context != nullptr) {
+    return context->getRuntime();
+  }
+  return util::TaskRuntime::getShared(taco_get_num_threads())->getRuntime();
+}
+
 } // namespace ir
 } // namespace taco
@@ -0,0 +1,122 @@
+#ifndef TACO_MODULE_CACHE_H
+#define TACO_MODULE_CACHE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "taco/codegen/module.h"
+
+namespace taco {
+namespace ir {
+
+/// An in-memory cache of compiled modules.  Modules are bucketed by a hash of
+/// their key and a bucket hit is confirmed with the key's equality predicate,
+/// so the hash must agree with the predicate (equal keys have equal hashes).
+/// Lookups only take a shared lock, so concurrent lookups do not serialize.
+///
+/// When the cache grows beyond its capacity, the least recently used modules
+/// that are not referenced outside the cache are evicted, which unloads them.
+template <typename Key>
+class ModuleCache {
+public:
+  typedef std::function<bool(const Key&, const Key&)> Equals;
+
+  ModuleCache(Equals equals)
+      : equals(std::move(equals)), clock(0), numEntries(0) {}
+
+  /// Returns the module cached under key, or nullptr if there is none.
+  std::shared_ptr<Module> get(size_t hash, const Key& key) const {
+    std::shared_lock<std::shared_timed_mutex> lock(mutex);
+    auto bucket = buckets.find(hash);
+    if (bucket == buckets.end()) {
+      return nullptr;
+    }
+    for (const auto& entry : bucket->second) {
+      if (equals(key, entry->key)) {
+        entry->lastUsed = ++clock;
+        return entry->module;
+      }
+    }
+    return nullptr;
+  }
+
+  /// Cache module under key, evicting unused modules if the cache then holds
+  /// more than capacity modules.
+  void insert(size_t hash, const Key& key, std::shared_ptr<Module> module,
+              size_t capacity) {
+    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+    std::shared_ptr<Entry> entry = std::make_shared<Entry>(key, module);
+    entry->lastUsed = ++clock;
+    buckets[hash].push_back(entry);
+    numEntries++;
+    if (numEntries > capacity) {
+      evict(capacity);
+    }
+  }
+
+  /// Returns the number of cached modules.
+  size_t size() const {
+    std::shared_lock<std::shared_timed_mutex> lock(mutex);
+    return numEntries;
+  }
+
+private:
+  struct Entry {
+    Entry(const Key& key, std::shared_ptr<Module> module)
+        : key(key), module(module), lastUsed(0) {}
+    Key key;
+    std::shared_ptr<Module> module;
+    std::atomic<uint64_t> lastUsed;
+  };
+
+  Equals equals;
+  std::unordered_map<size_t, std::vector<std::shared_ptr<Entry>>> buckets;
+  mutable std::shared_timed_mutex mutex;
+  mutable std::atomic<uint64_t> clock;
+  size_t numEntries;
+
+  /// Evict least recently used modules that nothing outside the cache refers
+  /// to.  Evicting down to three quarters of the capacity amortizes the cost
+  /// of scanning the cache over many insertions.
+  void evict(size_t capacity) {
+    std::vector<std::pair<uint64_t,size_t>> unused;
+    for (const auto& bucket : buckets) {
+      for (const auto& entry : bucket.second) {
+        if (entry->module.use_count() == 1) {
+          unused.push_back({entry->lastUsed, bucket.first});
+        }
+      }
+    }
+    std::sort(unused.begin(), unused.end());
+
+    const size_t target = capacity - capacity / 4;
+    for (const auto& candidate : unused) {
+      if (numEntries <= target) {
+        break;
+      }
+      auto& bucket = buckets[candidate.second];
+      for (auto it = bucket.begin(); it != bucket.end(); ++it) {
+        if ((*it)->lastUsed == candidate.first &&
+            (*it)->module.use_count() == 1) {
+          bucket.erase(it);
+          numEntries--;
+          break;
+        }
+      }
+      if (bucket.empty()) {
+        buckets.erase(candidate.second);
+      }
+    }
+  }
+};
+
+}}
+#endif
@@ -0,0 +1,117 @@
+#include "codegen/module_tcc.h"
+
+#include <mutex>
+#include <dlfcn.h>
+
+#include "taco/util/env.h"
+
+using namespace std;
+
+namespace taco {
+namespace ir {
+
+namespace {
+
+// The subset of the libtcc API that we use.  These declarations mirror
+// libtcc.h, which lets us load the library at runtime instead of requiring
+// its header and library at build time.
+struct TCCState;
+const int TCC_OUTPUT_MEMORY = 1;
+void* const TCC_RELOCATE_AUTO = (void*)1;
+
+struct LibTCC {
+  void* handle = nullptr;
+  TCCState* (*tcc_new)(void) = nullptr;
+  void (*tcc_delete)(TCCState*) = nullptr;
+  void (*tcc_set_error_func)(TCCState*, void*,
+                             void (*)(void*, const char*)) = nullptr;
+  void (*tcc_set_options)(TCCState*, const char*) = nullptr;
+  int (*tcc_set_output_type)(TCCState*, int) = nullptr;
+  int (*tcc_add_library)(TCCState*, const char*) = nullptr;
+  int (*tcc_compile_string)(TCCState*, const char*) = nullptr;
+  // Releases up to 0.9.27 take a second argument, later ones do not.  Passing
+  // TCC_RELOCATE_AUTO works with both, since extra arguments are ignored.
+  int (*tcc_relocate)(TCCState*, void*) = nullptr;
+  void* (*tcc_get_symbol)(TCCState*, const char*) = nullptr;
+
+  template <typename T>
+  bool resolve(T* func, const char* name) {
+    *reinterpret_cast<void**>(func) = dlsym(handle, name);
+    return *func != nullptr;
+  }
+
+  bool load() {
+    string path = util::getFromEnv("TACO_LIBTCC", "libtcc.so");
+    handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+      return false;
+    }
+    if (!resolve(&tcc_new, "tcc_new") ||
+        !resolve(&tcc_delete, "tcc_delete") ||
+        !resolve(&tcc_set_error_func, "tcc_set_error_func") ||
+        !resolve(&tcc_set_options, "tcc_set_options") ||
+        !resolve(&tcc_set_output_type, "tcc_set_output_type") ||
+        !resolve(&tcc_add_library, "tcc_add_library") ||
+        !resolve(&tcc_compile_string, "tcc_compile_string") ||
+        !resolve(&tcc_relocate, "tcc_relocate") ||
+        !resolve(&tcc_get_symbol, "tcc_get_symbol")) {
+      dlclose(handle);
+      handle = nullptr;
+      return false;
+    }
+    return true;
+  }
+};
+
+LibTCC* getLibTCC() {
+  static LibTCC libtcc;
+  static once_flag loaded;
+  call_once(loaded, []() { libtcc.load(); });
+  return libtcc.handle ? &libtcc : nullptr;
+}
+
+void appendError(void* error, const char* msg) {
+  *static_cast<string*>(error) += string(msg) + "\n";
+}
+
+} // anonymous namespace
+
+bool TCCCompiler::available() {
+  return getLibTCC() != nullptr;
+}
+
+void* TCCCompiler::compile(const string& source, string* error) {
+  LibTCC* libtcc = getLibTCC();
+  if (!libtcc) {
+    *error = "libtcc is not available";
+    return nullptr;
+  }
+
+  TCCState* state = libtcc->tcc_new();
+  if (!state) {
+    *error = "failed to create a libtcc compilation context";
+    return nullptr;
+  }
+  libtcc->tcc_set_error_func(state, error, appendError);
+  libtcc->tcc_set_options(state, util::getFromEnv("TACO_TCCFLAGS", "").c_str());
+  libtcc->tcc_set_output_type(state, TCC_OUTPUT_MEMORY);
+  if (libtcc->tcc_compile_string(state, source.c_str()) != 0 ||
+      libtcc->tcc_add_library(state, "m") != 0 ||
+      libtcc->tcc_relocate(state, TCC_RELOCATE_AUTO) < 0) {
+    libtcc->tcc_delete(state);
+    return nullptr;
+  }
+  return state;
+}
+
+void* TCCCompiler::getSymbol(void* handle, const string& name) {
+  LibTCC* libtcc = getLibTCC();
+  return libtcc->tcc_get_symbol(static_cast<TCCState*>(handle), name.c_str());
+}
+
+void TCCCompiler::release(void* handle) {
+  LibTCC* libtcc = getLibTCC();
+  libtcc->tcc_delete(static_cast<TCCState*>(handle));
+}
+
+}}
@@ -0,0 +1,29 @@
+#ifndef TACO_MODULE_TCC_H
+#define TACO_MODULE_TCC_H
+
+#include <string>
+
+namespace taco {
+namespace ir {
+
+/// In-process compilation of generated C code with libtcc.  libtcc is loaded
+/// with dlopen on first use (from TACO_LIBTCC, or libtcc.so on the library
+/// path), so taco neither links against it nor requires it to be installed.
+class TCCCompiler {
+public:
+  /// Returns true iff libtcc could be loaded.
+  static bool available();
+
+  /// Compile source into memory, returning an opaque handle to the compiled
+  /// code, or nullptr (with the diagnostics in error) if compilation failed.
+  static void* compile(const std::string& source, std::string* error);
+
+  /// Returns the address of the named function in compiled code, or nullptr.
+  static void* getSymbol(void* handle, const std::string& name);
+
+  /// Release compiled code.
+  static void release(void* handle);
+};
+
+}}
+#endif
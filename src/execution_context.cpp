@@ -0,0 +1,117 @@
+#include "taco/execution_context.h"
+
+#include <mutex>
+
+#include "taco/tensor.h"
+#include "taco/storage/result_allocator.h"
+#include "taco/util/task_runtime.h"
+
+using namespace std;
+
+namespace taco {
+
+struct ExecutionContext::Content {
+  int numThreads;
+  ParallelSchedule schedule;
+  int chunkSize;
+  vector<int> cpus;
+  shared_ptr<ResultAllocator> scratchAllocator;
+
+  mutex runtimeMutex;
+  unique_ptr<util::TaskRuntime> taskRuntime;
+  taco_runtime_t runtime;
+
+  /// Pass the settings to kernels through the runtime struct, if started.
+  /// The runtime mutex must be held.
+  void updateRuntime();
+};
+
+namespace {
+
+void* allocateScratch(taco_runtime_t* runtime, void* data, size_t size,
+                      int clear) {
+  ResultAllocator* allocator = static_cast<ResultAllocator*>(runtime->allocator);
+  if (size == 0) {
+    allocator->deallocate(data);
+    return nullptr;
+  }
+  return allocator->allocate(data, size, clear);
+}
+
+}
+
+void ExecutionContext::Content::updateRuntime() {
+  if (!taskRuntime) {
+    return;
+  }
+  runtime = *taskRuntime->getRuntime();
+  runtime.grain = chunkSize;
+  if (scratchAllocator) {
+    runtime.allocator = scratchAllocator.get();
+    runtime.allocate = allocateScratch;
+  }
+}
+
+ExecutionContext::ExecutionContext() : content(new Content) {
+  content->numThreads = taco_get_num_threads();
+  taco_get_parallel_schedule(&content->schedule, &content->chunkSize);
+}
+
+void ExecutionContext::setNumThreads(int numThreads) {
+  if (numThreads > 0 && numThreads != content->numThreads) {
+    lock_guard<mutex> lock(content->runtimeMutex);
+    content->numThreads = numThreads;
+    content->taskRuntime.reset();
+  }
+}
+
+int ExecutionContext::getNumThreads() const {
+  return content->numThreads;
+}
+
+void ExecutionContext::setParallelSchedule(ParallelSchedule schedule,
+                                           int chunkSize) {
+  lock_guard<mutex> lock(content->runtimeMutex);
+  content->schedule = schedule;
+  content->chunkSize = chunkSize;
+  content->updateRuntime();
+}
+
+void ExecutionContext::getParallelSchedule(ParallelSchedule* schedule,
+                                           int* chunkSize) const {
+  *schedule = content->schedule;
+  *chunkSize = content->chunkSize;
+}
+
+void ExecutionContext::setAffinity(const vector<int>& cpus) {
+  lock_guard<mutex> lock(content->runtimeMutex);
+  content->cpus = cpus;
+  content->taskRuntime.reset();
+}
+
+const vector<int>& ExecutionContext::getAffinity() const {
+  return content->cpus;
+}
+
+void ExecutionContext::setScratchAllocator(
+    shared_ptr<ResultAllocator> allocator) {
+  lock_guard<mutex> lock(content->runtimeMutex);
+  content->scratchAllocator = allocator;
+  content->updateRuntime();
+}
+
+shared_ptr<ResultAllocator> ExecutionContext::getScratchAllocator() const {
+  return content->scratchAllocator;
+}
+
+taco_runtime_t* ExecutionContext::getRuntime() const {
+  lock_guard<mutex> lock(content->runtimeMutex);
+  if (!content->taskRuntime) {
+    content->taskRuntime.reset(new util::TaskRuntime(content->numThreads,
+                                                     content->cpus));
+    content->updateRuntime();
+  }
+  return &content->runtime;
+}
+
+}
@@ -9,6 +9,8 @@
 #include "taco/lower/mode_format_dense.h"
 #include "taco/lower/mode_format_compressed.h"
 #include "taco/lower/mode_format_singleton.h"
+#include "taco/lower/mode_format_narrow_compressed.h"
+#include "taco/lower/mode_format_hashed.h"
 
 #include "taco/error.h"
 #include "taco/util/strings.h"
@@ -87,7 +89,9 @@ Datatype Format::getCoordinateTypePos(size_t level) const {
 
 Datatype Format::getCoordinateTypeIdx(size_t level) const {
   if (level >= levelArrayTypes.size()) {
-    return Int32;
+    // Narrow coordinates are 16-bit unless the format says otherwise
+    return (getModeFormats()[level].getName() == NarrowCompressed.getName())
+           ? UInt16 : Int32;
   }
   if (getModeFormats()[level].getName() == Dense.getName()) {
     return levelArrayTypes[level][0];
@@ -99,6 +103,48 @@ void Format::setLevelArrayTypes(std::vector<std::vector<Datatype>> levelArrayTyp
   this->levelArrayTypes = levelArrayTypes;
 }
 
+Datatype Format::getIndexType() const {
+  for (auto& arrayTypes : levelArrayTypes) {
+    for (auto& arrayType : arrayTypes) {
+      if (arrayType.getNumBits() == 64) {
+        return Int64;
+      }
+    }
+  }
+  return Int32;
+}
+
+void Format::setIndexType(Datatype indexType) {
+  taco_uassert(indexType == Int32 || indexType == Int64) <<
+      "The index type must be " << Int32 << " or " << Int64;
+  vector<vector<Datatype>> indexArrayTypes;
+  for (int level = 0; level < getOrder(); level++) {
+    const ModeFormat modeFormat = getModeFormats()[level];
+    if (modeFormat.getName() == Dense.getName()) {
+      indexArrayTypes.push_back({indexType});
+    } else if (modeFormat.getName() == NarrowCompressed.getName()) {
+      // Narrow coordinates keep their width and their bases are coordinates
+      indexArrayTypes.push_back({indexType, getCoordinateTypeIdx(level),
+                                 Int32});
+    } else {
+      indexArrayTypes.push_back({indexType, indexType});
+    }
+  }
+  levelArrayTypes = indexArrayTypes;
+}
+
+/// Returns whether two formats have the same index array types, where levels
+/// without types have Int32 arrays.
+static bool equalLevelArrayTypes(const Format& a, const Format& b) {
+  for (int level = 0; level < a.getOrder(); level++) {
+    if (a.getCoordinateTypePos(level) != b.getCoordinateTypePos(level) ||
+        a.getCoordinateTypeIdx(level) != b.getCoordinateTypeIdx(level)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 
 bool operator==(const Format& a, const Format& b){
   const auto aModeTypePacks = a.getModeFormatPacks();
@@ -120,7 +166,7 @@ bool operator==(const Format& a, const Format& b){
       return false;
     }
   } 
-  return true;
+  return equalLevelArrayTypes(a, b);
 }
 
 bool operator!=(const Format& a, const Format& b) {
@@ -128,8 +174,15 @@ bool operator!=(const Format& a, const Format& b) {
 }
 
 std::ostream &operator<<(std::ostream& os, const Format& format) {
-  return os << "(" << util::join(format.getModeFormatPacks(), ",") << "; "
-            << util::join(format.getModeOrdering(), ",") << ")";
+  os << "(" << util::join(format.getModeFormatPacks(), ",") << "; "
+     << util::join(format.getModeOrdering(), ",");
+  if (!equalLevelArrayTypes(format, Format(format.getModeFormatPacks()))) {
+    os << ";";
+    for (auto& arrayTypes : format.getLevelArrayTypes()) {
+      os << " {" << util::join(arrayTypes, ",") << "}";
+    }
+  }
+  return os << ")";
 }
 
 
@@ -303,6 +356,10 @@ bool ModeFormat::defined() const {
   return impl != nullptr;
 }
 
+std::shared_ptr<const ModeFormatImpl> ModeFormat::getImpl() const {
+  return impl;
+}
+
 bool operator==(const ModeFormat& a, const ModeFormat& b) {
   return (a.defined() && b.defined() && (*a.impl == *b.impl));
 }
@@ -312,7 +369,14 @@ bool operator!=(const ModeFormat& a, const ModeFormat& b) {
 }
 
 std::ostream& operator<<(std::ostream& os, const ModeFormat& modeFormat) {
-  return os << modeFormat.getName();
+  os << modeFormat.getName();
+  // Parameters change the generated code, so they are part of the format
+  const auto hashed =
+      dynamic_pointer_cast<const HashedModeFormat>(modeFormat.getImpl());
+  if (hashed != nullptr) {
+    os << "(" << hashed->width << ")";
+  }
+  return os;
 }
 
 
@@ -369,6 +433,9 @@ ModeFormat ModeFormat::Dense(std::make_shared<DenseModeFormat>());
 ModeFormat ModeFormat::Compressed(std::make_shared<CompressedModeFormat>());
 ModeFormat ModeFormat::Sparse = ModeFormat::Compressed;
 ModeFormat ModeFormat::Singleton(std::make_shared<SingletonModeFormat>());
+ModeFormat ModeFormat::NarrowCompressed(
+    std::make_shared<NarrowCompressedModeFormat>());
+ModeFormat ModeFormat::Hashed(std::make_shared<HashedModeFormat>());
 
 ModeFormat ModeFormat::dense = ModeFormat::Dense;
 ModeFormat ModeFormat::compressed = ModeFormat::Compressed;
@@ -379,6 +446,8 @@ const ModeFormat Dense = ModeFormat::Dense;
 const ModeFormat Compressed = ModeFormat::Compressed;
 const ModeFormat Sparse = ModeFormat::Compressed;
 const ModeFormat Singleton = ModeFormat::Singleton;
+const ModeFormat NarrowCompressed = ModeFormat::NarrowCompressed;
+const ModeFormat Hashed = ModeFormat::Hashed;
 
 const ModeFormat dense = ModeFormat::Dense;
 const ModeFormat compressed = ModeFormat::Compressed;
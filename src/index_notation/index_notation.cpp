@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <vector>
 #include <utility>
 #include <set>
@@ -359,7 +360,9 @@ struct Isomorphic : public IndexNotationVisitorStrict {
         !check(anode->stmt, bnode->stmt) ||
         anode->parallel_unit != bnode->parallel_unit ||
         anode->output_race_strategy != bnode->output_race_strategy ||
-        anode->unrollFactor != bnode->unrollFactor) {
+        anode->unrollFactor != bnode->unrollFactor ||
+        anode->merge_strategy != bnode->merge_strategy ||
+        anode->load_balance != bnode->load_balance) {
       eq = false;
       return;
     }
@@ -457,6 +460,250 @@ bool isomorphic(IndexStmt a, IndexStmt b) {
   return Isomorphic().check(a,b);
 }
 
+struct Canonicalizer : public IndexNotationVisitorStrict {
+  std::stringstream os;
+  std::map<TensorVar,int> tensorIds;
+  std::map<IndexVar,int> varIds;
+
+  std::string canonicalize(IndexStmt stmt) {
+    print(stmt);
+    return os.str();
+  }
+
+  void print(IndexExpr expr) {
+    if (!expr.defined()) {
+      os << "_";
+      return;
+    }
+    expr.accept(this);
+  }
+
+  void print(IndexStmt stmt) {
+    if (!stmt.defined()) {
+      os << "_";
+      return;
+    }
+    stmt.accept(this);
+  }
+
+  // Tensor and index variables are numbered in order of first occurrence,
+  // which is the same order in which Isomorphic pairs them up.
+  void print(TensorVar var) {
+    if (!util::contains(tensorIds, var)) {
+      int id = (int)tensorIds.size();
+      tensorIds.insert({var, id});
+      os << "T" << id << ":" << var.getType() << var.getFormat();
+      return;
+    }
+    os << "T" << tensorIds.at(var);
+  }
+
+  void print(IndexVar var) {
+    if (!util::contains(varIds, var)) {
+      int id = (int)varIds.size();
+      varIds.insert({var, id});
+    }
+    os << "i" << varIds.at(var);
+  }
+
+  void print(const std::vector<IndexVar>& vars) {
+    os << "[";
+    for (auto& var : vars) {
+      print(var);
+      os << ",";
+    }
+    os << "]";
+  }
+
+  using IndexNotationVisitorStrict::visit;
+
+  void visit(const AccessNode* node) {
+    os << "access(";
+    print(node->tensorVar);
+    print(node->indexVars);
+    if (node->isAccessingStructure) {
+      os << "s";
+    }
+    for (auto& window : node->windowedModes) {
+      os << "w" << window.first << ":" << window.second.lo << ","
+         << window.second.hi << "," << window.second.stride;
+    }
+    for (auto& indexSet : node->indexSetModes) {
+      os << "x" << indexSet.first << ":{"
+         << util::join(*indexSet.second.set, ",") << "}";
+    }
+    os << ")";
+  }
+
+  void visit(const LiteralNode* node) {
+    os << "lit(" << node->getDataType() << ":";
+    const uint8_t* bytes = (const uint8_t*)node->val;
+    const char* hexDigits = "0123456789abcdef";
+    for (int i = 0; i < node->getDataType().getNumBytes(); ++i) {
+      os << hexDigits[bytes[i] >> 4] << hexDigits[bytes[i] & 0xf];
+    }
+    os << ")";
+  }
+
+  template <class T>
+  void printUnary(const T* node, std::string name) {
+    os << name << "(";
+    print(node->a);
+    os << ")";
+  }
+
+  void visit(const NegNode* node) {
+    printUnary(node, "neg");
+  }
+
+  void visit(const SqrtNode* node) {
+    printUnary(node, "sqrt");
+  }
+
+  template <class T>
+  void printBinary(const T* node, std::string name) {
+    os << name << "(";
+    print(node->a);
+    os << ",";
+    print(node->b);
+    os << ")";
+  }
+
+  void visit(const AddNode* node) {
+    printBinary(node, "add");
+  }
+
+  void visit(const SubNode* node) {
+    printBinary(node, "sub");
+  }
+
+  void visit(const MulNode* node) {
+    printBinary(node, "mul");
+  }
+
+  void visit(const DivNode* node) {
+    printBinary(node, "div");
+  }
+
+  void visit(const CastNode* node) {
+    os << "cast<" << node->getDataType() << ">(";
+    print(node->a);
+    os << ")";
+  }
+
+  void visit(const CallIntrinsicNode* node) {
+    os << "call<" << node->func->getName() << ">(";
+    for (auto& arg : node->args) {
+      print(arg);
+      os << ",";
+    }
+    os << ")";
+  }
+
+  void visit(const ReductionNode* node) {
+    os << "reduce(";
+    print(node->op);
+    os << ",";
+    print(node->var);
+    os << ",";
+    print(node->a);
+    os << ")";
+  }
+
+  void visit(const AssignmentNode* node) {
+    os << "assign(";
+    print(node->lhs);
+    os << ",";
+    print(node->rhs);
+    os << ",";
+    print(node->op);
+    os << ")";
+  }
+
+  void visit(const YieldNode* node) {
+    os << "yield(";
+    print(node->indexVars);
+    print(node->expr);
+    os << ")";
+  }
+
+  void visit(const ForallNode* node) {
+    os << "forall(";
+    print(node->indexVar);
+    os << "," << (int)node->parallel_unit
+       << "," << (int)node->output_race_strategy
+       << "," << node->unrollFactor
+       << "," << (int)node->merge_strategy
+       << "," << (int)node->load_balance << ",";
+    print(node->stmt);
+    os << ")";
+  }
+
+  void visit(const WhereNode* node) {
+    os << "where(";
+    print(node->consumer);
+    os << ",";
+    print(node->producer);
+    os << ")";
+  }
+
+  void visit(const SequenceNode* node) {
+    os << "sequence(";
+    print(node->definition);
+    os << ",";
+    print(node->mutation);
+    os << ")";
+  }
+
+  void visit(const AssembleNode* node) {
+    os << "assemble(";
+    print(node->queries);
+    os << ",";
+    print(node->compute);
+    os << ")";
+  }
+
+  void visit(const MultiNode* node) {
+    os << "multi(";
+    print(node->stmt1);
+    os << ",";
+    print(node->stmt2);
+    os << ")";
+  }
+
+  void visit(const SuchThatNode* node) {
+    os << "suchthat(";
+    print(node->stmt);
+    for (auto& rel : node->predicate) {
+      os << ",rel" << rel.getRelType();
+      print(rel.getNode()->getParents());
+      print(rel.getNode()->getChildren());
+      switch (rel.getRelType()) {
+        case SPLIT:
+          os << rel.getNode<SplitRelNode>()->getSplitFactor();
+          break;
+        case DIVIDE:
+          os << rel.getNode<DivideRelNode>()->getDivFactor();
+          break;
+        case POS:
+          print(rel.getNode<PosRelNode>()->getAccess());
+          break;
+        case BOUND:
+          os << rel.getNode<BoundRelNode>()->getBound() << ","
+             << (int)rel.getNode<BoundRelNode>()->getBoundType();
+          break;
+        default:
+          break;
+      }
+    }
+    os << ")";
+  }
+};
+
+std::string canonicalize(IndexStmt stmt) {
+  return Canonicalizer().canonicalize(stmt);
+}
+
 struct Equals : public IndexNotationVisitorStrict {
   bool eq = false;
   IndexExpr bExpr;
@@ -666,7 +913,9 @@ struct Equals : public IndexNotationVisitorStrict {
         !equals(anode->stmt, bnode->stmt) ||
         anode->parallel_unit != bnode->parallel_unit ||
         anode->output_race_strategy != bnode->output_race_strategy ||
-        anode->unrollFactor != bnode->unrollFactor) {
+        anode->unrollFactor != bnode->unrollFactor ||
+        anode->merge_strategy != bnode->merge_strategy ||
+        anode->load_balance != bnode->load_balance) {
       eq = false;
       return;
     }
@@ -1576,9 +1825,10 @@ IndexStmt IndexStmt::reorder(std::vector<IndexVar> reorderedvars) const {
   return transformed;
 }
 
-IndexStmt IndexStmt::parallelize(IndexVar i, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy) const {
+IndexStmt IndexStmt::parallelize(IndexVar i, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy,
+                                  LoadBalance load_balance) const {
   string reason;
-  IndexStmt transformed = Parallelize(i, parallel_unit, output_race_strategy).apply(*this, &reason);
+  IndexStmt transformed = Parallelize(i, parallel_unit, output_race_strategy, load_balance).apply(*this, &reason);
   if (!transformed.defined()) {
     taco_uerror << reason;
   }
@@ -1686,7 +1936,7 @@ IndexStmt IndexStmt::unroll(IndexVar i, size_t unrollFactor) const {
 
     void visit(const ForallNode* node) {
       if (node->indexVar == i) {
-        stmt = Forall(i, rewrite(node->stmt), node->parallel_unit, node->output_race_strategy, unrollFactor);
+        stmt = Forall(i, rewrite(node->stmt), node->parallel_unit, node->output_race_strategy, unrollFactor, node->merge_strategy, node->load_balance);
       }
       else {
         IndexNotationRewriter::visit(node);
@@ -1696,6 +1946,25 @@ IndexStmt IndexStmt::unroll(IndexVar i, size_t unrollFactor) const {
   return UnrollLoop(i, unrollFactor).rewrite(*this);
 }
 
+IndexStmt IndexStmt::mergeby(IndexVar i, MergeStrategy strategy) const {
+  struct SetMergeStrategy : IndexNotationRewriter {
+    using IndexNotationRewriter::visit;
+    IndexVar i;
+    MergeStrategy strategy;
+    SetMergeStrategy(IndexVar i, MergeStrategy strategy) : i(i), strategy(strategy) {}
+
+    void visit(const ForallNode* node) {
+      if (node->indexVar == i) {
+        stmt = Forall(i, rewrite(node->stmt), node->parallel_unit, node->output_race_strategy, node->unrollFactor, strategy, node->load_balance);
+      }
+      else {
+        IndexNotationRewriter::visit(node);
+      }
+    }
+  };
+  return SetMergeStrategy(i, strategy).rewrite(*this);
+}
+
 IndexStmt IndexStmt::assemble(TensorVar result, AssembleStrategy strategy,
                               bool separatelySchedulable) const {
   string reason;
@@ -1797,8 +2066,8 @@ Forall::Forall(IndexVar indexVar, IndexStmt stmt)
     : Forall(indexVar, stmt, ParallelUnit::NotParallel, OutputRaceStrategy::IgnoreRaces) {
 }
 
-Forall::Forall(IndexVar indexVar, IndexStmt stmt, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy, size_t unrollFactor)
-        : Forall(new ForallNode(indexVar, stmt, parallel_unit, output_race_strategy, unrollFactor)) {
+Forall::Forall(IndexVar indexVar, IndexStmt stmt, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy, size_t unrollFactor, MergeStrategy merge_strategy, LoadBalance load_balance)
+        : Forall(new ForallNode(indexVar, stmt, parallel_unit, output_race_strategy, unrollFactor, merge_strategy, load_balance)) {
 }
 
 IndexVar Forall::getIndexVar() const {
@@ -1821,12 +2090,20 @@ size_t Forall::getUnrollFactor() const {
   return getNode(*this)->unrollFactor;
 }
 
+MergeStrategy Forall::getMergeStrategy() const {
+  return getNode(*this)->merge_strategy;
+}
+
+LoadBalance Forall::getLoadBalance() const {
+  return getNode(*this)->load_balance;
+}
+
 Forall forall(IndexVar i, IndexStmt stmt) {
   return Forall(i, stmt);
 }
 
-Forall forall(IndexVar i, IndexStmt stmt, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy, size_t unrollFactor) {
-  return Forall(i, stmt, parallel_unit, output_race_strategy, unrollFactor);
+Forall forall(IndexVar i, IndexStmt stmt, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy, size_t unrollFactor, MergeStrategy merge_strategy, LoadBalance load_balance) {
+  return Forall(i, stmt, parallel_unit, output_race_strategy, unrollFactor, merge_strategy, load_balance);
 }
 
 template <> bool isa<Forall>(IndexStmt s) {
@@ -3456,7 +3733,7 @@ private:
       stmt = op;
     }
     else {
-      stmt = new ForallNode(op->indexVar, body, op->parallel_unit, op->output_race_strategy, op->unrollFactor);
+      stmt = new ForallNode(op->indexVar, body, op->parallel_unit, op->output_race_strategy, op->unrollFactor, op->merge_strategy, op->load_balance);
     }
   }
 
@@ -227,6 +227,12 @@ void IndexNotationPrinter::visit(const ForallNode* op) {
   if (op->parallel_unit != ParallelUnit::NotParallel) {
     os << ", " << ParallelUnit_NAMES[(int) op->parallel_unit] << ", " << OutputRaceStrategy_NAMES[(int) op->output_race_strategy];
   }
+  if (op->merge_strategy != MergeStrategy::TwoFinger) {
+    os << ", " << MergeStrategy_NAMES[(int) op->merge_strategy];
+  }
+  if (op->load_balance != LoadBalance::Iterations) {
+    os << ", " << LoadBalance_NAMES[(int) op->load_balance];
+  }
   os << ")";
 }
 
@@ -5,6 +5,7 @@
 #include "taco/index_notation/index_notation.h"
 #include "taco/lower/lower.h"
 #include "taco/codegen/module.h"
+#include "taco/execution_context.h"
 #include "taco/storage/storage.h"
 #include "taco/storage/index.h"
 #include "taco/storage/array.h"
@@ -80,24 +81,48 @@ void unpackResults(size_t numResults, const vector<void*> arguments,
   }
 }
 
-bool Kernel::operator()(const vector<TensorStorage>& args) const {
+static int callFunc(ir::Module* module, string name,
+                    const vector<TensorStorage>& args, size_t numResults,
+                    bool unpack, const ExecutionContext* context) {
   vector<void*> arguments = packArguments(args);
-  int result = content->module->callFuncPacked("evaluate", arguments.data());
-  unpackResults(this->numResults, arguments, args);
-  return (result == 0);
+  int result = module->callFuncPacked(name, arguments, context);
+  if (unpack) {
+    unpackResults(numResults, arguments, args);
+  }
+  return result;
+}
+
+bool Kernel::operator()(const vector<TensorStorage>& args) const {
+  return callFunc(content->module.get(), "evaluate", args, numResults, true,
+                  nullptr) == 0;
+}
+
+bool Kernel::operator()(const ExecutionContext& context,
+                        const vector<TensorStorage>& args) const {
+  return callFunc(content->module.get(), "evaluate", args, numResults, true,
+                  &context) == 0;
 }
 
 bool Kernel::assemble(const vector<TensorStorage>& args) const {
-  vector<void*> arguments = packArguments(args);
-  int result = content->module->callFuncPacked("assemble", arguments.data());
-  unpackResults(this->numResults, arguments, args);
-  return (result == 0);
+  return callFunc(content->module.get(), "assemble", args, numResults, true,
+                  nullptr) == 0;
+}
+
+bool Kernel::assemble(const ExecutionContext& context,
+                      const vector<TensorStorage>& args) const {
+  return callFunc(content->module.get(), "assemble", args, numResults, true,
+                  &context) == 0;
 }
 
 bool Kernel::compute(const vector<TensorStorage>& args) const {
-  vector<void*> arguments = packArguments(args);
-  int result = content->module->callFuncPacked("compute", arguments.data());
-  return (result == 0);
+  return callFunc(content->module.get(), "compute", args, numResults, false,
+                  nullptr) == 0;
+}
+
+bool Kernel::compute(const ExecutionContext& context,
+                     const vector<TensorStorage>& args) const {
+  return callFunc(content->module.get(), "compute", args, numResults, false,
+                  &context) == 0;
 }
 
 bool Kernel::defined() {
@@ -9,6 +9,8 @@
 #include "taco/lower/merge_lattice.h"
 #include "taco/lower/mode.h"
 #include "taco/lower/mode_format_impl.h"
+#include "taco/target.h"
+#include "taco/util/parallel.h"
 
 #include <iostream>
 #include <algorithm>
@@ -660,6 +662,7 @@ struct Parallelize::Content {
   IndexVar i;
   ParallelUnit  parallel_unit;
   OutputRaceStrategy output_race_strategy;
+  LoadBalance load_balance;
 };
 
 
@@ -668,10 +671,12 @@ Parallelize::Parallelize() : content(nullptr) {
 
 Parallelize::Parallelize(IndexVar i) : Parallelize(i, ParallelUnit::DefaultUnit, OutputRaceStrategy::NoRaces) {}
 
-Parallelize::Parallelize(IndexVar i, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy) : content(new Content) {
+Parallelize::Parallelize(IndexVar i, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy,
+                         LoadBalance load_balance) : content(new Content) {
   content->i = i;
   content->parallel_unit = parallel_unit;
   content->output_race_strategy = output_race_strategy;
+  content->load_balance = load_balance;
 }
 
 
@@ -687,6 +692,10 @@ OutputRaceStrategy Parallelize::getOutputRaceStrategy() const {
   return content->output_race_strategy;
 }
 
+LoadBalance Parallelize::getLoadBalance() const {
+  return content->load_balance;
+}
+
 IndexStmt Parallelize::apply(IndexStmt stmt, std::string* reason) const {
   INIT_REASON(reason);
 
@@ -819,7 +828,7 @@ IndexStmt Parallelize::apply(IndexStmt stmt, std::string* reason) const {
           );
           taco_iassert(!precomputeAssignments.empty());
 
-          IndexStmt precomputed_stmt = forall(i, foralli.getStmt(), parallelize.getParallelUnit(), parallelize.getOutputRaceStrategy(), foralli.getUnrollFactor());
+          IndexStmt precomputed_stmt = forall(i, foralli.getStmt(), parallelize.getParallelUnit(), parallelize.getOutputRaceStrategy(), foralli.getUnrollFactor(), foralli.getMergeStrategy(), parallelize.getLoadBalance());
           for (auto assignment : precomputeAssignments) {
             // Construct temporary of correct type and size of outer loop
             TensorVar w(string("w_") + ParallelUnit_NAMES[(int) parallelize.getParallelUnit()], Type(assignment->lhs.getDataType(), {Dimension(i)}), taco::dense);
@@ -828,7 +837,7 @@ IndexStmt Parallelize::apply(IndexStmt stmt, std::string* reason) const {
             IndexStmt producer = ReplaceReductionExpr(map<Access, Access>({{assignment->lhs, w(i)}})).rewrite(precomputed_stmt);
             taco_iassert(isa<Forall>(producer));
             Forall producer_forall = to<Forall>(producer);
-            producer = forall(producer_forall.getIndexVar(), producer_forall.getStmt(), parallelize.getParallelUnit(), parallelize.getOutputRaceStrategy(), foralli.getUnrollFactor());
+            producer = forall(producer_forall.getIndexVar(), producer_forall.getStmt(), parallelize.getParallelUnit(), parallelize.getOutputRaceStrategy(), foralli.getUnrollFactor(), foralli.getMergeStrategy(), parallelize.getLoadBalance());
 
             // build consumer that writes from temporary to output, mark consumer as parallel reduction
             ParallelUnit reductionUnit = ParallelUnit::CPUThreadGroupReduction;
@@ -854,12 +863,13 @@ IndexStmt Parallelize::apply(IndexStmt stmt, std::string* reason) const {
                                          false, true);
           stmt = forall(i, body, parallelize.getParallelUnit(), 
                         parallelize.getOutputRaceStrategy(), 
-                        foralli.getUnrollFactor());
+                        foralli.getUnrollFactor(), foralli.getMergeStrategy(),
+                        parallelize.getLoadBalance());
           return;
         }
 
 
-        stmt = forall(i, foralli.getStmt(), parallelize.getParallelUnit(), parallelize.getOutputRaceStrategy(), foralli.getUnrollFactor());
+        stmt = forall(i, foralli.getStmt(), parallelize.getParallelUnit(), parallelize.getOutputRaceStrategy(), foralli.getUnrollFactor(), foralli.getMergeStrategy(), parallelize.getLoadBalance());
         return;
       }
 
@@ -1027,7 +1037,8 @@ IndexStmt SetAssembleStrategy::apply(IndexStmt stmt, string* reason) const {
         stmt = op;
       } else if (s.defined()) {
         stmt = Forall(op->indexVar, s, op->parallel_unit, 
-                      op->output_race_strategy, op->unrollFactor);
+                      op->output_race_strategy, op->unrollFactor,
+                      op->merge_strategy, op->load_balance);
       } else {
         stmt = IndexStmt();
       }
@@ -1245,7 +1256,8 @@ IndexStmt SetAssembleStrategy::apply(IndexStmt stmt, string* reason) const {
         stmt = op;
       } else if (s.defined()) {
         stmt = new ForallNode(op->indexVar, s, op->parallel_unit, 
-                              op->output_race_strategy, op->unrollFactor);
+                              op->output_race_strategy, op->unrollFactor,
+                              op->merge_strategy, op->load_balance);
       } else {
         stmt = IndexStmt();
       }
@@ -1291,6 +1303,52 @@ std::ostream& operator<<(std::ostream& os,
 
 // Autoscheduling functions
 
+// Returns whether the loop directly below a loop over rows iterates over a
+// compressed level below a dense level over the rows, such as the nonzeros
+// in the rows of a CSR matrix
+static bool iteratesRowNonzeros(Forall forall) {
+  IndexStmt body = forall.getStmt();
+  while (isa<Where>(body)) {
+    body = to<Where>(body).getProducer();
+  }
+  if (!isa<Forall>(body)) {
+    return false;
+  }
+  IndexVar i = forall.getIndexVar();
+  IndexVar j = to<Forall>(body).getIndexVar();
+  for (const Access& access : getArgumentAccesses(body)) {
+    const Format& format = access.getTensorVar().getFormat();
+    if (format.getOrder() < 2) {
+      continue;
+    }
+    const vector<int>& ordering = format.getModeOrdering();
+    const vector<IndexVar>& vars = access.getIndexVars();
+    if (vars[ordering[0]] == i && vars[ordering[1]] == j &&
+        format.getModeFormats()[0].getName() == Dense.getName() &&
+        format.getModeFormats()[1].getName() == Compressed.getName()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns whether kernels run their parallel loops on more than one thread,
+// which needs either OpenMP or the task runtime
+static bool runsInParallel() {
+  if (taco_get_num_threads() <= 1) {
+    return false;
+  }
+  const Target target = getTargetFromEnvironment();
+  if (target.parallelism == Target::TaskRuntime) {
+    return true;
+  }
+#if USE_OPENMP
+  return target.parallelism == Target::OpenMP;
+#else
+  return false;
+#endif
+}
+
 IndexStmt parallelizeOuterLoop(IndexStmt stmt) {
   // get outer ForAll
   Forall forall;
@@ -1328,7 +1386,12 @@ IndexStmt parallelizeOuterLoop(IndexStmt stmt) {
     return parallelized256;
   }
   else {
-    IndexStmt parallelized = Parallelize(forall.getIndexVar(), ParallelUnit::CPUThread, OutputRaceStrategy::NoRaces).apply(stmt, &reason);
+    // Merge path searches for the partition boundaries of each thread, which
+    // is only worth it if there is more than one thread
+    LoadBalance loadBalance = runsInParallel() && iteratesRowNonzeros(forall)
+                              ? LoadBalance::MergePath
+                              : LoadBalance::Iterations;
+    IndexStmt parallelized = Parallelize(forall.getIndexVar(), ParallelUnit::CPUThread, OutputRaceStrategy::NoRaces, loadBalance).apply(stmt, &reason);
     if (parallelized == IndexStmt()) {
       // can't parallelize
       return stmt;
@@ -1443,6 +1506,8 @@ IndexStmt reorderLoopsTopologically(IndexStmt stmt) {
     IndexStmt innerBody;
     map <IndexVar, ParallelUnit> forallParallelUnit;
     map <IndexVar, OutputRaceStrategy> forallOutputRaceStrategy;
+    map <IndexVar, MergeStrategy> forallMergeStrategy;
+    map <IndexVar, LoadBalance> forallLoadBalance;
     vector<IndexVar> indexVarOriginalOrder;
     Iterators iterators;
 
@@ -1456,6 +1521,8 @@ IndexStmt reorderLoopsTopologically(IndexStmt stmt) {
       indexVarOriginalOrder.push_back(i);
       forallParallelUnit[i] = foralli.getParallelUnit();
       forallOutputRaceStrategy[i] = foralli.getOutputRaceStrategy();
+      forallMergeStrategy[i] = foralli.getMergeStrategy();
+      forallLoadBalance[i] = foralli.getLoadBalance();
 
       // Iterator and if Iterator enforces constraints
       vector<pair<Iterator, bool>> depIterators;
@@ -1538,12 +1605,17 @@ IndexStmt reorderLoopsTopologically(IndexStmt stmt) {
     IndexStmt innerBody;
     const map <IndexVar, ParallelUnit> forallParallelUnit;
     const map <IndexVar, OutputRaceStrategy> forallOutputRaceStrategy;
+    const map <IndexVar, MergeStrategy> forallMergeStrategy;
+    const map <IndexVar, LoadBalance> forallLoadBalance;
 
     TopoReorderRewriter(const vector<IndexVar>& sortedVars, IndexStmt innerBody,
                         const map <IndexVar, ParallelUnit> forallParallelUnit,
-                        const map <IndexVar, OutputRaceStrategy> forallOutputRaceStrategy)
+                        const map <IndexVar, OutputRaceStrategy> forallOutputRaceStrategy,
+                        const map <IndexVar, MergeStrategy> forallMergeStrategy,
+                        const map <IndexVar, LoadBalance> forallLoadBalance)
         : sortedVars(sortedVars), innerBody(innerBody),
-        forallParallelUnit(forallParallelUnit), forallOutputRaceStrategy(forallOutputRaceStrategy)  {
+        forallParallelUnit(forallParallelUnit), forallOutputRaceStrategy(forallOutputRaceStrategy),
+        forallMergeStrategy(forallMergeStrategy), forallLoadBalance(forallLoadBalance)  {
     }
 
     void visit(const ForallNode* node) {
@@ -1554,14 +1626,15 @@ IndexStmt reorderLoopsTopologically(IndexStmt stmt) {
       taco_iassert(util::contains(sortedVars, i));
       stmt = innerBody;
       for (auto it = sortedVars.rbegin(); it != sortedVars.rend(); ++it) {
-        stmt = forall(*it, stmt, forallParallelUnit.at(*it), forallOutputRaceStrategy.at(*it), foralli.getUnrollFactor());
+        stmt = forall(*it, stmt, forallParallelUnit.at(*it), forallOutputRaceStrategy.at(*it), foralli.getUnrollFactor(), forallMergeStrategy.at(*it), forallLoadBalance.at(*it));
       }
       return;
     }
 
   };
   TopoReorderRewriter rewriter(sortedVars, dagBuilder.innerBody, 
-                               dagBuilder.forallParallelUnit, dagBuilder.forallOutputRaceStrategy);
+                               dagBuilder.forallParallelUnit, dagBuilder.forallOutputRaceStrategy,
+                               dagBuilder.forallMergeStrategy, dagBuilder.forallLoadBalance);
   return rewriter.rewrite(stmt);
 }
 
@@ -1701,7 +1774,8 @@ IndexStmt scalarPromote(IndexStmt stmt, ProvenanceGraph provGraph,
       }
 
       stmt = forall(i, body, foralli.getParallelUnit(),
-                    foralli.getOutputRaceStrategy(), foralli.getUnrollFactor());
+                    foralli.getOutputRaceStrategy(), foralli.getUnrollFactor(),
+                    foralli.getMergeStrategy(), foralli.getLoadBalance());
       for (const auto& consumer : consumers) {
         stmt = where(consumer, stmt);
       }
@@ -1833,4 +1907,446 @@ IndexStmt insertTemporaries(IndexStmt stmt)
   return stmt;
 }
 
+// Returns the index variables of the expression that are not reduced in it.
+static set<IndexVar> getFreeVars(IndexExpr expr) {
+  set<IndexVar> freeVars;
+  set<IndexVar> reductionVars;
+  match(expr,
+        function<void(const AccessNode*)>([&](const AccessNode* op) {
+          freeVars.insert(op->indexVars.begin(), op->indexVars.end());
+        }),
+        function<void(const ReductionNode*,Matcher*)>([&](
+                const ReductionNode* op, Matcher* ctx) {
+          reductionVars.insert(op->var);
+          ctx->match(op->a);
+        })
+  );
+  for (auto& var : reductionVars) {
+    freeVars.erase(var);
+  }
+  return freeVars;
+}
+
+// Returns true if the loops over the index variables iterate over every
+// coordinate when they compute the statements, which is the case if the
+// statements only access dense modes with them.
+static bool iteratesDensely(const vector<IndexStmt>& stmts,
+                            const set<IndexVar>& vars) {
+  bool dense = true;
+  for (auto& stmt : stmts) {
+    match(stmt,
+          function<void(const AccessNode*)>([&](const AccessNode* op) {
+            const Format& format = op->tensorVar.getFormat();
+            for (size_t level = 0; level < op->indexVars.size(); level++) {
+              int mode = format.getModeOrdering()[level];
+              if (util::contains(vars, op->indexVars[mode]) &&
+                  format.getModeFormats()[level].getName() !=
+                      Dense.getName()) {
+                dense = false;
+              }
+            }
+          })
+    );
+  }
+  return dense;
+}
+
+namespace {
+
+/// Rewrites an expression to reduce over new index variables, so that copies
+/// of the expression substituted into other expressions don't share them.
+struct RenameReductionVars : public IndexNotationRewriter {
+  using IndexNotationRewriter::visit;
+
+  void visit(const ReductionNode* op) {
+    IndexVar var;
+    map<IndexVar,IndexVar> renaming;
+    renaming.insert({op->var, var});
+    expr = Reduction(op->op, var, replace(rewrite(op->a), renaming));
+  }
+};
+
+/// Fuses the loop nests of assignments that read the tensors assigned by
+/// earlier assignments (see fuse).
+class Fuser {
+public:
+  Fuser(const vector<Assignment>& assignments, const set<TensorVar>& results)
+      : results(results) {
+    for (auto& assignment : assignments) {
+      TensorVar tensor = assignment.getLhs().getTensorVar();
+      match(assignment.getRhs(),
+            function<void(const AccessNode*)>([&](const AccessNode* op) {
+              if (util::contains(definitions, op->tensorVar)) {
+                numReads[op->tensorVar]++;
+              }
+            })
+      );
+      definitions.insert({tensor, assignment});
+    }
+  }
+
+  /// Returns true if the tensor is assigned by one of the assignments.
+  bool isDefined(TensorVar tensor) const {
+    return util::contains(definitions, tensor);
+  }
+
+  /// Returns the number of times the assignments read the tensor.
+  int getNumReads(TensorVar tensor) const {
+    return util::contains(numReads, tensor) ? numReads.at(tensor) : 0;
+  }
+
+  /// Returns true if the result has been assigned by fused loop nests.
+  bool isMaterialized(TensorVar result) const {
+    return util::contains(materialized, result);
+  }
+
+  /// Returns the statement in where statements that first compute the dense
+  /// temporaries that it reads, and that assign the results of temporaries
+  /// alongside it.
+  IndexStmt hoist(IndexStmt stmt) {
+    for (auto& assignment : resultAssignments) {
+      stmt = multi(stmt, assignment);
+    }
+    for (auto& producer : util::reverse(temporaryProducers)) {
+      stmt = where(stmt, producer);
+    }
+    temporaries.clear();
+    temporaryProducers.clear();
+    resultAssignments.clear();
+    return stmt;
+  }
+
+  /// Returns a statement that assigns the expression to lhs in loops over the
+  /// given index variables, nested in loops over the bound index variables.
+  /// Reductions and reads of the assignments are computed into workspaces by
+  /// where statements placed in the outermost loop that binds their free
+  /// variables.  If assignsResults is true, the results that are read in the
+  /// innermost loop are assigned from their workspace alongside lhs, provided
+  /// that the loops iterate over each of their components once.
+  IndexStmt fuse(Access lhs, IndexExpr rhs, IndexExpr op,
+                 const vector<IndexVar>& loops, const set<IndexVar>& bound,
+                 bool assignsResults) {
+    struct Producer {
+      TensorVar workspace;
+      IndexExpr rhs;
+      IndexExpr op;
+      vector<IndexVar> loops;
+      set<IndexVar> freeVars;
+      Access read;  // the read of a tensor of the assignments
+      IndexStmt stmt;
+    };
+
+    // Reductions are computed by loop nests of their own, while the reads of
+    // the assignments, and the reads these read in turn, are computed by the
+    // loops of the expression.  Producers are listed before the producers
+    // that read them.
+    struct ExtractProducers : public IndexNotationRewriter {
+      using IndexNotationRewriter::visit;
+
+      Fuser* fuser;
+      const vector<IndexVar>& loops;
+      const set<IndexVar>& bound;
+      set<IndexVar> enclosing;  // the loops that enclose the expression
+      vector<Producer> producers;
+      map<pair<TensorVar,vector<IndexVar>>, TensorVar> workspaces;
+
+      ExtractProducers(Fuser* fuser, const vector<IndexVar>& loops,
+                       const set<IndexVar>& bound)
+          : fuser(fuser), loops(loops), bound(bound), enclosing(bound) {
+        enclosing.insert(loops.begin(), loops.end());
+      }
+
+      void visit(const ReductionNode* op) {
+        TensorVar workspace = fuser->makeWorkspace("t" + op->var.getName(),
+                                                   op->getDataType());
+        set<IndexVar> freeVars = getFreeVars(op->a);
+        freeVars.erase(op->var);
+        producers.push_back({workspace, op->a, op->op, {op->var}, freeVars,
+                             Access(), IndexStmt()});
+        expr = workspace;
+      }
+
+      void visit(const AccessNode* op) {
+        if (!fuser->isDefined(op->tensorVar)) {
+          expr = op;
+          return;
+        }
+        const TensorVar& tensor = op->tensorVar;
+        set<IndexVar> freeVars(op->indexVars.begin(), op->indexVars.end());
+
+        // Intermediates that are read once are inlined, unless loops over
+        // other variables would compute them again
+        if (!util::contains(fuser->results, tensor) &&
+            fuser->getNumReads(tensor) == 1 &&
+            std::includes(freeVars.begin(), freeVars.end(),
+                          enclosing.begin(), enclosing.end())) {
+          expr = rewrite(fuser->substitute(op));
+          return;
+        }
+
+        // Tensors that loops over other variables would compute again are
+        // computed into dense temporaries by loop nests of their own
+        set<IndexVar> available;
+        getPlacement(freeVars, loops, bound, &available);
+        if (!std::includes(freeVars.begin(), freeVars.end(),
+                           available.begin(), available.end())) {
+          expr = Access(fuser->materialize(tensor), op->indexVars);
+          return;
+        }
+
+        // Reads of the same components share a workspace
+        auto key = make_pair(tensor, op->indexVars);
+        if (util::contains(workspaces, key)) {
+          expr = workspaces.at(key);
+          return;
+        }
+        set<IndexVar> consumerLoops = enclosing;
+        enclosing = available;
+        IndexExpr definition = rewrite(fuser->substitute(op));
+        enclosing = consumerLoops;
+        TensorVar workspace = fuser->makeWorkspace(tensor.getName() + "_w",
+                                                   op->getDataType());
+        producers.push_back({workspace, definition, IndexExpr(), {}, freeVars,
+                             op, IndexStmt()});
+        workspaces.insert({key, workspace});
+        expr = workspace;
+      }
+    };
+    ExtractProducers extract(this, loops, bound);
+    IndexExpr consumer = extract.rewrite(rhs);
+
+    // Place each producer in the outermost loop that binds its free variables
+    vector<vector<Producer>> producers(loops.size() + 1);
+    for (auto& producer : extract.producers) {
+      set<IndexVar> available;
+      size_t depth = getPlacement(producer.freeVars, loops, bound, &available);
+      if (producer.loops.empty()) {
+        producer.stmt = Assignment(producer.workspace, producer.rhs);
+      }
+      else {
+        producer.stmt = fuse(producer.workspace, producer.rhs, producer.op,
+                             producer.loops, available, false);
+      }
+      producers[depth].push_back(producer);
+    }
+
+    IndexStmt stmt = Assignment(lhs, consumer, op);
+    if (assignsResults) {
+      set<IndexVar> available = bound;
+      available.insert(loops.begin(), loops.end());
+      vector<IndexStmt> stmts = {stmt};
+      for (auto& depth : producers) {
+        for (auto& producer : depth) {
+          stmts.push_back(producer.stmt);
+        }
+      }
+      for (auto& producer : util::reverse(producers[loops.size()])) {
+        if (!producer.read.defined()) {
+          continue;
+        }
+        TensorVar tensor = producer.read.getTensorVar();
+        vector<IndexVar> vars = producer.read.getIndexVars();
+        if (util::contains(results, tensor) && !isMaterialized(tensor) &&
+            isDense(tensor.getFormat()) &&
+            set<IndexVar>(vars.begin(), vars.end()).size() == vars.size() &&
+            set<IndexVar>(vars.begin(), vars.end()) == available &&
+            iteratesDensely(stmts, available)) {
+          stmt = multi(Assignment(producer.read, producer.workspace), stmt);
+          materialized.insert(tensor);
+        }
+      }
+    }
+
+    for (size_t depth = loops.size() + 1; depth-- > 0;) {
+      for (auto& producer : util::reverse(producers[depth])) {
+        stmt = where(stmt, producer.stmt);
+      }
+      if (depth > 0) {
+        stmt = forall(loops[depth - 1], stmt);
+      }
+    }
+    return stmt;
+  }
+
+private:
+  set<TensorVar> results;
+  map<TensorVar,Assignment> definitions;
+  map<TensorVar,int> numReads;
+  set<TensorVar> materialized;
+  set<string> workspaceNames;
+
+  /// The dense temporaries of tensors, the loop nests that compute them, and
+  /// the assignments of results from them, which hoist adds to a statement.
+  map<TensorVar,TensorVar> temporaries;
+  vector<IndexStmt> temporaryProducers;
+  vector<IndexStmt> resultAssignments;
+
+  /// Returns the depth of the outermost of the loops, nested in loops over
+  /// the bound variables, that binds the variables, and sets available to the
+  /// variables that are bound there.
+  static size_t getPlacement(const set<IndexVar>& vars,
+                             const vector<IndexVar>& loops,
+                             const set<IndexVar>& bound,
+                             set<IndexVar>* available) {
+    *available = bound;
+    size_t depth = 0;
+    while (!std::includes(available->begin(), available->end(),
+                          vars.begin(), vars.end())) {
+      taco_iassert(depth < loops.size());
+      available->insert(loops[depth++]);
+    }
+    return depth;
+  }
+
+  /// Returns a dense temporary that a loop nest of its own assigns the tensor
+  /// to.  Dense results are assigned from it too.
+  TensorVar materialize(TensorVar tensor) {
+    if (util::contains(temporaries, tensor)) {
+      return temporaries.at(tensor);
+    }
+    Assignment definition = definitions.at(tensor);
+    vector<IndexVar> vars = definition.getLhs().getIndexVars();
+    Format format(vector<ModeFormatPack>(tensor.getOrder(), Dense));
+    TensorVar temporary(makeName(tensor.getName() + "_t"), tensor.getType(),
+                        format);
+    IndexExpr rhs = RenameReductionVars().rewrite(definition.getRhs());
+    temporaryProducers.push_back(fuse(Access(temporary, vars), rhs,
+                                      IndexExpr(), vars, {}, false));
+    temporaries.insert({tensor, temporary});
+    if (util::contains(results, tensor) && !isMaterialized(tensor) &&
+        isDense(tensor.getFormat())) {
+      IndexStmt assignment = Assignment(Access(tensor, vars),
+                                        Access(temporary, vars));
+      for (auto& var : util::reverse(vars)) {
+        assignment = forall(var, assignment);
+      }
+      resultAssignments.push_back(assignment);
+      materialized.insert(tensor);
+    }
+    return temporary;
+  }
+
+  /// Returns the right-hand side of the assignment of the accessed tensor,
+  /// over the index variables of the access.
+  IndexExpr substitute(Access access) {
+    Assignment definition = definitions.at(access.getTensorVar());
+    vector<IndexVar> vars = definition.getLhs().getIndexVars();
+    map<IndexVar,IndexVar> renaming;
+    for (size_t i = 0; i < vars.size(); i++) {
+      renaming.insert({vars[i], access.getIndexVars()[i]});
+    }
+    IndexExpr rhs = RenameReductionVars().rewrite(definition.getRhs());
+    return replace(rhs, renaming);
+  }
+
+  /// Returns a name that no other workspace or temporary has.
+  string makeName(string name) {
+    string unique = name;
+    for (int i = 1; util::contains(workspaceNames, unique); i++) {
+      unique = name + util::toString(i);
+    }
+    workspaceNames.insert(unique);
+    return unique;
+  }
+
+  /// Returns a scalar workspace with a name that no other workspace has.
+  TensorVar makeWorkspace(string name, Datatype type) {
+    return TensorVar(makeName(name), Type(type));
+  }
+};
+
+}
+
+IndexStmt fuse(const vector<Assignment>& assignments,
+               const vector<TensorVar>& results) {
+  taco_uassert(!results.empty()) << "There are no results to compute";
+
+  // The tensors that the assignments assign and read
+  vector<Assignment> definitions;
+  set<TensorVar> defined;
+  map<TensorVar,int> lastRead;
+  for (size_t k = 0; k < assignments.size(); k++) {
+    Assignment assignment = makeReductionNotation(assignments[k]);
+    Access lhs = assignment.getLhs();
+    TensorVar tensor = lhs.getTensorVar();
+    vector<IndexVar> vars = lhs.getIndexVars();
+    taco_uassert(!util::contains(defined, tensor))
+        << tensor.getName() << " is assigned more than once";
+    taco_uassert(set<IndexVar>(vars.begin(), vars.end()).size() == vars.size())
+        << tensor.getName() << " is assigned with repeated index variables";
+    taco_uassert(!lhs.hasWindowedModes() && !lhs.hasIndexSetModes())
+        << tensor.getName() << " is assigned to windows or index sets";
+    match(assignment.getRhs(),
+          function<void(const AccessNode*)>([&](const AccessNode* op) {
+            taco_uassert(op->tensorVar != tensor)
+                << tensor.getName() << " reads itself";
+            if (util::contains(defined, op->tensorVar)) {
+              Access access(op);
+              taco_uassert(!access.hasWindowedModes() &&
+                           !access.hasIndexSetModes() &&
+                           !access.isAccessingStructure())
+                  << op->tensorVar.getName()
+                  << " is read through windows, index sets or its structure";
+              lastRead[op->tensorVar] = (int)k;
+            }
+          })
+    );
+    definitions.push_back(assignment);
+    defined.insert(tensor);
+  }
+  for (auto& assignment : definitions) {
+    TensorVar tensor = assignment.getLhs().getTensorVar();
+    taco_uassert(!util::contains(lastRead, tensor) ||
+                 !assignment.getOperator().defined())
+        << tensor.getName() << " is read by other assignments, so it must be "
+        << "assigned with = rather than a compound assignment";
+  }
+  for (auto& result : results) {
+    taco_uassert(util::contains(defined, result))
+        << result.getName() << " is not assigned by the assignments";
+  }
+
+  // Results that no assignment reads are the roots of the fused loop nests,
+  // which compute the other results on the way
+  Fuser fuser(definitions, set<TensorVar>(results.begin(), results.end()));
+  IndexStmt stmt;
+  for (auto& assignment : definitions) {
+    TensorVar tensor = assignment.getLhs().getTensorVar();
+    if (!util::contains(results, tensor) || util::contains(lastRead, tensor)) {
+      continue;
+    }
+    bool readsAssignments = false;
+    match(assignment.getRhs(),
+          function<void(const AccessNode*)>([&](const AccessNode* op) {
+            readsAssignments |= fuser.isDefined(op->tensorVar);
+          })
+    );
+    IndexStmt root;
+    if (readsAssignments) {
+      root = fuser.hoist(fuser.fuse(assignment.getLhs(), assignment.getRhs(),
+                                    assignment.getOperator(),
+                                    assignment.getLhs().getIndexVars(), {},
+                                    true));
+    }
+    else {
+      root = insertTemporaries(
+          reorderLoopsTopologically(makeConcreteNotation(assignment)));
+    }
+    stmt = stmt.defined() ? multi(stmt, root) : root;
+  }
+  for (auto& result : results) {
+    taco_uassert(!util::contains(lastRead, result) ||
+                 fuser.isMaterialized(result))
+        << result.getName() << " cannot be fused with the assignments that "
+        << "read it, since none of them iterates densely over its components "
+        << "outside of reductions";
+  }
+
+  string reason;
+  taco_iassert(isConcreteNotation(stmt, &reason))
+      << "Fused statement is not concrete index notation: " << reason
+      << endl << stmt;
+  return stmt;
+}
+
 }
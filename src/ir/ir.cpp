@@ -411,6 +411,14 @@ Expr BitOr::make(Expr a, Expr b) {
   return bitOr;
 }
 
+Expr Shr::make(Expr a, Expr b) {
+  Shr *shr = new Shr;
+  shr->type = a.type();
+  shr->a = a;
+  shr->b = b;
+  return shr;
+}
+
 // Boolean binary ops
 Expr Eq::make(Expr a, Expr b) {
   Eq *eq = new Eq;
@@ -807,7 +815,7 @@ Stmt Print::make(std::string fmt, std::vector<Expr> params) {
 }
   
 Expr GetProperty::make(Expr tensor, TensorProperty property, int mode,
-                       int index, std::string name) {
+                       int index, std::string name, Datatype type) {
   GetProperty* gp = new GetProperty;
   gp->tensor = tensor;
   gp->property = property;
@@ -819,7 +827,7 @@ Expr GetProperty::make(Expr tensor, TensorProperty property, int mode,
   if (property == TensorProperty::Values)
     gp->type = tensor.type();
   else
-    gp->type = Int();
+    gp->type = type;
   
   return gp;
 }
@@ -903,6 +911,8 @@ template<> void ExprNode<BitAnd>::accept(IRVisitorStrict *v)
     const { v->visit((const BitAnd*)this); }
 template<> void ExprNode<BitOr>::accept(IRVisitorStrict *v)
     const { v->visit((const BitOr*)this); }
+template<> void ExprNode<Shr>::accept(IRVisitorStrict *v)
+    const { v->visit((const Shr*)this); }
 template<> void ExprNode<Eq>::accept(IRVisitorStrict *v)
     const { v->visit((const Eq*)this); }
 template<> void ExprNode<Neq>::accept(IRVisitorStrict *v)
@@ -199,6 +199,10 @@ void IRPrinter::visit(const BitOr* op){
   printBinOp(op->a, op->b, "|", Precedence::BOR);
 }
 
+void IRPrinter::visit(const Shr* op){
+  printBinOp(op->a, op->b, ">>", Precedence::SHR);
+}
+
 void IRPrinter::visit(const Eq* op){
   printBinOp(op->a, op->b, "==", Precedence::EQ);
 }
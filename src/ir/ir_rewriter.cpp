@@ -142,6 +142,10 @@ void IRRewriter::visit(const BitOr* op) {
   expr = visitBinaryOp(op, this);
 }
 
+void IRRewriter::visit(const Shr* op) {
+  expr = visitBinaryOp(op, this);
+}
+
 void IRRewriter::visit(const Eq* op) {
   expr = visitBinaryOp(op, this);
 }
@@ -103,6 +103,17 @@ protected:
     op->b.accept(this);
   }
 
+  void visit(const Shr *op) {
+    // The shift amount may have a different type than the shifted operand
+    if (op->a.type() != op->type) {
+      messages << "Node: " << (Expr)op << " has left operand with different "
+               << "type from result (expected " << op->type << " but got "
+               << op->a.type() << ")\n";
+    }
+    op->a.accept(this);
+    op->b.accept(this);
+  }
+
   void visit(const Eq *op) {
     verify_operand_types_consistent(op);
     op->a.accept(this);
@@ -75,6 +75,11 @@ void IRVisitor::visit(const BitOr* op){
   op->b.accept(this);
 }
 
+void IRVisitor::visit(const Shr* op){
+  op->a.accept(this);
+  op->b.accept(this);
+}
+
 void IRVisitor::visit(const Eq* op){
   op->a.accept(this);
   op->b.accept(this);
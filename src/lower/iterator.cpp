@@ -87,9 +87,10 @@ Iterator::Iterator(IndexVar indexVar, Expr tensor, Mode mode, Iterator parent,
   if (useNameForPos) {
     posNamePrefix = name;
   }
-  content->posVar   = Var::make(name,            Int());
-  content->endVar   = Var::make("p" + modeName + "_end",   Int());
-  content->beginVar = Var::make("p" + modeName + "_begin", Int());
+  const Datatype positionType = mode.getPositionType();
+  content->posVar   = Var::make(name,            positionType);
+  content->endVar   = Var::make("p" + modeName + "_end",   positionType);
+  content->beginVar = Var::make("p" + modeName + "_begin", positionType);
 
   content->coordVar = Var::make(name, Int());
   content->segendVar = Var::make(modeName + "_segend", Int());
@@ -306,6 +307,11 @@ Expr Iterator::getWidth() const {
   return getMode().getModeFormat().impl->getWidth(getMode());
 }
 
+Expr Iterator::getInsertGuard(const Expr& p) const {
+  taco_iassert(defined() && content->mode.defined());
+  return getMode().getModeFormat().impl->getInsertGuard(p, getMode());
+}
+
 Stmt Iterator::getInsertInitCoords(const Expr& pBegin, const Expr& pEnd) const {
   taco_iassert(defined() && content->mode.defined());
   return getMode().getModeFormat().impl->getInsertInitCoords(pBegin, pEnd,
@@ -583,9 +589,15 @@ void Iterators::createAccessIterators(Access access, Format format, Expr tensorI
     taco_iassert(modeTypePack.getModeFormats().size() > 0);
 
     int modeNumber = format.getModeOrdering()[level-1];
+    vector<Datatype> arrayTypes = {format.getCoordinateTypePos(level-1),
+                                   format.getCoordinateTypeIdx(level-1)};
+    if ((size_t)level <= format.getLevelArrayTypes().size() &&
+        format.getLevelArrayTypes()[level-1].size() > arrayTypes.size()) {
+      arrayTypes = format.getLevelArrayTypes()[level-1];
+    }
     ModePack modePack(modeTypePack.getModeFormats().size(),
                       modeTypePack.getModeFormats()[0], tensorIR,
-                      modeNumber, level);
+                      modeNumber, level, arrayTypes);
 
     int pos = 0;
     for (auto& modeType : modeTypePack.getModeFormats()) {
@@ -601,7 +613,7 @@ void Iterators::createAccessIterators(Access access, Format format, Expr tensorI
         iteratorIndexVar = indexVar;
       }
       Mode mode(tensorIR, dim, level, modeType, modePack, pos,
-                parentModeType);
+                parentModeType, format.getIndexType());
 
       string name = iteratorIndexVar.getName() + tensorConcrete.getName();
       Iterator iterator(iteratorIndexVar, tensorIR, mode, parent, name, true);
@@ -10,6 +10,7 @@
 #include "taco/ir/ir.h"
 #include "ir/ir_generators.h"
 #include "taco/ir/ir_visitor.h"
+#include "taco/ir/ir_rewriter.h"
 #include "taco/ir/simplify.h"
 #include "taco/lower/iterator.h"
 #include "taco/lower/merge_lattice.h"
@@ -74,7 +75,8 @@ static void createCapacityVars(const map<TensorVar, Expr>& tensorVars,
                                map<Expr, Expr>* capacityVars) {
   for (auto& tensorVar : tensorVars) {
     Expr tensor = tensorVar.second;
-    Expr capacityVar = Var::make(util::toString(tensor) + "_capacity", Int());
+    Expr capacityVar = Var::make(util::toString(tensor) + "_capacity",
+                                 tensorVar.first.getFormat().getIndexType());
     capacityVars->insert({tensor, capacityVar});
   }
 }
@@ -490,6 +492,16 @@ Stmt LowererImplImperative::lowerAssignment(Assignment assignment)
                                     atomicParallelUnit);
       }
       taco_iassert(computeStmt.defined());
+
+      // Results located into levels that can run out of room (e.g. full
+      // hashed segments) are only stored if there was room for them.
+      Iterator resultIterator = getIterators(assignment.getLhs()).back();
+      if (resultIterator.hasLocate() && resultIterator.hasInsert()) {
+        Expr insertGuard = resultIterator.getInsertGuard(loc);
+        if (insertGuard.defined()) {
+          computeStmt = IfThenElse::make(insertGuard, computeStmt);
+        }
+      }
     }
 
     if (!accessStmts.empty()) {
@@ -790,6 +802,9 @@ Stmt LowererImplImperative::lowerForall(Forall forall)
       canAccelWithSparseIteration &= indexListsExist;
     }
 
+    Iterator mergePathNonzeros;
+    TensorVar mergePathCarried;
+
     if (!isWhereProducer && hasPosDescendant && underivedAncestors.size() > 1 && provGraph.isPosVariable(iterator.getIndexVar()) && posDescendant == forall.getIndexVar()) {
       loops = lowerForallFusedPosition(forall, iterator, locators,
                                          inserters, appenders, reducedAccesses, recoveryStmt);
@@ -797,6 +812,15 @@ Stmt LowererImplImperative::lowerForall(Forall forall)
     else if (canAccelWithSparseIteration) {
       loops = lowerForallDenseAcceleration(forall, locators, inserters, appenders, reducedAccesses, recoveryStmt);
     }
+    // Emit a loop over threads that share the rows and their nonzeros
+    else if (forall.getLoadBalance() == LoadBalance::MergePath &&
+             iterator.isDimensionIterator() &&
+             canPartitionByMergePath(forall, &mergePathNonzeros,
+                                     &mergePathCarried)) {
+      loops = lowerForallMergePath(forall, mergePathNonzeros, mergePathCarried,
+                                   locators, inserters, appenders,
+                                   reducedAccesses, recoveryStmt);
+    }
     // Emit dimension coordinate iteration loop
     else if (iterator.isDimensionIterator()) {
       loops = lowerForallDimension(forall, point.locators(),
@@ -819,7 +843,8 @@ Stmt LowererImplImperative::lowerForall(Forall forall)
     std::vector<IndexVar> underivedAncestors = provGraph.getUnderivedAncestors(forall.getIndexVar());
     taco_iassert(underivedAncestors.size() == 1); // TODO: add support for fused coordinate of pos loop
     loops = lowerMergeLattice(lattice, underivedAncestors[0],
-                              forall.getStmt(), reducedAccesses);
+                              forall.getStmt(), reducedAccesses,
+                              forall.getMergeStrategy());
   }
 //  taco_iassert(loops.defined());
 
@@ -1256,9 +1281,12 @@ Stmt LowererImplImperative::lowerForallPosition(Forall forall, Iterator iterator
   Stmt declareCoordinate = Stmt();
   Stmt strideGuard = Stmt();
   Stmt boundsGuard = Stmt();
+  Expr found = true;
   if (provGraph.isCoordVariable(forall.getIndexVar())) {
-    Expr coordinateArray = iterator.posAccess(iterator.getPosVar(),
-                                              coordinates(iterator)).getResults()[0];
+    ModeFunction posAccess = iterator.posAccess(iterator.getPosVar(),
+                                                coordinates(iterator));
+    Expr coordinateArray = posAccess[0];
+    found = posAccess[1];
     // If the iterator is windowed, we must recover the coordinate index
     // variable from the windowed space.
     if (iterator.isWindowed()) {
@@ -1292,6 +1320,11 @@ Stmt LowererImplImperative::lowerForallPosition(Forall forall, Iterator iterator
 
   body = Block::make(recoveryStmt, body);
 
+  // Skip positions that don't store a coordinate, e.g. empty hash buckets
+  if (!isValue(found, true)) {
+    body = IfThenElse::make(found, body);
+  }
+
   // Code to append positions
   Stmt posAppend = generateAppendPositions(appenders);
 
@@ -1310,6 +1343,14 @@ Stmt LowererImplImperative::lowerForallPosition(Forall forall, Iterator iterator
     boundsCompute = bounds.compute();
     startBound = bounds[0];
     endBound = bounds[1];
+    // If the rows above are partitioned by merge path, then only iterate over
+    // the positions in this thread's share
+    if (util::contains(mergePathPositionBounds, iterator)) {
+      startBound = Max::make(startBound,
+                             mergePathPositionBounds.at(iterator).first);
+      endBound = Min::make(endBound,
+                           mergePathPositionBounds.at(iterator).second);
+    }
     // If we have a window on this iterator, then search for the start of
     // the window rather than starting at the beginning of the level.
     if (iterator.isWindowed()) {
@@ -1519,9 +1560,251 @@ Stmt LowererImplImperative::lowerForallFusedPosition(Forall forall, Iterator ite
 
 }
 
+bool LowererImplImperative::canPartitionByMergePath(Forall forall,
+                                                    Iterator* nonzeros,
+                                                    TensorVar* carried) {
+  if (forall.getParallelUnit() != ParallelUnit::CPUThread ||
+      (forall.getOutputRaceStrategy() != OutputRaceStrategy::NoRaces &&
+       forall.getOutputRaceStrategy() != OutputRaceStrategy::IgnoreRaces) ||
+      should_use_CUDA_codegen() || !generateComputeCode() ||
+      !provGraph.isUnderived(forall.getIndexVar())) {
+    return false;
+  }
+
+  // Workspaces hoisted out of the rows are not split between threads
+  auto temporary = temporaryInitialization.find(forall);
+  if (temporary != temporaryInitialization.end() &&
+      !isScalar(temporary->second.getTemporary().getType())) {
+    return false;
+  }
+
+  // The rows' results may be reduced into scalar temporaries that are
+  // written after the loop over the nonzeros
+  IndexStmt body = forall.getStmt();
+  while (isa<Where>(body)) {
+    Where where = to<Where>(body);
+    if (!isScalar(where.getTemporary().getType())) {
+      return false;
+    }
+    body = where.getProducer();
+  }
+  if (!isa<Forall>(body)) {
+    return false;
+  }
+  Forall nonzeroLoop = to<Forall>(body);
+  IndexVar i = forall.getIndexVar();
+  IndexVar j = nonzeroLoop.getIndexVar();
+  if (nonzeroLoop.getParallelUnit() != ParallelUnit::NotParallel ||
+      nonzeroLoop.getUnrollFactor() > 0 || !provGraph.isUnderived(j)) {
+    return false;
+  }
+
+  // The nonzero loop must iterate over a compressed level whose parent is a
+  // dense level over the rows, so that the parent's positions are the rows
+  MergeLattice lattice = MergeLattice::make(nonzeroLoop, iterators, provGraph,
+                                            definedIndexVars,
+                                            whereTempsToResult);
+  if (lattice.iterators().size() != 1 || lattice.points().size() != 1) {
+    return false;
+  }
+  Iterator iterator = lattice.iterators()[0];
+  if (!iterator.hasPosIter() || !iterator.isUnique() ||
+      iterator.isWindowed() || iterator.hasIndexSet() ||
+      iterator.getMode().getModeFormat().getName() != Compressed.getName()) {
+    return false;
+  }
+  Iterator parent = iterator.getParent();
+  if (parent.isRoot() || !parent.getParent().isRoot() ||
+      parent.getIndexVar() != i || !parent.hasLocate() ||
+      parent.isWindowed() ||
+      parent.getMode().getModeFormat().getName() != Dense.getName()) {
+    return false;
+  }
+  vector<Expr> bounds = provGraph.deriveIterBounds(i, definedIndexVarsOrdered,
+                                                   underivedBounds,
+                                                   indexVarToExprMap,
+                                                   iterators);
+  if (!isValue(bounds[0], 0)) {
+    return false;
+  }
+
+  // Splitting a row between threads is only safe if each row's results are
+  // either a single component, which can be carried, or are per nonzero
+  TensorVar carriedResult;
+  for (auto& result : getResultAccesses(forall).first) {
+    TensorVar var = result.getTensorVar();
+    if (util::contains(temporaries, var)) {
+      continue;
+    }
+    if (result.hasWindowedModes() || result.hasIndexSetModes()) {
+      return false;
+    }
+    for (auto& modeFormat : var.getFormat().getModeFormats()) {
+      if (modeFormat.getName() != Dense.getName()) {
+        return false;
+      }
+    }
+    const vector<IndexVar>& vars = result.getIndexVars();
+    if (vars.size() == 1 && vars[0] == i) {
+      if (carriedResult.defined() && carriedResult != var) {
+        return false;
+      }
+      carriedResult = var;
+    }
+    else if (vars.size() != 2 || !util::contains(vars, i) ||
+             !util::contains(vars, j)) {
+      return false;
+    }
+  }
+
+  *nonzeros = iterator;
+  *carried = carriedResult;
+  return true;
+}
+
+namespace {
+
+/// Redirects the loads and stores of a result's values to a thread's carry.
+struct RedirectToCarry : public IRRewriter {
+  Expr tensor;
+  Expr carry;
+  Expr thread;
+
+  RedirectToCarry(Expr tensor, Expr carry, Expr thread)
+      : tensor(tensor), carry(carry), thread(thread) {}
+
+  using IRRewriter::visit;
+
+  bool isValues(Expr arr) {
+    const GetProperty* property = arr.as<GetProperty>();
+    return property != nullptr && property->tensor == tensor &&
+           property->property == TensorProperty::Values;
+  }
+
+  void visit(const Load* op) {
+    expr = isValues(op->arr) ? Load::make(carry, thread) : op;
+  }
+
+  void visit(const Store* op) {
+    if (isValues(op->arr)) {
+      stmt = Store::make(carry, thread, rewrite(op->data));
+    }
+    else {
+      IRRewriter::visit(op);
+    }
+  }
+};
+
+}
+
+Stmt LowererImplImperative::lowerForallMergePath(Forall forall,
+                                                 Iterator nonzeros,
+                                                 TensorVar carried,
+                                                 vector<Iterator> locators,
+                                                 vector<Iterator> inserters,
+                                                 vector<Iterator> appenders,
+                                                 set<Access> reducedAccesses,
+                                                 ir::Stmt recoveryStmt)
+{
+  Expr coordinate = getCoordinateVar(forall.getIndexVar());
+  string name = coordinate.as<Var>()->name;
+  Datatype posType = nonzeros.getPosVar().type();
+
+  std::vector<ir::Expr> bounds = provGraph.deriveIterBounds(forall.getIndexVar(), definedIndexVarsOrdered, underivedBounds, indexVarToExprMap, iterators);
+  Expr rows = bounds[1];
+  Expr pos = nonzeros.getMode().getModePack().getArray(0);
+
+  // Each thread computes an equal share of the merge path, whose steps are
+  // the ends of the rows and the nonzeros.  The path is longer than both, so
+  // its steps are 64-bit even if positions are 32-bit.
+  Expr nnz = Var::make(name + "_nnz", Int64);
+  Expr threads = Var::make(name + "_threads", Int32);
+  Expr share = Var::make(name + "_share", Int64);
+  Expr items = ir::Add::make(rows, nnz);
+  Stmt partition = Block::make(
+      VarDecl::make(nnz, Load::make(pos, rows)),
+      VarDecl::make(threads, Call::make("omp_get_max_threads", {}, Int32)),
+      VarDecl::make(share, ir::Div::make(ir::Sub::make(ir::Add::make(items, threads), 1),
+                                     threads)));
+
+  Expr thread = Var::make(name + "_thread", Int32);
+  Expr diagonalStart = Var::make(name + "_diagonal_start", Int64);
+  Expr diagonalEnd = Var::make(name + "_diagonal_end", Int64);
+  Expr rowStart = Var::make(name + "_start", posType);
+  Expr rowEnd = Var::make(name + "_end", posType);
+  Expr posStart = Var::make(nonzeros.getPosVar().as<Var>()->name + "_start", posType);
+  Expr posEnd = Var::make(nonzeros.getPosVar().as<Var>()->name + "_end", posType);
+  Stmt search = Block::make({
+      VarDecl::make(diagonalStart, Min::make(ir::Mul::make(thread, share), items)),
+      VarDecl::make(diagonalEnd, Min::make(ir::Add::make(diagonalStart, share), items)),
+      VarDecl::make(rowStart, Call::make("taco_mergePathSearch",
+                                         {pos, rows, nnz, diagonalStart}, posType)),
+      VarDecl::make(rowEnd, Call::make("taco_mergePathSearch",
+                                       {pos, rows, nnz, diagonalEnd}, posType)),
+      VarDecl::make(posStart, ir::Cast::make(ir::Sub::make(diagonalStart, rowStart),
+                                             posType)),
+      VarDecl::make(posEnd, ir::Cast::make(ir::Sub::make(diagonalEnd, rowEnd),
+                                           posType))});
+
+  mergePathPositionBounds.insert({nonzeros, {posStart, posEnd}});
+  Stmt body = lowerForallBody(coordinate, forall.getStmt(),
+                              locators, inserters, appenders, reducedAccesses);
+  mergePathPositionBounds.erase(nonzeros);
+  body = Block::make(recoveryStmt, body);
+
+  // The thread completes the rows that end in its share...
+  Stmt rowLoop = For::make(coordinate, rowStart, rowEnd, 1, body);
+
+  // ...and computes the start of the row that the next share continues
+  Stmt carryInit, tail, fixup, carryAlloc, carryFree;
+  if (carried.defined()) {
+    Expr carry = Var::make(name + "_carry", carried.getType().getDataType(),
+                           true, false);
+    Expr carryRows = Var::make(name + "_carry_rows", posType, true, false);
+    Expr values = getValuesArray(carried);
+    carryAlloc = Block::make(VarDecl::make(carry, 0),
+                             Allocate::make(carry, threads),
+                             VarDecl::make(carryRows, 0),
+                             Allocate::make(carryRows, threads));
+    carryFree = Block::make(Free::make(carry), Free::make(carryRows));
+
+    carryInit = Block::make(
+        Store::make(carry, thread, ir::Literal::zero(carry.type())),
+        Store::make(carryRows, thread, rows));
+    Stmt carryBody = RedirectToCarry(getTensorVar(carried), carry,
+                                     thread).rewrite(body);
+    tail = IfThenElse::make(Lt::make(rowEnd, rows),
+                            Block::make(VarDecl::make(coordinate, rowEnd),
+                                        carryBody,
+                                        Store::make(carryRows, thread, rowEnd)));
+
+    // Add each thread's carry to the row that it started
+    Expr carryRow = Load::make(carryRows, thread);
+    fixup = For::make(thread, 0, threads, 1,
+                      IfThenElse::make(Lt::make(carryRow, rows),
+                                       Store::make(values, carryRow,
+                                                   ir::Add::make(Load::make(values, carryRow),
+                                                                 Load::make(carry, thread)))));
+  }
+  else {
+    // Results over the nonzeros don't need to be carried
+    tail = IfThenElse::make(Lt::make(rowEnd, rows),
+                            Block::make(VarDecl::make(coordinate, rowEnd),
+                                        body));
+  }
+
+  Stmt threadLoop = For::make(thread, 0, threads, 1,
+                              Block::make(search, carryInit, rowLoop, tail),
+                              LoopKind::Static, forall.getParallelUnit());
+
+  return Block::blanks(partition, carryAlloc, threadLoop, fixup, carryFree,
+                       generateAppendPositions(appenders));
+}
+
 Stmt LowererImplImperative::lowerMergeLattice(MergeLattice lattice, IndexVar coordinateVar,
                                     IndexStmt statement,
-                                    const std::set<Access>& reducedAccesses)
+                                    const std::set<Access>& reducedAccesses,
+                                    MergeStrategy mergeStrategy)
 {
   Expr coordinate = getCoordinateVar(coordinateVar);
   vector<Iterator> appenders = filter(lattice.results(),
@@ -1544,7 +1827,7 @@ Stmt LowererImplImperative::lowerMergeLattice(MergeLattice lattice, IndexVar coo
     // points in the merge lattice.
     IndexStmt zeroedStmt = zero(statement, getExhaustedAccesses(point,lattice));
     MergeLattice sublattice = lattice.subLattice(point);
-    Stmt mergeLoop = lowerMergePoint(sublattice, coordinate, coordinateVar, zeroedStmt, reducedAccesses, resolvedCoordDeclared);
+    Stmt mergeLoop = lowerMergePoint(sublattice, coordinate, coordinateVar, zeroedStmt, reducedAccesses, resolvedCoordDeclared, mergeStrategy);
     mergeLoopsVec.push_back(mergeLoop);
   }
   Stmt mergeLoops = Block::make(mergeLoopsVec);
@@ -1559,8 +1842,15 @@ Stmt LowererImplImperative::lowerMergeLattice(MergeLattice lattice, IndexVar coo
 
 Stmt LowererImplImperative::lowerMergePoint(MergeLattice pointLattice,
                                   ir::Expr coordinate, IndexVar coordinateVar, IndexStmt statement,
-                                  const std::set<Access>& reducedAccesses, bool resolvedCoordDeclared)
+                                  const std::set<Access>& reducedAccesses, bool resolvedCoordDeclared,
+                                  MergeStrategy mergeStrategy)
 {
+  if (mergeStrategy == MergeStrategy::Gallop &&
+      canGallop(pointLattice, resolvedCoordDeclared)) {
+    return lowerGallopingMergePoint(pointLattice, coordinate, coordinateVar,
+                                    statement, reducedAccesses);
+  }
+
   MergePoint point = pointLattice.points().front();
 
   vector<Iterator> iterators = point.iterators();
@@ -1648,6 +1938,80 @@ Stmt LowererImplImperative::lowerMergePoint(MergeLattice pointLattice,
                                  incIteratorVarStmts));
 }
 
+bool LowererImplImperative::canGallop(MergeLattice pointLattice,
+                                      bool resolvedCoordDeclared) const {
+  // Only intersections skip coordinates; unions must visit every coordinate
+  if (pointLattice.points().size() != 1 || resolvedCoordDeclared) {
+    return false;
+  }
+  MergePoint point = pointLattice.points().front();
+  if (point.mergers().size() < 2 ||
+      point.iterators().size() != point.mergers().size()) {
+    return false;
+  }
+  for (auto& iterator : point.mergers()) {
+    if (!iterator.hasPosIter() || !iterator.isOrdered() ||
+        !iterator.isUnique() || iterator.isWindowed() ||
+        iterator.hasIndexSet() ||
+        iterator.getMode().getModeFormat().getName() != Compressed.getName()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Stmt LowererImplImperative::lowerGallopingMergePoint(MergeLattice pointLattice,
+    ir::Expr coordinate, IndexVar coordinateVar, IndexStmt statement,
+    const std::set<Access>& reducedAccesses)
+{
+  MergePoint point = pointLattice.points().front();
+  vector<Iterator> mergers = point.mergers();
+
+  vector<Iterator> appenders;
+  vector<Iterator> inserters;
+  tie(appenders, inserters) = splitAppenderAndInserters(pointLattice.results());
+
+  // Load coordinates from position iterators
+  Stmt loadPosIterCoordinates = codeToLoadCoordinatesFromPosIterators(mergers,
+                                                                      true);
+
+  // No iterator has a coordinate below the largest of their coordinates
+  Stmt resolvedCoordinate = VarDecl::make(coordinate,
+                                          Max::make(coordinates(mergers)));
+
+  // If all iterators are at the coordinate then compute and advance each of
+  // them by one position
+  vector<Expr> coordComparisons;
+  vector<Stmt> incIteratorVarStmts;
+  vector<Stmt> gallopStmts;
+  for (auto& merger : mergers) {
+    Expr ivar = merger.getIteratorVar();
+    coordComparisons.push_back(Eq::make(merger.getCoordVar(), coordinate));
+    incIteratorVarStmts.push_back(compoundAssign(ivar, 1));
+
+    // Otherwise skip every iterator ahead to the first position whose
+    // coordinate is not below the coordinate
+    vector<Expr> gallopArgs = {
+      merger.getMode().getModePack().getArray(1),
+      ivar, merger.getEndVar(), coordinate
+    };
+    gallopStmts.push_back(Assign::make(ivar, Call::make("taco_gallop",
+                                                        gallopArgs,
+                                                        ivar.type())));
+  }
+  Stmt body = lowerForallBody(coordinate, statement, point.locators(),
+                              inserters, appenders, reducedAccesses);
+  Stmt intersection = IfThenElse::make(conjunction(coordComparisons),
+                                       Block::make(body,
+                                                   Block::make(incIteratorVarStmts)),
+                                       Block::make(gallopStmts));
+
+  return While::make(checkThatNoneAreExhausted(point.rangers()),
+                     Block::make(loadPosIterCoordinates,
+                                 resolvedCoordinate,
+                                 intersection));
+}
+
 Stmt LowererImplImperative::resolveCoordinate(std::vector<Iterator> mergers, ir::Expr coordinate, bool emitVarDecl) {
   if (mergers.size() == 1) {
     Iterator merger = mergers[0];
@@ -1772,8 +2136,8 @@ Stmt LowererImplImperative::lowerForallBody(Expr coordinate, IndexStmt stmt,
                                   const set<Access>& reducedAccesses) {
   Stmt initVals = resizeAndInitValues(appenders, reducedAccesses);
 
-  // Inserter positions
-  Stmt declInserterPosVars = declLocatePosVars(inserters);
+  // Inserter positions, at which the result coordinates are inserted
+  Stmt declInserterPosVars = declLocatePosVars(inserters, true);
 
   // Locate positions
   Stmt declLocatorPosVars = declLocatePosVars(locators);
@@ -1789,8 +2153,6 @@ Stmt LowererImplImperative::lowerForallBody(Expr coordinate, IndexStmt stmt,
   // Code to append coordinates
   Stmt appendCoords = appendCoordinate(appenders, coordinate);
 
-  // TODO: Emit code to insert coordinates
-
   return Block::make(initVals,
                      declInserterPosVars,
                      declLocatorPosVars,
@@ -2977,7 +3339,8 @@ Stmt LowererImplImperative::zeroInitValues(Expr tensor, Expr begin, Expr size) {
   return For::make(p, lower, upper, 1, zeroInit, parallel);
 }
 
-Stmt LowererImplImperative::declLocatePosVars(vector<Iterator> locators) {
+Stmt LowererImplImperative::declLocatePosVars(vector<Iterator> locators,
+                                              bool insert) {
   vector<Stmt> result;
   for (Iterator& locator : locators) {
     accessibleIterators.insert(locator);
@@ -2993,8 +3356,8 @@ Stmt LowererImplImperative::declLocatePosVars(vector<Iterator> locators) {
 
     if (doLocate) {
       Iterator locateIterator = locator;
-      if (locateIterator.hasPosIter()) {
-        taco_iassert(!provGraph.isUnderived(locateIterator.getIndexVar()));
+      if (locateIterator.hasPosIter() &&
+          !provGraph.isUnderived(locateIterator.getIndexVar())) {
         continue; // these will be recovered with separate procedure
       }
       do {
@@ -3018,6 +3381,12 @@ Stmt LowererImplImperative::declLocatePosVars(vector<Iterator> locators) {
         Stmt declarePosVar = VarDecl::make(locateIterator.getPosVar(),
                                            locate.getResults()[0]);
         result.push_back(declarePosVar);
+        if (insert) {
+          // Coordinates are inserted when computing too, since the positions
+          // that were located while assembling aren't kept.
+          result.push_back(locateIterator.getInsertCoord(
+              locateIterator.getPosVar(), coords));
+        }
 
         if (locateIterator.isLeaf()) {
           break;
@@ -21,6 +21,7 @@ struct Mode::Content {
   size_t     packLoc;           /// position within pack containing mode
 
   ModeFormat parentModeFormat;  /// type of previous mode in the tensor
+  Datatype   positionType;      /// type of positions in the mode
 
   std::map<std::string, ir::Expr> vars;
 };
@@ -29,8 +30,8 @@ Mode::Mode() : content(nullptr) {
 }
 
 Mode::Mode(ir::Expr tensor, Dimension size, int mode, ModeFormat modeFormat,
-     ModePack modePack, size_t packLoc, ModeFormat parentModeFormat)
-    : content(new Content) {
+     ModePack modePack, size_t packLoc, ModeFormat parentModeFormat,
+     Datatype positionType) : content(new Content) {
   taco_iassert(modeFormat.defined());
   content->tensor = tensor;
   content->size = size;
@@ -39,6 +40,7 @@ Mode::Mode(ir::Expr tensor, Dimension size, int mode, ModeFormat modeFormat,
   content->modePack = modePack;
   content->packLoc = packLoc;
   content->parentModeFormat = parentModeFormat;
+  content->positionType = positionType;
 }
 
 std::string Mode::getName() const {
@@ -73,6 +75,10 @@ ModeFormat Mode::getParentModeType() const {
   return content->parentModeFormat;
 }
 
+Datatype Mode::getPositionType() const {
+  return content->positionType;
+}
+
 ir::Expr Mode::getVar(std::string varName) const {
   taco_iassert(hasVar(varName));
   return content->vars.at(varName);
@@ -106,9 +112,10 @@ ModePack::ModePack() : content(new Content) {
 }
 
 ModePack::ModePack(size_t numModes, ModeFormat modeType, ir::Expr tensor,
-                   int mode, int level) : ModePack() {
+                   int mode, int level, const vector<Datatype>& arrayTypes)
+    : ModePack() {
   content->numModes = numModes;
-  content->arrays = modeType.impl->getArrays(tensor, mode, level);
+  content->arrays = modeType.impl->getArrays(tensor, mode, level, arrayTypes);
 }
 
 size_t ModePack::getNumModes() const {
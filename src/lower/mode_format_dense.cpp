@@ -89,8 +89,8 @@ ModeFunction DenseModeFormat::getYieldPos(Expr parentPos,
   return locate(parentPos, coords, mode);
 }
 
-vector<Expr> DenseModeFormat::getArrays(Expr tensor, int mode, 
-                                        int level) const {
+vector<Expr> DenseModeFormat::getArrays(Expr tensor, int mode, int level,
+    const vector<Datatype>& arrayTypes) const {
   return {GetProperty::make(tensor, TensorProperty::Dimension, mode)};
 }
 
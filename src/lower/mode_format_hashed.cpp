@@ -0,0 +1,111 @@
+#include "taco/lower/mode_format_hashed.h"
+
+#include "taco/util/strings.h"
+
+using namespace std;
+using namespace taco::ir;
+
+namespace taco {
+
+HashedModeFormat::HashedModeFormat() : HashedModeFormat(1024) {
+}
+
+HashedModeFormat::HashedModeFormat(int width) :
+    ModeFormatImpl("hashed", false, false, true, false, false, false, false,
+                   true, true, true, false, false, false, false),
+    width(width) {
+  taco_uassert(width > 0 && (width & (width - 1)) == 0) <<
+      "The width of a hashed mode must be a power of two";
+}
+
+ModeFormat HashedModeFormat::copy(
+    vector<ModeFormat::Property> properties) const {
+  for (const auto property : properties) {
+    taco_uassert(property != ModeFormat::ORDERED &&
+                 property != ModeFormat::NOT_UNIQUE) <<
+        "Hashed modes are unordered and unique";
+  }
+  return ModeFormat(std::make_shared<HashedModeFormat>(width));
+}
+
+ModeFunction HashedModeFormat::posIterBounds(Expr parentPos, Mode mode) const {
+  Expr pbegin = ir::Mul::make(parentPos, getWidth(mode));
+  Expr pend = ir::Add::make(pbegin, getWidth(mode));
+  return ModeFunction(Stmt(), {pbegin, pend});
+}
+
+ModeFunction HashedModeFormat::posIterAccess(Expr pos, vector<Expr> coords,
+                                             Mode mode) const {
+  taco_iassert(mode.getModePack().getNumModes() == 1) <<
+      "Hashed modes cannot share arrays with other modes";
+  Expr idx = Load::make(getCoordArray(mode.getModePack()), pos);
+  return ModeFunction(Stmt(), {idx, Gte::make(idx, 0)});
+}
+
+ModeFunction HashedModeFormat::locate(Expr parentPos, vector<Expr> coords,
+                                      Mode mode) const {
+  // Locating a coordinate that isn't stored finds the empty bucket that it
+  // would be inserted into, whose value is zero, or -1 if the segment is full.
+  Expr crdArray = getCoordArray(mode.getModePack());
+  Expr begin = ir::Mul::make(parentPos, getWidth(mode));
+  Expr pos = Call::make("taco_hashLocate",
+                        {crdArray, begin, getWidth(mode), coords.back()},
+                        mode.getPositionType());
+  return ModeFunction(Stmt(), {pos, true});
+}
+
+Stmt HashedModeFormat::getInsertCoord(Expr p, const vector<Expr>& i,
+                                      Mode mode) const {
+  return IfThenElse::make(getInsertGuard(p, mode),
+                          Store::make(getCoordArray(mode.getModePack()), p,
+                                      i.back()));
+}
+
+Expr HashedModeFormat::getWidth(Mode mode) const {
+  return width;
+}
+
+Expr HashedModeFormat::getInsertGuard(Expr p, Mode mode) const {
+  // Coordinates that don't fit in a full segment are dropped, which the host
+  // reports once the kernel returns
+  return Gte::make(p, 0);
+}
+
+Stmt HashedModeFormat::getInsertInitCoords(Expr pBegin, Expr pEnd,
+                                           Mode mode) const {
+  Expr crdArray = getCoordArray(mode.getModePack());
+  Expr pVar = Var::make("p" + mode.getName(), mode.getPositionType());
+  return For::make(pVar, pBegin, pEnd, 1, Store::make(crdArray, pVar, -1));
+}
+
+Stmt HashedModeFormat::getInsertInitLevel(Expr szPrev, Expr sz,
+                                          Mode mode) const {
+  return Allocate::make(getCoordArray(mode.getModePack()), sz);
+}
+
+Stmt HashedModeFormat::getInsertFinalizeLevel(Expr szPrev, Expr sz,
+                                              Mode mode) const {
+  return Stmt();
+}
+
+vector<Expr> HashedModeFormat::getArrays(Expr tensor, int mode, int level,
+    const vector<Datatype>& arrayTypes) const {
+  std::string arraysName = util::toString(tensor) + std::to_string(level);
+  return {GetProperty::make(tensor, TensorProperty::Indices,
+                            level - 1, 1, arraysName + "_crd", arrayTypes[1])};
+}
+
+int64_t HashedModeFormat::getHome(int64_t coordinate, int width) {
+  return (int64_t)(((uint32_t)coordinate * 2654435761u) & (uint32_t)(width-1));
+}
+
+Expr HashedModeFormat::getCoordArray(ModePack pack) const {
+  return pack.getArray(0);
+}
+
+bool HashedModeFormat::equals(const ModeFormatImpl& other) const {
+  return ModeFormatImpl::equals(other) &&
+         dynamic_cast<const HashedModeFormat&>(other).width == width;
+}
+
+}
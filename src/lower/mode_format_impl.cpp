@@ -211,6 +211,10 @@ Expr ModeFormatImpl::getWidth(Mode mode) const {
   return Expr();
 }
 
+Expr ModeFormatImpl::getInsertGuard(Expr p, Mode mode) const {
+  return Expr();
+}
+
 Stmt ModeFormatImpl::getInsertInitCoords(Expr pBegin,
     Expr pEnd, Mode mode) const {
   return Stmt();
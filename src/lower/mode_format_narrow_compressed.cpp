@@ -0,0 +1,120 @@
+#include "taco/lower/mode_format_narrow_compressed.h"
+
+#include "taco/util/strings.h"
+
+using namespace std;
+using namespace taco::ir;
+
+namespace taco {
+
+NarrowCompressedModeFormat::NarrowCompressedModeFormat() :
+    NarrowCompressedModeFormat(false, true, true, false) {
+}
+
+NarrowCompressedModeFormat::NarrowCompressedModeFormat(bool isFull,
+                                                       bool isOrdered,
+                                                       bool isUnique,
+                                                       bool isZeroless) :
+    ModeFormatImpl("narrow_compressed", isFull, isOrdered, isUnique, false,
+                   true, isZeroless, false, true, false, false, false, false,
+                   false, false) {
+}
+
+ModeFormat NarrowCompressedModeFormat::copy(
+    vector<ModeFormat::Property> properties) const {
+  bool isFull = this->isFull;
+  bool isOrdered = this->isOrdered;
+  bool isUnique = this->isUnique;
+  bool isZeroless = this->isZeroless;
+  for (const auto property : properties) {
+    switch (property) {
+      case ModeFormat::FULL:
+        isFull = true;
+        break;
+      case ModeFormat::NOT_FULL:
+        isFull = false;
+        break;
+      case ModeFormat::ORDERED:
+        isOrdered = true;
+        break;
+      case ModeFormat::NOT_ORDERED:
+        isOrdered = false;
+        break;
+      case ModeFormat::UNIQUE:
+        isUnique = true;
+        break;
+      case ModeFormat::NOT_UNIQUE:
+        isUnique = false;
+        break;
+      case ModeFormat::ZEROLESS:
+        isZeroless = true;
+        break;
+      case ModeFormat::NOT_ZEROLESS:
+        isZeroless = false;
+        break;
+      default:
+        break;
+    }
+  }
+  const auto narrowCompressedVariant =
+      std::make_shared<NarrowCompressedModeFormat>(isFull, isOrdered, isUnique,
+                                                   isZeroless);
+  return ModeFormat(narrowCompressedVariant);
+}
+
+ModeFunction NarrowCompressedModeFormat::posIterBounds(Expr parentPos,
+                                                       Mode mode) const {
+  Expr pbegin = Load::make(getPosArray(mode.getModePack()), parentPos);
+  Expr pend = Load::make(getPosArray(mode.getModePack()),
+                         ir::Add::make(parentPos, 1));
+  return ModeFunction(Stmt(), {pbegin, pend});
+}
+
+ModeFunction NarrowCompressedModeFormat::posIterAccess(Expr pos,
+                                                       vector<Expr> coords,
+                                                       Mode mode) const {
+  return ModeFunction(Stmt(), {getCoord(pos, mode), true});
+}
+
+ModeFunction NarrowCompressedModeFormat::coordBounds(Expr parentPos,
+                                                     Mode mode) const {
+  Expr pend = Load::make(getPosArray(mode.getModePack()),
+                         ir::Add::make(parentPos, 1));
+  return ModeFunction(Stmt(), {0, getCoord(ir::Sub::make(pend, 1), mode)});
+}
+
+vector<Expr> NarrowCompressedModeFormat::getArrays(Expr tensor, int mode,
+    int level, const vector<Datatype>& arrayTypes) const {
+  std::string arraysName = util::toString(tensor) + std::to_string(level);
+  const Datatype baseType = (arrayTypes.size() > 2) ? arrayTypes[2] : Int32;
+  return {GetProperty::make(tensor, TensorProperty::Indices,
+                            level - 1, 0, arraysName + "_pos", arrayTypes[0]),
+          GetProperty::make(tensor, TensorProperty::Indices,
+                            level - 1, 1, arraysName + "_crd", arrayTypes[1]),
+          GetProperty::make(tensor, TensorProperty::Indices,
+                            level - 1, 2, arraysName + "_base", baseType)};
+}
+
+Expr NarrowCompressedModeFormat::getPosArray(ModePack pack) const {
+  return pack.getArray(0);
+}
+
+Expr NarrowCompressedModeFormat::getCoordArray(ModePack pack) const {
+  return pack.getArray(1);
+}
+
+Expr NarrowCompressedModeFormat::getBaseArray(ModePack pack) const {
+  return pack.getArray(2);
+}
+
+Expr NarrowCompressedModeFormat::getCoord(Expr pos, Mode mode) const {
+  taco_iassert(mode.getModePack().getNumModes() == 1) <<
+      "Narrow compressed modes cannot share arrays with other modes";
+  Expr baseArray = getBaseArray(mode.getModePack());
+  Expr block = ir::Add::make(Shr::make(pos, Load::make(baseArray, 0)), 1);
+  Expr crdArray = getCoordArray(mode.getModePack());
+  Expr offset = ir::Cast::make(Load::make(crdArray, pos), Int());
+  return ir::Add::make(Load::make(baseArray, block), offset);
+}
+
+}
@@ -107,7 +107,7 @@ Stmt SingletonModeFormat::getAppendInitLevel(Expr parentSize, Expr size,
     return Stmt();
   }
 
-  Expr defaultCapacity = ir::Literal::make(allocSize, Datatype::Int32); 
+  Expr defaultCapacity = ir::Literal::make(allocSize, mode.getPositionType());
   Expr crdCapacity = getCoordCapacity(mode);
   Expr crdArray = getCoordArray(mode.getModePack());
   Stmt initCrdCapacity = VarDecl::make(crdCapacity, defaultCapacity);
@@ -145,12 +145,12 @@ Stmt SingletonModeFormat::getInsertCoord(Expr parentPos, Expr pos,
   return Store::make(crdArray, loc, coords.back());
 }
 
-std::vector<Expr> SingletonModeFormat::getArrays(Expr tensor, int mode, 
-                                                 int level) const {
+std::vector<Expr> SingletonModeFormat::getArrays(Expr tensor, int mode,
+    int level, const std::vector<Datatype>& arrayTypes) const {
   std::string arraysName = util::toString(tensor) + std::to_string(level);
   return {Expr(), 
           GetProperty::make(tensor, TensorProperty::Indices,
-                            level - 1, 1, arraysName + "_crd")};
+                            level - 1, 1, arraysName + "_crd", arrayTypes[1])};
 }
 
 Expr SingletonModeFormat::getCoordArray(ModePack pack) const {
@@ -161,7 +161,7 @@ Expr SingletonModeFormat::getCoordCapacity(Mode mode) const {
   const std::string varName = mode.getName() + "_crd_size";
   
   if (!mode.hasVar(varName)) {
-    Expr idxCapacity = Var::make(varName, Int());
+    Expr idxCapacity = Var::make(varName, mode.getPositionType());
     mode.addVar(varName, idxCapacity);
     return idxCapacity;
   }
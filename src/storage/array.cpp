@@ -18,6 +18,8 @@ struct Array::Content : util::Uncopyable {
   void*  data;
   size_t size;
   Policy policy = Array::UserOwns;
+  Placement placement;
+  std::shared_ptr<void> owner;
 
   ~Content() {
     switch (policy) {
@@ -98,6 +100,11 @@ Array::Array(Datatype type, void* data, size_t size, Policy policy) : Array() {
   content->policy = policy;
 }
 
+Array::Array(Datatype type, void* data, size_t size, shared_ptr<void> owner)
+    : Array(type, data, size, UserOwns) {
+  content->owner = owner;
+}
+
 const Datatype& Array::getType() const {
   return content->type;
 }
@@ -122,6 +129,10 @@ TypedComponentRef Array::operator[] (const int index) const {
   return TypedComponentRef(content->type, ((char *) content->data) + content->type.getNumBytes()*index);
 }
 
+const Placement& Array::getPlacement() const {
+  return content->placement;
+}
+
 void Array::zero() {
   memset(getData(), 0, getSize() * getType().getNumBytes());
 }
@@ -218,4 +229,15 @@ Array makeArray(Datatype type, size_t size) {
   }
 }
 
+Array makeArray(Datatype type, size_t size, const Placement& placement) {
+  if (placement.getKind() == Placement::Default ||
+      should_use_CUDA_unified_memory()) {
+    return makeArray(type, size);
+  }
+  Array array(type, placement.allocate(size * type.getNumBytes(), true), size,
+              Array::Free);
+  array.content->placement = placement;
+  return array;
+}
+
 }
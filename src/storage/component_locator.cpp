@@ -0,0 +1,271 @@
+#include "storage/component_locator.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "taco/format.h"
+#include "taco/error.h"
+#include "taco/lower/mode_format_hashed.h"
+#include "taco/storage/index.h"
+#include "storage/index_entries.h"
+
+using namespace std;
+
+namespace taco {
+
+/// Returns the first position in [begin, end) of a sorted crd array whose
+/// coordinate is not less than value, searching forward from begin with
+/// exponentially growing steps before bisecting.
+template <typename Level>
+static size_t gallop(const Level& level, size_t begin, size_t end, int value) {
+  size_t low = begin;
+  size_t high = begin;
+  size_t step = 1;
+  while (high < end && level.getCoordinate(high) < value) {
+    low = high + 1;
+    high = std::min(high + step, end);
+    step *= 2;
+  }
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (level.getCoordinate(middle) < value) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+/// Returns the first position in [begin, end) of a sorted crd array whose
+/// coordinate is greater than value.
+template <typename Level>
+static size_t upperBound(const Level& level, size_t begin, size_t end,
+                         int value) {
+  while (begin < end) {
+    size_t middle = begin + (end - begin) / 2;
+    if (level.getCoordinate(middle) <= value) {
+      begin = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  return begin;
+}
+
+/// Returns an array that refers to the elements of an array without keeping
+/// them alive, so that a locator doesn't hold on to the arrays of a tensor
+/// after they are replaced.
+static Array getView(const Array& array) {
+  return Array(array.getType(), (void*)array.getData(), array.getSize(),
+               Array::UserOwns);
+}
+
+int64_t ComponentLocator::Level::getCoordinate(size_t position) const {
+  if (bases == nullptr) {
+    return getEntry(crd, position);
+  }
+  const int64_t offset = (crd.getType() == UInt8)
+      ? ((const uint8_t*)crd.getData())[position]
+      : (crd.getType() == UInt16) ? ((const uint16_t*)crd.getData())[position]
+                                  : ((const uint32_t*)crd.getData())[position];
+  return bases[(position >> blockShift) + 1] + offset;
+}
+
+ComponentLocator::ComponentLocator(const TensorStorage& storage)
+    : pathLength(0) {
+  const Format& format = storage.getFormat();
+  const Index& index = storage.getIndex();
+  const vector<ModeFormat> modeFormats = format.getModeFormats();
+  const int order = format.getOrder();
+  for (int i = 0; i < order; i++) {
+    const ModeFormat& modeFormat = modeFormats[i];
+    const ModeIndex& modeIndex = index.getModeIndex(i);
+    Level level;
+    level.mode = format.getModeOrdering()[i];
+    level.dimension = storage.getDimensions()[level.mode];
+    level.ordered = modeFormat.isOrdered();
+    level.unique = modeFormat.isUnique();
+    level.size = 0;
+    level.bases = nullptr;
+    level.blockShift = 0;
+    level.width = 1;
+    if (modeFormat.getName() == Dense.getName()) {
+      level.kind = Level::Dense;
+      level.size = getEntry(modeIndex.getIndexArray(0), 0);
+    } else if (modeFormat.getName() == Sparse.getName()) {
+      level.kind = Level::Compressed;
+      level.pos = getView(modeIndex.getIndexArray(0));
+      level.crd = getView(modeIndex.getIndexArray(1));
+    } else if (modeFormat.getName() == Singleton.getName()) {
+      level.kind = Level::Singleton;
+      level.crd = getView(modeIndex.getIndexArray(1));
+    } else if (modeFormat.getName() == NarrowCompressed.getName()) {
+      level.kind = Level::Compressed;
+      level.pos = getView(modeIndex.getIndexArray(0));
+      level.crd = getView(modeIndex.getIndexArray(1));
+      level.bases = (const int32_t*)modeIndex.getIndexArray(2).getData();
+      level.blockShift = level.bases[0];
+    } else if (modeFormat.getName() == Hashed.getName()) {
+      level.kind = Level::Hashed;
+      level.crd = getView(modeIndex.getIndexArray(1));
+      level.width = dynamic_pointer_cast<const HashedModeFormat>(
+          modeFormat.getImpl())->width;
+    } else {
+      taco_not_supported_yet << "Locating components of " << modeFormat <<
+          " levels";
+    }
+    levels.push_back(level);
+  }
+  pathCoordinates.resize(order);
+  pathBegins.resize(order);
+  pathEnds.resize(order);
+  pathUnfiltered.resize(order);
+}
+
+bool ComponentLocator::matches(size_t position, int first, int last,
+                               const int* coordinate) const {
+  for (int k = first; k <= last; k++) {
+    const Level& level = levels[k];
+    if (level.getCoordinate(position) != coordinate[level.mode]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+ptrdiff_t ComponentLocator::locate(const int* coordinate) {
+  const int order = (int)levels.size();
+
+  // Reuse the levels of the previous lookup's path that have the same
+  // coordinates, which leaves the positions of the parent of the first level
+  // to search in [begin, end).
+  size_t begin = 0;
+  size_t end = 1;
+  int unfiltered = -1;
+  int k = 0;
+  while (k < pathLength && pathCoordinates[k] == coordinate[levels[k].mode]) {
+    begin = pathBegins[k];
+    end = pathEnds[k];
+    unfiltered = pathUnfiltered[k];
+    k++;
+  }
+  const int sharedLength = k;
+  const int previousLength = pathLength;
+  pathLength = k;
+  if (begin == end) {
+    return -1;
+  }
+
+  for (; k < order; k++) {
+    const Level& level = levels[k];
+    const int c = coordinate[level.mode];
+    if (c < 0 || c >= level.dimension) {
+      return -1;
+    }
+
+    switch (level.kind) {
+      case Level::Dense:
+        taco_uassert(end - begin == 1 && unfiltered == -1) <<
+            "Locating components below a level with duplicate coordinates";
+        begin = begin * level.size + c;
+        end = begin + 1;
+        break;
+      case Level::Compressed: {
+        taco_uassert(end - begin == 1 && unfiltered == -1) <<
+            "Locating components below a level with duplicate coordinates";
+        const size_t segmentBegin = getEntry(level.pos, begin);
+        const size_t segmentEnd = getEntry(level.pos, begin + 1);
+        if (level.ordered) {
+          // If the previous lookup searched the same segment for a smaller
+          // coordinate, this coordinate can't be before where it stopped.
+          size_t from = segmentBegin;
+          if (k == sharedLength && k < previousLength &&
+              pathCoordinates[k] < c) {
+            from = pathBegins[k];
+          }
+          begin = gallop(level, from, segmentEnd, c);
+          end = level.unique ? begin + (begin < segmentEnd &&
+                                        level.getCoordinate(begin) == c)
+                             : upperBound(level, begin, segmentEnd, c);
+        } else if (level.unique) {
+          begin = segmentBegin;
+          while (begin < segmentEnd && level.getCoordinate(begin) != c) {
+            begin++;
+          }
+          end = std::min(begin + 1, segmentEnd);
+        } else {
+          // The matching positions need not be contiguous, so the segment is
+          // filtered by the levels below that share its positions.
+          begin = segmentBegin;
+          end = segmentEnd;
+          unfiltered = k;
+        }
+        break;
+      }
+      case Level::Singleton:
+        if (level.ordered && unfiltered == -1) {
+          begin = gallop(level, begin, end, c);
+          end = level.unique ? begin + (begin < end &&
+                                        level.getCoordinate(begin) == c)
+                             : upperBound(level, begin, end, c);
+        } else {
+          if (unfiltered == -1) {
+            unfiltered = k;
+          }
+          if (level.unique) {
+            while (begin < end && !matches(begin, unfiltered, k, coordinate)) {
+              begin++;
+            }
+            end = std::min(begin + 1, end);
+            unfiltered = -1;
+          }
+        }
+        break;
+      case Level::Hashed: {
+        taco_uassert(end - begin == 1 && unfiltered == -1) <<
+            "Locating components below a level with duplicate coordinates";
+        // Probe the segment's buckets like the generated code does, until
+        // the coordinate or an empty bucket is found
+        const size_t segmentBegin = begin * level.width;
+        size_t bucket = HashedModeFormat::getHome(c, level.width);
+        begin = segmentBegin;
+        end = segmentBegin;
+        for (int probes = 0; probes < level.width; probes++) {
+          const int64_t stored = getEntry(level.crd, segmentBegin + bucket);
+          if (stored == c) {
+            begin = segmentBegin + bucket;
+            end = begin + 1;
+            break;
+          } else if (stored < 0) {
+            break;
+          }
+          bucket = (bucket + 1) & (level.width - 1);
+        }
+        break;
+      }
+    }
+
+    pathCoordinates[k] = c;
+    pathBegins[k] = begin;
+    pathEnds[k] = end;
+    pathUnfiltered[k] = unfiltered;
+    pathLength = k + 1;
+    if (begin == end) {
+      return -1;
+    }
+  }
+
+  // Levels at the bottom that are neither unique nor sorted are filtered last
+  if (unfiltered != -1) {
+    while (begin < end && !matches(begin, unfiltered, order - 1, coordinate)) {
+      begin++;
+    }
+    if (begin == end) {
+      return -1;
+    }
+  }
+  return begin;
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef TACO_STORAGE_COMPONENT_LOCATOR_H
+#define TACO_STORAGE_COMPONENT_LOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "taco/storage/storage.h"
+#include "taco/storage/array.h"
+
+namespace taco {
+
+/// Finds the positions of components in the values array of a packed tensor
+/// by walking down its levels, indexing dense levels directly and searching
+/// the coordinates of compressed and singleton levels.  A locator remembers
+/// the path to the last component it located, so a lookup only searches the
+/// levels below the longest prefix it shares with the previous one, and in a
+/// sorted level it gallops forward from where the previous search ended.
+/// Looking up components in lexicographic order therefore touches each index
+/// array about once.  A locator must not be shared by threads.
+class ComponentLocator {
+public:
+  /// Create a locator for a packed tensor.  The locator refers to the index
+  /// arrays of the tensor without keeping them alive, so it must not be used
+  /// after they are replaced.
+  explicit ComponentLocator(const TensorStorage& storage);
+
+  /// Returns the position in the values array of the component at the
+  /// coordinate, which has one entry per mode in mode (not storage) order,
+  /// or -1 if the component is not stored or the coordinate is out of bounds.
+  ptrdiff_t locate(const int* coordinate);
+
+private:
+  struct Level {
+    enum Kind {Dense, Compressed, Singleton, Hashed} kind;
+    int mode;
+    int dimension;
+    bool ordered;
+    bool unique;
+    size_t size;
+    Array pos;
+    Array crd;
+
+    /// The base array of narrow compressed levels, whose crd arrays hold
+    /// offsets from the base of each block of positions, or nullptr
+    const int32_t* bases;
+    int blockShift;
+
+    /// The number of buckets of each segment of hashed levels
+    int width;
+
+    /// Returns the coordinate at a position of a compressed or singleton level
+    int64_t getCoordinate(size_t position) const;
+  };
+  std::vector<Level> levels;
+
+  /// Returns whether the levels first through last, which share positions,
+  /// store the coordinate at the position.
+  bool matches(size_t position, int first, int last,
+               const int* coordinate) const;
+
+  /// The coordinates and position ranges of each level of the previous lookup,
+  /// which are valid for the first pathLength levels.  A range is only a
+  /// superset of the matching positions if the coordinates of the level in
+  /// pathUnfiltered and the levels below it remain to be compared.
+  std::vector<int> pathCoordinates;
+  std::vector<size_t> pathBegins;
+  std::vector<size_t> pathEnds;
+  std::vector<int> pathUnfiltered;
+  int pathLength;
+};
+
+}
+#endif
@@ -0,0 +1,133 @@
+#include "storage/encoded_levels.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+#include "taco/error.h"
+#include "taco/storage/array.h"
+
+using namespace std;
+
+namespace taco {
+
+static bool isEncoded(const ModeFormat& modeFormat) {
+  return modeFormat.getName() == NarrowCompressed.getName();
+}
+
+Format getPackFormat(const Format& format) {
+  vector<ModeFormatPack> modeFormatPacks;
+  for (const ModeFormatPack& modeFormatPack : format.getModeFormatPacks()) {
+    vector<ModeFormat> modeFormats;
+    for (const ModeFormat& modeFormat : modeFormatPack.getModeFormats()) {
+      if (!isEncoded(modeFormat)) {
+        modeFormats.push_back(modeFormat);
+        continue;
+      }
+      modeFormats.push_back(Compressed({
+          modeFormat.isFull() ? ModeFormat::FULL : ModeFormat::NOT_FULL,
+          modeFormat.isOrdered() ? ModeFormat::ORDERED : ModeFormat::NOT_ORDERED,
+          modeFormat.isUnique() ? ModeFormat::UNIQUE : ModeFormat::NOT_UNIQUE,
+          modeFormat.isZeroless() ? ModeFormat::ZEROLESS
+                                  : ModeFormat::NOT_ZEROLESS}));
+    }
+    modeFormatPacks.push_back(ModeFormatPack(modeFormats));
+  }
+
+  Format packFormat(modeFormatPacks, format.getModeOrdering());
+  vector<vector<Datatype>> levelArrayTypes = format.getLevelArrayTypes();
+  for (size_t level = 0; level < levelArrayTypes.size(); level++) {
+    if (isEncoded(format.getModeFormats()[level])) {
+      levelArrayTypes[level] = {format.getCoordinateTypePos(level), Int32};
+    }
+  }
+  packFormat.setLevelArrayTypes(levelArrayTypes);
+  return packFormat;
+}
+
+/// Returns the largest offset that an offset type can hold.
+static int64_t getMaxOffset(Datatype offsetType) {
+  switch (offsetType.getKind()) {
+    case Datatype::UInt8:  return UINT8_MAX;
+    case Datatype::UInt16: return UINT16_MAX;
+    case Datatype::UInt32:
+    case Datatype::Int32:  return INT32_MAX;
+    default:
+      taco_uerror << "Narrow coordinates must be unsigned integers of at " <<
+          "most 32 bits, not " << offsetType;
+      return 0;
+  }
+}
+
+template <typename Offset, typename Coordinate>
+static void setOffsets(Array offsets, const Coordinate* crd, size_t size,
+                       const vector<int32_t>& bases, int blockShift) {
+  Offset* data = (Offset*)offsets.getData();
+  for (size_t p = 0; p < size; p++) {
+    data[p] = (Offset)(crd[p] - bases[p >> blockShift]);
+  }
+}
+
+template <typename Coordinate>
+static ModeIndex narrowCoordinates(const Array& pos, const Coordinate* crd,
+                                   size_t size, Datatype offsetType) {
+  const int64_t maxOffset = getMaxOffset(offsetType);
+
+  // Merge pairs of blocks, starting from single positions, for as long as the
+  // coordinates of every merged block fit in offsets from its smallest one.
+  vector<int32_t> mins(crd, crd + size);
+  vector<int32_t> maxs(crd, crd + size);
+  int blockShift = 0;
+  while (mins.size() > 1 && blockShift < 30) {
+    const size_t numMerged = (mins.size() + 1) / 2;
+    vector<int32_t> mergedMins(numMerged);
+    vector<int32_t> mergedMaxs(numMerged);
+    bool fits = true;
+    for (size_t b = 0; b < numMerged && fits; b++) {
+      const size_t last = min(2*b + 1, mins.size() - 1);
+      mergedMins[b] = min(mins[2*b], mins[last]);
+      mergedMaxs[b] = max(maxs[2*b], maxs[last]);
+      fits = (int64_t)mergedMaxs[b] - mergedMins[b] <= maxOffset;
+    }
+    if (!fits) {
+      break;
+    }
+    mins.swap(mergedMins);
+    maxs.swap(mergedMaxs);
+    blockShift++;
+  }
+
+  Array base = makeArray(Int32, mins.size() + 1);
+  int32_t* baseData = (int32_t*)base.getData();
+  baseData[0] = blockShift;
+  copy(mins.begin(), mins.end(), baseData + 1);
+
+  Array offsets = makeArray(offsetType, size);
+  switch (offsetType.getKind()) {
+    case Datatype::UInt8:
+      setOffsets<uint8_t>(offsets, crd, size, mins, blockShift);
+      break;
+    case Datatype::UInt16:
+      setOffsets<uint16_t>(offsets, crd, size, mins, blockShift);
+      break;
+    default:
+      setOffsets<uint32_t>(offsets, crd, size, mins, blockShift);
+      break;
+  }
+  return ModeIndex({pos, offsets, base});
+}
+
+ModeIndex narrowCoordinates(const ModeIndex& modeIndex, Datatype offsetType) {
+  const Array& pos = modeIndex.getIndexArray(0);
+  const Array& crd = modeIndex.getIndexArray(1);
+  if (crd.getType() == Int64) {
+    return narrowCoordinates(pos, (const int64_t*)crd.getData(), crd.getSize(),
+                             offsetType);
+  }
+  taco_iassert(crd.getType() == Int32) << crd.getType();
+  return narrowCoordinates(pos, (const int32_t*)crd.getData(), crd.getSize(),
+                           offsetType);
+}
+
+}
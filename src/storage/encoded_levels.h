@@ -0,0 +1,27 @@
+#ifndef TACO_STORAGE_ENCODED_LEVELS_H
+#define TACO_STORAGE_ENCODED_LEVELS_H
+
+#include "taco/format.h"
+#include "taco/storage/index.h"
+#include "taco/storage/array.h"
+
+namespace taco {
+
+/// Encoded levels (narrow compressed levels) can't be
+/// assembled by generated code.  Tensors with encoded levels are instead
+/// packed as if their encoded levels were compressed, and the compressed
+/// levels are then encoded.
+
+/// Returns the format that tensors with the format are packed into, in which
+/// encoded levels are compressed levels with Int32 coordinates.
+Format getPackFormat(const Format& format);
+
+/// Returns the arrays {pos, crd, base} of a narrow compressed level (see
+/// NarrowCompressedModeFormat) with the coordinates of a compressed level,
+/// given its arrays {pos, crd}.  The offsets in crd have type offsetType, and
+/// the blocks are the largest power-of-two numbers of positions whose
+/// coordinates differ by no more than the largest offset.
+ModeIndex narrowCoordinates(const ModeIndex& modeIndex, Datatype offsetType);
+
+}
+#endif
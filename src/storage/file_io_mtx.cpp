@@ -5,6 +5,8 @@
 #include <sstream>
 #include <cstdlib>
 #include <climits>
+#include <numeric>
+#include <functional>
 
 #include "taco/tensor.h"
 #include "taco/format.h"
@@ -12,37 +14,128 @@
 #include "taco/util/strings.h"
 #include "taco/util/timers.h"
 #include "taco/util/files.h"
+#include "taco/util/parallel.h"
+#include "storage/text_scanner.h"
 
 using namespace std;
 
 namespace taco {
 
+/// Skip the comments and blank lines at the top of a MatrixMarket file and
+/// read the header line that follows them, with the sizes of the tensor.
+static vector<size_t> readSizes(const char*& cursor, const char* end) {
+  while (cursor < end) {
+    const char* line = cursor;
+    skipBlanks(line, end);
+    if (line < end && *line != '%' && *line != '\n') {
+      break;
+    }
+    skipLine(cursor, end);
+  }
+
+  vector<size_t> sizes;
+  long size;
+  while (scanInteger(cursor, end, &size) && size > 0) {
+    sizes.push_back(size);
+  }
+  skipLine(cursor, end);
+  return sizes;
+}
+
 template <typename T>
-TensorBase dispatchReadMTX(std::string filename, const T& format, bool pack) {
-  std::fstream file;
-  util::openStream(file, filename, fstream::in);
-  TensorBase tensor = readMTX(file, format, pack);
-  file.close();
+static TensorBase dispatchReadSparse(const char* begin, const char* end,
+                                     const T& format, bool symm) {
+  // The first non-comment line is the header with dimensions
+  vector<int> dimensions;
+  for (size_t dimension : readSizes(begin, end)) {
+    taco_uassert(dimension <= INT_MAX) << "Dimension exceeds INT_MAX";
+    dimensions.push_back(static_cast<int>(dimension));
+  }
+  taco_uassert(dimensions.size() > 1) << "Missing MatrixMarket header";
+  dimensions.pop_back();
+  if (symm)
+    taco_uassert(dimensions.size()==2) << "Symmetry only available for matrix";
+
+  TextComponents components = scanComponents(begin, end, dimensions.size(),
+                                             symm);
+  for (size_t mode = 0; mode < dimensions.size(); mode++) {
+    taco_uassert(components.dimensions[mode] <= dimensions[mode]) <<
+        "Index exceeds the dimension in the MatrixMarket header";
+  }
+
+  // Create matrix
+  TensorBase tensor(type<double>(), dimensions, format);
+  tensor.insertCOO(components.coordinates, components.values);
   return tensor;
 }
 
-TensorBase readMTX(std::string filename, const ModeFormat& modetype, bool pack) {
-  return dispatchReadMTX(filename, modetype, pack);
-}
+template <typename T>
+static TensorBase dispatchReadDense(const char* begin, const char* end,
+                                    const T& format, bool symm) {
+  // The first non-comment line is the header with dimension sizes
+  vector<int> dimensions;
+  for (size_t dimension : readSizes(begin, end)) {
+    taco_uassert(dimension <= INT_MAX) << "Dimension exceeds INT_MAX";
+    dimensions.push_back(static_cast<int>(dimension));
+  }
+  taco_uassert(!dimensions.empty()) << "Missing MatrixMarket header";
+  if (symm)
+    taco_uassert(dimensions.size()==2) << "Symmetry only available for matrix";
 
-TensorBase readMTX(std::string filename, const Format& format, bool pack) {
-  return dispatchReadMTX(filename, format, pack);
+  size_t size = std::accumulate(dimensions.begin(), dimensions.end(),
+                                (size_t)1, std::multiplies<size_t>());
+  taco_uassert(size <= INT_MAX) << "Cannot read more than " << INT_MAX <<
+                                   " components";
+  const size_t capacity = symm ? 2*size : size;
+  double* values = (double*)malloc(capacity * sizeof(double));
+  try {
+    scanReals(begin, end, values, size);
+  } catch (...) {
+    free(values);
+    throw;
+  }
+
+  // The first mode varies fastest
+  const size_t order = dimensions.size();
+  vector<int*> coordinates(order);
+  for (size_t mode = 0; mode < order; mode++) {
+    coordinates[mode] = (int*)malloc(capacity * sizeof(int));
+  }
+  util::parallelFor(size, util::getNumBlocks(size, 1 << 16),
+                    [&](int block, size_t begin, size_t end) {
+    for (size_t n = begin; n < end; n++) {
+      size_t index = n;
+      for (size_t mode = 0; mode < order-1; mode++) {
+        coordinates[mode][n] = index % dimensions[mode];
+        index = index / dimensions[mode];
+      }
+      coordinates[order-1][n] = index;
+    }
+  });
+  if (symm) {
+    size = mirrorComponents(coordinates[0], coordinates[1], values, size);
+  }
+
+  // Create matrix
+  TensorBase tensor(type<double>(), dimensions, format);
+  vector<Array> coordinateArrays;
+  for (size_t mode = 0; mode < order; mode++) {
+    coordinateArrays.push_back(Array(Int32, coordinates[mode], size,
+                                     Array::Free));
+  }
+  tensor.insertCOO(coordinateArrays, Array(Float64, values, size, Array::Free));
+  return tensor;
 }
 
 template <typename T>
-TensorBase dispatchReadMTX(std::istream& stream, const T& format, bool pack) {
-  string line;
-  if (!std::getline(stream, line)) {
+static TensorBase dispatchReadMTX(const char* begin, const char* end,
+                                  const T& format, bool pack) {
+  if (begin == end) {
     return TensorBase();
   }
 
   // Read Header
-  std::stringstream lineStream(line);
+  std::stringstream lineStream(getLine(begin, end));
   string head, type, formats, field, symmetry;
   lineStream >> head >> type >> formats >> field >> symmetry;
   taco_uassert(head=="%%MatrixMarket") << "Unknown header of MatrixMarket";
@@ -60,9 +153,9 @@ TensorBase dispatchReadMTX(std::istream& stream, const T& format, bool pack) {
 
   TensorBase tensor;
   if (formats=="coordinate")
-    tensor = readSparse(stream,format,symm);
+    tensor = dispatchReadSparse(begin, end, format, symm);
   else if (formats=="array")
-    tensor = readDense(stream,format,symm);
+    tensor = dispatchReadDense(begin, end, format, symm);
   else
     taco_uerror << "MatrixMarket format not available";
 
@@ -73,6 +166,27 @@ TensorBase dispatchReadMTX(std::istream& stream, const T& format, bool pack) {
   return tensor;
 }
 
+template <typename T>
+TensorBase dispatchReadMTX(std::string filename, const T& format, bool pack) {
+  util::MappedFile file(filename);
+  return dispatchReadMTX(file.getData(), file.getData() + file.getSize(),
+                         format, pack);
+}
+
+TensorBase readMTX(std::string filename, const ModeFormat& modetype, bool pack) {
+  return dispatchReadMTX(filename, modetype, pack);
+}
+
+TensorBase readMTX(std::string filename, const Format& format, bool pack) {
+  return dispatchReadMTX(filename, format, pack);
+}
+
+template <typename T>
+TensorBase dispatchReadMTX(std::istream& stream, const T& format, bool pack) {
+  string text = readStream(stream);
+  return dispatchReadMTX(text.data(), text.data() + text.size(), format, pack);
+}
+
 TensorBase readMTX(std::istream& stream, const ModeFormat& modetype, bool pack) {
   return dispatchReadMTX(stream, modetype, pack);
 }
@@ -84,69 +198,9 @@ TensorBase readMTX(std::istream& stream, const Format& format, bool pack) {
 template <typename T>
 TensorBase dispatchReadSparse(std::istream& stream, const T& format, 
                               bool symm) {
-  string line;
-  std::getline(stream,line);
-
-  // Skip comments at the top of the file
-  string token;
-  do {
-    std::stringstream lineStream(line);
-    lineStream >> token;
-    if (token[0] != '%') {
-      break;
-    }
-  } while (std::getline(stream, line));
-
-  // The first non-comment line is the header with dimensions
-  vector<int> dimensions;
-  char* linePtr = (char*)line.data();
-  while (size_t dimension = strtoul(linePtr, &linePtr, 10)) {
-    taco_uassert(dimension <= INT_MAX) << "Dimension exceeds INT_MAX";
-    dimensions.push_back(static_cast<int>(dimension));
-  }
-  size_t nnz = dimensions[dimensions.size()-1];
-  dimensions.pop_back();
-  if (symm)
-    taco_uassert(dimensions.size()==2) << "Symmetry only available for matrix";
-
-  vector<int> coordinates;
-  vector<double> values;
-  coordinates.reserve(nnz*dimensions.size());
-  values.reserve(nnz);
-
-  while (std::getline(stream, line)) {
-    linePtr = (char*)line.data();
-    for (size_t i=0; i < dimensions.size(); i++) {
-      long index = strtol(linePtr, &linePtr, 10);
-      taco_uassert(index <= INT_MAX) << "Index exceeds INT_MAX";
-      coordinates.push_back(static_cast<int>(index));
-    }
-    double val = strtod(linePtr, &linePtr);
-    values.push_back(val);
-  }
-
-  // Create matrix
-  TensorBase tensor(type<double>(), dimensions, format);
-  if (symm)
-    tensor.reserve(2*nnz);
-  else
-    tensor.reserve(nnz);
-
-  // Insert coordinates
-  std::vector<int> coord;
-  for (size_t i = 0; i < nnz; i++) {
-    coord.clear();
-    for (size_t mode = 0; mode < dimensions.size(); mode++) {
-      coord.push_back(coordinates[i*dimensions.size() + mode] -1);
-    }
-    tensor.insert(coord, values[i]);
-    if (symm && coord.front() != coord.back()) {
-      std::reverse(coord.begin(), coord.end());
-      tensor.insert(coord, values[i]);
-    }
-  }
-
-  return tensor;
+  string text = readStream(stream);
+  return dispatchReadSparse(text.data(), text.data() + text.size(), format,
+                            symm);
 }
 
 TensorBase readSparse(std::istream& stream, const ModeFormat& modetype, 
@@ -160,65 +214,9 @@ TensorBase readSparse(std::istream& stream, const Format& format, bool symm) {
 
 template <typename T>
 TensorBase dispatchReadDense(std::istream& stream, const T& format, bool symm) {
-  string line;
-  std::getline(stream,line);
-
-  // Skip comments at the top of the file
-  string token;
-  do {
-    std::stringstream lineStream(line);
-    lineStream >> token;
-    if (token[0] != '%') {
-      break;
-    }
-  } while (std::getline(stream, line));
-
-  // The first non-comment line is the header with dimension sizes
-  vector<int> dimensions;
-  char* linePtr = (char*)line.data();
-  while (size_t dimension = strtoul(linePtr, &linePtr, 10)) {
-    taco_uassert(dimension <= INT_MAX) << "Dimension exceeds INT_MAX";
-    dimensions.push_back(static_cast<int>(dimension));
-  }
-  if (symm)
-    taco_uassert(dimensions.size()==2) << "Symmetry only available for matrix";
-
-  vector<double> values;
-  auto size = std::accumulate(begin(dimensions), end(dimensions),
-                              1, std::multiplies<double>());
-  values.reserve(size);
-
-  while (std::getline(stream, line)) {
-    linePtr = (char*)line.data();
-    double val = strtod(linePtr, &linePtr);
-    values.push_back(val);
-  }
-
-  // Create matrix
-  TensorBase tensor(type<double>(), dimensions, format);
-  if (symm)
-    tensor.reserve(2*size);
-  else
-    tensor.reserve(size);
-
-  // Insert coordinates
-  std::vector<int> coord;
-  for (auto n = 0; n<size; n++) {
-    coord.clear();
-    auto index=n;
-    for (size_t mode = 0; mode < dimensions.size()-1; mode++) {
-      coord.push_back(index%dimensions[mode]);
-      index=index/dimensions[mode];
-    }
-    coord.push_back(index);
-    tensor.insert(coord, values[n]);
-    if (symm && coord.front() != coord.back()) {
-      std::reverse(coord.begin(), coord.end());
-      tensor.insert(coord, values[n]);
-    }
-  }
-
-  return tensor;
+  string text = readStream(stream);
+  return dispatchReadDense(text.data(), text.data() + text.size(), format,
+                           symm);
 }
 
 TensorBase readDense(std::istream& stream, const ModeFormat& modetype, 
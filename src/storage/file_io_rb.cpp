@@ -14,6 +14,7 @@
 #include "taco/util/files.h"
 #include "taco/util/collections.h"
 #include "taco/cuda.h"
+#include "storage/text_scanner.h"
 
 using namespace std;
 
@@ -86,6 +87,61 @@ void readFile(std::istream &hbfile,
   readRHS();
 }
 
+/// Allocate an array of n elements for a matrix read from a file.
+template <typename T>
+static T* allocateArray(size_t n) {
+  if (should_use_CUDA_unified_memory()) {
+    return (T*)cuda_unified_alloc(n * sizeof(T));
+  }
+  return (T*)malloc(n * sizeof(T));
+}
+
+/// Read a matrix from text in memory, scanning the numbers in parallel.
+static void readFile(const char* begin, const char* end,
+                     int* nrow, int* ncol,
+                     int** colptr, int** rowind, double** values) {
+  std::string title, key;
+  int totcrd,ptrcrd,indcrd,valcrd,rhscrd;
+  std::string mxtype;
+  int nnzero, neltvl;
+  std::string ptrfmt, indfmt, valfmt, rhsfmt;
+
+  // The header has four lines, and a fifth if there are right-hand sides
+  const char* cursor = begin;
+  std::string header;
+  for (int i = 0; i < 4; i++) {
+    header += getLine(cursor, end) + "\n";
+  }
+  std::istringstream headerStream(header);
+  readHeader(headerStream,
+             &title, &key,
+             &totcrd, &ptrcrd, &indcrd, &valcrd, &rhscrd,
+             &mxtype, nrow, ncol, &nnzero, &neltvl,
+             &ptrfmt, &indfmt, &valfmt, &rhsfmt);
+  if (rhscrd > 0) {
+    skipLine(cursor, end);
+  }
+
+  // Find the lines of each section, which are then scanned in parallel
+  const char* sections[4] = {cursor};
+  int sectionLines[3] = {ptrcrd, indcrd, valcrd};
+  for (int section = 0; section < 3; section++) {
+    for (int line = 0; line < sectionLines[section]; line++) {
+      skipLine(cursor, end);
+    }
+    sections[section+1] = cursor;
+  }
+
+  *colptr = allocateArray<int>(*ncol+1);
+  scanIntegers(sections[0], sections[1], *colptr, *ncol+1, -1);
+  *rowind = allocateArray<int>(nnzero);
+  scanIntegers(sections[1], sections[2], *rowind, nnzero, -1);
+  *values = allocateArray<double>(nnzero);
+  scanReals(sections[2], sections[3], *values, nnzero);
+
+  readRHS();
+}
+
 template<typename T>
 void writeFile(std::ostream &hbfile, std::string key,
                int nrow, int ncol, int nnzero,
@@ -307,27 +363,15 @@ TensorBase readRB(std::string filename, const ModeFormat& modetype, bool pack) {
   return TensorBase();
 }
 
-TensorBase readRB(std::string filename, const Format& format, bool pack) {
-  std::fstream file;
-  util::openStream(file, filename, fstream::in);
-  TensorBase tensor = readRB(file, format, pack);
-  file.close();
-
-  return tensor;
-}
-
-TensorBase readRB(std::istream& stream, const ModeFormat& modetype, bool pack) {
-  taco_uassert(false) << "RB files must be loaded into a CSC matrix";
-  return TensorBase();
-}
-
-TensorBase readRB(std::istream& stream, const Format& format, bool pack) {
+/// Read an rb matrix from text in memory.
+static TensorBase readRB(const char* begin, const char* end,
+                         const Format& format, bool pack) {
   int rows, cols;
   int *colptr = NULL;
   int *rowidx = NULL;
   double *vals = NULL;
 
-  readFile(stream, &rows, &cols, &colptr, &rowidx, &vals);
+  readFile(begin, end, &rows, &cols, &colptr, &rowidx, &vals);
 
   taco_uassert(format == CSC) << "RB files must be loaded into a CSC matrix";
   TensorBase tensor(type<double>(), {(int)rows,(int)cols}, CSC);
@@ -349,6 +393,21 @@ TensorBase readRB(std::istream& stream, const Format& format, bool pack) {
   return tensor;
 }
 
+TensorBase readRB(std::string filename, const Format& format, bool pack) {
+  util::MappedFile file(filename);
+  return readRB(file.getData(), file.getData() + file.getSize(), format, pack);
+}
+
+TensorBase readRB(std::istream& stream, const ModeFormat& modetype, bool pack) {
+  taco_uassert(false) << "RB files must be loaded into a CSC matrix";
+  return TensorBase();
+}
+
+TensorBase readRB(std::istream& stream, const Format& format, bool pack) {
+  std::string text = readStream(stream);
+  return readRB(text.data(), text.data() + text.size(), format, pack);
+}
+
 void writeRB(std::string filename, const TensorBase& tensor) {
   taco_iassert(tensor.getOrder() == 2) <<
       "The .rb format only supports matrices. Consider using the .tns format "
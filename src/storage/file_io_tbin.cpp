@@ -0,0 +1,334 @@
+#include "taco/storage/file_io_tbin.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include "taco/tensor.h"
+#include "taco/format.h"
+#include "taco/error.h"
+#include "taco/storage/index.h"
+#include "taco/storage/array.h"
+#include "taco/util/files.h"
+#include "storage/index_entries.h"
+#include "storage/text_scanner.h"
+
+using namespace std;
+
+namespace taco {
+
+// A tbin file starts with a 64 byte header: the magic string, the format
+// version, a byte order mark and the number of 64-bit metadata words that
+// follow the header.  The metadata describes the format, the dimensions and
+// the arrays of the tensor, and gives the offset of each array in the file.
+// The arrays follow the metadata, and every array starts at a multiple of
+// 64 bytes.
+static const char tbinMagic[8] = {'t','a','c','o','t','b','i','n'};
+static const uint64_t tbinVersion = 1;
+static const uint64_t tbinByteOrder = 0x0102030405060708;
+static const size_t tbinHeaderSize = 64;
+static const size_t tbinAlignment = 64;
+
+// Mode format properties
+static const uint64_t tbinFull     = 1 << 0;
+static const uint64_t tbinOrdered  = 1 << 1;
+static const uint64_t tbinUnique   = 1 << 2;
+static const uint64_t tbinZeroless = 1 << 3;
+
+static size_t alignOffset(size_t offset) {
+  return (offset + tbinAlignment - 1) / tbinAlignment * tbinAlignment;
+}
+
+namespace {
+
+/// Reads the metadata words of a tbin file, checking that they are in bounds.
+struct MetadataReader {
+  const uint64_t* words;
+  size_t numWords;
+  size_t next;
+
+  uint64_t get() {
+    taco_uassert(next < numWords) << "Truncated tbin metadata";
+    return words[next++];
+  }
+
+  string getString() {
+    size_t length = get();
+    size_t numStringWords = (length + 7) / 8;
+    taco_uassert(numStringWords <= numWords - next) << "Truncated tbin metadata";
+    string str((const char*)&words[next], length);
+    next += numStringWords;
+    return str;
+  }
+};
+
+/// Builds the metadata words of a tbin file.
+struct MetadataWriter {
+  vector<uint64_t> words;
+
+  void add(uint64_t word) {
+    words.push_back(word);
+  }
+
+  void addString(const string& str) {
+    add(str.size());
+    size_t first = words.size();
+    words.resize(first + (str.size() + 7) / 8, 0);
+    memcpy(&words[first], str.data(), str.size());
+  }
+};
+
+}
+
+static ModeFormat makeModeFormat(const string& name, uint64_t properties) {
+  ModeFormat modeFormat;
+  for (const ModeFormat& base : {ModeFormat::Dense, ModeFormat::Compressed,
+                                 ModeFormat::Singleton}) {
+    if (base.getName() == name) {
+      modeFormat = base;
+    }
+  }
+  taco_uassert(modeFormat.defined()) <<
+      "Cannot read tbin files with " << name << " modes";
+  return modeFormat({
+      (properties & tbinFull)     ? ModeFormat::FULL     : ModeFormat::NOT_FULL,
+      (properties & tbinOrdered)  ? ModeFormat::ORDERED  : ModeFormat::NOT_ORDERED,
+      (properties & tbinUnique)   ? ModeFormat::UNIQUE   : ModeFormat::NOT_UNIQUE,
+      (properties & tbinZeroless) ? ModeFormat::ZEROLESS : ModeFormat::NOT_ZEROLESS
+  });
+}
+
+/// Read a tbin tensor from data, which belongs to owner.  The arrays of the
+/// tensor point into data and keep owner alive.
+static TensorBase readTBIN(const char* data, size_t size,
+                           shared_ptr<void> owner) {
+  taco_uassert(size >= tbinHeaderSize &&
+               memcmp(data, tbinMagic, sizeof(tbinMagic)) == 0) <<
+      "Not a tbin file";
+  const uint64_t* header = (const uint64_t*)data;
+  taco_uassert(header[1] == tbinVersion) <<
+      "Unsupported tbin version " << header[1] << " (expected " <<
+      tbinVersion << ")";
+  taco_uassert(header[2] == tbinByteOrder) <<
+      "The tbin file was written on a machine with a different byte order";
+  taco_uassert(header[3] <= (size - tbinHeaderSize) / sizeof(uint64_t)) <<
+      "Truncated tbin metadata";
+  MetadataReader metadata = {(const uint64_t*)(data + tbinHeaderSize),
+                             (size_t)header[3], 0};
+
+  Datatype componentType((Datatype::Kind)metadata.get());
+  const size_t order = metadata.get();
+  vector<int> dimensions(order);
+  for (size_t i = 0; i < order; i++) {
+    dimensions[i] = (int)metadata.get();
+  }
+  vector<int> modeOrdering(order);
+  for (size_t i = 0; i < order; i++) {
+    modeOrdering[i] = (int)metadata.get();
+  }
+
+  vector<ModeFormat> modeFormats;
+  for (size_t i = 0; i < order; i++) {
+    string name = metadata.getString();
+    modeFormats.push_back(makeModeFormat(name, metadata.get()));
+  }
+  vector<ModeFormatPack> modeFormatPacks;
+  const size_t numPacks = metadata.get();
+  size_t mode = 0;
+  for (size_t i = 0; i < numPacks; i++) {
+    size_t packSize = metadata.get();
+    taco_uassert(packSize <= order - mode) << "Invalid tbin mode format packs";
+    modeFormatPacks.push_back(vector<ModeFormat>(
+        modeFormats.begin() + mode, modeFormats.begin() + mode + packSize));
+    mode += packSize;
+  }
+  taco_uassert(mode == order) << "Invalid tbin mode format packs";
+
+  auto readArray = [&]() {
+    Datatype type((Datatype::Kind)metadata.get());
+    size_t numElements = metadata.get();
+    size_t offset = metadata.get();
+    size_t numBytes = numElements * type.getNumBytes();
+    taco_uassert(offset <= size && numBytes <= size - offset &&
+                 offset % tbinAlignment == 0) << "Invalid tbin array";
+    return Array(type, (void*)(data + offset), numElements, owner);
+  };
+
+  vector<ModeIndex> modeIndices;
+  vector<vector<Datatype>> levelArrayTypes;
+  for (size_t i = 0; i < order; i++) {
+    size_t numArrays = metadata.get();
+    vector<Array> arrays;
+    vector<Datatype> arrayTypes;
+    for (size_t j = 0; j < numArrays; j++) {
+      arrays.push_back(readArray());
+      arrayTypes.push_back(arrays.back().getType());
+    }
+    modeIndices.push_back(ModeIndex(arrays));
+    levelArrayTypes.push_back(arrayTypes);
+  }
+  Array values = readArray();
+  taco_uassert(values.getType() == componentType) << "Invalid tbin values";
+
+  Format format(modeFormatPacks, modeOrdering);
+  format.setLevelArrayTypes(levelArrayTypes);
+  TensorBase tensor(componentType, dimensions, format);
+  TensorStorage storage = tensor.getStorage();
+  storage.setIndex(Index(format, modeIndices));
+  storage.setValues(values);
+  tensor.setStorage(storage);
+  return tensor;
+}
+
+/// Check that a tensor read from source has the format it was read with.
+static void checkFormat(const TensorBase& tensor, const Format& format,
+                        const string& source) {
+  taco_uassert(tensor.getFormat() == format) <<
+      "The tbin " << source << " holds a tensor with format " <<
+      tensor.getFormat() << ", which must be read with that format";
+}
+
+static TensorBase readTBIN(string filename) {
+  // The arrays of the tensor are writable, so the mapping is copy-on-write
+  auto file = make_shared<util::MappedFile>(filename, true);
+  return readTBIN(file->getData(), file->getSize(), file);
+}
+
+static TensorBase readTBIN(istream& stream) {
+  auto text = make_shared<string>(readStream(stream));
+  return readTBIN(text->data(), text->size(), text);
+}
+
+TensorBase readTBIN(string filename, const ModeFormat& modetype, bool pack) {
+  TensorBase tensor = readTBIN(filename);
+  checkFormat(tensor, Format(vector<ModeFormatPack>(tensor.getOrder(),
+                                                    modetype)),
+              "file " + filename);
+  return tensor;
+}
+
+TensorBase readTBIN(string filename, const Format& format, bool pack) {
+  TensorBase tensor = readTBIN(filename);
+  checkFormat(tensor, format, "file " + filename);
+  return tensor;
+}
+
+TensorBase readTBIN(istream& stream, const ModeFormat& modetype, bool pack) {
+  TensorBase tensor = readTBIN(stream);
+  checkFormat(tensor, Format(vector<ModeFormatPack>(tensor.getOrder(),
+                                                    modetype)),
+              "stream");
+  return tensor;
+}
+
+TensorBase readTBIN(istream& stream, const Format& format, bool pack) {
+  TensorBase tensor = readTBIN(stream);
+  checkFormat(tensor, format, "stream");
+  return tensor;
+}
+
+void writeTBIN(string filename, const TensorBase& tensor) {
+  std::fstream file;
+  util::openStream(file, filename, fstream::out | fstream::binary);
+  writeTBIN(file, tensor);
+  file.close();
+}
+
+void writeTBIN(ostream& stream, const TensorBase& tensor) {
+  TensorBase packed = tensor;
+  packed.pack();
+  const TensorStorage& storage = packed.getStorage();
+  const Format& format = storage.getFormat();
+  const Index& index = storage.getIndex();
+  const int order = packed.getOrder();
+
+  MetadataWriter metadata;
+  metadata.add(packed.getComponentType().getKind());
+  metadata.add(order);
+  for (int dimension : packed.getDimensions()) {
+    metadata.add(dimension);
+  }
+  for (int mode : format.getModeOrdering()) {
+    metadata.add(mode);
+  }
+  for (const ModeFormat& modeFormat : format.getModeFormats()) {
+    metadata.addString(modeFormat.getName());
+    metadata.add((modeFormat.isFull()     ? tbinFull     : 0) |
+                 (modeFormat.isOrdered()  ? tbinOrdered  : 0) |
+                 (modeFormat.isUnique()   ? tbinUnique   : 0) |
+                 (modeFormat.isZeroless() ? tbinZeroless : 0));
+  }
+  metadata.add(format.getModeFormatPacks().size());
+  for (const ModeFormatPack& pack : format.getModeFormatPacks()) {
+    metadata.add(pack.getModeFormats().size());
+  }
+
+  // The arrays are written after the metadata, so record where their offsets
+  // go and fill them in once the size of the metadata is known.  Arrays may
+  // have more room than they use, so only write the used elements.
+  vector<Array> arrays;
+  vector<size_t> arraySizes;
+  vector<size_t> offsetWords;
+  auto addArray = [&](const Array& array, size_t numElements) {
+    metadata.add(array.getType().getKind());
+    metadata.add(numElements);
+    offsetWords.push_back(metadata.words.size());
+    metadata.add(0);
+    arrays.push_back(array);
+    arraySizes.push_back(numElements);
+  };
+  size_t numCoordinates = 1;
+  for (int i = 0; i < order; i++) {
+    const ModeIndex& modeIndex = index.getModeIndex(i);
+    const ModeFormat modeFormat = format.getModeFormats()[i];
+    metadata.add(modeIndex.numIndexArrays());
+    if (modeFormat.getName() == Dense.getName()) {
+      addArray(modeIndex.getIndexArray(0), 1);
+      numCoordinates *= getEntry(modeIndex.getIndexArray(0), 0);
+    } else if (modeFormat.getName() == Sparse.getName()) {
+      const Array& pos = modeIndex.getIndexArray(0);
+      addArray(pos, numCoordinates + 1);
+      numCoordinates = getEntry(pos, numCoordinates);
+      addArray(modeIndex.getIndexArray(1), numCoordinates);
+    } else {
+      for (int j = 0; j < modeIndex.numIndexArrays(); j++) {
+        const Array& array = modeIndex.getIndexArray(j);
+        addArray(array, array.getSize());
+      }
+    }
+  }
+  addArray(storage.getValues(), numCoordinates);
+
+  size_t offset = alignOffset(tbinHeaderSize +
+                              metadata.words.size() * sizeof(uint64_t));
+  for (size_t i = 0; i < arrays.size(); i++) {
+    metadata.words[offsetWords[i]] = offset;
+    offset = alignOffset(offset + arraySizes[i] *
+                                  arrays[i].getType().getNumBytes());
+  }
+
+  uint64_t header[tbinHeaderSize / sizeof(uint64_t)] = {0};
+  memcpy(header, tbinMagic, sizeof(tbinMagic));
+  header[1] = tbinVersion;
+  header[2] = tbinByteOrder;
+  header[3] = metadata.words.size();
+  stream.write((const char*)header, sizeof(header));
+  stream.write((const char*)metadata.words.data(),
+               metadata.words.size() * sizeof(uint64_t));
+
+  const char padding[tbinAlignment] = {0};
+  size_t written = tbinHeaderSize + metadata.words.size() * sizeof(uint64_t);
+  for (size_t i = 0; i < arrays.size(); i++) {
+    stream.write(padding, alignOffset(written) - written);
+    written = alignOffset(written);
+    size_t numBytes = arraySizes[i] * arrays[i].getType().getNumBytes();
+    stream.write((const char*)arrays[i].getData(), numBytes);
+    written += numBytes;
+  }
+  stream.write(padding, alignOffset(written) - written);
+  taco_uassert(stream.good()) << "Error writing tbin tensor";
+}
+
+}
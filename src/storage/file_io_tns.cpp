@@ -13,20 +13,53 @@
 #include "taco/error.h"
 #include "taco/util/strings.h"
 #include "taco/util/files.h"
+#include "storage/text_scanner.h"
 
 using namespace std;
 
 namespace taco {
 
 template <typename T>
-TensorBase dispatchReadTNS(std::string filename, const T& format, bool pack) {
-  std::fstream file;
-  util::openStream(file, filename, fstream::in);
-  TensorBase tensor = readTNS(file, format, pack);
-  file.close();
+TensorBase dispatchReadTNS(const char* begin, const char* end, const T& format,
+                           bool pack) {
+  // Infer tensor order from the first coordinate
+  const char* cursor = begin;
+  while (cursor < end) {
+    const char* line = cursor;
+    skipBlanks(line, end);
+    if (line < end && *line != '\n' && *line != '#' && *line != '%') {
+      break;
+    }
+    skipLine(cursor, end);
+  }
+  if (cursor == end) {
+    return TensorBase();
+  }
+  std::string firstLine = getLine(cursor, end);
+  size_t order = countNumbers(firstLine.data(),
+                              firstLine.data() + firstLine.size()) - 1;
+
+  // Load data
+  TextComponents components = scanComponents(begin, end, order, false);
+
+  // Create tensor
+  TensorBase tensor(type<double>(), components.dimensions, format);
+  tensor.insertCOO(components.coordinates, components.values);
+
+  if (pack) {
+    tensor.pack();
+  }
+
   return tensor;
 }
 
+template <typename T>
+TensorBase dispatchReadTNS(std::string filename, const T& format, bool pack) {
+  util::MappedFile file(filename);
+  return dispatchReadTNS(file.getData(), file.getData() + file.getSize(),
+                         format, pack);
+}
+
 TensorBase readTNS(std::string filename, const ModeFormat& modetype, bool pack) {
   return dispatchReadTNS(filename, modetype, pack);
 }
@@ -37,53 +70,8 @@ TensorBase readTNS(std::string filename, const Format& format, bool pack) {
 
 template <typename T>
 TensorBase dispatchReadTNS(std::istream& stream, const T& format, bool pack) {
-  std::vector<int>    coordinates;
-  std::vector<double> values;
-
-  std::string line;
-  if (!std::getline(stream, line)) {
-    return TensorBase();
-  }
-
-  // Infer tensor order from the first coordinate
-  vector<string> toks = util::split(line, " ");
-  size_t order = toks.size()-1;
-  std::vector<int> dimensions(order);
-  std::vector<int> coordinate(order);
-
-  // Load data
-  do {
-    char* linePtr = (char*)line.data();
-    for (size_t i = 0; i < order; i++) {
-      long idx = strtol(linePtr, &linePtr, 10);
-      taco_uassert(idx <= INT_MAX)<<"Coordinate in file is larger than INT_MAX";
-      coordinate[i] = (int)idx - 1;
-      dimensions[i] = std::max(dimensions[i], (int)idx);
-    }
-    coordinates.insert(coordinates.end(), coordinate.begin(), coordinate.end());
-    double val = strtod(linePtr, &linePtr);
-    values.push_back(val);
-
-  } while (std::getline(stream, line));
-
-  // Create tensor
-  const size_t nnz = values.size();
-  TensorBase tensor(type<double>(), dimensions, format);
-  tensor.reserve(nnz);
-
-  // Insert coordinates (TODO add and use bulk insertion)
-  for (size_t i = 0; i < nnz; i++) {
-    for (size_t j = 0; j < order; j++) {
-      coordinate[j] = coordinates[i*order + j];
-    }
-    tensor.insert(coordinate, values[i]);
-  }
-
-  if (pack) {
-    tensor.pack();
-  }
-
-  return tensor;
+  std::string text = readStream(stream);
+  return dispatchReadTNS(text.data(), text.data() + text.size(), format, pack);
 }
 
 TensorBase readTNS(std::istream& stream, const ModeFormat& modetype, bool pack) {
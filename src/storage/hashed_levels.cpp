@@ -0,0 +1,111 @@
+#include "storage/hashed_levels.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "taco/error.h"
+#include "taco/storage/array.h"
+#include "storage/index_entries.h"
+
+using namespace std;
+
+namespace taco {
+
+Format getCompressedFormat(const Format& format) {
+  vector<ModeFormatPack> modeFormatPacks;
+  for (const ModeFormatPack& modeFormatPack : format.getModeFormatPacks()) {
+    vector<ModeFormat> modeFormats;
+    for (const ModeFormat& modeFormat : modeFormatPack.getModeFormats()) {
+      modeFormats.push_back((modeFormat.getName() == Hashed.getName())
+                            ? Compressed : modeFormat);
+    }
+    modeFormatPacks.push_back(ModeFormatPack(modeFormats));
+  }
+
+  Format compressedFormat(modeFormatPacks, format.getModeOrdering());
+  vector<vector<Datatype>> levelArrayTypes = format.getLevelArrayTypes();
+  for (size_t level = 0; level < levelArrayTypes.size(); level++) {
+    if (format.getModeFormats()[level].getName() == Hashed.getName()) {
+      levelArrayTypes[level] = {format.getCoordinateTypePos(level),
+                                format.getCoordinateTypeIdx(level)};
+    }
+  }
+  compressedFormat.setLevelArrayTypes(levelArrayTypes);
+  return compressedFormat;
+}
+
+template <typename Coordinate>
+static bool hasFullSegment(const Array& crd, int width) {
+  const Coordinate* buckets = (const Coordinate*)crd.getData();
+  for (size_t begin = 0; begin < crd.getSize(); begin += width) {
+    if (all_of(buckets + begin, buckets + begin + width,
+               [](Coordinate stored) { return stored >= 0; })) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool hasFullSegment(const Array& crd, int width) {
+  if (crd.getType() == Int64) {
+    return hasFullSegment<int64_t>(crd, width);
+  }
+  taco_iassert(crd.getType() == Int32) << crd.getType();
+  return hasFullSegment<int32_t>(crd, width);
+}
+
+template <typename Coordinate>
+static ModeIndex compressBuckets(const Array& crd, Array& values, int width,
+                                 Datatype posType) {
+  const Coordinate* buckets = (const Coordinate*)crd.getData();
+  const size_t numSegments = crd.getSize() / width;
+  size_t size = 0;
+  for (size_t p = 0; p < crd.getSize(); p++) {
+    size += (buckets[p] >= 0);
+  }
+
+  Array pos = makeArray(posType, numSegments + 1);
+  Array compressedCrd = makeArray(crd.getType(), size);
+  Array compressedValues = makeArray(values.getType(), size);
+  const size_t valueSize = values.getType().getNumBytes();
+  vector<pair<Coordinate,size_t>> segment;
+  size_t k = 0;
+  for (size_t s = 0; s < numSegments; s++) {
+    setEntry(pos, s, k);
+
+    // Sort the coordinates of the segment's buckets
+    segment.clear();
+    for (size_t p = s * width; p < (s + 1) * width; p++) {
+      if (buckets[p] >= 0) {
+        segment.push_back({buckets[p], p});
+      }
+    }
+    sort(segment.begin(), segment.end());
+
+    for (const auto& entry : segment) {
+      ((Coordinate*)compressedCrd.getData())[k] = entry.first;
+      memcpy((char*)compressedValues.getData() + k * valueSize,
+             (const char*)values.getData() + entry.second * valueSize,
+             valueSize);
+      k++;
+    }
+  }
+  setEntry(pos, numSegments, k);
+  values = compressedValues;
+  return ModeIndex({pos, compressedCrd});
+}
+
+ModeIndex compressBuckets(const ModeIndex& modeIndex, Array& values, int width,
+                          Datatype posType) {
+  const Array& crd = modeIndex.getIndexArray(1);
+  if (crd.getType() == Int64) {
+    return compressBuckets<int64_t>(crd, values, width, posType);
+  }
+  taco_iassert(crd.getType() == Int32) << crd.getType();
+  return compressBuckets<int32_t>(crd, values, width, posType);
+}
+
+}
@@ -0,0 +1,28 @@
+#ifndef TACO_STORAGE_HASHED_LEVELS_H
+#define TACO_STORAGE_HASHED_LEVELS_H
+
+#include "taco/format.h"
+#include "taco/storage/index.h"
+#include "taco/storage/array.h"
+
+namespace taco {
+
+/// Returns the format with its hashed levels replaced by ordered compressed
+/// levels.
+Format getCompressedFormat(const Format& format);
+
+/// Returns true if a segment of the crd array of a hashed level with the
+/// given width has no empty buckets.  Generated code can't insert new
+/// coordinates into such a segment, so it might have dropped some.
+bool hasFullSegment(const Array& crd, int width);
+
+/// Returns the arrays {pos, crd} of an ordered compressed level with the
+/// coordinates of a hashed level with the given width, which must be the last
+/// level of a tensor, given its arrays.  The values of the tensor are moved
+/// to the positions of the compressed level and the values of empty buckets
+/// are dropped.
+ModeIndex compressBuckets(const ModeIndex& modeIndex, Array& values, int width,
+                          Datatype posType);
+
+}
+#endif
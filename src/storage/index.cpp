@@ -57,8 +57,12 @@ size_t Index::getSize() const {
     auto modeIndex = getModeIndex(i);
     if (modeType.getName() == Dense.getName()) {
       size *= modeIndex.getIndexArray(0).get(0).getAsIndex();
-    } else if (modeType.getName() == Sparse.getName()) {
+    } else if (modeType.getName() == Sparse.getName() ||
+               modeType.getName() == NarrowCompressed.getName()) {
       size = modeIndex.getIndexArray(0).get(size).getAsIndex();
+    } else if (modeType.getName() == Hashed.getName()) {
+      // Hashed levels store their empty buckets
+      size = modeIndex.getIndexArray(1).getSize();
     } else {
       taco_not_supported_yet;
     }
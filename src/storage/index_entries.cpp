@@ -0,0 +1,24 @@
+#include "storage/index_entries.h"
+
+#include "taco/error.h"
+
+namespace taco {
+
+int64_t getEntry(const Array& array, size_t i) {
+  if (array.getType() == Int64) {
+    return ((const int64_t*)array.getData())[i];
+  }
+  taco_iassert(array.getType() == Int32) << array.getType();
+  return ((const int32_t*)array.getData())[i];
+}
+
+void setEntry(Array array, size_t i, int64_t value) {
+  if (array.getType() == Int64) {
+    ((int64_t*)array.getData())[i] = value;
+    return;
+  }
+  taco_iassert(array.getType() == Int32) << array.getType();
+  ((int32_t*)array.getData())[i] = (int32_t)value;
+}
+
+}
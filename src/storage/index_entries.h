@@ -0,0 +1,18 @@
+#ifndef TACO_STORAGE_INDEX_ENTRIES_H
+#define TACO_STORAGE_INDEX_ENTRIES_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "taco/storage/array.h"
+
+namespace taco {
+
+/// Returns the i-th entry of an Int32 or Int64 index array.
+int64_t getEntry(const Array& array, size_t i);
+
+/// Sets the i-th entry of an Int32 or Int64 index array to value.
+void setEntry(Array array, size_t i, int64_t value);
+
+}
+#endif
@@ -0,0 +1,258 @@
+#include "taco/storage/placement.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "taco/error.h"
+#include "taco/tensor.h"
+#include "taco/util/parallel.h"
+#include "taco/util/strings.h"
+
+using namespace std;
+
+namespace taco {
+
+namespace {
+
+/// Arrays are only touched in parallel if every thread gets this many bytes,
+/// since smaller arrays are not worth starting threads for.
+const size_t minBytesPerThread = 1 << 18;
+
+/// Calls f(begin, end) for the parts of size bytes that the threads of a
+/// placement touch, on threads that are bound to the cpus of the placement.
+template <typename F>
+void forEachPart(const Placement& placement, size_t size, F f) {
+  const int numThreads = placement.getNumThreads();
+  const vector<int>& cpus = placement.getCpus();
+  const int numParts = (size >= numThreads * minBytesPerThread) ? numThreads
+                                                                : 1;
+  util::parallelFor(size, numParts, [&](int part, size_t begin, size_t end) {
+#if defined(__linux__)
+    cpu_set_t existing;
+    bool bound = false;
+    if (!cpus.empty()) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpus[part % cpus.size()], &set);
+      // The calling thread touches the first part and is unbound afterwards
+      bound = (part != 0 ||
+               pthread_getaffinity_np(pthread_self(), sizeof(existing),
+                                      &existing) == 0) &&
+              pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+#endif
+    f(begin, end);
+#if defined(__linux__)
+    if (bound && part == 0) {
+      pthread_setaffinity_np(pthread_self(), sizeof(existing), &existing);
+    }
+#endif
+  });
+}
+
+#if defined(__linux__) && defined(SYS_mbind)
+/// Returns the mask of the online NUMA nodes, or an empty mask if they are
+/// not known.
+const vector<unsigned long>& getOnlineNodes() {
+  static const vector<unsigned long> nodes = []() {
+    // The online nodes are listed as ranges, e.g. 0-1,3
+    vector<unsigned long> mask;
+    ifstream file("/sys/devices/system/node/online");
+    string ranges, range;
+    if (!getline(file, ranges)) {
+      return mask;
+    }
+    const size_t bitsPerWord = 8 * sizeof(unsigned long);
+    stringstream rangesStream(ranges);
+    while (getline(rangesStream, range, ',')) {
+      size_t dash = range.find('-');
+      int first = atoi(range.substr(0, dash).c_str());
+      int last = (dash == string::npos) ? first
+                                        : atoi(range.substr(dash+1).c_str());
+      for (int node = first; node <= last; node++) {
+        if ((size_t)node / bitsPerWord >= mask.size()) {
+          mask.resize(node / bitsPerWord + 1, 0);
+        }
+        mask[node / bitsPerWord] |= 1ul << (node % bitsPerWord);
+      }
+    }
+    return mask;
+  }();
+  return nodes;
+}
+#endif
+
+/// Spread the pages of an array that has not been touched yet round robin
+/// over the online NUMA nodes.
+void interleave(void* data, size_t size) {
+#if defined(__linux__) && defined(SYS_mbind)
+  const int mpolInterleave = 3;  // MPOL_INTERLEAVE of <numaif.h>
+  const vector<unsigned long>& nodes = getOnlineNodes();
+  if (nodes.empty() || size == 0) {
+    return;
+  }
+  // The kernel reads one bit less of the mask than it is told
+  const unsigned long maxNode = nodes.size() * 8 * sizeof(unsigned long) + 1;
+  // The placement is a hint, so failures leave the default placement
+  syscall(SYS_mbind, data, size, mpolInterleave, nodes.data(), maxNode, 0);
+#endif
+}
+
+}
+
+Placement::Placement() : Placement(Default) {
+}
+
+Placement::Placement(Kind kind, int numThreads, const vector<int>& cpus)
+    : kind(kind), numThreads(numThreads), cpus(cpus) {
+  taco_uassert(numThreads >= 0) << "The number of threads must not be negative";
+  if (numThreads == 0 && !cpus.empty()) {
+    this->numThreads = (int)cpus.size();
+  }
+}
+
+Placement::Kind Placement::getKind() const {
+  return kind;
+}
+
+int Placement::getNumThreads() const {
+  return (numThreads > 0) ? numThreads : std::max(taco_get_num_threads(), 1);
+}
+
+const vector<int>& Placement::getCpus() const {
+  return cpus;
+}
+
+void* Placement::allocate(size_t size, bool clear) const {
+  if (kind == Default) {
+    return clear ? calloc(1, size) : malloc(size);
+  }
+
+  // Pages are placed whole, so placed arrays start on a page of their own
+  size_t pageSize = 4096;
+#if defined(__linux__)
+  pageSize = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+  void* data = nullptr;
+  if (posix_memalign(&data, pageSize, size) != 0) {
+    return nullptr;
+  }
+  switch (kind) {
+    case Interleaved:
+      interleave(data, size);
+      if (clear) {
+        memset(data, 0, size);
+      }
+      break;
+    case FirstTouch:
+      forEachPart(*this, size, [data](size_t begin, size_t end) {
+        memset((char*)data + begin, 0, end - begin);
+      });
+      break;
+    case Default:
+      taco_ierror;
+      break;
+  }
+  return data;
+}
+
+void Placement::copy(void* destination, const void* source,
+                     size_t size) const {
+  if (kind != FirstTouch) {
+    memcpy(destination, source, size);
+    return;
+  }
+  forEachPart(*this, size, [&](size_t begin, size_t end) {
+    memcpy((char*)destination + begin, (const char*)source + begin,
+           end - begin);
+  });
+}
+
+bool operator==(const Placement& a, const Placement& b) {
+  return a.getKind() == b.getKind() &&
+         a.getNumThreads() == b.getNumThreads() &&
+         a.getCpus() == b.getCpus();
+}
+
+bool operator!=(const Placement& a, const Placement& b) {
+  return !(a == b);
+}
+
+std::ostream& operator<<(std::ostream& os, const Placement& placement) {
+  switch (placement.getKind()) {
+    case Placement::Default:
+      return os << "default";
+    case Placement::FirstTouch:
+      os << "first touch (" << placement.getNumThreads() << " threads";
+      if (!placement.getCpus().empty()) {
+        os << " on cpus " << util::join(placement.getCpus());
+      }
+      return os << ")";
+    case Placement::Interleaved:
+      return os << "interleaved";
+  }
+  return os;
+}
+
+PlacedAllocator::PlacedAllocator(const Placement& placement)
+    : placement(placement) {
+}
+
+void* PlacedAllocator::allocate(void* data, size_t size, bool clear) {
+  size_t existingSize = 0;
+  if (data != nullptr) {
+    lock_guard<std::mutex> lock(mutex);
+    auto existing = sizes.find(data);
+    if (existing == sizes.end()) {
+      return realloc(data, size);
+    }
+    existingSize = existing->second;
+    if (size <= existingSize) {
+      return data;
+    }
+  }
+
+  // Grown arrays are moved, since the pages that realloc adds would be
+  // touched by whichever thread writes them first
+  void* placed = placement.allocate(size, clear);
+  if (placed == nullptr) {
+    return nullptr;
+  }
+  if (data != nullptr) {
+    placement.copy(placed, data, existingSize);
+  }
+  {
+    lock_guard<std::mutex> lock(mutex);
+    if (data != nullptr) {
+      sizes.erase(data);
+    }
+    sizes[placed] = size;
+  }
+  free(data);
+  return placed;
+}
+
+void PlacedAllocator::deallocate(void* data) {
+  {
+    lock_guard<std::mutex> lock(mutex);
+    sizes.erase(data);
+  }
+  free(data);
+}
+
+const Placement& PlacedAllocator::getPlacement() const {
+  return placement;
+}
+
+}
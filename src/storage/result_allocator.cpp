@@ -0,0 +1,100 @@
+#include "taco/storage/result_allocator.h"
+
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+namespace taco {
+
+ResultArena::ResultArena() : nextSlot(0) {
+}
+
+ResultArena::~ResultArena() {
+  // Arrays that hold arena memory keep the arena alive, so every slot is free
+  for (const Slot& slot : slots) {
+    free(slot.data);
+  }
+}
+
+void ResultArena::begin() {
+  lock_guard<std::mutex> lock(mutex);
+  nextSlot = 0;
+}
+
+void* ResultArena::allocate(void* data, size_t size, bool clear) {
+  lock_guard<std::mutex> lock(mutex);
+  if (data != nullptr) {
+    auto slotIndex = slotIndices.find(data);
+    if (slotIndex == slotIndices.end()) {
+      return realloc(data, size);
+    }
+    Slot& slot = slots[slotIndex->second];
+    if (size <= slot.capacity) {
+      return data;
+    }
+    void* grown = realloc(data, size);
+    if (grown != nullptr) {
+      slotIndices.erase(slotIndex);
+      slotIndices[grown] = &slot - slots.data();
+      slot.data = grown;
+      slot.capacity = size;
+    }
+    return grown;
+  }
+
+  const size_t index = nextSlot++;
+  if (index < slots.size() && slots[index].free) {
+    Slot& slot = slots[index];
+    if (slot.capacity < size) {
+      slotIndices.erase(slot.data);
+      free(slot.data);
+      slot.data = malloc(size);
+      slot.capacity = size;
+      slotIndices[slot.data] = index;
+    }
+    slot.free = false;
+    if (clear) {
+      memset(slot.data, 0, size);
+    }
+    return slot.data;
+  }
+
+  data = clear ? calloc(1, size) : malloc(size);
+  if (index == slots.size() && data != nullptr) {
+    slots.push_back({data, size, false});
+    slotIndices[data] = index;
+  }
+  // Otherwise the slot still holds a live result that its owner kept, so the
+  // new allocation is not recycled.
+  return data;
+}
+
+void ResultArena::deallocate(void* data) {
+  lock_guard<std::mutex> lock(mutex);
+  auto slotIndex = slotIndices.find(data);
+  if (slotIndex == slotIndices.end()) {
+    free(data);
+    return;
+  }
+  slots[slotIndex->second].free = true;
+}
+
+static thread_local ResultAllocator* threadResultAllocator = nullptr;
+
+ResultAllocator* getThreadResultAllocator() {
+  return threadResultAllocator;
+}
+
+void setThreadResultAllocator(ResultAllocator* allocator) {
+  threadResultAllocator = allocator;
+}
+
+void* allocateResult(void* data, size_t size, int clear) {
+  if (threadResultAllocator != nullptr) {
+    return threadResultAllocator->allocate(data, size, clear);
+  }
+  return clear ? calloc(1, size) : realloc(data, size);
+}
+
+}
@@ -0,0 +1,231 @@
+#include "storage/row_blocks.h"
+
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+#include "taco/format.h"
+#include "taco/error.h"
+#include "taco/storage/index.h"
+#include "storage/index_entries.h"
+#include "taco/util/files.h"
+
+using namespace std;
+
+namespace taco {
+
+template <typename T>
+static size_t lowerBound(const Array& crd, size_t begin, size_t end,
+                         size_t value) {
+  const T* data = (const T*)crd.getData();
+  return lower_bound(data + begin, data + end, (T)value) - data;
+}
+
+/// Returns the position of the first coordinate in [begin, end) of a
+/// compressed mode's crd array that is not less than value.
+static size_t lowerBound(const Array& crd, size_t begin, size_t end,
+                         size_t value) {
+  if (crd.getType() == Int64) {
+    return lowerBound<int64_t>(crd, begin, end, value);
+  }
+  taco_iassert(crd.getType() == Int32) << crd.getType();
+  return lowerBound<int32_t>(crd, begin, end, value);
+}
+
+/// Returns a view of an array that starts at the given element.
+static Array getSuffix(const Array& array, size_t begin) {
+  taco_iassert(begin <= array.getSize());
+  char* data = (char*)array.getData() + begin * array.getType().getNumBytes();
+  return Array(array.getType(), data, array.getSize() - begin, Array::UserOwns);
+}
+
+static bool isMode(const Format& format, int level, const ModeFormat& mode) {
+  return format.getModeFormats()[level].getName() == mode.getName();
+}
+
+/// Returns the positions [begin, end) of the rows in the outermost level.
+static pair<size_t,size_t> getRowPositions(const TensorStorage& storage,
+                                           int begin, int end) {
+  const Format& format = storage.getFormat();
+  taco_uassert(format.getOrder() > 0) << "Scalars do not have rows";
+  if (isMode(format, 0, Dense)) {
+    return {begin, end};
+  }
+  taco_uassert(isMode(format, 0, Sparse)) <<
+      "The outermost mode of a row block must be dense or compressed";
+  const ModeIndex& modeIndex = storage.getIndex().getModeIndex(0);
+  const Array& pos = modeIndex.getIndexArray(0);
+  const Array& crd = modeIndex.getIndexArray(1);
+  size_t first = lowerBound(crd, getEntry(pos, 0), getEntry(pos, 1), begin);
+  size_t last = lowerBound(crd, first, getEntry(pos, 1), end);
+  return {first, last};
+}
+
+/// Call f(array, begin, end) for the elements [begin, end) of each index and
+/// value array of a tensor that are accessed by the rows [begin, end).
+template <typename F>
+static void forEachRowBlockSlice(const TensorStorage& storage, int begin,
+                                 int end, F f) {
+  const Format& format = storage.getFormat();
+  const Index& index = storage.getIndex();
+  size_t first, last;
+  tie(first, last) = getRowPositions(storage, begin, end);
+  if (isMode(format, 0, Sparse)) {
+    f(index.getModeIndex(0).getIndexArray(1), first, last);
+  }
+  for (int level = 1; level < format.getOrder(); level++) {
+    const ModeIndex& modeIndex = index.getModeIndex(level);
+    if (isMode(format, level, Dense)) {
+      size_t size = getEntry(modeIndex.getIndexArray(0), 0);
+      first *= size;
+      last *= size;
+    } else if (isMode(format, level, Sparse)) {
+      const Array& pos = modeIndex.getIndexArray(0);
+      f(pos, first, last + 1);
+      first = getEntry(pos, first);
+      last = getEntry(pos, last);
+      f(modeIndex.getIndexArray(1), first, last);
+    } else if (isMode(format, level, Singleton)) {
+      f(modeIndex.getIndexArray(1), first, last);
+    } else {
+      taco_not_supported_yet;
+    }
+  }
+  f(storage.getValues(), first, last);
+}
+
+size_t getRowBlockBytes(const TensorStorage& storage, int begin, int end) {
+  size_t bytes = 0;
+  forEachRowBlockSlice(storage, begin, end,
+                       [&](const Array& array, size_t first, size_t last) {
+    bytes += (last - first) * array.getType().getNumBytes();
+  });
+  return bytes;
+}
+
+TensorStorage getRowBlock(const TensorStorage& storage, int begin, int end) {
+  const Format& format = storage.getFormat();
+  const Index& index = storage.getIndex();
+  vector<int> dimensions = storage.getDimensions();
+  vector<ModeIndex> modeIndices;
+
+  // Positions below a dense outermost mode are shifted to start at the block,
+  // until a compressed level maps them back to positions in the tensor.
+  size_t shift = 0;
+  if (isMode(format, 0, Dense)) {
+    dimensions[format.getModeOrdering()[0]] = end - begin;
+    Array size = makeArray(index.getModeIndex(0).getIndexArray(0).getType(), 1);
+    setEntry(size, 0, end - begin);
+    modeIndices.push_back(ModeIndex({size}));
+    shift = begin;
+  } else {
+    const ModeIndex& modeIndex = index.getModeIndex(0);
+    Array pos = makeArray(modeIndex.getIndexArray(0).getType(), 2);
+    size_t first, last;
+    tie(first, last) = getRowPositions(storage, begin, end);
+    setEntry(pos, 0, first);
+    setEntry(pos, 1, last);
+    modeIndices.push_back(ModeIndex({pos, modeIndex.getIndexArray(1)}));
+  }
+  for (int level = 1; level < format.getOrder(); level++) {
+    const ModeIndex& modeIndex = index.getModeIndex(level);
+    if (isMode(format, level, Dense)) {
+      shift *= getEntry(modeIndex.getIndexArray(0), 0);
+      modeIndices.push_back(modeIndex);
+    } else if (isMode(format, level, Sparse)) {
+      modeIndices.push_back(ModeIndex({
+          getSuffix(modeIndex.getIndexArray(0), shift),
+          modeIndex.getIndexArray(1)}));
+      shift = 0;
+    } else if (isMode(format, level, Singleton)) {
+      modeIndices.push_back(ModeIndex({
+          modeIndex.getIndexArray(0),
+          getSuffix(modeIndex.getIndexArray(1), shift)}));
+    } else {
+      taco_not_supported_yet;
+    }
+  }
+
+  TensorStorage block(storage.getComponentType(), dimensions, format);
+  block.setIndex(Index(format, modeIndices));
+  block.setValues(getSuffix(storage.getValues(), shift));
+  return block;
+}
+
+void prefetchRowBlock(const TensorStorage& storage, int begin, int end) {
+  forEachRowBlockSlice(storage, begin, end,
+                       [](const Array& array, size_t first, size_t last) {
+    const size_t numBytes = array.getType().getNumBytes();
+    util::adviseWillNeed((const char*)array.getData() + first * numBytes,
+                         (last - first) * numBytes);
+  });
+}
+
+void releaseRowBlock(const TensorStorage& storage, int begin, int end) {
+  forEachRowBlockSlice(storage, begin, end,
+                       [](const Array& array, size_t first, size_t last) {
+    const size_t numBytes = array.getType().getNumBytes();
+    util::adviseWontNeed((const char*)array.getData() + first * numBytes,
+                         (last - first) * numBytes);
+  });
+}
+
+template <typename T>
+static void addValues(Array& result, const Array& values, size_t begin,
+                      size_t end) {
+  T* resultData = (T*)result.getData();
+  const T* data = (const T*)values.getData();
+  for (size_t i = begin; i < end; i++) {
+    resultData[i] += data[i];
+  }
+}
+
+void addValues(Array result, const Array& values, size_t begin, size_t end) {
+  taco_iassert(result.getType() == values.getType() &&
+               result.getSize() == values.getSize() &&
+               begin <= end && end <= values.getSize());
+  switch (result.getType().getKind()) {
+    case Datatype::UInt8:
+      addValues<uint8_t>(result, values, begin, end);
+      break;
+    case Datatype::UInt16:
+      addValues<uint16_t>(result, values, begin, end);
+      break;
+    case Datatype::UInt32:
+      addValues<uint32_t>(result, values, begin, end);
+      break;
+    case Datatype::UInt64:
+      addValues<uint64_t>(result, values, begin, end);
+      break;
+    case Datatype::Int8:
+      addValues<int8_t>(result, values, begin, end);
+      break;
+    case Datatype::Int16:
+      addValues<int16_t>(result, values, begin, end);
+      break;
+    case Datatype::Int32:
+      addValues<int32_t>(result, values, begin, end);
+      break;
+    case Datatype::Int64:
+      addValues<int64_t>(result, values, begin, end);
+      break;
+    case Datatype::Float32:
+      addValues<float>(result, values, begin, end);
+      break;
+    case Datatype::Float64:
+      addValues<double>(result, values, begin, end);
+      break;
+    case Datatype::Complex64:
+      addValues<std::complex<float>>(result, values, begin, end);
+      break;
+    case Datatype::Complex128:
+      addValues<std::complex<double>>(result, values, begin, end);
+      break;
+    default:
+      taco_not_supported_yet;
+      break;
+  }
+}
+
+}
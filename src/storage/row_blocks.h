@@ -0,0 +1,39 @@
+#ifndef TACO_STORAGE_ROW_BLOCKS_H
+#define TACO_STORAGE_ROW_BLOCKS_H
+
+#include <cstddef>
+
+#include "taco/storage/storage.h"
+#include "taco/storage/array.h"
+
+namespace taco {
+
+/// Row blocks are ranges [begin, end) of the coordinates of the outermost
+/// stored mode of a tensor, which must be dense or compressed.  They split the
+/// tensor into parts that can be computed on one at a time, so that only one
+/// part of the tensor needs to be in memory at a time.
+
+/// Returns the number of bytes of the index and value arrays of a tensor that
+/// are accessed by the rows [begin, end).
+size_t getRowBlockBytes(const TensorStorage& storage, int begin, int end);
+
+/// Returns a view of the rows [begin, end) of a tensor that shares its arrays.
+/// If the outermost stored mode is dense the rows of the view are numbered
+/// from 0, so the view has end - begin rows.  If it is compressed the rows
+/// keep their coordinates, and only the positions of the rows are iterated.
+TensorStorage getRowBlock(const TensorStorage& storage, int begin, int end);
+
+/// Advise that the rows [begin, end) of a tensor will be accessed soon, so
+/// that they are read ahead if the tensor is memory mapped from a file.
+void prefetchRowBlock(const TensorStorage& storage, int begin, int end);
+
+/// Advise that the rows [begin, end) of a tensor will not be accessed again
+/// soon, so that their memory is reclaimed first.
+void releaseRowBlock(const TensorStorage& storage, int begin, int end);
+
+/// Add the elements [begin, end) of values to the same elements of result,
+/// which has the same type and size.
+void addValues(Array result, const Array& values, size_t begin, size_t end);
+
+}
+#endif
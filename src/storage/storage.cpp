@@ -3,6 +3,7 @@
 #include <iostream>
 #include <string>
 #include <climits>
+#include <atomic>
 
 #include "taco/type.h"
 #include "taco/format.h"
@@ -15,6 +16,9 @@ using namespace std;
 
 namespace taco {
 
+// Version numbers of all tensor storages
+static std::atomic<uint64_t> nextVersion(0);
+
 // class Storage
 struct TensorStorage::Content {
   Datatype      componentType;
@@ -25,10 +29,12 @@ struct TensorStorage::Content {
 
   Index         index;
   Array         values;
+  uint64_t      version;
+  Placement     placement;
 
   Content(Datatype componentType, vector<int> dimensions, Format format)
       : componentType(componentType), dimensions(dimensions), format(format),
-        index(format) {
+        index(format), version(nextVersion++) {
     int order = (int)dimensions.size();
 
     taco_iassert(order <= INT_MAX && componentType.getNumBits() <= INT_MAX);
@@ -46,7 +52,10 @@ struct TensorStorage::Content {
         modeTypes[i] = taco_mode_dense;
       } else if (modeType.getName() == Sparse.getName()) {
         modeTypes[i] = taco_mode_sparse;
-      } else if (modeType.getName() == Singleton.getName()) {
+      } else if (modeType.getName() == Singleton.getName() ||
+                 modeType.getName() == Hashed.getName()) {
+        modeTypes[i] = taco_mode_sparse;
+      } else if (modeType.getName() == NarrowCompressed.getName()) {
         modeTypes[i] = taco_mode_sparse;
       } else {
         taco_not_supported_yet;
@@ -147,7 +156,8 @@ TensorStorage::operator struct taco_tensor_t*() const {
         tensorData->indices[i][1] = (uint8_t*)idx.getData();
       }
     }
-    else if (modeType.getName() == Singleton.getName()) {
+    else if (modeType.getName() == Singleton.getName() ||
+             modeType.getName() == Hashed.getName()) {
       // TODO Uncomment assert and remove conditional
       // taco_iassert(modeIndex.numIndexArrays() == 2)
       //     << modeIndex.numIndexArrays();
@@ -156,6 +166,15 @@ TensorStorage::operator struct taco_tensor_t*() const {
         tensorData->indices[i][1] = (uint8_t*)idx.getData();
       }
     }
+    // Narrow compressed levels also have the bases of their coordinates
+    else if (modeType.getName() == NarrowCompressed.getName()) {
+      if (modeIndex.numIndexArrays() > 0) {
+        for (int j = 0; j < 3; j++) {
+          tensorData->indices[i][j] =
+              (uint8_t*)modeIndex.getIndexArray(j).getData();
+        }
+      }
+    }
     else {
       taco_not_supported_yet;
     }
@@ -166,12 +185,57 @@ TensorStorage::operator struct taco_tensor_t*() const {
   return content->tensorData;
 }
 
+uint64_t TensorStorage::getVersion() const {
+  return content->version;
+}
+
 void TensorStorage::setIndex(const Index& index) {
   content->index = index;
+  content->version = nextVersion++;
 }
 
 void TensorStorage::setValues(const Array& values) {
   content->values = values;
+  content->version = nextVersion++;
+}
+
+void TensorStorage::setPlacement(const Placement& placement) {
+  content->placement = placement;
+}
+
+const Placement& TensorStorage::getPlacement() const {
+  return content->placement;
+}
+
+/// Returns a copy of the array with the placement, or the array if it already
+/// has the placement.
+static Array placeArray(const Array& array, const Placement& placement) {
+  if (array.getPlacement() == placement || array.getSize() == 0) {
+    return array;
+  }
+  Array placed = makeArray(array.getType(), array.getSize(), placement);
+  placement.copy(placed.getData(), array.getData(),
+                 array.getSize() * array.getType().getNumBytes());
+  return placed;
+}
+
+void TensorStorage::place() {
+  const Placement& placement = content->placement;
+  if (placement.getKind() == Placement::Default) {
+    return;
+  }
+  Index index = getIndex();
+  vector<ModeIndex> modeIndices;
+  for (int i = 0; i < index.numModeIndices(); i++) {
+    ModeIndex modeIndex = index.getModeIndex(i);
+    vector<Array> indexArrays;
+    for (int j = 0; j < modeIndex.numIndexArrays(); j++) {
+      indexArrays.push_back(placeArray(modeIndex.getIndexArray(j), placement));
+    }
+    modeIndices.push_back(ModeIndex(indexArrays));
+  }
+  setIndex(Index(index.getFormat(), modeIndices));
+  setValues(placeArray(getValues(), placement));
 }
 
 bool equals(TensorStorage a, TensorStorage b) {
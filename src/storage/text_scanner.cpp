@@ -0,0 +1,399 @@
+#include "storage/text_scanner.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#include "taco/error.h"
+#include "taco/util/parallel.h"
+
+using namespace std;
+
+namespace taco {
+
+// Minimum number of bytes of text scanned by each thread
+static const size_t minChunkSize = 1 << 20;
+
+static inline bool isBlank(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static inline bool isWhitespace(char c) {
+  return isBlank(c) || c == '\n';
+}
+
+static inline bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+void skipBlanks(const char*& cursor, const char* end) {
+  while (cursor < end && isBlank(*cursor)) {
+    cursor++;
+  }
+}
+
+void skipLine(const char*& cursor, const char* end) {
+  if (cursor >= end) {
+    cursor = end;
+    return;
+  }
+  const char* newline = (const char*)memchr(cursor, '\n', end - cursor);
+  cursor = newline ? newline + 1 : end;
+}
+
+string getLine(const char*& cursor, const char* end) {
+  const char* begin = cursor;
+  skipLine(cursor, end);
+  const char* lineEnd = cursor;
+  while (lineEnd > begin && (lineEnd[-1] == '\n' || lineEnd[-1] == '\r')) {
+    lineEnd--;
+  }
+  return string(begin, lineEnd);
+}
+
+bool scanInteger(const char*& cursor, const char* end, long* value) {
+  skipBlanks(cursor, end);
+  const char* p = cursor;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    p++;
+  }
+  if (p == end || !isDigit(*p)) {
+    return false;
+  }
+  long result = 0;
+  for (; p < end && isDigit(*p); p++) {
+    result = (result > LONG_MAX / 10) ? LONG_MAX : result * 10 + (*p - '0');
+  }
+  if (p < end && !isWhitespace(*p)) {
+    return false;
+  }
+  *value = negative ? -result : result;
+  cursor = p;
+  return true;
+}
+
+bool scanReal(const char*& cursor, const char* end, double* value) {
+  // Powers of ten that are exactly representable as doubles
+  static const double powersOf10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+
+  skipBlanks(cursor, end);
+  const char* p = cursor;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    p++;
+  }
+
+  // Accumulate up to 19 significant digits, which fit in 64 bits
+  uint64_t mantissa = 0;
+  int numDigits = 0;
+  int exponent = 0;
+  bool truncated = false;
+  bool anyDigits = false;
+  for (; p < end && isDigit(*p); p++) {
+    anyDigits = true;
+    if (mantissa == 0 && *p == '0') {
+      continue;
+    } else if (numDigits < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      numDigits++;
+    } else {
+      truncated = true;
+      exponent++;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (p++; p < end && isDigit(*p); p++) {
+      anyDigits = true;
+      if (mantissa == 0 && *p == '0') {
+        exponent--;
+      } else if (numDigits < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        numDigits++;
+        exponent--;
+      } else {
+        truncated = true;
+      }
+    }
+  }
+  if (anyDigits && p < end &&
+      (*p == 'e' || *p == 'E' || *p == 'd' || *p == 'D')) {
+    const char* q = p + 1;
+    bool negativeExponent = false;
+    if (q < end && (*q == '-' || *q == '+')) {
+      negativeExponent = (*q == '-');
+      q++;
+    }
+    if (q < end && isDigit(*q)) {
+      int exponentPart = 0;
+      for (; q < end && isDigit(*q); q++) {
+        exponentPart = std::min(exponentPart * 10 + (*q - '0'), 100000);
+      }
+      exponent += negativeExponent ? -exponentPart : exponentPart;
+      p = q;
+    }
+  }
+
+  // Small mantissas scaled by exact powers of ten are correctly rounded by a
+  // single floating-point multiplication or division.  Anything else (long
+  // mantissas, large exponents, inf and nan) is left to strtod.
+  if (anyDigits && !truncated && numDigits <= 15 &&
+      exponent >= -22 && exponent <= 22) {
+    double result = (double)mantissa;
+    result = (exponent >= 0) ? result * powersOf10[exponent]
+                             : result / powersOf10[-exponent];
+    *value = negative ? -result : result;
+  } else {
+    char token[128];
+    size_t length = 0;
+    for (const char* t = cursor;
+         t < end && !isWhitespace(*t) && length < sizeof(token) - 1; t++) {
+      token[length++] = (*t == 'd' || *t == 'D') ? 'e' : *t;
+    }
+    token[length] = '\0';
+    char* tokenEnd;
+    *value = strtod(token, &tokenEnd);
+    if (tokenEnd == token) {
+      return false;
+    }
+    p = std::max(p, cursor + (tokenEnd - token));
+  }
+
+  // Ignore trailing characters of the number, as strtod does
+  while (p < end && !isWhitespace(*p)) {
+    p++;
+  }
+  cursor = p;
+  return true;
+}
+
+/// Split [begin, end) into numChunks chunks that start at the beginning of
+/// lines, returning the numChunks+1 chunk boundaries.
+static vector<const char*> splitLines(const char* begin, const char* end,
+                                      int numChunks) {
+  vector<const char*> boundaries(numChunks + 1);
+  boundaries[0] = begin;
+  for (int chunk = 1; chunk < numChunks; chunk++) {
+    const char* boundary =
+        begin + util::getBlockBegin(end - begin, numChunks, chunk) - 1;
+    boundary = std::max(boundary, boundaries[chunk - 1]);
+    skipLine(boundary, end);
+    boundaries[chunk] = boundary;
+  }
+  boundaries[numChunks] = end;
+  return boundaries;
+}
+
+/// Returns true if the line at the cursor holds no component.
+static inline bool isBlankOrComment(const char* cursor, const char* end) {
+  skipBlanks(cursor, end);
+  return cursor == end || *cursor == '\n' || *cursor == '%' || *cursor == '#';
+}
+
+TextComponents scanComponents(const char* begin, const char* end, int order,
+                              bool symmetric) {
+  const int numChunks = util::getNumBlocks(end - begin, minChunkSize);
+  const vector<const char*> chunks = splitLines(begin, end, numChunks);
+
+  // Count the components of each chunk, to scan them straight into place
+  vector<size_t> offsets(numChunks + 1, 0);
+  util::parallelFor(numChunks, numChunks, [&](int chunk, size_t, size_t) {
+    size_t count = 0;
+    for (const char* cursor = chunks[chunk]; cursor < chunks[chunk + 1];
+         skipLine(cursor, end)) {
+      count += !isBlankOrComment(cursor, end);
+    }
+    offsets[chunk + 1] = count;
+  });
+  for (int chunk = 0; chunk < numChunks; chunk++) {
+    offsets[chunk + 1] += offsets[chunk];
+  }
+  const size_t numComponents = offsets[numChunks];
+  taco_uassert(numComponents <= INT_MAX) <<
+      "Cannot read more than " << INT_MAX << " components";
+
+  // Symmetric matrices have room for each component to be mirrored
+  const size_t capacity = symmetric ? 2 * numComponents : numComponents;
+  vector<int*> coordinates(order);
+  for (int mode = 0; mode < order; mode++) {
+    coordinates[mode] = (int*)malloc(capacity * sizeof(int));
+  }
+  double* values = (double*)malloc(capacity * sizeof(double));
+
+  vector<vector<int>> dimensions(numChunks, vector<int>(order, 0));
+  vector<const char*> malformed(numChunks, nullptr);
+  util::parallelFor(numChunks, numChunks, [&](int chunk, size_t, size_t) {
+    size_t component = offsets[chunk];
+    vector<int>& chunkDimensions = dimensions[chunk];
+    for (const char* cursor = chunks[chunk]; cursor < chunks[chunk + 1];
+         skipLine(cursor, end)) {
+      if (isBlankOrComment(cursor, end)) {
+        continue;
+      }
+      const char* line = cursor;
+      for (int mode = 0; mode < order; mode++) {
+        long coordinate;
+        if (!scanInteger(cursor, end, &coordinate) ||
+            coordinate < 1 || coordinate > INT_MAX) {
+          malformed[chunk] = line;
+          return;
+        }
+        coordinates[mode][component] = (int)coordinate - 1;
+        chunkDimensions[mode] = std::max(chunkDimensions[mode],
+                                         (int)coordinate);
+      }
+      if (!scanReal(cursor, end, &values[component])) {
+        malformed[chunk] = line;
+        return;
+      }
+      component++;
+    }
+  });
+  for (const char* line : malformed) {
+    if (line) {
+      for (int mode = 0; mode < order; mode++) {
+        free(coordinates[mode]);
+      }
+      free(values);
+      taco_uerror << "Malformed component: " << getLine(line, end);
+    }
+  }
+
+  size_t size = numComponents;
+  if (symmetric) {
+    taco_iassert(order == 2);
+    size = mirrorComponents(coordinates[0], coordinates[1], values,
+                            numComponents);
+  }
+
+  TextComponents components;
+  components.dimensions = vector<int>(order, 0);
+  for (const vector<int>& chunkDimensions : dimensions) {
+    for (int mode = 0; mode < order; mode++) {
+      components.dimensions[mode] = std::max(components.dimensions[mode],
+                                             chunkDimensions[mode]);
+    }
+  }
+  for (int mode = 0; mode < order; mode++) {
+    components.coordinates.push_back(Array(Int32, coordinates[mode], size,
+                                           Array::Free));
+  }
+  components.values = Array(Float64, values, size, Array::Free);
+  return components;
+}
+
+size_t mirrorComponents(int* rows, int* columns, double* values,
+                        size_t size) {
+  // Append the mirrored components of each block after those of the
+  // preceding blocks
+  const int numBlocks = util::getNumBlocks(size, minChunkSize);
+  vector<size_t> offsets(numBlocks + 1, size);
+  util::parallelFor(size, numBlocks, [&](int block, size_t begin, size_t end) {
+    size_t count = 0;
+    for (size_t i = begin; i < end; i++) {
+      count += (rows[i] != columns[i]);
+    }
+    offsets[block + 1] = count;
+  });
+  for (int block = 0; block < numBlocks; block++) {
+    offsets[block + 1] += offsets[block];
+  }
+  util::parallelFor(size, numBlocks, [&](int block, size_t begin, size_t end) {
+    size_t mirrored = offsets[block];
+    for (size_t i = begin; i < end; i++) {
+      if (rows[i] != columns[i]) {
+        rows[mirrored] = columns[i];
+        columns[mirrored] = rows[i];
+        values[mirrored] = values[i];
+        mirrored++;
+      }
+    }
+  });
+  return offsets[numBlocks];
+}
+
+size_t countNumbers(const char* begin, const char* end) {
+  size_t count = 0;
+  bool inNumber = false;
+  for (const char* p = begin; p < end; p++) {
+    bool whitespace = isWhitespace(*p);
+    count += (!whitespace && !inNumber);
+    inNumber = !whitespace;
+  }
+  return count;
+}
+
+/// Scan the numbers in [begin, end) in newline-aligned chunks in parallel,
+/// where scan(cursor, end, i) scans the i'th number.
+template <typename Scan>
+static void scanNumbers(const char* begin, const char* end, size_t numValues,
+                        Scan scan) {
+  const int numChunks = util::getNumBlocks(end - begin, minChunkSize);
+  const vector<const char*> chunks = splitLines(begin, end, numChunks);
+
+  vector<size_t> offsets(numChunks + 1, 0);
+  util::parallelFor(numChunks, numChunks, [&](int chunk, size_t, size_t) {
+    offsets[chunk + 1] = countNumbers(chunks[chunk], chunks[chunk + 1]);
+  });
+  for (int chunk = 0; chunk < numChunks; chunk++) {
+    offsets[chunk + 1] += offsets[chunk];
+  }
+  taco_uassert(offsets[numChunks] >= numValues) <<
+      "Expected " << numValues << " numbers but found " << offsets[numChunks];
+
+  vector<const char*> malformed(numChunks, nullptr);
+  util::parallelFor(numChunks, numChunks, [&](int chunk, size_t, size_t) {
+    const char* cursor = chunks[chunk];
+    const size_t chunkEnd = std::min(offsets[chunk + 1], numValues);
+    for (size_t i = offsets[chunk]; i < chunkEnd; i++) {
+      while (isWhitespace(*cursor)) {
+        cursor++;
+      }
+      if (!scan(cursor, chunks[chunk + 1], i)) {
+        malformed[chunk] = cursor;
+        return;
+      }
+    }
+  });
+  for (const char* number : malformed) {
+    if (number) {
+      taco_uerror << "Malformed number: " << getLine(number, end);
+    }
+  }
+}
+
+void scanIntegers(const char* begin, const char* end, int* values,
+                  size_t numValues, int offset) {
+  scanNumbers(begin, end, numValues,
+              [&](const char*& cursor, const char* end, size_t i) {
+    long value;
+    if (!scanInteger(cursor, end, &value) || value > INT_MAX ||
+        value < INT_MIN) {
+      return false;
+    }
+    values[i] = (int)value + offset;
+    return true;
+  });
+}
+
+void scanReals(const char* begin, const char* end, double* values,
+               size_t numValues) {
+  scanNumbers(begin, end, numValues,
+              [&](const char*& cursor, const char* end, size_t i) {
+    return scanReal(cursor, end, &values[i]);
+  });
+}
+
+string readStream(istream& stream) {
+  return string(istreambuf_iterator<char>(stream), istreambuf_iterator<char>());
+}
+
+}
@@ -0,0 +1,73 @@
+#ifndef TACO_STORAGE_TEXT_SCANNER_H
+#define TACO_STORAGE_TEXT_SCANNER_H
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "taco/storage/array.h"
+
+namespace taco {
+
+/// Scanners for the numbers in text tensor files.  They read from a cursor
+/// into the text, advance it past what they read and never read past end, so
+/// that the text (e.g. a memory mapped file) need not be null terminated.
+
+/// Skip spaces, tabs and carriage returns, but not newlines.
+void skipBlanks(const char*& cursor, const char* end);
+
+/// Skip past the next newline.
+void skipLine(const char*& cursor, const char* end);
+
+/// Returns the text from the cursor to the next newline and skips past it.
+std::string getLine(const char*& cursor, const char* end);
+
+/// Scan a decimal integer, after skipping blanks.
+bool scanInteger(const char*& cursor, const char* end, long* value);
+
+/// Scan a floating-point number, after skipping blanks.  Fortran exponents
+/// (1.0D+00) are accepted.  The result is correctly rounded.
+bool scanReal(const char*& cursor, const char* end, double* value);
+
+/// Components scanned from the lines of a coordinate text file.
+struct TextComponents {
+  /// One more than the largest coordinate in each mode.
+  std::vector<int> dimensions;
+
+  /// The 0-based Int32 coordinates of each mode and the Float64 values.  The
+  /// arrays are allocated with malloc and free their data.
+  std::vector<Array> coordinates;
+  Array values;
+};
+
+/// Scan lines of order 1-based coordinates, each followed by a value, from
+/// [begin, end).  Blank lines and comment lines (starting with % or #) are
+/// skipped.  If symmetric is true, every off-diagonal matrix component is
+/// also added with its coordinates swapped.  The text is split into
+/// newline-aligned chunks that are scanned in parallel.
+TextComponents scanComponents(const char* begin, const char* end, int order,
+                              bool symmetric);
+
+/// Append the mirror image of every off-diagonal component of a symmetric
+/// matrix with size components, returning the new number of components.
+/// The arrays must have room for twice as many components.
+size_t mirrorComponents(int* rows, int* columns, double* values, size_t size);
+
+/// Returns the number of whitespace-separated numbers in [begin, end).
+size_t countNumbers(const char* begin, const char* end);
+
+/// Scan the first numValues whitespace-separated integers in [begin, end)
+/// into values, in parallel, adding offset to each.
+void scanIntegers(const char* begin, const char* end, int* values,
+                  size_t numValues, int offset);
+
+/// Scan the first numValues whitespace-separated reals in [begin, end) into
+/// values, in parallel.
+void scanReals(const char* begin, const char* end, double* values,
+               size_t numValues);
+
+/// Returns the remaining contents of a stream.
+std::string readStream(std::istream& stream);
+
+}
+#endif
@@ -46,7 +46,8 @@ taco_tensor_t* init_taco_tensor_t(int32_t order, int32_t csize,
         t->indices[i] = (uint8_t **) alloc_mem(1 * sizeof(uint8_t **));
         break;
       case taco_mode_sparse:
-        t->indices[i] = (uint8_t **) alloc_mem(2 * sizeof(uint8_t **));
+        // Narrow compressed levels store block bases in a third array
+        t->indices[i] = (uint8_t **) alloc_mem(3 * sizeof(uint8_t **));
         break;
     }
   }
@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "taco/target.h"
+#include "taco/util/env.h"
 
 using namespace std;
 
@@ -12,6 +13,16 @@ namespace {
 map<string, Target::Arch> archMap = {{"c99", Target::C99},
                                       {"x86", Target::X86}};
 
+map<string, Target::SIMD> simdMap = {{"none", Target::NoSIMD},
+                                      {"sse4", Target::SSE4},
+                                      {"avx2", Target::AVX2},
+                                      {"avx512", Target::AVX512},
+                                      {"neon", Target::NEON}};
+
+map<string, Target::Parallelism> parallelismMap = {
+                                      {"openmp", Target::OpenMP},
+                                      {"runtime", Target::TaskRuntime}};
+
 map<string, Target::OS> osMap = {{"unknown", Target::OSUnknown},
                                   {"linux", Target::Linux},
                                   {"macos", Target::MacOS},
@@ -75,7 +86,50 @@ bool Target::validateTargetString(const string &s) {
   return (arch_end != string::npos) && (os_end != string::npos);
 }
 
+int Target::getVectorBytes(SIMD simd) {
+  switch (simd) {
+    case NoSIMD:
+      return 0;
+    case SSE4:
+    case NEON:
+      return 16;
+    case AVX2:
+      return 32;
+    case AVX512:
+      return 64;
+  }
+  return 0;
+}
+
+string Target::getSIMDFlags(SIMD simd) {
+  switch (simd) {
+    case SSE4:
+      return "-msse4.2";
+    case AVX2:
+      return "-mavx2 -mfma";
+    case AVX512:
+      return "-mavx512f";
+    case NoSIMD:
+    case NEON:
+      // NEON is part of the baseline of 64-bit ARM
+      return "";
+  }
+  return "";
+}
+
 Target getTargetFromEnvironment() {
-  return Target(Target::Arch::C99, Target::OS::MacOS);
+  Target target(Target::Arch::C99, Target::OS::MacOS);
+  if (util::getFromEnv("TACO_JIT", "system") == "inprocess") {
+    target.jit = Target::InProcess;
+  }
+  string simd = util::getFromEnv("TACO_SIMD", "none");
+  taco_uassert(simdMap.count(simd) > 0) <<
+      "Unknown SIMD instruction set in TACO_SIMD: " << simd;
+  target.simd = simdMap.at(simd);
+  string parallelism = util::getFromEnv("TACO_PARALLELISM", "openmp");
+  taco_uassert(parallelismMap.count(parallelism) > 0) <<
+      "Unknown parallelism model in TACO_PARALLELISM: " << parallelism;
+  target.parallelism = parallelismMap.at(parallelism);
+  return target;
 }
 } // namespace taco
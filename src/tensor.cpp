@@ -9,6 +9,9 @@
 #include <vector>
 #include <utility>
 #include <mutex>
+#include <atomic>
+#include <future>
+#include <thread>
 
 #include "taco/cuda.h"
 #include "taco/format.h"
@@ -20,27 +23,40 @@
 //#include "codegen/codegen_c.h"
 //#include "codegen/codegen_cuda.h"
 //#include "taco/taco_tensor_t.h"
+#include "taco/index_notation/index_notation_rewriter.h"
 #include "taco/index_notation/index_notation_visitor.h"
 #include "taco/index_notation/transformations.h"
 #include "taco/ir/ir.h"
 #include "taco/ir/ir_printer.h"
 #include "taco/lower/lower.h"
+#include "taco/lower/mode_format_hashed.h"
 #include "taco/storage/storage.h"
 #include "taco/storage/index.h"
 #include "taco/storage/array.h"
 #include "taco/storage/pack.h"
+#include "taco/storage/placement.h"
+#include "taco/storage/result_allocator.h"
 #include "taco/storage/file_io_tns.h"
 #include "taco/storage/file_io_mtx.h"
 #include "taco/storage/file_io_rb.h"
+#include "taco/storage/file_io_tbin.h"
 #include "taco/storage/typed_vector.h"
 #include "taco/util/collections.h"
 #include "taco/util/strings.h"
 #include "taco/util/timers.h"
+#include "taco/util/env.h"
+#include "taco/util/thread_pool.h"
+#include "taco/util/parallel.h"
 #include "taco/util/name_generator.h"
 
 #include "codegen/codegen_c.h"
 #include "codegen/codegen_cuda.h"
+#include "codegen/module_cache.h"
 #include "error/error_checks.h"
+#include "storage/row_blocks.h"
+#include "storage/encoded_levels.h"
+#include "storage/hashed_levels.h"
+#include "storage/component_locator.h"
 #include "taco/cuda.h"
 #include "lower/iteration_graph.h"
 
@@ -88,9 +104,14 @@ static Format initFormat(Format format) {
       } else if (modeType.getName() == Sparse.getName()) {
         arrayTypes.push_back(Int32);
         arrayTypes.push_back(Int32);
-      } else if (modeType.getName() == Singleton.getName()) {
+      } else if (modeType.getName() == Singleton.getName() ||
+                 modeType.getName() == Hashed.getName()) {
         arrayTypes.push_back(Int32);
         arrayTypes.push_back(Int32);
+      } else if (modeType.getName() == NarrowCompressed.getName()) {
+        arrayTypes.push_back(Int32);
+        arrayTypes.push_back(UInt16);
+        arrayTypes.push_back(Int32);
       } else {
         taco_not_supported_yet;
       }
@@ -116,7 +137,9 @@ TensorBase::TensorBase(string name, Datatype ctype, vector<int> dimensions,
   for (int i = 0; i < format.getOrder(); ++i) {
     if (format.getModeFormats()[i].getName() == Dense.getName()) {
       const size_t idx = format.getModeOrdering()[i];
-      modeIndices[i] = ModeIndex({makeArray({content->dimensions[idx]})});
+      Array size = makeArray(getFormat().getCoordinateTypePos(i), 1);
+      size.get(0) = content->dimensions[idx];
+      modeIndices[i] = ModeIndex({size});
     }
   }
   content->storage.setIndex(Index(format, modeIndices));
@@ -133,6 +156,8 @@ TensorBase::TensorBase(string name, Datatype ctype, vector<int> dimensions,
   content->coordinateBuffer = shared_ptr<vector<char>>(new vector<char>);
   content->coordinateBufferUsed = 0;
   content->coordinateSize = getOrder()*sizeof(int) + ctype.getNumBytes();
+  content->hasBulkComponents = false;
+  content->bulkComponentsSorted = false;
 }
 
 void TensorBase::setName(std::string name) const {
@@ -190,6 +215,28 @@ size_t TensorBase::getAllocSize() const {
   return content->allocSize;
 }
 
+void TensorBase::setResultAllocator(shared_ptr<ResultAllocator> allocator) {
+  content->resultAllocator = allocator;
+}
+
+shared_ptr<ResultAllocator> TensorBase::getResultAllocator() const {
+  return content->resultAllocator;
+}
+
+void TensorBase::setPlacement(const Placement& placement) {
+  content->storage.setPlacement(placement);
+  content->storage.place();
+  if (placement.getKind() == Placement::Default) {
+    content->resultAllocator = nullptr;
+  } else {
+    content->resultAllocator = make_shared<PlacedAllocator>(placement);
+  }
+}
+
+const Placement& TensorBase::getPlacement() const {
+  return content->storage.getPlacement();
+}
+
 void TensorBase::unsetNeverPacked() {
   content->neverPacked = false;
 }
@@ -234,45 +281,219 @@ void TensorBase::setAssembleWhileCompute(bool assembleWhileCompute) {
   content->assembleWhileCompute = assembleWhileCompute;
 }
 
-static size_t numIntegersToCompare = 0;
-static int lexicographicalCmp(const void* a, const void* b) {
-  for (size_t i = 0; i < numIntegersToCompare; i++) {
-    int diff = ((int*)a)[i] - ((int*)b)[i];
-    if (diff != 0) {
-      return diff;
+// Minimum number of coordinates handled by each thread when packing
+static const size_t packBlockSize = 1 << 16;
+
+/// Stable least-significant-digit radix sort of (key, index) pairs, one byte of
+/// the keys at a time.  Only the low numBits bits of the keys are compared.
+/// Each block of the input is histogrammed and scattered by its own thread.
+template <typename Index>
+static void radixSort(vector<uint64_t>& keys, vector<Index>& indices,
+                      int numBits) {
+  const size_t size = keys.size();
+  const int numBlocks = util::getNumBlocks(size, packBlockSize);
+  const int radix = 256;
+  vector<uint64_t> keysTmp(size);
+  vector<Index> indicesTmp(size);
+  vector<size_t> offsets(numBlocks * radix);
+
+  for (int shift = 0; shift < numBits; shift += 8) {
+    std::fill(offsets.begin(), offsets.end(), 0);
+    util::parallelFor(size, numBlocks, [&](int block, size_t begin, size_t end) {
+      size_t* counts = &offsets[block * radix];
+      for (size_t i = begin; i < end; i++) {
+        counts[(keys[i] >> shift) & (radix - 1)]++;
+      }
+    });
+
+    // Exclusive prefix sum in digit-major order, so that each block scatters
+    // its elements after those of the preceding blocks with the same digit.
+    size_t offset = 0;
+    bool allSame = false;
+    for (int digit = 0; digit < radix; digit++) {
+      size_t digitCount = 0;
+      for (int block = 0; block < numBlocks; block++) {
+        size_t count = offsets[block * radix + digit];
+        offsets[block * radix + digit] = offset;
+        offset += count;
+        digitCount += count;
+      }
+      allSame |= (digitCount == size);
+    }
+    if (allSame) {
+      continue;
+    }
+
+    util::parallelFor(size, numBlocks, [&](int block, size_t begin, size_t end) {
+      size_t* positions = &offsets[block * radix];
+      for (size_t i = begin; i < end; i++) {
+        size_t position = positions[(keys[i] >> shift) & (radix - 1)]++;
+        keysTmp[position] = keys[i];
+        indicesTmp[position] = indices[i];
+      }
+    });
+    keys.swap(keysTmp);
+    indices.swap(indicesTmp);
+  }
+}
+
+/// Returns the order in which to visit coordinates so that they are sorted
+/// lexicographically by the modes given in permutation, where
+/// coordinate(i, mode) returns the coordinate of the i'th component.
+/// Adjacent modes are concatenated into 64-bit keys (using as many bits as
+/// their dimensions require), and the keys are radix sorted from the least to
+/// the most significant, relying on the stability of the sort.
+template <typename Index, typename Coordinates>
+static vector<Index> sortCoordinates(Coordinates coordinate,
+                                     size_t numCoordinates,
+                                     const vector<int>& permutation,
+                                     const vector<int>& dimensions) {
+  const int order = (int)permutation.size();
+  const int numBlocks = util::getNumBlocks(numCoordinates, packBlockSize);
+
+  vector<int> modeBits(order);
+  for (int i = 0; i < order; i++) {
+    int dimension = dimensions[permutation[i]];
+    while (modeBits[i] < 31 && (1 << modeBits[i]) < dimension) {
+      modeBits[i]++;
+    }
+  }
+
+  vector<Index> indices(numCoordinates);
+  util::parallelFor(numCoordinates, numBlocks,
+                    [&](int block, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      indices[i] = (Index)i;
+    }
+  });
+
+  vector<uint64_t> keys(numCoordinates);
+  int last = order;
+  while (last > 0) {
+    // Group the modes [first, last) into one key
+    int first = last;
+    int numBits = 0;
+    while (first > 0 && numBits + modeBits[first-1] <= 64) {
+      first--;
+      numBits += modeBits[first];
+    }
+
+    std::atomic<bool> sorted(true);
+    util::parallelFor(numCoordinates, numBlocks,
+                      [&](int block, size_t begin, size_t end) {
+      bool blockSorted = true;
+      for (size_t i = begin; i < end; i++) {
+        uint64_t key = 0;
+        for (int j = first; j < last; j++) {
+          key = (key << modeBits[j]) |
+                (uint32_t)coordinate(indices[i], permutation[j]);
+        }
+        keys[i] = key;
+        blockSorted &= (i == begin || keys[i-1] <= key);
+      }
+      if (!blockSorted) {
+        sorted = false;
+      }
+    });
+    for (int block = 1; sorted && block < numBlocks; block++) {
+      size_t begin = util::getBlockBegin(numCoordinates, numBlocks, block);
+      if (begin > 0 && begin < numCoordinates && keys[begin-1] > keys[begin]) {
+        sorted = false;
+      }
+    }
+
+    // Keys that are already in order (e.g. when coordinates are inserted in
+    // order by file readers) need not be sorted, since the sort is stable.
+    if (!sorted) {
+      radixSort(keys, indices, numBits);
     }
+    last = first;
+  }
+  return indices;
+}
+
+/// Call f with the order returned by sortCoordinates, which holds 32-bit
+/// indices unless there are too many coordinates for them.
+template <typename Coordinates, typename F>
+static void withSortedCoordinates(Coordinates coordinate, size_t numCoordinates,
+                                  const vector<int>& permutation,
+                                  const vector<int>& dimensions, F f) {
+  if (numCoordinates <= UINT32_MAX) {
+    f(sortCoordinates<uint32_t>(coordinate, numCoordinates, permutation,
+                                dimensions));
+  } else {
+    f(sortCoordinates<uint64_t>(coordinate, numCoordinates, permutation,
+                                dimensions));
   }
-  return 0;
 }
 
 static size_t unpackTensorData(const taco_tensor_t& tensorData,
-                               const TensorBase& tensor) {
+                               const TensorBase& tensor,
+                               shared_ptr<ResultAllocator> allocator=nullptr) {
   auto storage = tensor.getStorage();
   auto format = storage.getFormat();
 
+  // Arrays allocated by a result allocator are returned to it when freed
+  auto makeResultArray = [&](Datatype type, void* data, size_t size,
+                             Array::Policy policy) {
+    if (!allocator) {
+      return Array(type, data, size, policy);
+    }
+    return Array(type, data, size, shared_ptr<void>(data, [allocator](void* data) {
+      allocator->deallocate(data);
+    }));
+  };
+
   vector<ModeIndex> modeIndices;
   size_t numVals = 1;
   for (int i = 0; i < tensor.getOrder(); i++) {
     ModeFormat modeType = format.getModeFormats()[i];
+    Datatype posType = format.getCoordinateTypePos(i);
+    Datatype crdType = format.getCoordinateTypeIdx(i);
     if (modeType.getName() == Dense.getName()) {
-      Array size = makeArray({*(int*)tensorData.indices[i][0]});
-      modeIndices.push_back(ModeIndex({size}));
-      numVals *= ((int*)tensorData.indices[i][0])[0];
+      size_t size = Array(posType, tensorData.indices[i][0], 1,
+                          Array::UserOwns).get(0).getAsIndex();
+      Array sizeArray = makeArray(posType, 1);
+      memcpy(sizeArray.getData(), tensorData.indices[i][0],
+             posType.getNumBytes());
+      modeIndices.push_back(ModeIndex({sizeArray}));
+      numVals *= size;
     } else if (modeType.getName() == Sparse.getName()) {
-      auto size = ((int*)tensorData.indices[i][0])[numVals];
-      Array pos = Array(type<int>(), tensorData.indices[i][0], numVals+1, Array::UserOwns);
-      Array idx = Array(type<int>(), tensorData.indices[i][1], size, Array::UserOwns);
+      Array pos = makeResultArray(posType, tensorData.indices[i][0], numVals+1, Array::UserOwns);
+      size_t size = pos.get(numVals).getAsIndex();
+      Array idx = makeResultArray(crdType, tensorData.indices[i][1], size, Array::UserOwns);
       modeIndices.push_back(ModeIndex({pos, idx}));
       numVals = size;
     } else if (modeType.getName() == Singleton.getName()) {
-      Array idx = Array(type<int>(), tensorData.indices[i][1], numVals, Array::UserOwns);
-      modeIndices.push_back(ModeIndex({makeArray(type<int>(), 0), idx}));
+      Array idx = makeResultArray(crdType, tensorData.indices[i][1], numVals, Array::UserOwns);
+      modeIndices.push_back(ModeIndex({makeArray(posType, 0), idx}));
+    } else if (modeType.getName() == Hashed.getName()) {
+      const int width = dynamic_pointer_cast<const HashedModeFormat>(
+          modeType.getImpl())->width;
+      size_t size = numVals * width;
+      Array idx = makeResultArray(crdType, tensorData.indices[i][1], size, Array::UserOwns);
+      if (hasFullSegment(idx, width)) {
+        taco_uerror << "A segment of hashed level " << i << " of "
+                    << tensor.getName() << " needs more than the " << width
+                    << " buckets of the level";
+      }
+      modeIndices.push_back(ModeIndex({makeArray(posType, 0), idx}));
+      numVals = size;
+    } else if (modeType.getName() == NarrowCompressed.getName()) {
+      // Narrow compressed levels are packed as compressed levels with Int32
+      // coordinates (see getPackFormat), which are narrowed here.
+      Array pos = makeResultArray(posType, tensorData.indices[i][0], numVals+1, Array::UserOwns);
+      size_t size = pos.get(numVals).getAsIndex();
+      Array idx = Array(Int32, tensorData.indices[i][1], size, Array::Free);
+      modeIndices.push_back(narrowCoordinates(ModeIndex({pos, idx}), crdType));
+      numVals = size;
     } else {
       taco_not_supported_yet;
     }
   }
   storage.setIndex(Index(format, modeIndices));
-  storage.setValues(Array(tensor.getComponentType(), tensorData.vals, numVals));
+  storage.setValues(makeResultArray(tensor.getComponentType(), tensorData.vals,
+                                    numVals, Array::Free));
   return numVals;
 }
 
@@ -343,8 +564,17 @@ void TensorBase::pack() {
   const int csize = getComponentType().getNumBytes();
   const std::vector<int>& dimensions = getDimensions();
 
+  // Bulk inserted components are packed straight from their arrays, unless
+  // there are also components in the insertion buffer.
+  if (content->hasBulkComponents &&
+      (content->coordinateBufferUsed > 0 || order == 0)) {
+    flushBulkComponents();
+  }
+
   taco_iassert((content->coordinateBufferUsed % content->coordinateSize) == 0);
-  const size_t numCoordinates = content->coordinateBufferUsed / content->coordinateSize;
+  const size_t numCoordinates = content->hasBulkComponents
+      ? content->bulkValues.getSize()
+      : content->coordinateBufferUsed / content->coordinateSize;
 
   const auto helperFuncs = getHelperFunctions(getFormat(), getComponentType(),
                                               dimensions);
@@ -366,7 +596,7 @@ void TensorBase::pack() {
     bufferStorage->vals = (uint8_t*)content->coordinateBuffer->data();
 
     std::vector<void*> arguments = {content->storage, bufferStorage};
-    helperFuncs->callFuncPacked("pack", arguments.data());
+    helperFuncs->callFuncPacked("pack", arguments);
     content->valuesSize = unpackTensorData(*((taco_tensor_t*)arguments[0]), *this);
 
     deinit_taco_tensor_t(bufferStorage);
@@ -384,64 +614,221 @@ void TensorBase::pack() {
     permutedDimensions[i] = dimensions[permutation[i]];
   }
 
-  const size_t coordSize = content->coordinateSize;
-  char* coordinatesPtr = content->coordinateBuffer->data();
-  vector<int> permuteBuffer(order);
-  for (size_t i = 0; i < numCoordinates; ++i) {
-    int* coordinate = (int*)coordinatesPtr;
-    for (int j = 0; j < order; j++) {
-      permuteBuffer[j] = coordinate[permutation[j]];
-    }
-    for (int j = 0; j < order; j++) {
-      coordinate[j] = permuteBuffer[j];
-    }
-    coordinatesPtr += content->coordinateSize;
-  }
-  coordinatesPtr = content->coordinateBuffer->data();
-
   // The pack code expects the coordinates to be sorted
-  numIntegersToCompare = order;
-  qsort(coordinatesPtr, numCoordinates, coordSize, lexicographicalCmp);
-
-
-  // Move coords into separate arrays
+  const Datatype indexType = getFormat().getIndexType();
+  taco_uassert(indexType == Int64 || numCoordinates <= (size_t)INT_MAX) <<
+      "Cannot pack more than " << INT_MAX << " components into a format " <<
+      "with " << Int32 << " indices";
   std::vector<std::vector<int>> coordinates(order);
-  for (int i = 0; i < order; ++i) {
-    coordinates[i] = std::vector<int>(numCoordinates);
-  }
-  char* values = (char*) malloc(numCoordinates * csize);
-  for (size_t i = 0; i < numCoordinates; ++i) {
-    int* coordLoc = (int*)&coordinatesPtr[i * coordSize];
+  std::vector<const int*> coordinatesPtrs(order);
+  char* values = nullptr;
+  const char* valuesPtr = nullptr;
+  const int numBlocks = util::getNumBlocks(numCoordinates, packBlockSize);
+  if (content->hasBulkComponents && content->bulkComponentsSorted) {
+    for (int d = 0; d < order; ++d) {
+      coordinatesPtrs[d] =
+          (const int*)content->bulkCoordinates[permutation[d]].getData();
+    }
+    valuesPtr = (const char*)content->bulkValues.getData();
+  } else {
     for (int d = 0; d < order; ++d) {
-      coordinates[d][i] = *coordLoc;
-      coordLoc++;
+      coordinates[d] = std::vector<int>(numCoordinates);
+      coordinatesPtrs[d] = coordinates[d].data();
+    }
+    values = (char*) malloc(numCoordinates * csize);
+    valuesPtr = values;
+
+    // Permute and move coords into separate arrays, in sorted order
+    if (content->hasBulkComponents) {
+      std::vector<const int*> bulkCoordinates(order);
+      for (int d = 0; d < order; ++d) {
+        bulkCoordinates[d] = (const int*)content->bulkCoordinates[d].getData();
+      }
+      const char* bulkValues = (const char*)content->bulkValues.getData();
+      withSortedCoordinates(
+          [&](size_t i, int mode) { return bulkCoordinates[mode][i]; },
+          numCoordinates, permutation, dimensions,
+          [&](const auto& sortedOrder) {
+        util::parallelFor(numCoordinates, numBlocks,
+                          [&](int block, size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) {
+            const size_t component = sortedOrder[i];
+            for (int d = 0; d < order; ++d) {
+              coordinates[d][i] = bulkCoordinates[permutation[d]][component];
+            }
+            memcpy(&values[i * csize], &bulkValues[component * csize], csize);
+          }
+        });
+      });
+    } else {
+      const size_t coordSize = content->coordinateSize;
+      const char* coordinatesPtr = content->coordinateBuffer->data();
+      const size_t valuesOffset = order * sizeof(int);
+      withSortedCoordinates(
+          [&](size_t i, int mode) {
+            return ((const int*)&coordinatesPtr[i * coordSize])[mode];
+          }, numCoordinates, permutation, dimensions,
+          [&](const auto& sortedOrder) {
+        util::parallelFor(numCoordinates, numBlocks,
+                          [&](int block, size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) {
+            const char* coordLoc =
+                &coordinatesPtr[(size_t)sortedOrder[i] * coordSize];
+            for (int d = 0; d < order; ++d) {
+              coordinates[d][i] = ((const int*)coordLoc)[permutation[d]];
+            }
+            memcpy(&values[i * csize], coordLoc + valuesOffset, csize);
+          }
+        });
+      });
     }
-    memcpy(&values[i * csize], coordLoc, csize);
   }
 
-
   content->coordinateBuffer->clear();
   content->coordinateBufferUsed = 0;
 
-
   std::vector<taco_mode_t> bufferModeTypes(order, taco_mode_sparse);
   taco_tensor_t* bufferStorage = init_taco_tensor_t(order, csize,
       (int32_t*)dimensions.data(), (int32_t*)permutation.data(),
       (taco_mode_t*)bufferModeTypes.data());
-  std::vector<int> pos = {0, (int)numCoordinates};
-  bufferStorage->indices[0][0] = (uint8_t*)pos.data();
+  // The buffer's positions have the same type as the positions of the format
+  std::vector<int64_t> pos = {0, (int64_t)numCoordinates};
+  std::vector<int32_t> pos32 = {0, (int32_t)numCoordinates};
+  bufferStorage->indices[0][0] = (indexType == Int64) ? (uint8_t*)pos.data()
+                                                      : (uint8_t*)pos32.data();
   for (int i = 0; i < order; ++i) {
-    bufferStorage->indices[i][1] = (uint8_t*)coordinates[i].data();
+    bufferStorage->indices[i][1] = (uint8_t*)coordinatesPtrs[i];
   }
-  bufferStorage->vals = (uint8_t*)values;
+  bufferStorage->vals = (uint8_t*)valuesPtr;
 
   // Pack nonzero components into required format
   std::vector<void*> arguments = {content->storage, bufferStorage};
-  helperFuncs->callFuncPacked("pack", arguments.data());
+  helperFuncs->callFuncPacked("pack", arguments);
   content->valuesSize = unpackTensorData(*((taco_tensor_t*)arguments[0]), *this);
+  content->storage.place();
 
   free(values);
   deinit_taco_tensor_t(bufferStorage);
+  content->hasBulkComponents = false;
+  content->bulkCoordinates.clear();
+  content->bulkValues = Array();
+}
+
+void TensorBase::insertCOO(const std::vector<Array>& coordinates, Array values,
+                           bool sorted) {
+  taco_uassert(coordinates.size() == (size_t)getOrder()) <<
+      "Wrong number of coordinate arrays";
+  taco_uassert(values.getType() == getComponentType()) <<
+      "Cannot insert values of type '" << values.getType() << "' " <<
+      "into a tensor with component type " << getComponentType();
+  for (const Array& modeCoordinates : coordinates) {
+    taco_uassert(modeCoordinates.getType() == Int32) <<
+        "Coordinates must be of type " << Int32;
+    taco_uassert(modeCoordinates.getSize() == values.getSize()) <<
+        "There must be as many coordinates in each mode as values";
+  }
+  syncDependentTensors();
+  if (content->hasBulkComponents) {
+    flushBulkComponents();
+  }
+  content->hasBulkComponents = true;
+  content->bulkComponentsSorted = sorted;
+  content->bulkCoordinates = coordinates;
+  content->bulkValues = values;
+  setNeedsPack(true);
+}
+
+/// Set the row of each component of a CSR matrix with the given positions.
+template <typename Position>
+static void expandRows(const Position* pos, size_t numRows, int* rows) {
+  util::parallelFor(numRows, util::getNumBlocks(pos[numRows], packBlockSize),
+                    [&](int block, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      std::fill(rows + pos[i], rows + pos[i+1], (int)i);
+    }
+  });
+}
+
+/// Returns the first row whose positions are not in [0, nnz] or are
+/// decreasing, or numRows if the positions are valid.
+template <typename Position>
+static size_t findInvalidRow(const Position* pos, size_t numRows,
+                             size_t nnz) {
+  if (pos[0] != 0) {
+    return 0;
+  }
+  for (size_t i = 0; i < numRows; ++i) {
+    if (pos[i+1] < pos[i] || (size_t)pos[i+1] > nnz) {
+      return i;
+    }
+  }
+  return numRows;
+}
+
+void TensorBase::insertCSR(Array pos, Array crd, Array values, bool sorted) {
+  taco_uassert(getOrder() == 2) << "Only matrices can be inserted in CSR form";
+  taco_uassert(pos.getType() == Int32 || pos.getType() == Int64) <<
+      "Positions must be of type " << Int32 << " or " << Int64;
+  taco_uassert(pos.getSize() == (size_t)getDimension(0) + 1) <<
+      "There must be one more position than rows";
+
+  const size_t numRows = getDimension(0);
+  const size_t invalidRow = (pos.getType() == Int64)
+      ? findInvalidRow((const int64_t*)pos.getData(), numRows, crd.getSize())
+      : findInvalidRow((const int32_t*)pos.getData(), numRows, crd.getSize());
+  if (invalidRow < numRows) {
+    taco_uerror << "The positions of row " << invalidRow << " are not "
+                << "nondecreasing in [0, " << crd.getSize() << "]";
+  }
+  if ((size_t)pos.get(numRows).getAsIndex() != crd.getSize()) {
+    taco_uerror << "The last position must be the number of components";
+  }
+  int* rows = (int*)malloc(crd.getSize() * sizeof(int));
+  if (pos.getType() == Int64) {
+    expandRows((const int64_t*)pos.getData(), numRows, rows);
+  } else {
+    expandRows((const int32_t*)pos.getData(), numRows, rows);
+  }
+
+  // Rows are sorted, so the components are sorted if columns are sorted
+  // within each row and the matrix is stored row-major.
+  insertCOO({Array(Int32, rows, crd.getSize(), Array::Free), crd}, values,
+            sorted && getFormat().getModeOrdering()[0] == 0);
+}
+
+void TensorBase::flushBulkComponents() {
+  taco_iassert(content->hasBulkComponents);
+  const int order = getOrder();
+  const size_t csize = getComponentType().getNumBytes();
+  const size_t coordSize = content->coordinateSize;
+  const size_t numComponents = content->bulkValues.getSize();
+
+  const size_t offset = content->coordinateBufferUsed;
+  if (content->coordinateBuffer->size() < offset + numComponents * coordSize) {
+    content->coordinateBuffer->resize(offset + numComponents * coordSize);
+  }
+  char* buffer = content->coordinateBuffer->data() + offset;
+  std::vector<const int*> coordinates(order);
+  for (int d = 0; d < order; ++d) {
+    coordinates[d] = (const int*)content->bulkCoordinates[d].getData();
+  }
+  const char* values = (const char*)content->bulkValues.getData();
+  util::parallelFor(numComponents,
+                    util::getNumBlocks(numComponents, packBlockSize),
+                    [&](int block, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      int* coordLoc = (int*)&buffer[i * coordSize];
+      for (int d = 0; d < order; ++d) {
+        coordLoc[d] = coordinates[d][i];
+      }
+      memcpy(coordLoc + order, &values[i * csize], csize);
+    }
+  });
+  content->coordinateBufferUsed += numComponents * coordSize;
+
+  content->hasBulkComponents = false;
+  content->bulkCoordinates.clear();
+  content->bulkValues = Array();
 }
 
 void TensorBase::setStorage(TensorStorage storage) {
@@ -559,32 +946,24 @@ const Access TensorBase::operator()() const {
   return this->operator()(std::vector<IndexVar>());
 }
 
-TensorBase::KernelsCache TensorBase::computeKernels;
-std::mutex TensorBase::computeKernelsMutex;
+static ModuleCache<IndexStmt> computeKernels(
+    [](const IndexStmt& a, const IndexStmt& b) { return isomorphic(a, b); });
 
-std::shared_ptr<Module> TensorBase::getComputeKernel(const IndexStmt stmt) {
-  computeKernelsMutex.lock();
-  const auto computeKernelsReverse =
-      util::ReverseConstIterable<TensorBase::KernelsCache>(computeKernels);
-  for (const auto& computeKernel : computeKernelsReverse) {
-    if (isomorphic(stmt, computeKernel.first)) {
-      const auto kernelModule = computeKernel.second;
-      computeKernelsMutex.unlock();
-      return kernelModule;
-    }
-  }
-  computeKernelsMutex.unlock();
-  return nullptr;
+std::shared_ptr<Module> TensorBase::getComputeKernel(const IndexStmt stmt,
+                                                     size_t hash) {
+  return computeKernels.get(hash, stmt);
 }
 
-void TensorBase::cacheComputeKernel(const IndexStmt stmt,
+void TensorBase::cacheComputeKernel(const IndexStmt stmt, size_t hash,
                                     const std::shared_ptr<Module> kernel) {
-  computeKernelsMutex.lock();
-  computeKernels.emplace_back(stmt, kernel);
-  computeKernelsMutex.unlock();
+  computeKernels.insert(hash, stmt, kernel, taco_get_kernel_cache_capacity());
 }
 
 void TensorBase::compile() {
+  compile(makeCompileStmt(), content->assembleWhileCompute);
+}
+
+IndexStmt TensorBase::makeCompileStmt() {
   Assignment assignment = getAssignment();
   taco_uassert(assignment.defined())
       << error::compile_without_expr;
@@ -620,54 +999,228 @@ void TensorBase::compile() {
   stmt = reorderLoopsTopologically(stmt);
   stmt = insertTemporaries(stmt);
   stmt = parallelizeOuterLoop(stmt);
-  compile(stmt, content->assembleWhileCompute);
+  return stmt;
 }
+
 void TensorBase::compile(taco::IndexStmt stmt, bool assembleWhileCompute) {
   if (!needsCompile()) {
     return;
   }
+  waitForCompile();
+  setNeedsCompile(false);
+  compileStmt(stmt, assembleWhileCompute);
+}
+
+static util::ThreadPool& getCompileThreadPool() {
+  static util::ThreadPool pool(std::stoi(util::getFromEnv("TACO_COMPILE_THREADS",
+      std::to_string(std::thread::hardware_concurrency()))));
+  return pool;
+}
+
+std::shared_future<void> TensorBase::compileAsync() {
+  if (!needsCompile()) {
+    if (content->pendingCompile.valid()) {
+      return content->pendingCompile;
+    }
+    std::promise<void> compiled;
+    compiled.set_value();
+    return compiled.get_future().share();
+  }
+  IndexStmt stmt = makeCompileStmt();
+  waitForCompile();
   setNeedsCompile(false);
 
+  // The content owns the future of the task, so the task only holds a weak
+  // reference to it; compiling for a tensor that was destroyed is skipped.
+  std::weak_ptr<Content> weakContent = content;
+  const bool assembleWhileCompute = content->assembleWhileCompute;
+  content->pendingCompile = getCompileThreadPool().submit([=]() {
+    TensorBase tensor;
+    tensor.content = weakContent.lock();
+    if (tensor.content) {
+      tensor.compileStmt(stmt, assembleWhileCompute);
+    }
+  }).share();
+  return content->pendingCompile;
+}
+
+void TensorBase::waitForCompile() const {
+  if (content->pendingCompile.valid()) {
+    // Rethrows any error raised while compiling
+    content->pendingCompile.get();
+    content->pendingCompile = std::shared_future<void>();
+  }
+}
+
+void TensorBase::compileStmt(IndexStmt stmt, bool assembleWhileCompute) {
   IndexStmt concretizedAssign = stmt;
   IndexStmt stmtToCompile = stmt.concretize();
   stmtToCompile = scalarPromote(stmtToCompile);
+  content->computeStmt = stmtToCompile;
+
+  // If we have to recompile the kernel, we need to create a new Module. Since
+  // the module we are holding on to could have been retrieved from the cache,
+  // we can't modify it.
+  content->module = make_shared<Module>();
 
-  if (!std::getenv("CACHE_KERNELS") ||
-      std::string(std::getenv("CACHE_KERNELS")) != "0") {
+  // Isomorphic statements have the same canonical form, so hashing it gives
+  // the in-memory cache buckets that only isomorphic() has to search.  The
+  // target is hashed too, since kernels of different targets have different
+  // calling conventions.
+  const bool cacheKernels = !std::getenv("CACHE_KERNELS") ||
+      std::string(std::getenv("CACHE_KERNELS")) != "0";
+  size_t hash = 0;
+  if (cacheKernels) {
     concretizedAssign = stmtToCompile;
-    const auto cachedKernel = getComputeKernel(concretizedAssign);
+    const std::string canonicalForm = canonicalize(concretizedAssign);
+    const Target& target = content->module->getTarget();
+    hash = std::hash<std::string>()(canonicalForm + " simd " +
+        util::toString(target.simd) + " parallelism " +
+        util::toString(target.parallelism));
+    const auto cachedKernel = getComputeKernel(concretizedAssign, hash);
     if (cachedKernel) {
       content->module = cachedKernel;
       return;
     }
+
+    // Look for a kernel compiled by an earlier process in the on-disk cache.
+    content->module->setCacheKey(canonicalForm +
+        (assembleWhileCompute ? " assembleWhileCompute" : ""));
+    if (content->module->loadFromCache()) {
+      cacheComputeKernel(concretizedAssign, hash, content->module);
+      return;
+    }
   }
 
   content->assembleFunc = lower(stmtToCompile, "assemble", true, false);
   content->computeFunc = lower(stmtToCompile, "compute",  assembleWhileCompute, true);
-  // If we have to recompile the kernel, we need to create a new Module. Since
-  // the module we are holding on to could have been retrieved from the cache,
-  // we can't modify it.
-  content->module = make_shared<Module>();
   content->module->addFunction(content->assembleFunc);
   content->module->addFunction(content->computeFunc);
   content->module->compile();
-  cacheComputeKernel(concretizedAssign, content->module);
+  cacheComputeKernel(concretizedAssign, hash, content->module);
 }
 
 taco_tensor_t* TensorBase::getTacoTensorT() {
   return getStorage();
 }
 
+/// Set while tensors compute the expressions of a DAG, which they then do
+/// one at a time
+static thread_local bool evaluatingDag = false;
+
 void TensorBase::syncValues() {
   if (content->needsPack) {
     pack();
   } else if (content->needsCompute) {
+    if (taco_get_lazy_dag() && !evaluatingDag) {
+      evaluateDag();
+      return;
+    }
     compile();
     assemble();
     compute();
   }
 }
 
+TensorBase TensorBase::compressHashedLevels() {
+  syncValues();
+  const Format& format = getFormat();
+  const TensorStorage& storage = getStorage();
+  TensorBase result(getComponentType(), getDimensions(),
+                    getCompressedFormat(format));
+
+  vector<ModeIndex> modeIndices;
+  Array vals = storage.getValues();
+  for (int i = 0; i < getOrder(); i++) {
+    const ModeFormat modeType = format.getModeFormats()[i];
+    const ModeIndex& modeIndex = storage.getIndex().getModeIndex(i);
+    if (modeType.getName() != Hashed.getName()) {
+      modeIndices.push_back(modeIndex);
+      continue;
+    }
+    taco_uassert(i == getOrder() - 1) <<
+        "Only hashed levels that are the last level can be compressed";
+    const int width = dynamic_pointer_cast<const HashedModeFormat>(
+        modeType.getImpl())->width;
+    modeIndices.push_back(compressBuckets(modeIndex, vals, width,
+                                          format.getCoordinateTypePos(i)));
+  }
+  TensorStorage resultStorage = result.getStorage();
+  resultStorage.setIndex(Index(result.getFormat(), modeIndices));
+  resultStorage.setValues(vals);
+  result.setStorage(resultStorage);
+  result.unsetNeverPacked();
+  return result;
+}
+
+ptrdiff_t TensorBase::locate(const vector<int>& coordinate) {
+  const TensorStorage& storage = getStorage();
+  if (storage.getValues().getData() == nullptr) {
+    return -1;
+  }
+  // The locator is kept for the next lookup, which can then reuse the part of
+  // the path to this component that leads to both
+  if (content->locator == nullptr ||
+      content->locatorVersion != storage.getVersion()) {
+    content->locator = make_shared<ComponentLocator>(storage);
+    content->locatorVersion = storage.getVersion();
+  }
+  return content->locator->locate(coordinate.data());
+}
+
+Array TensorBase::gather(const vector<Array>& coordinates) {
+  const int order = getOrder();
+  taco_uassert(coordinates.size() == (size_t)order) <<
+      "Wrong number of coordinate arrays";
+  const size_t numCoordinates = (order > 0) ? coordinates[0].getSize() : 1;
+  for (const Array& modeCoordinates : coordinates) {
+    taco_uassert(modeCoordinates.getType() == Int32) <<
+        "Coordinates must be Int32 arrays";
+    taco_uassert(modeCoordinates.getSize() == numCoordinates) <<
+        "Every mode must have the same number of coordinates";
+  }
+  syncValues();
+
+  const Datatype componentType = getComponentType();
+  const size_t numBytes = componentType.getNumBytes();
+  Array result = makeArray(componentType, numCoordinates);
+  result.zero();
+  const TensorStorage& storage = getStorage();
+  const char* values = (const char*)storage.getValues().getData();
+  if (values == nullptr || numCoordinates == 0) {
+    return result;
+  }
+
+  vector<const int*> modeCoordinates(order);
+  for (int mode = 0; mode < order; mode++) {
+    modeCoordinates[mode] = (const int*)coordinates[mode].getData();
+  }
+  char* resultValues = (char*)result.getData();
+  const int numBlocks = util::getNumBlocks(numCoordinates, packBlockSize);
+  withSortedCoordinates(
+      [&](size_t i, int mode) { return modeCoordinates[mode][i]; },
+      numCoordinates, getFormat().getModeOrdering(), getDimensions(),
+      [&](const auto& sortedOrder) {
+    util::parallelFor(numCoordinates, numBlocks,
+                      [&](int block, size_t begin, size_t end) {
+      ComponentLocator locator(storage);
+      vector<int> coordinate(order);
+      for (size_t i = begin; i < end; i++) {
+        const size_t index = sortedOrder[i];
+        for (int mode = 0; mode < order; mode++) {
+          coordinate[mode] = modeCoordinates[mode][index];
+        }
+        ptrdiff_t position = locator.locate(coordinate.data());
+        if (position >= 0) {
+          memcpy(resultValues + index * numBytes,
+                 values + position * numBytes, numBytes);
+        }
+      }
+    });
+  });
+  return result;
+}
+
 void TensorBase::addDependentTensor(TensorBase& tensor) {
   content->dependentTensors.push_back(tensor.content);
 }
@@ -751,12 +1304,13 @@ static inline map<TensorVar, TensorBase> getTensors(const IndexExpr& expr) {
   return getOperands.arguments;
 }
 
+/// Returns the tensors passed to the tensor's kernels, in argument order.
 static inline
-vector<void*> packArguments(const TensorBase& tensor) {
-  vector<void*> arguments;
+vector<TensorBase> getArgumentTensors(const TensorBase& tensor) {
+  vector<TensorBase> arguments;
 
   // Pack the result tensor
-  arguments.push_back(tensor.getStorage());
+  arguments.push_back(tensor);
 
   // Pack any index sets on the result tensor at the front of the arguments list.
   auto lhs = getNode(tensor.getAssignment().getLhs());
@@ -765,7 +1319,7 @@ vector<void*> packArguments(const TensorBase& tensor) {
   if (isa<AccessNode>(lhs)) {
     auto indexSetModes = to<AccessNode>(lhs)->indexSetModes;
     for (auto& it : indexSetModes) {
-      arguments.push_back(it.second.tensor.getStorage());
+      arguments.push_back(it.second.tensor);
     }
   }
 
@@ -775,17 +1329,35 @@ vector<void*> packArguments(const TensorBase& tensor) {
   auto tensors = getTensors(tensor.getAssignment().getRhs());
   for (auto& operand : operands) {
     taco_iassert(util::contains(tensors, operand));
-    arguments.push_back(tensors.at(operand).getStorage());
+    arguments.push_back(tensors.at(operand));
   }
 
   return arguments;
 }
 
+static inline
+vector<void*> packArguments(const TensorBase& tensor) {
+  vector<void*> arguments;
+  for (auto& argument : getArgumentTensors(tensor)) {
+    arguments.push_back(argument.getStorage());
+  }
+  return arguments;
+}
+
 void TensorBase::assemble() {
+  assemble(nullptr);
+}
+
+void TensorBase::assemble(const ExecutionContext& context) {
+  assemble(&context);
+}
+
+void TensorBase::assemble(const ExecutionContext* context) {
   taco_uassert(!needsCompile()) << error::assemble_without_compile;
   if (!needsAssemble()) {
     return;
   }
+  waitForCompile();
   // Sync operand tensors if needed.
   auto operands = getTensors(getAssignment().getRhs());
   for (auto& operand : operands) {
@@ -793,20 +1365,32 @@ void TensorBase::assemble() {
   }
 
   auto arguments = packArguments(*this);
-  content->module->callFuncPacked("assemble", arguments.data());
+  callKernel([&]() {
+    return content->module->callFuncPacked("assemble", arguments, context);
+  }, !content->assembleWhileCompute);
 
   if (!content->assembleWhileCompute) {
     setNeedsAssemble(false);
     taco_tensor_t* tensorData = ((taco_tensor_t*)arguments[0]);
-    content->valuesSize = unpackTensorData(*tensorData, *this);
+    content->valuesSize = unpackTensorData(*tensorData, *this,
+                                           content->resultAllocator);
   }
 }
 
 void TensorBase::compute() {
+  compute(nullptr);
+}
+
+void TensorBase::compute(const ExecutionContext& context) {
+  compute(&context);
+}
+
+void TensorBase::compute(const ExecutionContext* context) {
   taco_uassert(!needsCompile()) << error::compute_without_compile;
   if (!needsCompute()) {
     return;
   }
+  waitForCompile();
   setNeedsCompute(false);
   // Sync operand tensors if needed.
   auto operands = getTensors(getAssignment().getRhs());
@@ -816,12 +1400,385 @@ void TensorBase::compute() {
   }
 
   auto arguments = packArguments(*this);
-  this->content->module->callFuncPacked("compute", arguments.data());
+  callKernel([&]() {
+    return content->module->callFuncPacked("compute", arguments, context);
+  }, content->assembleWhileCompute);
 
   if (content->assembleWhileCompute) {
     setNeedsAssemble(false);
     taco_tensor_t* tensorData = ((taco_tensor_t*)arguments[0]);
-    content->valuesSize = unpackTensorData(*tensorData, *this);
+    content->valuesSize = unpackTensorData(*tensorData, *this,
+                                           content->resultAllocator);
+  }
+}
+
+void TensorBase::callKernel(const function<int()>& kernel,
+                            bool allocatesResults) {
+  ResultAllocator* allocator = content->resultAllocator.get();
+  if (allocator == nullptr) {
+    kernel();
+    return;
+  }
+
+  // Drop the previous results, which the kernel replaces without reading, so
+  // that the allocator can reuse their memory for the new results.  The sizes
+  // of dense modes are kept, since they are read back from the arguments.
+  if (allocatesResults && !getAssignment().getOperator().defined()) {
+    const Format& format = getFormat();
+    vector<ModeIndex> modeIndices;
+    for (int i = 0; i < format.getOrder(); i++) {
+      modeIndices.push_back(format.getModeFormats()[i].getName() == Dense.getName()
+                            ? content->storage.getIndex().getModeIndex(i)
+                            : ModeIndex());
+    }
+    content->storage.setIndex(Index(format, modeIndices));
+    content->storage.setValues(Array());
+  }
+
+  ResultAllocator* threadAllocator = getThreadResultAllocator();
+  setThreadResultAllocator(allocator);
+  allocator->begin();
+  kernel();
+  setThreadResultAllocator(threadAllocator);
+}
+
+struct BoundKernel::Content {
+  TensorBase result;
+  shared_ptr<Module> module;
+  Module::PackedFunc assembleFunc;
+  Module::PackedFunc computeFunc;
+  bool assembleWhileCompute;
+  bool hasOperator;
+
+  /// The argument tensors, the arguments last passed to the kernels (followed
+  /// by the task runtime if the kernels use it), and the versions of the
+  /// argument storage they were converted from.
+  vector<TensorBase> tensors;
+  vector<void*> arguments;
+  vector<uint64_t> versions;
+
+  /// Sync the operands and refresh the arguments whose storage was replaced.
+  void bindArguments() {
+    for (size_t i = 1; i < tensors.size(); i++) {
+      tensors[i].syncValues();
+    }
+    for (size_t i = 0; i < tensors.size(); i++) {
+      const TensorStorage& storage = tensors[i].getStorage();
+      if (storage.getVersion() != versions[i]) {
+        arguments[i] = (taco_tensor_t*)storage;
+        versions[i] = storage.getVersion();
+      }
+    }
+  }
+
+  void call(Module::PackedFunc func, bool allocatesResults,
+            const ExecutionContext* context) {
+    if (arguments.size() > tensors.size()) {
+      arguments.back() = module->getRuntime(context);
+    }
+    if (!result.content->resultAllocator) {
+      Module::callPackedFunc(func, arguments.data(), context);
+      return;
+    }
+    result.callKernel([&]() {
+      return Module::callPackedFunc(func, arguments.data(), context);
+    }, allocatesResults);
+  }
+};
+
+BoundKernel::BoundKernel() {
+}
+
+void BoundKernel::assemble() {
+  assemble(nullptr);
+}
+
+void BoundKernel::assemble(const ExecutionContext& context) {
+  assemble(&context);
+}
+
+void BoundKernel::assemble(const ExecutionContext* context) {
+  taco_uassert(content != nullptr) << "The kernel is not bound to a tensor";
+  content->bindArguments();
+  content->call(content->assembleFunc, !content->assembleWhileCompute,
+                context);
+  if (!content->assembleWhileCompute) {
+    content->result.setNeedsAssemble(false);
+    content->result.content->valuesSize =
+        unpackTensorData(*(taco_tensor_t*)content->arguments[0],
+                         content->result, content->result.content->resultAllocator);
+  }
+}
+
+void BoundKernel::compute() {
+  compute(nullptr);
+}
+
+void BoundKernel::compute(const ExecutionContext& context) {
+  compute(&context);
+}
+
+void BoundKernel::compute(const ExecutionContext* context) {
+  taco_uassert(content != nullptr) << "The kernel is not bound to a tensor";
+  content->bindArguments();
+  content->call(content->computeFunc, content->assembleWhileCompute, context);
+  content->result.setNeedsCompute(false);
+  if (content->assembleWhileCompute) {
+    content->result.setNeedsAssemble(false);
+    content->result.content->valuesSize =
+        unpackTensorData(*(taco_tensor_t*)content->arguments[0],
+                         content->result, content->result.content->resultAllocator);
+  }
+}
+
+void BoundKernel::evaluate() {
+  taco_uassert(content != nullptr) << "The kernel is not bound to a tensor";
+  if (!content->hasOperator && !content->assembleWhileCompute) {
+    assemble();
+  }
+  compute();
+}
+
+void BoundKernel::evaluate(const ExecutionContext& context) {
+  taco_uassert(content != nullptr) << "The kernel is not bound to a tensor";
+  if (!content->hasOperator && !content->assembleWhileCompute) {
+    assemble(context);
+  }
+  compute(context);
+}
+
+BoundKernel TensorBase::bind() {
+  compile();
+  waitForCompile();
+
+  BoundKernel kernel;
+  kernel.content = make_shared<BoundKernel::Content>();
+  kernel.content->result = *this;
+  kernel.content->module = content->module;
+  kernel.content->assembleFunc = content->module->getPackedFunc("assemble");
+  kernel.content->computeFunc = content->module->getPackedFunc("compute");
+  kernel.content->assembleWhileCompute = content->assembleWhileCompute;
+  kernel.content->hasOperator = getAssignment().getOperator().defined();
+  kernel.content->tensors = getArgumentTensors(*this);
+  kernel.content->arguments.resize(kernel.content->tensors.size() +
+                                   (content->module->getRuntime() ? 1 : 0),
+                                   nullptr);
+  // No storage has this version, so every argument is bound on the first call
+  kernel.content->versions.resize(kernel.content->tensors.size(), UINT64_MAX);
+
+  // The bound kernel is evaluated on demand, so the tensor no longer depends
+  // on its operands.
+  for (size_t i = 1; i < kernel.content->tensors.size(); i++) {
+    kernel.content->tensors[i].removeDependentTensor(*this);
+  }
+  return kernel;
+}
+
+/// Returns the index variable of the outermost loop of a concrete statement.
+static IndexVar getOutermostLoopVar(IndexStmt stmt) {
+  while (isa<SuchThat>(stmt)) {
+    stmt = to<SuchThat>(stmt).getStmt();
+  }
+  taco_uassert(isa<Forall>(stmt)) <<
+      "Out-of-core computation requires the outermost statement to be a loop, "
+      "but it is " << stmt;
+  return to<Forall>(stmt).getIndexVar();
+}
+
+/// Returns true if an access to a tensor with the given format is split into
+/// row blocks by the loop over outerVar.
+static bool isRowBlocked(const Access& access, const Format& format,
+                         const IndexVar& outerVar) {
+  const vector<IndexVar>& indexVars = access.getIndexVars();
+  for (size_t i = 0; i < indexVars.size(); i++) {
+    if (indexVars[i] == outerVar) {
+      taco_uassert((int)i == format.getModeOrdering()[0]) <<
+          "Out-of-core computation requires " << outerVar << " to index " <<
+          "the outermost stored mode of " << access.getTensorVar().getName();
+      return true;
+    }
+  }
+  return false;
+}
+
+void TensorBase::computeOutOfCore(size_t memoryBudget) {
+  taco_uassert(!needsCompile()) << error::compute_without_compile;
+  if (!needsCompute()) {
+    return;
+  }
+  waitForCompile();
+  taco_uassert(!content->assembleWhileCompute) <<
+      "Out-of-core computation does not support assembling while computing";
+  const Format& format = getFormat();
+  for (const ModeFormat& modeFormat : format.getModeFormats()) {
+    taco_uassert(modeFormat.getName() == Dense.getName()) <<
+        "The result of an out-of-core computation must be dense";
+  }
+
+  // Find the operands that the outermost loop iterates over, which are split
+  // into row blocks.  The other operands are used whole by every block.
+  const IndexVar outerVar = getOutermostLoopVar(content->computeStmt);
+  auto operands = getTensors(getAssignment().getRhs());
+  vector<TensorBase> blocked;
+  match(getAssignment().getRhs(),
+    function<void(const AccessNode*)>([&](const AccessNode* node) {
+      Access access(node);
+      if (!util::contains(operands, access.getTensorVar())) {
+        return;
+      }
+      TensorBase operand = operands.at(access.getTensorVar());
+      if (isRowBlocked(access, operand.getFormat(), outerVar) &&
+          !util::contains(blocked, operand)) {
+        blocked.push_back(operand);
+      }
+    })
+  );
+  if (blocked.empty()) {
+    compute();
+    return;
+  }
+  // If any operand is compressed in its outermost mode, the rows of the
+  // blocks keep their coordinates, so operands that are dense in their
+  // outermost mode are used whole.  Each block would then iterate over every
+  // row of dense operands added to the compressed ones, so that's not allowed.
+  bool compressedRows = false;
+  for (auto& operand : blocked) {
+    if (operand.getFormat().getModeFormats()[0].getName() == Sparse.getName()) {
+      compressedRows = true;
+    }
+  }
+  if (compressedRows) {
+    vector<TensorBase> compressed;
+    for (auto& operand : blocked) {
+      if (operand.getFormat().getModeFormats()[0].getName() == Sparse.getName()) {
+        compressed.push_back(operand);
+      }
+    }
+    if (compressed.size() < blocked.size()) {
+      match(getAssignment().getRhs(),
+        function<void(const AddNode*)>([&](const AddNode* node) {
+          taco_uerror << "Out-of-core computation cannot add operands that "
+                         "are dense and compressed in their outermost mode";
+        }),
+        function<void(const SubNode*)>([&](const SubNode* node) {
+          taco_uerror << "Out-of-core computation cannot subtract operands "
+                         "that are dense and compressed in their outermost mode";
+        })
+      );
+    }
+    blocked = compressed;
+  }
+  const Format& blockedFormat = blocked[0].getFormat();
+  const int numRows = blocked[0].getDimension(blockedFormat.getModeOrdering()[0]);
+
+  // With a dense outermost mode, each block computes its own rows of the
+  // result.  Otherwise each block's results are accumulated into the result.
+  const bool blockedResult = !compressedRows &&
+      isRowBlocked(getAssignment().getLhs(), format, outerVar);
+
+  setNeedsCompute(false);
+  for (auto& operand : operands) {
+    operand.second.syncValues();
+    operand.second.removeDependentTensor(*this);
+  }
+
+  // Allocate the dense result
+  vector<ModeIndex> modeIndices;
+  size_t size = 1;
+  for (int mode : format.getModeOrdering()) {
+    modeIndices.push_back(ModeIndex({makeArray({getDimension(mode)})}));
+    size *= getDimension(mode);
+  }
+  TensorStorage& storage = getStorage();
+  if (needsAssemble()) {
+    storage.setIndex(Index(format, modeIndices));
+    storage.setValues(makeArray(getComponentType(), size,
+                                storage.getPlacement()));
+    content->valuesSize = size;
+    setNeedsAssemble(false);
+  }
+  // Without a blocked result, each block writes the rows it iterates over if
+  // they index the outermost stored mode of the result, and otherwise all of
+  // it, and only those components of the partial result are added.
+  const vector<IndexVar>& resultVars = getAssignment().getLhs().getIndexVars();
+  const bool rowIndexedResult = !resultVars.empty() &&
+      resultVars[format.getModeOrdering()[0]] == outerVar;
+  const size_t rowSize = rowIndexedResult
+      ? size / getDimension(format.getModeOrdering()[0]) : 0;
+  vector<TensorStorage> partialResult;
+  if (!blockedResult) {
+    storage.getValues().zero();
+    partialResult.push_back(TensorStorage(getComponentType(), getDimensions(),
+                                          format));
+    partialResult[0].setIndex(Index(format, modeIndices));
+    partialResult[0].setValues(makeArray(getComponentType(), size));
+  }
+
+  // Split the rows into the largest blocks that fit in the memory budget, and
+  // at least one row each.
+  auto getBlockBytes = [&](int begin, int end) {
+    size_t bytes = 0;
+    for (auto& operand : blocked) {
+      bytes += getRowBlockBytes(operand.getStorage(), begin, end);
+    }
+    return bytes;
+  };
+  vector<int> blockBounds = {0};
+  while (blockBounds.back() < numRows) {
+    int begin = blockBounds.back();
+    int low = begin + 1;
+    int high = numRows;
+    while (low < high) {
+      int mid = low + (high - low + 1) / 2;
+      if (getBlockBytes(begin, mid) <= memoryBudget) {
+        low = mid;
+      } else {
+        high = mid - 1;
+      }
+    }
+    blockBounds.push_back(low);
+  }
+
+  const vector<void*> arguments = packArguments(*this);
+  for (size_t block = 0; block + 1 < blockBounds.size(); block++) {
+    const int begin = blockBounds[block];
+    const int end = blockBounds[block + 1];
+    if (block + 2 < blockBounds.size()) {
+      for (auto& operand : blocked) {
+        prefetchRowBlock(operand.getStorage(), end, blockBounds[block + 2]);
+      }
+    }
+
+    // Run the compute kernel with the operands replaced by views of the block
+    vector<void*> blockArguments = arguments;
+    vector<TensorStorage> views;
+    for (auto& operand : blocked) {
+      views.push_back(getRowBlock(operand.getStorage(), begin, end));
+      std::replace(blockArguments.begin(), blockArguments.end(),
+                   (void*)(taco_tensor_t*)operand.getStorage(),
+                   (void*)(taco_tensor_t*)views.back());
+    }
+    if (blockedResult) {
+      views.push_back(getRowBlock(storage, begin, end));
+      blockArguments[0] = (taco_tensor_t*)views.back();
+    } else {
+      // The kernel assigns to every component of the partial result, unless
+      // it accumulates into the result
+      if (getAssignment().getOperator().defined()) {
+        partialResult[0].getValues().zero();
+      }
+      blockArguments[0] = (taco_tensor_t*)partialResult[0];
+    }
+    content->module->callFuncPacked("compute", blockArguments);
+    if (!blockedResult) {
+      addValues(storage.getValues(), partialResult[0].getValues(),
+                rowIndexedResult ? begin * rowSize : 0,
+                rowIndexedResult ? end * rowSize : size);
+    }
+
+    for (auto& operand : blocked) {
+      releaseRowBlock(operand.getStorage(), begin, end);
+    }
   }
 }
 
@@ -833,6 +1790,14 @@ void TensorBase::evaluate() {
   this->compute();
 }
 
+void TensorBase::evaluate(const ExecutionContext& context) {
+  this->compile();
+  if (!getAssignment().getOperator().defined()) {
+    this->assemble(context);
+  }
+  this->compute(context);
+}
+
 void TensorBase::operator=(const IndexExpr& expr) {
   taco_uassert(getOrder() == 0)
       << "Must use index variable on the left-hand-side when assigning an "
@@ -865,22 +1830,26 @@ Assignment TensorBase::getAssignment() const {
 }
 
 void TensorBase::printComputeIR(ostream& os, bool color, bool simplify) const {
+  waitForCompile();
   std::shared_ptr<ir::CodeGen> codegen = ir::CodeGen::init_default(os, ir::CodeGen::ImplementationGen);
   codegen->compile(content->computeFunc.as<Function>(), false);
 }
 
 void TensorBase::printAssembleIR(ostream& os, bool color, bool simplify) const {
+  waitForCompile();
   IRPrinter printer(os, color, simplify);
   printer.print(content->assembleFunc.as<Function>()->body);
 }
 
 string TensorBase::getSource() const {
+  waitForCompile();
   return content->module->getSource();
 }
 
 void TensorBase::compileSource(std::string source) {
   taco_iassert(getAssignment().getRhs().defined())
       << error::compile_without_expr;
+  waitForCompile();
 
   IndexStmt stmt = makeConcreteNotation(makeReductionNotation(getAssignment()));
   stmt = reorderLoopsTopologically(stmt);
@@ -905,27 +1874,32 @@ void TensorBase::compileSource(std::string source) {
   setNeedsCompile(false);
 }
 
-TensorBase::HelperFuncsCache TensorBase::helperFunctions;
-std::mutex TensorBase::helperFunctionsMutex;
+typedef std::tuple<Format,Datatype,std::vector<int>> HelperFuncsKey;
+static ModuleCache<HelperFuncsKey> helperFunctions(
+    [](const HelperFuncsKey& a, const HelperFuncsKey& b) {
+      return std::get<0>(a) == std::get<0>(b) &&
+             std::get<1>(a) == std::get<1>(b) &&
+             std::get<2>(a) == std::get<2>(b);
+    });
+
+static size_t hashHelperFunctionsKey(const Format& format, Datatype ctype,
+                                     const std::vector<int>& dimensions) {
+  std::stringstream key;
+  key << format << ctype << "[" << util::join(dimensions) << "]";
+  return std::hash<std::string>()(key.str());
+}
 
 std::shared_ptr<ir::Module>
 TensorBase::getHelperFunctions(const Format& format, Datatype ctype,
                                const std::vector<int>& dimensions) {
-  helperFunctionsMutex.lock();
-  const auto helperFunctionsReverse =
-      util::ReverseConstIterable<TensorBase::HelperFuncsCache>(helperFunctions);
-  for (const auto& helperFuncs : helperFunctionsReverse) {
-    if (std::get<0>(helperFuncs) == format &&
-        std::get<1>(helperFuncs) == ctype &&
-        std::get<2>(helperFuncs) == dimensions) {
-      // If helper functions had already been generated for specified tensor
-      // format and type, then use cached version.
-      const auto helperFuncsModule = std::get<3>(helperFuncs);
-      helperFunctionsMutex.unlock();
-      return helperFuncsModule;
-    }
-  }
-  helperFunctionsMutex.unlock();
+  // If helper functions had already been generated for specified tensor
+  // format and type, then use cached version.
+  const auto cachedHelperFuncs = helperFunctions.get(
+      hashHelperFunctionsKey(format, ctype, dimensions),
+      std::make_tuple(format, ctype, dimensions));
+  if (cachedHelperFuncs) {
+    return cachedHelperFuncs;
+  }
 
   std::shared_ptr<Module> helperModule = std::make_shared<Module>();
 
@@ -935,14 +1909,22 @@ TensorBase::getHelperFunctions(const Format& format, Datatype ctype,
   const auto dims = util::map(dimensions, getDim);
 
   if (format.getOrder() > 0) {
-    const Format bufferFormat = COO(format.getOrder(), false, true, false,
-                                    format.getModeOrdering());
+    Format bufferFormat = COO(format.getOrder(), false, true, false,
+                              format.getModeOrdering());
+    std::vector<std::vector<Datatype>> bufferArrayTypes(format.getOrder(),
+                                                        {Int32, Int32});
+    bufferArrayTypes[0][0] = format.getIndexType();
+    bufferFormat.setLevelArrayTypes(bufferArrayTypes);
     TensorVar bufferTensor(Type(ctype, Shape(dims)), bufferFormat);
     TensorVar packedTensor(Type(ctype, Shape(dims)), format);
 
+    // Encoded levels can't be assembled, so they are packed as compressed
+    // levels that are encoded after packing.
+    TensorVar wideTensor(Type(ctype, Shape(dims)), getPackFormat(format));
+
     // Define packing and iterator routines in index notation.
     std::vector<IndexVar> indexVars(format.getOrder());
-    IndexStmt packStmt = (packedTensor(indexVars) = bufferTensor(indexVars));
+    IndexStmt packStmt = (wideTensor(indexVars) = bufferTensor(indexVars));
     IndexStmt iterateStmt = Yield(indexVars, packedTensor(indexVars));
     for (int i = format.getOrder() - 1; i >= 0; --i) {
       int mode = format.getModeOrdering()[i];
@@ -950,7 +1932,14 @@ TensorBase::getHelperFunctions(const Format& format, Datatype ctype,
       iterateStmt = forall(indexVars[mode], iterateStmt);
     }
 
-    // Lower packing and iterator code.
+    // Lower packing and iterator code, unless the on-disk kernel cache
+    // already holds them.
+    helperModule->setCacheKey("pack " + canonicalize(packStmt) + "\n" +
+                              "iterate " + canonicalize(iterateStmt));
+    if (helperModule->loadFromCache()) {
+      cacheHelperFunctions(format, ctype, dimensions, helperModule);
+      return helperModule;
+    }
     helperModule->addFunction(lower(packStmt, "pack", true, true));
     helperModule->addFunction(lower(iterateStmt, "iterate", false, true));
   } else {
@@ -971,14 +1960,19 @@ TensorBase::getHelperFunctions(const Format& format, Datatype ctype,
     helperModule->addFunction(lower(iterateStmt, "iterate", false, true));
   }
   helperModule->compile();
-
-  helperFunctionsMutex.lock();
-  helperFunctions.emplace_back(format, ctype, dimensions, helperModule);
-  helperFunctionsMutex.unlock();
+  cacheHelperFunctions(format, ctype, dimensions, helperModule);
 
   return helperModule;
 }
 
+void TensorBase::cacheHelperFunctions(const Format& format, Datatype ctype,
+                                      const std::vector<int>& dimensions,
+                                      const std::shared_ptr<Module> helpers) {
+  helperFunctions.insert(hashHelperFunctionsKey(format, ctype, dimensions),
+                         std::make_tuple(format, ctype, dimensions), helpers,
+                         taco_get_kernel_cache_capacity());
+}
+
 template<typename T>
 bool isZero(T a) {
   if ((double)a == 0.0) {
@@ -1224,6 +2218,9 @@ TensorBase dispatchRead(T& file, FileType filetype, U format, bool pack) {
     case FileType::rb:
       tensor = readRB(file, format, pack);
       break;
+    case FileType::tbin:
+      tensor = readTBIN(file, format, pack);
+      break;
   }
   return tensor;
 }
@@ -1245,6 +2242,9 @@ TensorBase dispatchRead(std::string filename, U format, bool pack) {
   else if (extension == "rb") {
     tensor = dispatchRead(filename, FileType::rb, format, pack);
   }
+  else if (extension == "tbin") {
+    tensor = dispatchRead(filename, FileType::tbin, format, pack);
+  }
   else {
     taco_uerror << "File extension not recognized: " << filename << std::endl;
   }
@@ -1296,6 +2296,9 @@ void dispatchWrite(T& file, const TensorBase& tensor, FileType filetype) {
     case FileType::rb:
       writeRB(file, tensor);
       break;
+    case FileType::tbin:
+      writeTBIN(file, tensor);
+      break;
   }
 }
 
@@ -1316,6 +2319,9 @@ void write(string filename, const TensorBase& tensor) {
   else if (extension == "rb") {
     dispatchWrite(filename, tensor, FileType::rb);
   }
+  else if (extension == "tbin") {
+    dispatchWrite(filename, tensor, FileType::tbin);
+  }
   else {
     taco_uerror << "File extension not recognized: " << filename << std::endl;
   }
@@ -1339,9 +2345,426 @@ void packOperands(const TensorBase& tensor) {
   }
 }
 
+void evaluateFused(const vector<TensorBase>& results) {
+  bool needsCompute = false;
+  for (auto& result : results) {
+    taco_uassert(result.getAssignment().defined())
+        << error::compile_without_expr;
+    needsCompute |= result.content->needsCompute;
+  }
+  if (!needsCompute) {
+    return;
+  }
+
+  // The results' expressions, preceded by the uncomputed expressions of their
+  // operands in the order they can be evaluated in.  Compound assignments are
+  // computed on their own, since they read the tensor's earlier values.
+  vector<TensorBase> pipeline;
+  set<TensorBase> visited;
+  function<void(TensorBase)> addExpression = [&](TensorBase tensor) {
+    if (util::contains(visited, tensor)) {
+      return;
+    }
+    visited.insert(tensor);
+    for (auto& operand : getTensors(tensor.getAssignment().getRhs())) {
+      TensorBase operandTensor = operand.second;
+      if (operandTensor.content->needsCompute &&
+          !operandTensor.content->needsPack &&
+          operandTensor.getAssignment().defined() &&
+          !operandTensor.getAssignment().getOperator().defined()) {
+        addExpression(operandTensor);
+      }
+    }
+    pipeline.push_back(tensor);
+  };
+  for (auto& result : results) {
+    addExpression(result);
+  }
+
+  vector<Assignment> assignments;
+  map<TensorVar, TensorBase> tensors;
+  for (auto& tensor : pipeline) {
+    assignments.push_back(tensor.getAssignment());
+    tensors.insert({tensor.getTensorVar(), tensor});
+    auto operands = getTensors(tensor.getAssignment().getRhs());
+    tensors.insert(operands.begin(), operands.end());
+  }
+  vector<TensorVar> resultVars;
+  for (auto& result : results) {
+    resultVars.push_back(result.getTensorVar());
+  }
+  IndexStmt stmt = fuse(assignments, resultVars);
+  stmt = parallelizeOuterLoop(stmt);
+
+  shared_ptr<ResultAllocator> allocator = results[0].getResultAllocator();
+  for (auto& result : results) {
+    taco_uassert(result.getResultAllocator() == allocator)
+        << "The results of fused expressions must share a result allocator";
+  }
+  for (auto& argument : getArguments(stmt)) {
+    tensors.at(argument).syncValues();
+  }
+
+  // Fused statements are cached with the compute kernels of tensors, but
+  // hashed apart from them since their modules have an evaluate function.
+  IndexStmt stmtToCompile = scalarPromote(stmt.concretize());
+  shared_ptr<Module> module = make_shared<Module>();
+  const Target& target = module->getTarget();
+  const size_t hash = std::hash<std::string>()(canonicalize(stmtToCompile) +
+      " fused simd " + util::toString(target.simd) + " parallelism " +
+      util::toString(target.parallelism));
+  shared_ptr<Module> cachedModule =
+      TensorBase::getComputeKernel(stmtToCompile, hash);
+  if (cachedModule) {
+    module = cachedModule;
+  }
+  else {
+    module->addFunction(lower(stmtToCompile, "evaluate", true, true));
+    module->compile();
+    TensorBase::cacheComputeKernel(stmtToCompile, hash, module);
+  }
+
+  vector<TensorBase> resultTensors;
+  vector<void*> arguments;
+  for (auto& result : getResults(stmt)) {
+    resultTensors.push_back(tensors.at(result));
+    arguments.push_back(tensors.at(result).getStorage());
+  }
+  for (auto& argument : getArguments(stmt)) {
+    arguments.push_back(tensors.at(argument).getStorage());
+  }
+  resultTensors[0].callKernel([&]() {
+    return module->callFuncPacked("evaluate", arguments);
+  }, true);
+
+  for (size_t i = 0; i < resultTensors.size(); i++) {
+    TensorBase& result = resultTensors[i];
+    result.content->valuesSize =
+        unpackTensorData(*(taco_tensor_t*)arguments[i], result, allocator);
+    result.setNeedsAssemble(false);
+    result.setNeedsCompute(false);
+    for (auto& operand : getTensors(result.getAssignment().getRhs())) {
+      operand.second.removeDependentTensor(result);
+    }
+  }
+}
+
+namespace {
+
+/// A subexpression of the expression of a tensor that doesn't depend on the
+/// variables of enclosing reductions.
+struct Subexpression {
+  TensorBase tensor;
+  IndexExpr expr;
+
+  /// The subexpression over canonical index variables, which is equal to the
+  /// canonical forms of copies of the subexpression over other variables
+  IndexExpr canonical;
+
+  /// The free variables of the subexpression, in the order they first appear
+  vector<IndexVar> freeVars;
+};
+
+/// Renames the index variables of an expression to canonical variables, in
+/// the order they first appear.
+struct Canonicalize : public IndexNotationRewriter {
+  using IndexNotationRewriter::visit;
+
+  vector<IndexVar>& canonicalVars;
+  map<IndexVar,IndexVar> renaming;
+  set<IndexVar> reductionVars;
+  vector<IndexVar> freeVars;
+  int numAccesses = 0;
+  bool hasModifiers = false;
+
+  Canonicalize(vector<IndexVar>& canonicalVars)
+      : canonicalVars(canonicalVars) {}
+
+  IndexVar rename(IndexVar var) {
+    if (!util::contains(renaming, var)) {
+      const size_t position = renaming.size();
+      if (position == canonicalVars.size()) {
+        canonicalVars.push_back(IndexVar());
+      }
+      renaming.insert({var, canonicalVars[position]});
+      if (!util::contains(reductionVars, var)) {
+        freeVars.push_back(var);
+      }
+    }
+    return renaming.at(var);
+  }
+
+  void visit(const AccessNode* op) {
+    numAccesses++;
+    hasModifiers |= !op->windowedModes.empty() || !op->indexSetModes.empty() ||
+                    op->isAccessingStructure;
+    vector<IndexVar> indexVars;
+    for (auto& var : op->indexVars) {
+      indexVars.push_back(rename(var));
+    }
+    expr = Access(op->tensorVar, indexVars);
+  }
+
+  void visit(const ReductionNode* op) {
+    reductionVars.insert(op->var);
+    IndexVar var = rename(op->var);
+    expr = Reduction(op->op, var, rewrite(op->a));
+  }
+};
+
+/// Collects the subexpressions of the expression of a tensor that don't
+/// depend on the variables of enclosing reductions.
+struct CollectSubexpressions : public IndexNotationVisitor {
+  using IndexNotationVisitor::visit;
+
+  TensorBase tensor;
+  vector<IndexVar>& canonicalVars;
+  vector<Subexpression>& subexpressions;
+  set<IndexVar> reductionVars;
+
+  CollectSubexpressions(TensorBase tensor, vector<IndexVar>& canonicalVars,
+                        vector<Subexpression>& subexpressions)
+      : tensor(tensor), canonicalVars(canonicalVars),
+        subexpressions(subexpressions) {}
+
+  void collect(IndexExpr expr) {
+    Canonicalize canonicalize(canonicalVars);
+    IndexExpr canonical = canonicalize.rewrite(expr);
+    if (canonicalize.numAccesses == 0 || canonicalize.hasModifiers) {
+      return;
+    }
+    for (auto& var : canonicalize.freeVars) {
+      if (util::contains(reductionVars, var)) {
+        return;
+      }
+    }
+    subexpressions.push_back({tensor, expr, canonical,
+                              canonicalize.freeVars});
+  }
+
+  void visit(const UnaryExprNode* op) {
+    collect(op);
+    IndexNotationVisitor::visit(op);
+  }
+
+  void visit(const BinaryExprNode* op) {
+    collect(op);
+    IndexNotationVisitor::visit(op);
+  }
+
+  void visit(const ReductionNode* op) {
+    collect(op);
+    reductionVars.insert(op->var);
+    op->a.accept(this);
+    reductionVars.erase(op->var);
+  }
+};
+
+}
+
+void TensorBase::evaluateDag() {
+  auto isUncomputed = [](const TensorBase& tensor) {
+    if (tensor.content == nullptr || !tensor.content->needsCompute ||
+        tensor.content->needsPack || !tensor.getAssignment().defined()) {
+      return false;
+    }
+    // Tensors whose expressions read their earlier values are left alone
+    return !util::contains(getTensors(tensor.getAssignment().getRhs()),
+                           tensor.getTensorVar());
+  };
+
+  // The uncomputed tensors that are connected to this one through the tensors
+  // that they read
+  vector<TensorBase> dag;
+  set<TensorBase> inDag;
+  if (isUncomputed(*this)) {
+    dag.push_back(*this);
+    inDag.insert(*this);
+  }
+  for (size_t next = 0; next < dag.size(); next++) {
+    for (auto& operand : getTensors(dag[next].getAssignment().getRhs())) {
+      vector<TensorBase> connected = operand.second.getDependentTensors();
+      connected.push_back(operand.second);
+      for (auto& tensor : connected) {
+        if (!util::contains(inDag, tensor) && isUncomputed(tensor)) {
+          dag.push_back(tensor);
+          inDag.insert(tensor);
+        }
+      }
+    }
+  }
+
+  // Compute the largest subexpression that occurs more than once, and replace
+  // its occurrences with reads of it, until no subexpression repeats
+  vector<IndexVar> canonicalVars;
+  vector<IndexExpr> unshared;
+  while (true) {
+    vector<Subexpression> subexpressions;
+    for (auto& tensor : dag) {
+      CollectSubexpressions collect(tensor, canonicalVars, subexpressions);
+      tensor.getAssignment().getRhs().accept(&collect);
+    }
+    vector<Subexpression> shared;
+    size_t sharedSize = 0;
+    for (size_t i = 0; i < subexpressions.size(); i++) {
+      const size_t size = util::toString(subexpressions[i].canonical).size();
+      if (size <= sharedSize ||
+          util::any(unshared, [&](const IndexExpr& expr) {
+            return equals(expr, subexpressions[i].canonical);
+          })) {
+        continue;
+      }
+      vector<Subexpression> occurrences = {subexpressions[i]};
+      for (size_t j = i + 1; j < subexpressions.size(); j++) {
+        if (equals(subexpressions[i].canonical, subexpressions[j].canonical)) {
+          occurrences.push_back(subexpressions[j]);
+        }
+      }
+      if (occurrences.size() > 1) {
+        shared = occurrences;
+        sharedSize = size;
+      }
+    }
+    if (shared.empty()) {
+      break;
+    }
+
+    // A tensor whose whole expression is the subexpression computes it for
+    // the others, and otherwise a temporary does.  Mode m of the tensor is
+    // indexed by free variable positions[m] of the subexpression.
+    TensorBase computed;
+    vector<size_t> positions;
+    bool computedByTensor = false;
+    for (auto& occurrence : shared) {
+      Assignment assignment = occurrence.tensor.getAssignment();
+      Access lhs = assignment.getLhs();
+      vector<IndexVar> vars = lhs.getIndexVars();
+      if (occurrence.expr != assignment.getRhs() ||
+          assignment.getOperator().defined() || lhs.hasWindowedModes() ||
+          lhs.hasIndexSetModes() || vars.size() != occurrence.freeVars.size() ||
+          set<IndexVar>(vars.begin(), vars.end()) !=
+              set<IndexVar>(occurrence.freeVars.begin(),
+                            occurrence.freeVars.end())) {
+        continue;
+      }
+      computed = occurrence.tensor;
+      computedByTensor = true;
+      for (auto& var : vars) {
+        positions.push_back(util::locate(occurrence.freeVars, var));
+      }
+      break;
+    }
+    if (!computedByTensor) {
+      // The temporary has the format of a tensor that is assigned over the
+      // free variables of the subexpression, with its modes in the same
+      // order, and is dense otherwise.  Subexpressions that only sparse
+      // tensors read aren't shared, since they would read dense temporaries.
+      const Subexpression& first = shared[0];
+      Format format(vector<ModeFormatPack>(first.freeVars.size(), Dense));
+      bool hasFormat = false;
+      bool readByDense = false;
+      for (auto& occurrence : shared) {
+        readByDense |= isDense(occurrence.tensor.getFormat());
+        vector<IndexVar> vars =
+            occurrence.tensor.getAssignment().getLhs().getIndexVars();
+        if (hasFormat || vars.size() != occurrence.freeVars.size() ||
+            set<IndexVar>(vars.begin(), vars.end()) !=
+                set<IndexVar>(occurrence.freeVars.begin(),
+                              occurrence.freeVars.end())) {
+          continue;
+        }
+        format = occurrence.tensor.getFormat();
+        hasFormat = true;
+        for (auto& var : vars) {
+          positions.push_back(util::locate(occurrence.freeVars, var));
+        }
+      }
+      if (!hasFormat && !readByDense) {
+        unshared.push_back(first.canonical);
+        continue;
+      }
+      if (!hasFormat) {
+        for (size_t position = 0; position < first.freeVars.size();
+             position++) {
+          positions.push_back(position);
+        }
+      }
+
+      vector<int> freeDimensions;
+      for (auto& var : first.freeVars) {
+        int dimension = -1;
+        match(first.expr,
+              function<void(const AccessNode*)>([&](const AccessNode* op) {
+                for (size_t mode = 0; mode < op->indexVars.size(); mode++) {
+                  if (op->indexVars[mode] == var &&
+                      isa<AccessTensorNode>(op) && dimension < 0) {
+                    dimension = to<AccessTensorNode>(op)->tensor
+                                .getDimension((int)mode);
+                  }
+                }
+              })
+        );
+        taco_iassert(dimension >= 0);
+        freeDimensions.push_back(dimension);
+      }
+      vector<int> dimensions;
+      vector<IndexVar> vars;
+      for (auto& position : positions) {
+        dimensions.push_back(freeDimensions[position]);
+        vars.push_back(first.freeVars[position]);
+      }
+      computed = TensorBase(util::uniqueName("cse"),
+                            first.expr.getDataType(), dimensions, format);
+      computed(vars) = first.expr;
+      dag.push_back(computed);
+      inDag.insert(computed);
+    }
+
+    map<TensorBase, map<IndexExpr,IndexExpr>> substitutions;
+    for (auto& occurrence : shared) {
+      if (computedByTensor && occurrence.tensor == computed &&
+          occurrence.expr == computed.getAssignment().getRhs()) {
+        continue;
+      }
+      vector<IndexVar> vars;
+      for (auto& position : positions) {
+        vars.push_back(occurrence.freeVars[position]);
+      }
+      substitutions[occurrence.tensor].insert({occurrence.expr,
+                                               computed(vars)});
+    }
+    for (auto& tensorSubstitutions : substitutions) {
+      TensorBase tensor = tensorSubstitutions.first;
+      Assignment assignment = tensor.getAssignment();
+      IndexExpr rhs = replace(assignment.getRhs(), tensorSubstitutions.second);
+      for (auto& operand : getTensors(assignment.getRhs())) {
+        operand.second.removeDependentTensor(tensor);
+      }
+      for (auto& operand : getTensors(rhs)) {
+        operand.second.addDependentTensor(tensor);
+      }
+      tensor.setAssignment(Assignment(assignment.getLhs(), rhs,
+                                      assignment.getOperator()));
+      tensor.setNeedsCompile(true);
+    }
+  }
+
+  // Tensors compute the tensors they read first
+  struct EvaluatingDag {
+    EvaluatingDag() { evaluatingDag = true; }
+    ~EvaluatingDag() { evaluatingDag = false; }
+  } evaluating;
+  syncValues();
+  for (auto& tensor : dag) {
+    tensor.syncValues();
+  }
+}
+
 static ParallelSchedule taco_parallel_sched = ParallelSchedule::Static;
 static int taco_chunk_size = 0;
 static int taco_num_threads = 1;
+static std::atomic<size_t> taco_kernel_cache_capacity(1024);
+static std::atomic<bool> taco_lazy_dag(false);
 
 void taco_set_parallel_schedule(ParallelSchedule sched, int chunk_size) {
   taco_parallel_sched = sched;
@@ -1363,4 +2786,20 @@ int taco_get_num_threads() {
   return taco_num_threads;
 }
 
+void taco_set_kernel_cache_capacity(size_t capacity) {
+  taco_kernel_cache_capacity = capacity;
+}
+
+size_t taco_get_kernel_cache_capacity() {
+  return taco_kernel_cache_capacity;
+}
+
+void taco_set_lazy_dag(bool lazyDag) {
+  taco_lazy_dag = lazyDag;
+}
+
+bool taco_get_lazy_dag() {
+  return taco_lazy_dag;
+}
+
 }
@@ -4,7 +4,12 @@
 
 #include <iostream>
 #include <fstream>
+#include <cstdint>
 #include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -24,4 +29,66 @@ void openStream(std::fstream& stream, std::string path, fstream::openmode mode)
   taco_uassert(stream.is_open()) << "Error opening file: " << path;
 }
 
+MappedFile::MappedFile(std::string path, bool copyOnWrite)
+    : data(nullptr), size(0) {
+  int fd = open(sanitizePath(path).c_str(), O_RDONLY);
+  taco_uassert(fd != -1) << "Error opening file: " << path;
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    taco_uerror << "Error reading file: " << path;
+  }
+  size = info.st_size;
+  if (size > 0) {
+    const int protection = copyOnWrite ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void* mapping = mmap(nullptr, size, protection, MAP_PRIVATE, fd, 0);
+    close(fd);
+    taco_uassert(mapping != MAP_FAILED) << "Error mapping file: " << path;
+    // The file is read front to back
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    data = (const char*)mapping;
+  } else {
+    close(fd);
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (data) {
+    munmap((void*)data, size);
+  }
+}
+
+const char* MappedFile::getData() const {
+  return data;
+}
+
+size_t MappedFile::getSize() const {
+  return size;
+}
+
+// Round [data, data + size) out to page boundaries and apply the advice.
+// Advice is only a hint, so errors (e.g. memory that isn't mapped) are ignored.
+static void advise(const void* data, size_t size, int advice) {
+  if (size == 0) {
+    return;
+  }
+  const uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+  uintptr_t begin = (uintptr_t)data / pageSize * pageSize;
+  uintptr_t end = (uintptr_t)data + size;
+  madvise((void*)begin, end - begin, advice);
+}
+
+void adviseWillNeed(const void* data, size_t size) {
+  advise(data, size, MADV_WILLNEED);
+}
+
+void adviseWontNeed(const void* data, size_t size) {
+#ifdef MADV_COLD
+  advise(data, size, MADV_COLD);
+#else
+  (void)data;
+  (void)size;
+#endif
+}
+
 }}
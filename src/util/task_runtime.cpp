@@ -0,0 +1,259 @@
+#include "taco/util/task_runtime.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+namespace taco {
+namespace util {
+
+struct TaskRuntime::Loop {
+  taco_runtime_t* runtime;
+  taco_loop_body_t body;
+  void* closure;
+  int64_t grain;
+
+  /// The number of iterations that have not run yet
+  atomic<int64_t> remaining;
+
+  /// The number of queued tasks of the loop
+  atomic<int64_t> queued;
+
+  /// The thread that started the loop sleeps on changed while the loop has no
+  /// queued tasks, until tasks are queued or the loop finishes.
+  mutex sleepMutex;
+  condition_variable changed;
+  atomic<bool> sleeping;
+  bool finished;
+};
+
+namespace {
+
+// The runtime that the calling thread is a worker of, and its worker id
+thread_local TaskRuntime* currentRuntime = nullptr;
+thread_local int currentWorker = 0;
+
+void* allocate(taco_runtime_t*, void* data, size_t size, int clear) {
+  if (size == 0) {
+    free(data);
+    return nullptr;
+  }
+  return clear ? calloc(1, size) : realloc(data, size);
+}
+
+}
+
+TaskRuntime::TaskRuntime(int numWorkers, const vector<int>& cpus)
+    : numQueued(0), stopping(false) {
+  numWorkers = max(numWorkers, 1);
+  runtime.impl = this;
+  runtime.num_workers = numWorkers;
+  runtime.grain = 0;
+  runtime.parallel_for = runParallelFor;
+  runtime.allocator = nullptr;
+  runtime.allocate = allocate;
+  for (int i = 0; i < numWorkers; i++) {
+    queues.emplace_back(new Queue());
+  }
+  for (int i = 0; i < numWorkers - 1; i++) {
+    threads.emplace_back([this, i]() { work(i); });
+#if defined(__linux__)
+    if (!cpus.empty()) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpus[i % cpus.size()], &set);
+      pthread_setaffinity_np(threads.back().native_handle(), sizeof(set), &set);
+    }
+#endif
+  }
+}
+
+TaskRuntime::~TaskRuntime() {
+  {
+    lock_guard<std::mutex> lock(sleepMutex);
+    stopping = true;
+  }
+  available.notify_all();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+int TaskRuntime::getNumWorkers() const {
+  return runtime.num_workers;
+}
+
+taco_runtime_t* TaskRuntime::getRuntime() {
+  return &runtime;
+}
+
+TaskRuntime* TaskRuntime::getShared(int numWorkers) {
+  static std::mutex mutex;
+  static map<int, unique_ptr<TaskRuntime>> runtimes;
+  numWorkers = max(numWorkers, 1);
+  lock_guard<std::mutex> lock(mutex);
+  unique_ptr<TaskRuntime>& runtime = runtimes[numWorkers];
+  if (!runtime) {
+    runtime.reset(new TaskRuntime(numWorkers));
+  }
+  return runtime.get();
+}
+
+void TaskRuntime::parallelFor(int64_t begin, int64_t end, int64_t grain,
+                              taco_loop_body_t body, void* closure) {
+  parallelFor(&runtime, begin, end, grain, body, closure);
+}
+
+void TaskRuntime::runParallelFor(taco_runtime_t* runtime, int64_t begin,
+                                 int64_t end, int64_t grain,
+                                 taco_loop_body_t body, void* closure) {
+  static_cast<TaskRuntime*>(runtime->impl)->parallelFor(
+      runtime, begin, end, (grain > 0) ? grain : runtime->grain, body, closure);
+}
+
+void TaskRuntime::parallelFor(taco_runtime_t* runtime, int64_t begin,
+                              int64_t end, int64_t grain,
+                              taco_loop_body_t body, void* closure) {
+  if (end <= begin) {
+    return;
+  }
+  int worker = getWorker();
+  if (this->runtime.num_workers == 1) {
+    body(runtime, closure, begin, end, worker);
+    return;
+  }
+
+  // The body is passed the runtime struct the loop was started with, so that
+  // loops nested in it start with the same one
+  Loop loop;
+  loop.runtime = runtime;
+  loop.body = body;
+  loop.closure = closure;
+  const int64_t numWorkers = this->runtime.num_workers;
+  loop.grain = (grain > 0) ? grain
+                           : max((end - begin) / (8 * numWorkers), (int64_t)1);
+  loop.remaining = end - begin;
+  loop.queued = 0;
+  loop.sleeping = false;
+  loop.finished = false;
+  run(worker, {&loop, begin, end});
+
+  // Help with the loop until all of it has run.  Only tasks of this loop are
+  // run while waiting, since the worker may be in the middle of a task of
+  // an enclosing loop whose per-worker state must not be reused.  When none
+  // are queued, the other workers are running the rest, so sleep until they
+  // queue more or finish.  The loop is only left once the worker that
+  // finished it has released it.
+  Task task;
+  while (true) {
+    if (pop(worker, &loop, &task) || steal(worker, &loop, &task)) {
+      run(worker, task);
+      continue;
+    }
+    unique_lock<std::mutex> lock(loop.sleepMutex);
+    loop.sleeping = true;
+    loop.changed.wait(lock, [&loop]() {
+      return loop.finished || loop.queued > 0;
+    });
+    loop.sleeping = false;
+    if (loop.finished) {
+      return;
+    }
+  }
+}
+
+int TaskRuntime::getWorker() {
+  return (currentRuntime == this) ? currentWorker : (int)queues.size() - 1;
+}
+
+void TaskRuntime::push(int worker, Task task) {
+  {
+    lock_guard<std::mutex> lock(queues[worker]->mutex);
+    queues[worker]->tasks.push_back(task);
+  }
+  numQueued++;
+  task.loop->queued++;
+  {
+    // Pairs with the check of numQueued of sleeping workers
+    lock_guard<std::mutex> lock(sleepMutex);
+  }
+  available.notify_one();
+  if (task.loop->sleeping) {
+    lock_guard<std::mutex> lock(task.loop->sleepMutex);
+    task.loop->changed.notify_one();
+  }
+}
+
+bool TaskRuntime::pop(int worker, Loop* loop, Task* task) {
+  Queue& queue = *queues[worker];
+  lock_guard<std::mutex> lock(queue.mutex);
+  for (auto it = queue.tasks.rbegin(); it != queue.tasks.rend(); ++it) {
+    if (loop == nullptr || it->loop == loop) {
+      *task = *it;
+      queue.tasks.erase(next(it).base());
+      numQueued--;
+      task->loop->queued--;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TaskRuntime::steal(int worker, Loop* loop, Task* task) {
+  const int numQueues = (int)queues.size();
+  for (int i = 1; i < numQueues; i++) {
+    Queue& queue = *queues[(worker + i) % numQueues];
+    lock_guard<std::mutex> lock(queue.mutex);
+    for (auto it = queue.tasks.begin(); it != queue.tasks.end(); ++it) {
+      if (loop == nullptr || it->loop == loop) {
+        *task = *it;
+        queue.tasks.erase(it);
+        numQueued--;
+        task->loop->queued--;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void TaskRuntime::run(int worker, Task task) {
+  Loop* loop = task.loop;
+  while (task.end - task.begin > loop->grain) {
+    int64_t middle = task.begin + (task.end - task.begin) / 2;
+    push(worker, {loop, middle, task.end});
+    task.end = middle;
+  }
+  loop->body(loop->runtime, loop->closure, task.begin, task.end, worker);
+  const int64_t size = task.end - task.begin;
+  if (loop->remaining.fetch_sub(size, memory_order_acq_rel) == size) {
+    lock_guard<std::mutex> lock(loop->sleepMutex);
+    loop->finished = true;
+    loop->changed.notify_one();
+  }
+}
+
+void TaskRuntime::work(int worker) {
+  currentRuntime = this;
+  currentWorker = worker;
+  while (true) {
+    Task task;
+    if (pop(worker, nullptr, &task) || steal(worker, nullptr, &task)) {
+      run(worker, task);
+      continue;
+    }
+    unique_lock<std::mutex> lock(sleepMutex);
+    available.wait(lock, [this]() { return stopping || numQueued > 0; });
+    if (stopping) {
+      return;
+    }
+  }
+}
+
+}}
@@ -0,0 +1,56 @@
+#include "taco/util/thread_pool.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace taco {
+namespace util {
+
+ThreadPool::ThreadPool(int numThreads) : stopping(false) {
+  numThreads = max(numThreads, 1);
+  for (int i = 0; i < numThreads; i++) {
+    threads.emplace_back([this]() { run(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  available.notify_all();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+int ThreadPool::getNumThreads() const {
+  return (int)threads.size();
+}
+
+void ThreadPool::enqueue(function<void()> task) {
+  {
+    lock_guard<std::mutex> lock(mutex);
+    tasks.push(task);
+  }
+  available.notify_one();
+}
+
+void ThreadPool::run() {
+  while (true) {
+    function<void()> task;
+    {
+      unique_lock<std::mutex> lock(mutex);
+      available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+      if (tasks.empty()) {
+        return;
+      }
+      task = tasks.front();
+      tasks.pop();
+    }
+    task();
+  }
+}
+
+}}
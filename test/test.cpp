@@ -1,3 +1,6 @@
+#include <cstdio>
+#include <cstdlib>
+#include <ftw.h>
 #include <functional>
 
 #include "test.h"
@@ -46,6 +49,61 @@ std::string testDataDirectory() {
   return testDirectory() + "/data/";
 }
 
+ScopedEnv::ScopedEnv(const std::string& name, const std::string& value)
+    : name(name) {
+  const char* old = getenv(name.c_str());
+  wasSet = (old != nullptr);
+  oldValue = wasSet ? old : "";
+  setenv(name.c_str(), value.c_str(), 1);
+}
+
+ScopedEnv::~ScopedEnv() {
+  if (wasSet) {
+    setenv(name.c_str(), oldValue.c_str(), 1);
+  } else {
+    unsetenv(name.c_str());
+  }
+}
+
+ScopedNumThreads::ScopedNumThreads(int numThreads)
+    : oldNumThreads(taco_get_num_threads()) {
+  taco_set_num_threads(numThreads);
+}
+
+ScopedNumThreads::~ScopedNumThreads() {
+  taco_set_num_threads(oldNumThreads);
+}
+
+ScopedLazyDag::ScopedLazyDag(bool lazyDag)
+    : oldLazyDag(taco_get_lazy_dag()) {
+  taco_set_lazy_dag(lazyDag);
+}
+
+ScopedLazyDag::~ScopedLazyDag() {
+  taco_set_lazy_dag(oldLazyDag);
+}
+
+ScopedTempDirectory::ScopedTempDirectory() {
+  char pathTemplate[] = "/tmp/taco_test_XXXXXX";
+  if (mkdtemp(pathTemplate) != nullptr) {
+    path = pathTemplate;
+  }
+}
+
+ScopedTempDirectory::~ScopedTempDirectory() {
+  if (path.empty()) {
+    return;
+  }
+  // Remove the contents before the directories that hold them
+  nftw(path.c_str(), [](const char* file, const struct stat*, int,
+                        struct FTW*) { return remove(file); },
+       16, FTW_DEPTH | FTW_PHYS);
+}
+
+const std::string& ScopedTempDirectory::getPath() const {
+  return path;
+}
+
 ostream& operator<<(ostream& os, const NotationTest& test) {
   os << endl;
   os << "Expected: " << test.expected << endl;
@@ -98,6 +98,57 @@ void ASSERT_COMPONENTS_EQUALS(vector<vector<vector<int>>> expectedIndices,
 // a TacoException with the input string err contained within the body.
 void ASSERT_THROWS_EXCEPTION_WITH_ERROR(std::function<void()> f, std::string err);
 
+/// Sets an environment variable until the guard goes out of scope, which
+/// restores its earlier value, also when an assertion returns early.
+class ScopedEnv {
+public:
+  ScopedEnv(const std::string& name, const std::string& value);
+  ~ScopedEnv();
+
+private:
+  std::string name;
+  bool wasSet;
+  std::string oldValue;
+};
+
+/// Sets the number of threads of taco_set_num_threads until the guard goes
+/// out of scope, which restores the earlier number.
+class ScopedNumThreads {
+public:
+  explicit ScopedNumThreads(int numThreads);
+  ~ScopedNumThreads();
+
+private:
+  int oldNumThreads;
+};
+
+/// Sets whether expressions are evaluated lazily as a DAG with
+/// taco_set_lazy_dag until the guard goes out of scope, which restores the
+/// earlier setting.
+class ScopedLazyDag {
+public:
+  explicit ScopedLazyDag(bool lazyDag);
+  ~ScopedLazyDag();
+
+private:
+  bool oldLazyDag;
+};
+
+/// A new temporary directory that is removed with its contents when the
+/// guard goes out of scope.
+class ScopedTempDirectory {
+public:
+  ScopedTempDirectory();
+  ~ScopedTempDirectory();
+
+  /// Returns the path of the directory, or an empty string if it could not
+  /// be created.
+  const std::string& getPath() const;
+
+private:
+  std::string path;
+};
+
 struct NotationTest {
   NotationTest(IndexStmt actual, IndexStmt expected)
       : actual(actual), expected(expected) {}
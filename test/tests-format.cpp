@@ -5,6 +5,7 @@
 
 #include "taco/tensor.h"
 #include "taco/format.h"
+#include "taco/lower/mode_format_hashed.h"
 #include "taco/index_notation/index_notation.h"
 #include "taco/storage/storage.h"
 #include "taco/util/strings.h"
@@ -72,3 +73,113 @@ TEST(format, dense) {
   A.pack();
   ASSERT_COMPONENTS_EQUALS({{{3}}, {{3}}}, {0,2,0, 0,0,0, 3,0,4}, A);
 }
+
+TEST(format, narrowCompressed) {
+  // Columns far apart in the same row don't fit 8-bit offsets from one base,
+  // so packing picks smaller blocks than for 16-bit offsets.
+  const int n = 60001;
+  std::vector<std::tuple<int,int,double>> components = {
+    std::make_tuple(0, 3, 1.0), std::make_tuple(0, 200, 2.0),
+    std::make_tuple(0, n-1, 3.0), std::make_tuple(2, 5, 4.0),
+    std::make_tuple(2, 6, 5.0), std::make_tuple(3, 0, 6.0),
+    std::make_tuple(3, 40000, 7.0)};
+  Format narrow16({Dense, NarrowCompressed});
+  Format narrow8({Dense, NarrowCompressed});
+  narrow8.setLevelArrayTypes({{Int32}, {Int32, UInt8, Int32}});
+  Tensor<double> expected("expected", {4, n}, CSR);
+  Tensor<double> A16("A16", {4, n}, narrow16);
+  Tensor<double> A8("A8", {4, n}, narrow8);
+  for (auto& component : components) {
+    const int row = std::get<0>(component);
+    const int col = std::get<1>(component);
+    expected.insert({row, col}, std::get<2>(component));
+    A16.insert({row, col}, std::get<2>(component));
+    A8.insert({row, col}, std::get<2>(component));
+  }
+  expected.pack();
+  A16.pack();
+  A8.pack();
+
+  const ModeIndex& index16 = A16.getStorage().getIndex().getModeIndex(1);
+  const ModeIndex& index8 = A8.getStorage().getIndex().getModeIndex(1);
+  ASSERT_EQ(UInt16, index16.getIndexArray(1).getType());
+  ASSERT_EQ(UInt8, index8.getIndexArray(1).getType());
+  ASSERT_LT(index8.getIndexArray(2).get(0).getAsIndex(),
+            index16.getIndexArray(2).get(0).getAsIndex());
+  ASSERT_TRUE(equals(expected, A16));
+  ASSERT_TRUE(equals(expected, A8));
+  ASSERT_EQ(7.0, A8.at({3, 40000}));
+  ASSERT_EQ(0.0, A8.at({3, 40001}));
+
+  IndexVar i, j;
+  Tensor<double> x("x", {n}, Format({Dense}));
+  for (int k = 0; k < n; k++) {
+    x.insert({k}, (double)(k % 7 + 1));
+  }
+  x.pack();
+  Tensor<double> y("y", {4}, Format({Dense}));
+  y(i) = A8(i,j) * x(j);
+  y.evaluate();
+  Tensor<double> yExpected("yExpected", {4}, Format({Dense}));
+  yExpected(i) = expected(i,j) * x(j);
+  yExpected.evaluate();
+  ASSERT_TRUE(equals(yExpected, y));
+}
+
+TEST(format, hashed) {
+  // The rows of a sparse matrix product are scattered into hash tables
+  const int n = 40;
+  Format hashed({Dense, ModeFormat(std::make_shared<HashedModeFormat>(64))});
+  Tensor<double> B("B", {n, n}, CSR);
+  Tensor<double> C("C", {n, n}, CSR);
+  for (int row = 0; row < n; row++) {
+    for (int col = (row * 7) % 5; col < n; col += 5 + row % 3) {
+      B.insert({row, col}, (double)(row + col + 1));
+      C.insert({col, (row * 3) % n}, (double)(row - col));
+    }
+  }
+  B.pack();
+  C.pack();
+
+  IndexVar i, j, k;
+  Tensor<double> A("A", {n, n}, hashed);
+  A(i,j) = B(i,k) * C(k,j);
+  A.compile(A.getAssignment().concretize().reorder({i, k, j}));
+  A.assemble();
+  A.compute();
+  Tensor<double> expected("expected", {n, n}, Format({Dense, Dense}));
+  expected(i,j) = B(i,k) * C(k,j);
+  expected.evaluate();
+  for (int row = 0; row < n; row++) {
+    for (int col = 0; col < n; col++) {
+      ASSERT_EQ(expected.at({row, col}), A.at({row, col}));
+    }
+  }
+
+  // Compressing the hashed level sorts the coordinates of each row
+  Tensor<double> compressed = A.compressHashedLevels();
+  ASSERT_EQ(Compressed, compressed.getFormat().getModeFormats()[1]);
+  ASSERT_TRUE(equals(expected, compressed));
+
+  // Hashed tensors can also be packed and iterated over
+  Tensor<double> H("H", {n, n}, hashed);
+  for (auto& component : B) {
+    H.insert(component.first.toVector(), component.second);
+  }
+  H.pack();
+  ASSERT_TRUE(equals(B, H.compressHashedLevels()));
+  Tensor<double> sum("sum", {n}, Format({Dense}));
+  sum(i) = H(i,j);
+  sum.evaluate();
+  Tensor<double> sumExpected("sumExpected", {n}, Format({Dense}));
+  sumExpected(i) = B(i,j);
+  sumExpected.evaluate();
+  ASSERT_TRUE(equals(sumExpected, sum));
+
+  // Rows of the product don't fit in 4 buckets
+  Format narrow({Dense, ModeFormat(std::make_shared<HashedModeFormat>(4))});
+  Tensor<double> N("N", {n, n}, narrow);
+  N(i,j) = B(i,k) * C(k,j);
+  N.compile(N.getAssignment().concretize().reorder({i, k, j}));
+  ASSERT_THROW({ N.assemble(); N.compute(); }, TacoException);
+}
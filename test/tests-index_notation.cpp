@@ -153,6 +153,24 @@ TEST(notation, isomorphic) {
   ASSERT_FALSE(isomorphic(sum(j, B(i,j) + C(i,j)), sum(j, B(j,i) + C(j,i))));
 }
 
+TEST(notation, canonicalize) {
+  ASSERT_EQ(canonicalize(A(i,j) = B(i,j) + C(i,j)),
+            canonicalize(B(i,j) = C(i,j) + A(i,j)));
+  ASSERT_EQ(canonicalize(forall(i, forall(j, A(i,j) = B(i,j) + C(i,j)))),
+            canonicalize(forall(j, forall(i, A(j,i) = B(j,i) + C(j,i)))));
+  ASSERT_NE(canonicalize(A(i,j) = B(i,j) + C(i,j)),
+            canonicalize(A(i,k) = B(i,k) + C(k,i)));
+  ASSERT_NE(canonicalize(A(i,j) = B(i,j) + C(i,j)),
+            canonicalize(D(i,j) = E(i,j) + F(i,j)));
+  ASSERT_NE(canonicalize(D(i,j) = E(i,j) + F(i,j)),
+            canonicalize(D(i,j) = E(i,j) + G(i,j)));
+  ASSERT_NE(canonicalize(forall(i, forall(j, A(i,j) = B(i,j) + C(i,j),
+                                ParallelUnit::DefaultUnit,
+                                OutputRaceStrategy::NoRaces))),
+            canonicalize(forall(j, forall(i, A(j,i) = B(j,i) + C(j,i)))));
+  ASSERT_NE(canonicalize(a(i) = b(i) * 2.0), canonicalize(a(i) = b(i) * 3.0));
+}
+
 TEST(notation, generatePackCOOStmt) {
   ModeFormat compressedNU = ModeFormat::Compressed(ModeFormat::NOT_UNIQUE);
   ModeFormat singletonNU = ModeFormat::Singleton(ModeFormat::NOT_UNIQUE);
@@ -1,6 +1,13 @@
 #include "test.h"
 
 #include "taco/tensor.h"
+#include "taco/storage/file_io_tns.h"
+#include "taco/storage/file_io_tbin.h"
+#include "taco/util/env.h"
+#include "storage/text_scanner.h"
+
+#include <cstdlib>
+#include <sstream>
 
 using namespace taco;
 
@@ -127,3 +134,77 @@ TEST(io, mtxsymmetric) {
 
   ASSERT_TRUE(equals(expected, tensor));
 }
+
+TEST(io, tns_parallel) {
+  // Large enough to be split into chunks that are scanned in parallel
+  std::stringstream stream;
+  const int n = 300000;
+  for (int k = 0; k < n; k++) {
+    stream << (k % 1000) + 1 << " " << (k / 1000) + 1 << "  " << k << ".25\n";
+    if (k % 50000 == 0) {
+      stream << "# comment\n\n";
+    }
+  }
+  Tensor<double> tensor = readTNS(stream, Format({Sparse, Sparse}));
+  ASSERT_EQ(1000, tensor.getDimension(0));
+  ASSERT_EQ(n / 1000, tensor.getDimension(1));
+  ASSERT_EQ((size_t)n, tensor.getStorage().getIndex().getSize());
+  ASSERT_EQ(1.25, (double)tensor(1, 0));
+  ASSERT_EQ((n-1) + 0.25, (double)tensor(999, n/1000 - 1));
+}
+
+TEST(io, scan_real) {
+  for (std::string number : {"0", "-0.5", "1.1", "307.1", "1e-5", "1.5E+22",
+                             "3.14159265358979323846", "-2.5e-320", "1e400",
+                             "123456789012345678901234567890", "0.000001234",
+                             "inf", "-nan"}) {
+    const char* cursor = number.data();
+    double value;
+    ASSERT_TRUE(scanReal(cursor, number.data() + number.size(), &value));
+    ASSERT_EQ(number.data() + number.size(), cursor);
+    double expected = strtod(number.c_str(), nullptr);
+    if (expected == expected) {
+      ASSERT_EQ(expected, value) << number;
+    } else {
+      ASSERT_NE(value, value) << number;
+    }
+  }
+
+  std::string fortran = "-2.5D+01";
+  const char* cursor = fortran.data();
+  double value;
+  ASSERT_TRUE(scanReal(cursor, fortran.data() + fortran.size(), &value));
+  ASSERT_EQ(-25.0, value);
+}
+
+TEST(io, tbin) {
+  Format dcsr({Sparse, Sparse}, {1, 0});
+  Tensor<double> tensor({5, 10}, dcsr);
+  tensor.insert({0, 1}, 1.0);
+  tensor.insert({4, 9}, 2.0);
+  tensor.insert({3, 1}, 3.0);
+  tensor.pack();
+
+  std::string filename = util::getTmpdir() + "tensor.tbin";
+  write(filename, tensor);
+  TensorBase mapped = read(filename, dcsr);
+  ASSERT_EQ(dcsr, mapped.getFormat());
+  ASSERT_TRUE(equals(tensor, mapped));
+  ASSERT_THROW(read(filename, Format({Dense, Sparse})), TacoException);
+
+  // Writes to a mapped tensor are not written back to the file
+  ((double*)mapped.getStorage().getValues().getData())[0] = 42.0;
+  ASSERT_TRUE(equals(tensor, read(filename, dcsr)));
+
+  std::stringstream stream;
+  writeTBIN(stream, tensor);
+  ASSERT_EQ(0u, stream.str().size() % 64);
+  ASSERT_TRUE(equals(tensor, readTBIN(stream, dcsr)));
+
+  Tensor<int> dense({3, 4, 2}, Dense);
+  dense.insert({2, 3, 1}, 7);
+  dense.insert({0, 1, 0}, 5);
+  dense.pack();
+  writeTBIN(filename, dense);
+  ASSERT_TRUE(equals(dense, readTBIN(filename, Dense)));
+}
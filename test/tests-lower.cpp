@@ -267,6 +267,15 @@ TEST_P(lower, compile) {
       ASSERT_TRUE(kernel(arguments));
       verifyResults(results, arguments, varsFormatted, expected);
     }
+
+    {
+      SCOPED_TRACE("Execution Context\n");
+      ExecutionContext context;
+      context.setNumThreads(2);
+      context.setParallelSchedule(ParallelSchedule::Dynamic, 1);
+      ASSERT_TRUE(kernel(context, arguments));
+      verifyResults(results, arguments, varsFormatted, expected);
+    }
   }
 }
 
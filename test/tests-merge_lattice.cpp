@@ -35,7 +35,8 @@ public:
     return parentSize;
   }
 
-  vector<ir::Expr> getArrays(ir::Expr tensor, int mode, int level) const {
+  vector<ir::Expr> getArrays(ir::Expr tensor, int mode, int level,
+                             const vector<Datatype>& arrayTypes) const {
     return {};
   }
 };
@@ -887,6 +887,80 @@ TEST(scheduling_eval, spmvCPU) {
   ASSERT_TENSOR_EQ(expected, y);
 }
 
+TEST(scheduling_eval, spmvCPU_simd) {
+  if (should_use_CUDA_codegen()) {
+    return;
+  }
+#if defined(__x86_64__)
+  ScopedEnv simd("TACO_SIMD", "sse4");
+
+  int NUM_I = 1021/10;
+  int NUM_J = 1039/10;
+  float SPARSITY = .3;
+  Tensor<double> A("A", {NUM_I, NUM_J}, CSR);
+  Tensor<double> x("x", {NUM_J}, Format({Dense}));
+  Tensor<double> y("y", {NUM_I}, Format({Dense}));
+
+  srand(4321);
+  for (int i = 0; i < NUM_I; i++) {
+    for (int j = 0; j < NUM_J; j++) {
+      float rand_float = (float)rand()/(float)(RAND_MAX);
+      if (rand_float < SPARSITY) {
+        A.insert({i, j}, (double) ((int) (rand_float * 3 / SPARSITY)));
+      }
+    }
+  }
+
+  for (int j = 0; j < NUM_J; j++) {
+    float rand_float = (float)rand()/(float)(RAND_MAX);
+    x.insert({j}, (double) ((int) (rand_float*3/SPARSITY)));
+  }
+
+  x.pack();
+  A.pack();
+
+  // Vector lanes gather x and sum into a vector accumulator
+  IndexVar jpos("jpos"), jpos0("jpos0"), jpos1("jpos1");
+  y(i) = A(i, j) * x(j);
+  IndexStmt stmt = y.getAssignment().concretize();
+  stmt = stmt.pos(j, jpos, A(i, j))
+             .split(jpos, jpos0, jpos1, 8)
+             .parallelize(jpos1, ParallelUnit::CPUVector,
+                          OutputRaceStrategy::ParallelReduction);
+  y.compile(stmt);
+  y.assemble();
+  y.compute();
+  ASSERT_NE(std::string::npos, y.getSource().find("vector_size(16)"));
+
+  Tensor<double> expected("expected", {NUM_I}, Format({Dense}));
+  expected(i) = A(i, j) * x(j);
+  expected.compile();
+  expected.assemble();
+  expected.compute();
+  ASSERT_TENSOR_EQ(expected, y);
+
+  // Vector lanes load and store contiguous components
+  IndexVar i0("i0"), i1("i1");
+  Tensor<double> z("z", {NUM_J}, Format({Dense}));
+  z(i) = x(i) * x(i) - x(i);
+  stmt = z.getAssignment().concretize()
+          .split(i, i0, i1, 4)
+          .parallelize(i1, ParallelUnit::CPUVector,
+                       OutputRaceStrategy::NoRaces);
+  z.compile(stmt);
+  z.assemble();
+  z.compute();
+  ASSERT_NE(std::string::npos, z.getSource().find("vector_size(16)"));
+
+  Tensor<double> expectedZ("expectedZ", {NUM_J}, Format({Dense}));
+  expectedZ(i) = x(i) * x(i) - x(i);
+  expectedZ.compile();
+  expectedZ.assemble();
+  expectedZ.compute();
+  ASSERT_TENSOR_EQ(expectedZ, z);
+#endif
+}
+
 TEST(scheduling_eval, precompute2D) {
   if (should_use_CUDA_codegen()) {
     return;
@@ -391,6 +391,194 @@ TEST(scheduling, lowerSparseAddSparse) {
 }
 
 
+TEST(scheduling, mergebyGallop) {
+  // B is much sparser than A, so most of A is skipped
+  Tensor<double> A("A", {1000}, Format({Sparse}));
+  Tensor<double> B("B", {1000}, Format({Sparse}));
+  Tensor<double> C("C", {1000}, Format({Sparse}));
+
+  for (int i = 0; i < 1000; i++) {
+    if (i % 3 != 0) {
+      A.insert({i}, (double) i);
+    }
+    if (i % 97 == 5) {
+      B.insert({i}, (double) i);
+    }
+  }
+
+  A.pack();
+  B.pack();
+
+  IndexVar i("i");
+  C(i) = A(i) * B(i);
+
+  IndexStmt stmt = C.getAssignment().concretize();
+  stmt = stmt.mergeby(i, MergeStrategy::Gallop);
+
+  C.compile(stmt);
+  C.assemble();
+  C.compute();
+  ASSERT_NE(std::string::npos, C.getSource().find("= taco_gallop("));
+
+  Tensor<double> expected("expected", {1000}, Format({Sparse}));
+  expected(i) = A(i) * B(i);
+  expected.compile();
+  expected.assemble();
+  expected.compute();
+  ASSERT_TENSOR_EQ(expected, C);
+
+  // Unions visit every coordinate, so they keep the two-finger merge
+  Tensor<double> D("D", {1000}, Format({Sparse}));
+  D(i) = A(i) + B(i);
+  stmt = D.getAssignment().concretize();
+  stmt = stmt.mergeby(i, MergeStrategy::Gallop);
+  D.compile(stmt);
+  D.assemble();
+  D.compute();
+  ASSERT_EQ(std::string::npos, D.getSource().find("= taco_gallop("));
+
+  Tensor<double> expectedD("expectedD", {1000}, Format({Sparse}));
+  expectedD(i) = A(i) + B(i);
+  expectedD.compile();
+  expectedD.assemble();
+  expectedD.compute();
+  ASSERT_TENSOR_EQ(expectedD, D);
+}
+
+TEST(scheduling, mergebyGallopTriangles) {
+  // Counts the triangles of a graph by intersecting rows of its adjacency
+  // matrix
+  const int n = 60;
+  Tensor<double> A("A", {n, n}, CSR);
+  Tensor<double> B("B", {n, n}, CSR);
+  Tensor<double> C("C", {n, n}, CSR);
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      if (i != j && (i * 7 + j * 13) % 5 == 0) {
+        A.insert({i, j}, 1.0);
+        B.insert({i, j}, 1.0);
+        C.insert({i, j}, 1.0);
+      }
+    }
+  }
+  A.pack();
+  B.pack();
+  C.pack();
+
+  Tensor<double> triangles("triangles");
+  triangles() = A(i, j) * B(j, k) * C(i, k);
+  IndexStmt stmt = triangles.getAssignment().concretize();
+  stmt = stmt.mergeby(k, MergeStrategy::Gallop);
+  triangles.compile(stmt);
+  triangles.assemble();
+  triangles.compute();
+
+  Tensor<double> expected("expected");
+  expected() = A(i, j) * B(j, k) * C(i, k);
+  expected.compile();
+  expected.assemble();
+  expected.compute();
+  ASSERT_TENSOR_EQ(expected, triangles);
+}
+
+TEST(scheduling, parallelizeMergePath) {
+  if (should_use_CUDA_codegen()) {
+    return;
+  }
+
+  // The first rows hold most of the nonzeros
+  const int n = 200;
+  Tensor<double> A("A", {n, n}, CSR);
+  Tensor<double> x("x", {n}, Format({Dense}));
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j += 1 + i) {
+      A.insert({i, j}, (double) (i + j));
+    }
+    x.insert({i}, (double) i);
+  }
+  A.pack();
+  x.pack();
+
+  Tensor<double> y("y", {n}, Format({Dense}));
+  y(i) = A(i, j) * x(j);
+  IndexStmt stmt = y.getAssignment().concretize();
+  stmt = stmt.parallelize(i, ParallelUnit::CPUThread,
+                          OutputRaceStrategy::NoRaces, LoadBalance::MergePath);
+  y.compile(stmt);
+  y.assemble();
+  y.compute();
+  ASSERT_NE(std::string::npos, y.getSource().find("= taco_mergePathSearch("));
+
+  Tensor<double> expected("expected", {n}, Format({Dense}));
+  expected(i) = A(i, j) * x(j);
+  expected.compile(expected.getAssignment().concretize());
+  expected.assemble();
+  expected.compute();
+  ASSERT_TENSOR_EQ(expected, y);
+
+  // Results over the nonzeros aren't split between threads
+  Tensor<double> B("B", {n, n}, Format({Dense, Dense}));
+  B(i, j) = A(i, j) * x(j);
+  stmt = B.getAssignment().concretize();
+  stmt = stmt.parallelize(i, ParallelUnit::CPUThread,
+                          OutputRaceStrategy::NoRaces, LoadBalance::MergePath);
+  B.compile(stmt);
+  B.assemble();
+  B.compute();
+  ASSERT_NE(std::string::npos, B.getSource().find("= taco_mergePathSearch("));
+
+  Tensor<double> expectedB("expectedB", {n, n}, Format({Dense, Dense}));
+  expectedB(i, j) = A(i, j) * x(j);
+  expectedB.compile(expectedB.getAssignment().concretize());
+  expectedB.assemble();
+  expectedB.compute();
+  ASSERT_TENSOR_EQ(expectedB, B);
+}
+
+TEST(scheduling, parallelizeOuterLoopMergePath) {
+  if (should_use_CUDA_codegen()) {
+    return;
+  }
+
+  const int n = 50;
+  Tensor<double> A("A", {n, n}, CSR);
+  Tensor<double> x("x", {n}, Format({Dense}));
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j += 1 + i) {
+      A.insert({i, j}, (double) (i + j));
+    }
+    x.insert({i}, (double) i);
+  }
+  A.pack();
+  x.pack();
+
+  // Merge path is only chosen for loops that can run on more than one thread
+  {
+    ScopedNumThreads numThreads(1);
+    Tensor<double> y("y", {n}, Format({Dense}));
+    y(i) = A(i, j) * x(j);
+    y.evaluate();
+    ASSERT_EQ(std::string::npos,
+              y.getSource().find("= taco_mergePathSearch("));
+  }
+  {
+    ScopedEnv parallelism("TACO_PARALLELISM", "runtime");
+    ScopedNumThreads numThreads(2);
+    Tensor<double> y("y", {n}, Format({Dense}));
+    y(i) = A(i, j) * x(j);
+    y.evaluate();
+    ASSERT_NE(std::string::npos,
+              y.getSource().find("= taco_mergePathSearch("));
+
+    Tensor<double> expected("expected", {n}, Format({Dense}));
+    expected(i) = A(i, j) * x(j);
+    expected.compile(expected.getAssignment().concretize());
+    expected.assemble();
+    expected.compute();
+    ASSERT_TENSOR_EQ(expected, y);
+  }
+}
+
 TEST(scheduling, lowerSparseMatrixMul) {
   Tensor<double> A("A", {8, 8}, CSR);
   Tensor<double> B("B", {8, 8}, CSC);
@@ -1,13 +1,31 @@
 #include "test.h"
 #include "taco/component.h"
 #include "taco/tensor.h"
+#include "taco/codegen/module.h"
+#include "codegen/module_cache.h"
+#include "codegen/module_tcc.h"
+#include "taco/index_notation/transformations.h"
+#include "taco/lower/lower.h"
+#include "taco/storage/result_allocator.h"
+#include "taco/util/env.h"
+#include "taco/util/task_runtime.h"
 #include "test_tensors.h"
 
+#include <atomic>
+#include <dirent.h>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <numeric>
 #include <sstream>
 #include <string>
 #include <vector>
 #include "taco/util/collections.h"
 
+#if USE_OPENMP
+#include <omp.h>
+#endif
+
 using namespace taco;
 
 TEST(tensor, double_scalar) {
@@ -72,6 +90,115 @@ TEST(tensor, duplicates) {
   }
 }
 
+TEST(tensor, pack_unsorted) {
+  // Large enough to be sorted by several threads, with duplicates
+  Tensor<double> a({1000,1000}, CSR);
+  map<vector<int>,double> vals;
+  unsigned seed = 42;
+  for (int k = 0; k < 150000; k++) {
+    seed = seed * 1103515245u + 12345u;
+    int i = (seed >> 8) % 1000;
+    seed = seed * 1103515245u + 12345u;
+    int j = (seed >> 8) % 1000;
+    a.insert({i,j}, 1.0);
+    vals[{i,j}] += 1.0;
+  }
+  a.pack();
+
+  auto expected = vals.begin();
+  for (auto val = a.beginTyped<int>(); val != a.endTyped<int>(); ++val) {
+    ASSERT_TRUE(expected != vals.end());
+    ASSERT_EQ(expected->first, val->first.toVector());
+    ASSERT_EQ(expected->second, val->second);
+    ++expected;
+  }
+  ASSERT_TRUE(expected == vals.end());
+
+  // Coordinates that do not fit in one 64-bit sort key
+  const int n = 1 << 30;
+  Tensor<double> b({n,n,n}, Format({Sparse,Sparse,Sparse}, {2,0,1}));
+  b.insert({5,n-1,0}, 1.0);
+  b.insert({5,0,n-1}, 2.0);
+  b.insert({0,n-1,n-1}, 3.0);
+  b.insert({5,0,0}, 4.0);
+  b.pack();
+  vector<pair<vector<int>,double>> expectedB = {
+    {{5,0,0}, 4.0}, {{5,n-1,0}, 1.0}, {{0,n-1,n-1}, 3.0}, {{5,0,n-1}, 2.0}
+  };
+  size_t k = 0;
+  for (auto val = b.beginTyped<int>(); val != b.endTyped<int>(); ++val, ++k) {
+    ASSERT_LT(k, expectedB.size());
+    ASSERT_EQ(expectedB[k].first, val->first.toVector());
+    ASSERT_EQ(expectedB[k].second, val->second);
+  }
+  ASSERT_EQ(expectedB.size(), k);
+}
+
+TEST(tensor, insert_coo) {
+  vector<int> rows = {2, 0, 2, 1, 0};
+  vector<int> cols = {1, 3, 1, 0, 0};
+  vector<double> vals = {1.0, 2.0, 3.0, 4.0, 5.0};
+  map<vector<int>,double> expected = {{{0,0}, 5.0}, {{0,3}, 2.0},
+                                      {{1,0}, 4.0}, {{2,1}, 4.0}};
+
+  for (Format format : {CSR, CSC, Format({Sparse,Sparse})}) {
+    Tensor<double> a({3,4}, format);
+    a.insertCOO({makeArray(rows.data(), rows.size()),
+                 makeArray(cols.data(), cols.size())},
+                makeArray(vals.data(), vals.size()));
+    a.pack();
+    map<vector<int>,double> actual;
+    for (auto val = a.beginTyped<int>(); val != a.endTyped<int>(); ++val) {
+      actual[val->first.toVector()] = val->second;
+    }
+    ASSERT_EQ(expected, actual);
+
+    // Bulk components are added to inserted and packed components
+    a.insert({1,1}, 1.0);
+    a.insertCOO({makeArray({0}), makeArray({0})}, makeArray({1.0}), true);
+    a.pack();
+    actual.clear();
+    for (auto val = a.beginTyped<int>(); val != a.endTyped<int>(); ++val) {
+      actual[val->first.toVector()] = val->second;
+    }
+    map<vector<int>,double> expectedSum = expected;
+    expectedSum[{0,0}] += 1.0;
+    expectedSum[{1,1}] = 1.0;
+    ASSERT_EQ(expectedSum, actual);
+  }
+
+  // Sorted components are packed directly from the arrays
+  Tensor<double> b({3,4}, CSR);
+  b.insertCOO({makeArray({0, 0, 1, 2, 2}), makeArray({0, 3, 0, 1, 1})},
+              makeArray({5.0, 2.0, 4.0, 1.0, 3.0}), true);
+  ASSERT_EQ(4.0, (double)b(2,1));
+  ASSERT_EQ(5.0, (double)b(0,0));
+}
+
+TEST(tensor, insert_csr) {
+  Tensor<double> a({3,4}, CSC);
+  a.insertCSR(makeArray({0, 2, 2, 3}), makeArray({1, 3, 0}),
+              makeArray({1.0, 2.0, 3.0}), true);
+  a.pack();
+  Tensor<double> expected({3,4}, CSC);
+  expected.insert({0,1}, 1.0);
+  expected.insert({0,3}, 2.0);
+  expected.insert({2,0}, 3.0);
+  expected.pack();
+  ASSERT_TRUE(equals(expected, a));
+
+  // Positions are checked before the arrays are adopted
+  Tensor<double> b({3,4}, CSR);
+  ASSERT_THROWS_EXCEPTION_WITH_ERROR([&]() {
+    b.insertCSR(makeArray({0, 2, 1, 3}), makeArray({1, 3, 0}),
+                makeArray({1.0, 2.0, 3.0}));
+  }, "row 1");
+  ASSERT_THROWS_EXCEPTION_WITH_ERROR([&]() {
+    b.insertCSR(makeArray({0, 2, 2, 2}), makeArray({1, 3, 0}),
+                makeArray({1.0, 2.0, 3.0}));
+  }, "last position");
+}
+
 TEST(tensor, duplicates_scalar) {
   Tensor<double> a;
   a.insert({}, 1.0);
@@ -494,3 +621,696 @@ TEST(tensor, cache) {
   // ability to answer a request for the first query.
   c(i, j) = a(i, j); c.evaluate();
 }
+
+TEST(tensor, kernel_cache) {
+  ScopedTempDirectory cacheDir;
+  ASSERT_FALSE(cacheDir.getPath().empty());
+  ScopedEnv cacheDirEnv("TACO_KERNEL_CACHE_DIR", cacheDir.getPath());
+
+  IndexVar i("i");
+  TensorVar a("a", Type(Float64, {3}), Dense);
+  TensorVar b("b", Type(Float64, {3}), Dense);
+  IndexStmt stmt = forall(i, a(i) = b(i) * 2.0);
+
+  ir::Module module;
+  module.setCacheKey(canonicalize(stmt));
+  ASSERT_FALSE(module.loadFromCache());
+  module.addFunction(lower(stmt, "compute", false, true));
+  module.compile();
+
+  // An isomorphic statement hits the entry published by the first module
+  ir::Module cached;
+  IndexVar j("j");
+  TensorVar x("x", Type(Float64, {3}), Dense);
+  TensorVar y("y", Type(Float64, {3}), Dense);
+  cached.setCacheKey(canonicalize(forall(j, x(j) = y(j) * 2.0)));
+  ASSERT_TRUE(cached.loadFromCache());
+  ASSERT_NE(nullptr, cached.getFuncPtr("compute"));
+  ASSERT_EQ(module.getSource(), cached.getSource());
+
+  ir::Module uncached;
+  uncached.setCacheKey(canonicalize(forall(i, a(i) = b(i) * 3.0)));
+  ASSERT_FALSE(uncached.loadFromCache());
+}
+
+TEST(tensor, module_cache) {
+  ir::ModuleCache<int> cache([](const int& a, const int& b) { return a == b; });
+
+  // Keys 1 and 3 collide in the same bucket and are told apart by equality
+  auto m1 = std::make_shared<ir::Module>();
+  auto m2 = std::make_shared<ir::Module>();
+  auto m3 = std::make_shared<ir::Module>();
+  cache.insert(0, 1, m1, 4);
+  cache.insert(1, 2, m2, 4);
+  cache.insert(0, 3, m3, 4);
+  ASSERT_EQ(m1, cache.get(0, 1));
+  ASSERT_EQ(m2, cache.get(1, 2));
+  ASSERT_EQ(m3, cache.get(0, 3));
+  ASSERT_EQ(nullptr, cache.get(0, 2));
+  ASSERT_EQ(3u, cache.size());
+
+  // Only modules that are not referenced outside the cache are evicted, least
+  // recently used first
+  m1.reset();
+  m2.reset();
+  cache.get(0, 1);
+  cache.insert(2, 4, std::make_shared<ir::Module>(), 2);
+  ASSERT_EQ(nullptr, cache.get(1, 2));
+  ASSERT_EQ(m3, cache.get(0, 3));
+  ASSERT_EQ(2u, cache.size());
+}
+
+TEST(tensor, kernel_cache_capacity) {
+  size_t capacity = taco_get_kernel_cache_capacity();
+  taco_set_kernel_cache_capacity(1);
+
+  IndexVar i("i");
+  Tensor<double> a("a", {3}, {Dense});
+  Tensor<double> b("b", {3}, {Dense});
+  b(0) = 1.0;
+  b(2) = 2.0;
+  for (double scale : {2.0, 3.0, 2.0}) {
+    a(i) = b(i) * scale;
+    a.evaluate();
+    ASSERT_EQ(scale * 2.0, a.at({2}));
+  }
+
+  taco_set_kernel_cache_capacity(capacity);
+  ASSERT_EQ(capacity, taco_get_kernel_cache_capacity());
+}
+
+/// Returns the number of entries of a directory other than . and ..
+static size_t countDirectoryEntries(const std::string& path) {
+  size_t count = 0;
+  DIR* dir = opendir(path.c_str());
+  if (dir == nullptr) {
+    return count;
+  }
+  while (struct dirent* entry = readdir(dir)) {
+    const std::string name = entry->d_name;
+    count += (name != "." && name != "..");
+  }
+  closedir(dir);
+  return count;
+}
+
+TEST(tensor, inprocess_jit) {
+  if (!ir::TCCCompiler::available()) {
+    std::cout << "Skipping tensor.inprocess_jit: libtcc could not be loaded"
+              << std::endl;
+    return;
+  }
+  ScopedEnv jit("TACO_JIT", "inprocess");
+  const std::string tmpdir = util::getTmpdir();
+  const size_t numEntries = countDirectoryEntries(tmpdir);
+
+  IndexVar i("i");
+  TensorVar a("a", Type(Float64, {3}), Dense);
+  TensorVar b("b", Type(Float64, {3}), Dense);
+  Target target = getTargetFromEnvironment();
+  ASSERT_EQ(Target::InProcess, target.jit);
+  ir::Module module(target);
+  module.addFunction(lower(forall(i, a(i) = b(i) * 2.0), "compute", false, true));
+  ASSERT_EQ("", module.compile());
+  ASSERT_NE(nullptr, module.getFuncPtr("compute"));
+  ASSERT_NE(nullptr, module.getFuncPtr("_shim_compute"));
+
+  // Tensors compile their kernels in-process too
+  Tensor<double> x("x", {3}, Format({Dense}));
+  x.insert({0}, 1.0);
+  x.insert({2}, 3.0);
+  x.pack();
+  Tensor<double> y("y", {3}, Format({Dense}));
+  y(i) = x(i) * 7.5 + 0.25;
+  y.evaluate();
+  ASSERT_EQ(7.75, y.at({0}));
+  ASSERT_EQ(0.25, y.at({1}));
+  ASSERT_EQ(22.75, y.at({2}));
+
+  // No library or source files were written
+  ASSERT_EQ(numEntries, countDirectoryEntries(tmpdir));
+}
+
+TEST(tensor, compile_async) {
+  Tensor<double> b("b", {4}, Format({Dense}));
+  b.insert({0}, 1.0);
+  b.insert({2}, 3.0);
+  b.pack();
+
+  IndexVar i;
+  vector<Tensor<double>> results;
+  vector<shared_future<void>> compiled;
+  for (int k = 1; k <= 4; k++) {
+    Tensor<double> a("a", {4}, Format({Dense}));
+    a(i) = b(i) * (double)k;
+    compiled.push_back(a.compileAsync());
+    results.push_back(a);
+  }
+  // Repeated requests return the pending compilation
+  ASSERT_NO_THROW(results[0].compileAsync().get());
+
+  for (size_t k = 0; k < results.size(); k++) {
+    results[k].evaluate();
+    ASSERT_TRUE(compiled[k].valid());
+    ASSERT_EQ(1.0 * (k+1), (double)results[k](0));
+    ASSERT_EQ(3.0 * (k+1), (double)results[k](2));
+  }
+}
+
+TEST(tensor, compute_out_of_core) {
+  const int m = 200, n = 50;
+  Tensor<double> x("x", {n}, Format({Dense}));
+  Tensor<double> w("w", {m}, Format({Dense}));
+  Tensor<double> B("B", {n, 3}, Format({Dense, Dense}));
+  for (int j = 0; j < n; j++) {
+    x.insert({j}, (double)(j % 7));
+    for (int k = 0; k < 3; k++) {
+      B.insert({j, k}, (double)(j + k));
+    }
+  }
+  for (int i = 0; i < m; i++) {
+    w.insert({i}, (double)(i % 5));
+  }
+  x.pack();
+  w.pack();
+  B.pack();
+
+  IndexVar i, j, k;
+  for (Format format : {CSR, Format({Sparse, Sparse}), Format({Dense, Dense})}) {
+    Tensor<double> A("A", {m, n}, format);
+    for (int r = 0; r < m; r += 3) {
+      for (int c = r % 4; c < n; c += 1 + r % 9) {
+        A.insert({r, c}, (double)(r + c));
+      }
+    }
+    A.pack();
+
+    // Each block computes its own rows of y
+    Tensor<double> y("y", {m}, Format({Dense}));
+    Tensor<double> expectedY("y", {m}, Format({Dense}));
+    y(i) = A(i,j) * x(j);
+    expectedY(i) = A(i,j) * x(j);
+    y.compile();
+    y.computeOutOfCore(256);
+    expectedY.evaluate();
+    ASSERT_TRUE(equals(expectedY, y)) << format;
+
+    // Each block's results are accumulated into z
+    Tensor<double> z("z", {n}, Format({Dense}));
+    Tensor<double> expectedZ("z", {n}, Format({Dense}));
+    z(j) = A(i,j) * w(i);
+    expectedZ(j) = A(i,j) * w(i);
+    z.compile();
+    z.computeOutOfCore(256);
+    expectedZ.evaluate();
+    ASSERT_TRUE(equals(expectedZ, z)) << format;
+
+    Tensor<double> C("C", {m, 3}, Format({Dense, Dense}));
+    Tensor<double> expectedC("C", {m, 3}, Format({Dense, Dense}));
+    C(i,k) = A(i,j) * B(j,k);
+    expectedC(i,k) = A(i,j) * B(j,k);
+    C.compile();
+    C.computeOutOfCore(512);
+    expectedC.evaluate();
+    ASSERT_TRUE(equals(expectedC, C)) << format;
+  }
+}
+
+TEST(tensor, result_arena) {
+  Tensor<double> b("b", {10, 10}, CSR);
+  Tensor<double> c("c", {10, 10}, CSR);
+  for (int k = 0; k < 10; k++) {
+    b.insert({k, k}, 1.0);
+    c.insert({k, 9 - k}, 2.0);
+  }
+  b.pack();
+  c.pack();
+
+  IndexVar i, j;
+  Tensor<double> a("a", {10, 10}, CSR);
+  a.setResultAllocator(std::make_shared<ResultArena>());
+  a(i,j) = b(i,j) + c(i,j);
+  a.evaluate();
+  const void* crd = a.getStorage().getIndex().getModeIndex(1).getIndexArray(1).getData();
+  const void* vals = a.getStorage().getValues().getData();
+
+  // Later results reuse the memory of earlier results
+  for (int k = 0; k < 3; k++) {
+    a(i,j) = b(i,j) + c(i,j);
+    a.evaluate();
+    ASSERT_EQ(crd, a.getStorage().getIndex().getModeIndex(1).getIndexArray(1).getData());
+    ASSERT_EQ(vals, a.getStorage().getValues().getData());
+    ASSERT_EQ(20u, a.getStorage().getIndex().getSize());
+    ASSERT_EQ(3.0, (double)a(5, 5) + (double)a(5, 4));
+  }
+
+  // Results that are still referenced are not reused
+  Array values = a.getStorage().getValues();
+  a(i,j) = b(i,j) * c(i,j);
+  a.evaluate();
+  ASSERT_NE(values.getData(), a.getStorage().getValues().getData());
+  ASSERT_EQ(1.0, ((double*)values.getData())[0]);
+  ASSERT_EQ(0u, a.getStorage().getIndex().getSize());
+}
+
+TEST(tensor, placement) {
+  // Placed arrays start on a page and are zeroed
+  Placement firstTouch(Placement::FirstTouch, 4, {0});
+  Array array = makeArray(Float64, 1 << 20, firstTouch);
+  ASSERT_EQ(0u, (uintptr_t)array.getData() % 4096);
+  ASSERT_EQ(firstTouch, array.getPlacement());
+  ASSERT_EQ(0.0, ((double*)array.getData())[0]);
+  ASSERT_EQ(0.0, ((double*)array.getData())[(1 << 20) - 1]);
+  Array interleaved = makeArray(Int32, 1000, Placement::Interleaved);
+  ASSERT_EQ(0, ((int*)interleaved.getData())[999]);
+
+  // Grown allocations keep their contents
+  PlacedAllocator allocator(firstTouch);
+  int* data = (int*)allocator.allocate(nullptr, 4 * sizeof(int), false);
+  std::iota(data, data + 4, 1);
+  data = (int*)allocator.allocate(data, 1 << 22, false);
+  ASSERT_EQ(0u, (uintptr_t)data % 4096);
+  ASSERT_EQ(4, data[3]);
+  allocator.deallocate(data);
+
+  // Packed arrays and results of tensors are placed
+  Tensor<double> B("B", {100, 100}, CSR);
+  Tensor<double> x("x", {100}, Format({Dense}));
+  B.setPlacement(firstTouch);
+  for (int i = 0; i < 100; i++) {
+    B.insert({i, (i * 7) % 100}, (double)i);
+    x.insert({i}, 2.0);
+  }
+  B.pack();
+  x.pack();
+  ASSERT_EQ(firstTouch, B.getStorage().getValues().getPlacement());
+  ASSERT_EQ(firstTouch,
+            B.getStorage().getIndex().getModeIndex(1).getIndexArray(1)
+             .getPlacement());
+
+  IndexVar i, j;
+  Tensor<double> y("y", {100}, Format({Dense}));
+  y.setPlacement(Placement::Interleaved);
+  y(i) = B(i,j) * x(j);
+  y.evaluate();
+  ASSERT_EQ(0u, (uintptr_t)y.getStorage().getValues().getData() % 4096);
+  for (int k = 0; k < 100; k++) {
+    ASSERT_EQ(2.0 * k, (double)y(k));
+  }
+}
+
+TEST(tensor, evaluate_fused) {
+  Tensor<double> A("A", {50, 40}, CSR);
+  Tensor<double> x("x", {40}, Format({Dense}));
+  Tensor<double> b("b", {50}, Format({Dense}));
+  for (int k = 0; k < 50; k++) {
+    A.insert({k, (k * 3) % 40}, (double)k);
+    A.insert({k, (k * 7 + 1) % 40}, 1.0);
+    b.insert({k}, (double)(k % 5));
+  }
+  for (int k = 0; k < 40; k++) {
+    x.insert({k}, (double)(k % 3));
+  }
+  A.pack();
+  x.pack();
+  b.pack();
+
+  IndexVar i, j;
+  Tensor<double> expectedY("expectedY", {50}, Format({Dense}));
+  Tensor<double> expectedZ("expectedZ", {50}, Format({Dense}));
+  expectedY(i) = A(i,j) * x(j) + b(i);
+  expectedY.evaluate();
+  expectedZ(i) = expectedY(i) * expectedY(i);
+  expectedZ.evaluate();
+
+  // The intermediates are computed in the loop over the rows of A
+  Tensor<double> t("t", {50}, Format({Dense}));
+  Tensor<double> y("y", {50}, Format({Dense}));
+  Tensor<double> z("z", {50}, Format({Dense}));
+  t(i) = A(i,j) * x(j);
+  y(i) = t(i) + b(i);
+  z(i) = y(i) * y(i);
+  evaluateFused({z});
+  ASSERT_TRUE(equals(expectedZ, z));
+  ASSERT_TRUE(y.needsCompute());
+  ASSERT_TRUE(equals(expectedY, y));
+
+  // Results that are read by other results are assigned on the way
+  Tensor<double> y2("y2", {50}, Format({Dense}));
+  Tensor<double> z2("z2", {50}, Format({Dense}));
+  y2(i) = A(i,j) * x(j) + b(i);
+  z2(i) = y2(i) * y2(i);
+  evaluateFused({y2, z2});
+  ASSERT_FALSE(y2.needsCompute());
+  ASSERT_TRUE(equals(expectedY, y2));
+  ASSERT_TRUE(equals(expectedZ, z2));
+
+  // Also when they are read by intermediates
+  Tensor<double> t3("t3", {50}, Format({Dense}));
+  Tensor<double> y3("y3", {50}, Format({Dense}));
+  Tensor<double> z3("z3", {50}, Format({Dense}));
+  t3(i) = A(i,j) * x(j) + b(i);
+  y3(i) = t3(i) * 1.0;
+  z3(i) = y3(i) * y3(i);
+  evaluateFused({t3, z3});
+  ASSERT_FALSE(t3.needsCompute());
+  ASSERT_TRUE(equals(expectedY, t3));
+  ASSERT_TRUE(equals(expectedZ, z3));
+
+  // Tensors that a reader reduces over are computed once into temporaries
+  Tensor<double> B("B", {30, 50}, Format({Dense, Dense}));
+  for (int k = 0; k < 30; k++) {
+    B.insert({k, (k * 11) % 50}, (double)(k % 4));
+    B.insert({k, k}, 1.0);
+  }
+  B.pack();
+  IndexVar k;
+  Tensor<double> expectedT("expectedT", {50}, Format({Dense}));
+  Tensor<double> expectedW("expectedW", {30}, Format({Dense}));
+  expectedT(i) = A(i,j) * x(j);
+  expectedT.evaluate();
+  expectedW(k) = B(k,i) * expectedT(i);
+  expectedW.evaluate();
+  Tensor<double> t4("t4", {50}, Format({Dense}));
+  Tensor<double> w4("w4", {30}, Format({Dense}));
+  t4(i) = A(i,j) * x(j);
+  w4(k) = B(k,i) * t4(i);
+  IndexStmt fused = fuse({t4.getAssignment(), w4.getAssignment()},
+                         {w4.getTensorVar()});
+  ASSERT_TRUE(isa<Where>(fused));
+  ASSERT_EQ(1, to<Where>(fused).getTemporary().getOrder());
+  evaluateFused({w4});
+  ASSERT_TRUE(equals(expectedW, w4));
+
+  // Results are assigned from their temporary
+  Tensor<double> t5("t5", {50}, Format({Dense}));
+  Tensor<double> w5("w5", {30}, Format({Dense}));
+  t5(i) = A(i,j) * x(j);
+  w5(k) = B(k,i) * t5(i);
+  evaluateFused({t5, w5});
+  ASSERT_FALSE(t5.needsCompute());
+  ASSERT_TRUE(equals(expectedT, t5));
+  ASSERT_TRUE(equals(expectedW, w5));
+}
+
+TEST(tensor, lazy_dag) {
+  Tensor<double> B("B", {20, 30}, CSR);
+  Tensor<double> C("C", {30, 10}, Format({Dense, Dense}));
+  Tensor<double> D("D", {20, 10}, Format({Dense, Dense}));
+  for (int k = 0; k < 20; k++) {
+    B.insert({k, (k * 7) % 30}, (double)k);
+    B.insert({k, (k * 3 + 1) % 30}, 2.0);
+  }
+  for (int k = 0; k < 30; k++) {
+    C.insert({k, k % 10}, (double)(k % 4));
+  }
+  for (int k = 0; k < 20; k++) {
+    D.insert({k, k % 10}, 1.0);
+  }
+  B.pack();
+  C.pack();
+  D.pack();
+
+  IndexVar i, j, k, a, b, c;
+  Tensor<double> expectedP("expectedP", {20, 10}, Format({Dense, Dense}));
+  Tensor<double> expectedX("expectedX", {20, 10}, Format({Dense, Dense}));
+  Tensor<double> expectedY("expectedY", {20, 10}, Format({Dense, Dense}));
+  expectedP(i,k) = B(i,j) * C(j,k);
+  expectedX(i,k) = B(i,j) * C(j,k) + D(i,k);
+  expectedY(i,k) = B(i,j) * C(j,k) - D(i,k);
+  expectedP.evaluate();
+  expectedX.evaluate();
+  expectedY.evaluate();
+
+  ScopedLazyDag lazyDag(true);
+
+  // The product is computed by a temporary that the sum and difference read
+  Tensor<double> X("X", {20, 10}, Format({Dense, Dense}));
+  Tensor<double> Y("Y", {20, 10}, Format({Dense, Dense}));
+  X(i,k) = B(i,j) * C(j,k) + D(i,k);
+  Y(a,b) = B(a,c) * C(c,b) - D(a,b);
+  ASSERT_TRUE(equals(expectedX, X));
+  ASSERT_FALSE(Y.needsCompute());
+  ASSERT_TRUE(equals(expectedY, Y));
+  ASSERT_FALSE(util::contains(getArguments(makeConcreteNotation(
+      Y.getAssignment())), B.getTensorVar()));
+
+  // Tensors whose expression is the product compute it for the others
+  Tensor<double> P("P", {20, 10}, Format({Dense, Dense}));
+  Tensor<double> X2("X2", {20, 10}, Format({Dense, Dense}));
+  P(i,k) = B(i,j) * C(j,k);
+  X2(i,k) = B(i,j) * C(j,k) + D(i,k);
+  ASSERT_TRUE(equals(expectedX, X2));
+  ASSERT_TRUE(equals(expectedP, P));
+  ASSERT_TRUE(util::contains(getArguments(makeConcreteNotation(
+      X2.getAssignment())), P.getTensorVar()));
+
+  // Temporaries have the format of the tensors that read them
+  Tensor<double> X3("X3", {20, 10}, CSR);
+  Tensor<double> Y3("Y3", {20, 10}, CSR);
+  X3(i,k) = B(i,j) * C(j,k) + D(i,k);
+  Y3(i,k) = B(i,j) * C(j,k) - D(i,k);
+  ASSERT_TRUE(equals(expectedX, X3));
+  ASSERT_TRUE(equals(expectedY, Y3));
+  ASSERT_FALSE(util::contains(getArguments(makeConcreteNotation(
+      Y3.getAssignment())), B.getTensorVar()));
+  for (auto& argument : getArguments(makeConcreteNotation(
+           Y3.getAssignment()))) {
+    ASSERT_TRUE(argument == D.getTensorVar() || argument.getFormat() == CSR);
+  }
+}
+
+TEST(tensor, bound_kernel) {
+  Tensor<double> A("A", {3, 3}, CSR);
+  Tensor<double> x("x", {3}, Format({Dense}));
+  A.insert({0, 0}, 1.0);
+  A.insert({1, 2}, 2.0);
+  A.insert({2, 1}, 3.0);
+  A.pack();
+  for (int k = 0; k < 3; k++) {
+    x.insert({k}, 1.0);
+  }
+  x.pack();
+
+  IndexVar i, j;
+  Tensor<double> y("y", {3}, Format({Dense}));
+  y(i) = A(i,j) * x(j);
+  BoundKernel kernel = y.bind();
+  kernel.evaluate();
+  ASSERT_EQ(2.0, (double)y(1));
+
+  // Values changed in place are used by the next call
+  ((double*)x.getStorage().getValues().getData())[2] = 5.0;
+  kernel.compute();
+  ASSERT_EQ(10.0, (double)y(1));
+
+  // Replaced storage is rebound
+  A.insert({1, 1}, 1.0);
+  A.pack();
+  kernel.compute();
+  ASSERT_EQ(11.0, (double)y(1));
+
+#if USE_OPENMP
+  // The calling thread's OpenMP settings are restored after calls
+  omp_set_num_threads(3);
+  {
+    ScopedNumThreads numThreads(2);
+    kernel.compute();
+  }
+  ASSERT_EQ(3, omp_get_max_threads());
+#endif
+
+  // Results with an index are assembled
+  Tensor<double> C("C", {3, 3}, CSR);
+  C.insert({0, 2}, 1.0);
+  C.insert({1, 1}, 1.0);
+  C.pack();
+  Tensor<double> B("B", {3, 3}, CSR);
+  B(i,j) = A(i,j) + C(i,j);
+  BoundKernel assembled = B.bind();
+  assembled.evaluate();
+  ASSERT_EQ(5u, B.getStorage().getIndex().getSize());
+  ASSERT_EQ(2.0, (double)B(1, 1));
+  ASSERT_EQ(1.0, (double)B(0, 2));
+  ASSERT_THROW(BoundKernel().compute(), TacoException);
+}
+
+TEST(tensor, task_runtime) {
+  // Nested loops run on the workers of the enclosing loop
+  util::TaskRuntime runtime(4);
+  std::atomic<int64_t> sum(0);
+  struct Closure {
+    util::TaskRuntime* runtime;
+    std::atomic<int64_t>* sum;
+  } closure = {&runtime, &sum};
+  runtime.parallelFor(0, 100, 0,
+      [](taco_runtime_t* rt, void* c, int64_t begin, int64_t end, int32_t) {
+        for (int64_t i = begin; i < end; i++) {
+          rt->parallel_for(rt, 0, i, 1,
+              [](taco_runtime_t*, void* c, int64_t begin, int64_t end,
+                 int32_t worker) {
+                ((Closure*)c)->sum->fetch_add(end - begin);
+              }, c);
+        }
+      }, &closure);
+  ASSERT_EQ(99 * 100 / 2, sum.load());
+
+  if (should_use_CUDA_codegen()) {
+    return;
+  }
+  ScopedEnv parallelism("TACO_PARALLELISM", "runtime");
+  ScopedNumThreads numThreads(4);
+
+  Tensor<double> A("A", {50, 40}, CSR);
+  Tensor<double> x("x", {50}, Format({Dense}));
+  for (int i = 0; i < 50; i++) {
+    for (int j = i % 3; j < 40; j += 1 + i % 7) {
+      A.insert({i, j}, (double)(i + j));
+    }
+    x.insert({i}, (double)(i % 5));
+  }
+  A.pack();
+  x.pack();
+
+  // Scatters through the columns need atomic updates
+  IndexVar i, j;
+  Tensor<double> y("y", {40}, Format({Dense}));
+  y(j) = A(i,j) * x(i);
+  IndexStmt stmt = y.getAssignment().concretize();
+  y.compile(stmt.reorder({i,j}).parallelize(i, ParallelUnit::CPUThread,
+                                            OutputRaceStrategy::Atomics));
+  y.evaluate();
+  ASSERT_NE(std::string::npos, y.getSource().find("->parallel_for("));
+  ASSERT_NE(std::string::npos, y.getSource().find("__atomic_compare_exchange("));
+
+  Tensor<double> z("z", {50}, Format({Dense}));
+  z(i) = A(i,j) * x(i);
+  BoundKernel kernel = z.bind();
+  kernel.evaluate();
+
+  Tensor<double> expectedY("expectedY", {40}, Format({Dense}));
+  expectedY(j) = A(i,j) * x(i);
+  expectedY.evaluate();
+  ASSERT_TENSOR_EQ(expectedY, y);
+  Tensor<double> expectedZ("expectedZ", {50}, Format({Dense}));
+  expectedZ(i) = A(i,j) * x(i);
+  expectedZ.evaluate();
+  ASSERT_TENSOR_EQ(expectedZ, z);
+}
+
+TEST(tensor, execution_context) {
+  if (should_use_CUDA_codegen()) {
+    return;
+  }
+  // Counts the workspaces that kernels allocate
+  struct CountingAllocator : public ResultAllocator {
+    std::atomic<int> allocations{0};
+    void* allocate(void* data, size_t size, bool clear) {
+      allocations++;
+      return clear ? calloc(1, size) : realloc(data, size);
+    }
+    void deallocate(void* data) {
+      free(data);
+    }
+  };
+  auto allocator = std::make_shared<CountingAllocator>();
+  ExecutionContext context;
+  context.setNumThreads(3);
+  context.setParallelSchedule(ParallelSchedule::Dynamic, 2);
+  context.setScratchAllocator(allocator);
+  int numThreads = taco_get_num_threads();
+
+  Tensor<double> B("B", {20, 30}, CSR);
+  Tensor<double> C("C", {30, 25}, CSR);
+  for (int i = 0; i < 20; i++) {
+    for (int k = i % 4; k < 30; k += 3 + i % 5) {
+      B.insert({i, k}, (double)(i + k));
+    }
+  }
+  for (int k = 0; k < 30; k++) {
+    for (int j = k % 3; j < 25; j += 2 + k % 7) {
+      C.insert({k, j}, (double)(k - j));
+    }
+  }
+  B.pack();
+  C.pack();
+
+  IndexVar i, j, k;
+  Tensor<double> expected("expected", {20, 25}, CSR);
+  expected(i,j) = B(i,k) * C(k,j);
+  expected.evaluate();
+
+  // The context's settings apply to its calls only
+  Tensor<double> A("A", {20, 25}, CSR);
+  A(i,j) = B(i,k) * C(k,j);
+  A.evaluate(context);
+  ASSERT_TENSOR_EQ(expected, A);
+  ASSERT_EQ(numThreads, taco_get_num_threads());
+
+  // Kernels for the task runtime allocate workspaces with the context's
+  // allocator
+  Tensor<double> D("D", {20, 25}, CSR);
+  D(i,j) = B(i,k) * C(k,j);
+  {
+    ScopedEnv parallelism("TACO_PARALLELISM", "runtime");
+    D.compile();
+  }
+  D.assemble(context);
+  D.compute(context);
+  ASSERT_TENSOR_EQ(expected, D);
+  ASSERT_LT(0, allocator->allocations.load());
+  ASSERT_EQ(3, context.getRuntime()->num_workers);
+  ASSERT_EQ(2, context.getRuntime()->grain);
+}
+
+TEST(tensor, locate) {
+  const std::vector<Format> formats = {
+      Format({Dense, Dense, Dense}), Format({Dense, Sparse, Sparse}),
+      Format({Sparse, Sparse, Sparse}, {2, 0, 1}), COO(3),
+      Format({Sparse, Dense, Sparse})};
+  std::map<std::vector<int>, double> components;
+  srand(12);
+  for (int k = 0; k < 60; k++) {
+    components[{rand() % 5, rand() % 7, rand() % 6}] = k + 1;
+  }
+
+  std::vector<int> crd0, crd1, crd2;
+  for (int i = 0; i < 5; i++) {
+    for (int j = 0; j < 7; j++) {
+      for (int k = 0; k < 6; k++) {
+        crd0.push_back((i * 3) % 5);
+        crd1.push_back(j);
+        crd2.push_back((k * 5) % 6);
+      }
+    }
+  }
+  crd0.push_back(5);
+  crd1.push_back(-1);
+  crd2.push_back(0);
+
+  for (const Format& format : formats) {
+    Tensor<double> A({5, 7, 6}, format);
+    for (auto& component : components) {
+      A.insert(component.first, component.second);
+    }
+    A.pack();
+
+    ASSERT_EQ(0.0, A.at({1, 8, 0}));
+    for (size_t n = 0; n + 1 < crd0.size(); n++) {
+      std::vector<int> coordinate = {crd0[n], crd1[n], crd2[n]};
+      double expected = components.count(coordinate) ?
+                        components[coordinate] : 0.0;
+      ASSERT_EQ(expected, A.at(coordinate)) << format;
+    }
+
+    Array values = A.gather({makeArray(crd0), makeArray(crd1),
+                             makeArray(crd2)});
+    ASSERT_EQ(crd0.size(), values.getSize());
+    for (size_t n = 0; n < crd0.size(); n++) {
+      std::vector<int> coordinate = {crd0[n], crd1[n], crd2[n]};
+      double expected = components.count(coordinate) ?
+                        components[coordinate] : 0.0;
+      ASSERT_EQ(expected, ((double*)values.getData())[n]) << format;
+    }
+  }
+}
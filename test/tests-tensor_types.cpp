@@ -421,3 +421,51 @@ TEST(DISABLED_tensor_types, coordinate_types) {
   }
 
 }
+
+TEST(tensor_types, int64_indices) {
+  Format csr64 = CSR;
+  csr64.setIndexType(Int64);
+  ASSERT_EQ(Int64, csr64.getIndexType());
+  ASSERT_EQ(Int32, CSR.getIndexType());
+  ASSERT_NE(CSR, csr64);
+
+  Tensor<double> A("A", {3, 4}, csr64);
+  Tensor<double> B("B", {3, 4}, csr64);
+  A.insert({0, 1}, 1.0);
+  A.insert({2, 0}, 2.0);
+  A.insert({2, 3}, 3.0);
+  B.insert({0, 1}, 4.0);
+  B.insert({1, 2}, 5.0);
+  A.pack();
+  B.pack();
+  const ModeIndex& modeIndex = A.getStorage().getIndex().getModeIndex(1);
+  ASSERT_EQ(Int64, modeIndex.getIndexArray(0).getType());
+  ASSERT_EQ(Int64, modeIndex.getIndexArray(1).getType());
+  ASSERT_EQ(3.0, A.at({2, 3}));
+  ASSERT_EQ(0.0, A.at({1, 3}));
+
+  Tensor<double> x("x", {4}, Format({Dense}));
+  for (int j = 0; j < 4; j++) {
+    x.insert({j}, (double)(j + 1));
+  }
+  x.pack();
+  Tensor<double> y("y", {3}, Format({Dense}));
+  y(i) = A(i,j) * x(j);
+  y.evaluate();
+  ASSERT_EQ(2.0, y.at({0}));
+  ASSERT_EQ(0.0, y.at({1}));
+  ASSERT_EQ(14.0, y.at({2}));
+
+  Tensor<double> C("C", {3, 4}, csr64);
+  C(i,j) = A(i,j) + B(i,j);
+  C.evaluate();
+  ASSERT_EQ(Int64, C.getStorage().getIndex().getModeIndex(1)
+                    .getIndexArray(1).getType());
+  Tensor<double> expected("expected", {3, 4}, CSR);
+  expected.insert({0, 1}, 5.0);
+  expected.insert({1, 2}, 5.0);
+  expected.insert({2, 0}, 2.0);
+  expected.insert({2, 3}, 3.0);
+  expected.pack();
+  ASSERT_TRUE(equals(expected, C));
+}
@@ -257,14 +257,17 @@ static void printSchedulingHelp() {
               "index variable `i` by `factor` number of iterations, where "
               "`factor` is a positive integer.");
     cout << endl;
-    printFlag("s=parallelize(i, u, strat)", "tags an index variable `i` for "
+    printFlag("s=parallelize(i, u, strat[, balance])", "tags an index variable `i` for "
               "parallel execution on hardware type `u`. Data races are handled by "
               "an output race strategy `strat`. Since the other transformations "
               "expect serial code, parallelize must come last in a series of "
               "transformations.  Possible parallel hardware units are: "
               "NotParallel, GPUBlock, GPUWarp, GPUThread, CPUThread, CPUVector. "
               "Possible output race strategies are: "
-              "IgnoreRaces, NoRaces, Atomics, Temporary, ParallelReduction.");
+              "IgnoreRaces, NoRaces, Atomics, Temporary, ParallelReduction. "
+              "CPU threads share the loop by its iterations or, with the "
+              "MergePath balance, by equal shares of the rows and nonzeros "
+              "of a compressed level below it.");
 }
 
 static void printVersionInfo() {
@@ -533,11 +536,16 @@ static bool setSchedulingCommands(vector<vector<string>> scheduleCommands, parse
       stmt = stmt.unroll(findVar(i), unrollFactor);
 
     } else if (command == "parallelize") {
-      string i, unit, strategy;
-      taco_uassert(scheduleCommand.size() == 3) << "'parallelize' scheduling directive takes 3 parameters: parallelize(i, unit, strategy)";
+      string i, unit, strategy, balance = "Iterations";
+      taco_uassert(scheduleCommand.size() == 3 || scheduleCommand.size() == 4)
+          << "'parallelize' scheduling directive takes 3 or 4 parameters: "
+          << "parallelize(i, unit, strategy [, balance])";
       i        = scheduleCommand[0];
       unit     = scheduleCommand[1];
       strategy = scheduleCommand[2];
+      if (scheduleCommand.size() == 4) {
+        balance = scheduleCommand[3];
+      }
 
       ParallelUnit parallel_unit;
       if (unit == "NotParallel") {
@@ -576,7 +584,18 @@ static bool setSchedulingCommands(vector<vector<string>> scheduleCommands, parse
         goto end;
       }
 
-      stmt = stmt.parallelize(findVar(i), parallel_unit, output_race_strategy);
+      LoadBalance load_balance;
+      if (balance == "Iterations") {
+        load_balance = LoadBalance::Iterations;
+      } else if (balance == "MergePath") {
+        load_balance = LoadBalance::MergePath;
+      } else {
+        taco_uerror << "Load balance not defined.";
+        goto end;
+      }
+
+      stmt = stmt.parallelize(findVar(i), parallel_unit, output_race_strategy,
+                              load_balance);
 
     } else if (command == "assemble") {
       taco_uassert(scheduleCommand.size() == 2 || scheduleCommand.size() == 3) 